@@ -35,7 +35,7 @@
  *   7.  Achieved - Support drive motor control using Roboteq SBL2360 (without mixing).
  *   8.  Achieved - Support dome motor control using a Syren 10.
  *   9   Testing  - Support radio communication with dome electroncis instead of a slip ring.
- *   10. Future   - Support drive motor control using Sabertooth.
+ *   10. Testing  - Support drive motor control using Sabertooth.
  *   11. Future   - Support drive motor control using Roboteq SBL1360 (with mixing).
  *   12. Future   - Support I2C-based FX system to replace Marcduino body master.
  *
@@ -77,35 +77,102 @@
  */
 #include "Settings.h"
 #include "src/toolbox/DebugUtils.h"
+#include "src/config/Config.h"
 #include "src/controller/Controller.h"
 #include "src/domeMotor/DomeMotor.h"
 #include "src/driveMotor/DriveMotor.h"
 #include "src/marcduino/Marcduino.h"
+#include "src/scheduler/Scheduler.h"
+#include "src/scheduler/Timeline.h"
+#include "src/hal/SerialQueue.h"
+#include "src/hal/MotorBus.h"
+#include "src/console/Console.h"
 
-#if defined(PS3_NAVIGATION)
-Controller_PS3Nav controller(controllerSettings, controllerTimings);
+// Every settings array in Settings.h is read through a section of the config.
+// Declare them all here, ahead of anything that reads a setting, in an order
+// that does not change. Saved settings are laid out in this order.
+
+#define CONFIG_SECTION(name, defaults) Config_Section name(&config, defaults, sizeof(defaults) / sizeof(defaults[0]))
+
+Config config(CONFIG_VERSION);
+CONFIG_SECTION(cfgController, controllerSettings);
+CONFIG_SECTION(cfgControllerTimings, controllerTimings);
+CONFIG_SECTION(cfgScheduler, schedulerTimings);
+CONFIG_SECTION(cfgDrive, driveMotorSettings);
+CONFIG_SECTION(cfgDriveMotion, driveMotionSettings);
+CONFIG_SECTION(cfgDrivePins, driveMotorPins);
+CONFIG_SECTION(cfgRoboteq, roboteqSettings);
+CONFIG_SECTION(cfgSabertooth, sabertoothSettings);
+CONFIG_SECTION(cfgDome, domeMotorSettings);
+CONFIG_SECTION(cfgDomeTimings, domeMotorTimings);
+CONFIG_SECTION(cfgDomePosition, domePositionSettings);
+CONFIG_SECTION(cfgSyren, syrenSettings);
+CONFIG_SECTION(cfgMarcduino, marcduinoSettings);
+
+#if !defined(ARDUINO)
+Controller_Script controller(&cfgController, &cfgControllerTimings);   // Host build: input comes from a script.
+#elif defined(PS3_NAVIGATION)
+Controller_PS3Nav controller(&cfgController, &cfgControllerTimings);
 Controller_PS3Nav* Controller_PS3Nav::anchor = { NULL };
 #elif defined(PS3_CONTROLLER)
-Controller_PS3 controller(controllerSettings, controllerTimings);
+Controller_PS3 controller(&cfgController, &cfgControllerTimings);
 Controller_PS3* Controller_PS3::anchor = { NULL };
 #elif defined(PS4_CONTROLLER)
-Controller_PS4 controller(controllerSettings, controllerTimings, pair);
+Controller_PS4 controller(&cfgController, &cfgControllerTimings, pair);
 Controller_PS4* Controller_PS4::anchor = { NULL };
 #elif defined(PS5_CONTROLLER)
-Controller_PS5 controller(controllerSettings, controllerTimings, pair);
+Controller_PS5 controller(&cfgController, &cfgControllerTimings, pair);
 Controller_PS5* Controller_PS5::anchor = { NULL };
 #endif
 
-DomeMotor_Syren10 domeMotor(&controller, domeMotorSettings, domeMotorTimings, syrenSettings);
-DriveMotor_Roboteq driveMotor(&controller, driveMotorSettings, driveMotorPins, roboteqSettings);
-Marcduino marcduino(&controller, marcduinoSettings);
+DomeMotor_Syren10 domeMotor(&controller, &cfgDome, &cfgDomeTimings, &cfgDomePosition, &cfgSyren);
+#if defined(SABERTOOTH_DRIVE)
+DriveMotor_Sabertooth driveMotor(&controller, &cfgDrive, &cfgDrivePins, &cfgDriveMotion, &cfgSabertooth);
+#else
+DriveMotor_Roboteq driveMotor(&controller, &cfgDrive, &cfgDrivePins, &cfgDriveMotion, &cfgRoboteq);
+#endif
+Timeline_Event_Struct timelineEvents[TIMELINE_DEPTH];
+Timeline timeline(timelineEvents, TIMELINE_DEPTH);
+
+Marcduino marcduino(&controller, &cfgMarcduino, &timeline);
+Scheduler scheduler(&controller, &cfgScheduler);
+
+#if defined(SERIAL_CONSOLE)
+// Console names for the config sections above, in the same order.
+const char consoleSections[] PROGMEM = "controller controllerTimings scheduler drive driveMotion drivePins roboteq sabertooth dome domeTimings domePosition syren marcduino";
+Console console(Serial, &config, consoleSections);
+#endif
+
+// Scheduled tasks and disconnect handlers, defined after loop().
 
-// Rearrange the Serial configurations to fit your electronics.
+void driveTask(const Input_Frame_Struct* frame);
+void domeTask(const Input_Frame_Struct* frame);
+void marcduinoTask(const Input_Frame_Struct* frame);
+void driveDisconnect(void);
+void domeDisconnect(void);
+void domeCue(byte action, byte arg1, byte arg2);
+void domeRoutine(byte routineNumber);
+void marcduinoDisconnect(void);
+void consoleSend(const char* command, byte location);
+void consoleAction(byte action, byte arg1, byte arg2);
+void consoleChange(const Config_Section* section, byte index);
 
-HardwareSerial &MD_Body_Serial    = Serial3;
-HardwareSerial &DomeMotor_Serial  = Serial2;  // Connects to Syren10.
-HardwareSerial &DriveMotor_Serial = Serial2;  // Daisy chain Syren10 to Sabertooth. Roboteq RS232/Serial is not yet supported.
-HardwareSerial &MD_Dome_Serial    = Serial1;
+// Rearrange the Serial configurations to fit your electronics. Each port gets
+// one outbound queue. The Syren10 and Sabertooth share a motor bus that puts
+// stop packets first and merges repeated speed updates.
+
+byte mdBodyBuffer[MD_BODY_QUEUE_DEPTH];
+byte motorBuffer[MOTOR_QUEUE_DEPTH];
+byte mdDomeBuffer[MD_DOME_QUEUE_DEPTH];
+
+SerialQueue mdBodyQueue(Serial3, mdBodyBuffer, MD_BODY_QUEUE_DEPTH);
+MotorBus motorBus(Serial2, motorBuffer, MOTOR_QUEUE_DEPTH);
+SerialQueue mdDomeQueue(Serial1, mdDomeBuffer, MD_DOME_QUEUE_DEPTH);
+
+SerialQueue &MD_Body_Serial    = mdBodyQueue;
+SerialQueue &DomeMotor_Serial  = motorBus;  // Connects to Syren10.
+SerialQueue &DriveMotor_Serial = motorBus;  // Daisy chain Syren10 to Sabertooth, or connect a Roboteq in RS232 mode.
+SerialQueue &MD_Dome_Serial    = mdDomeQueue;
 
 
 /* ============================================================
@@ -118,7 +185,7 @@ void setup() {
   // Start the serial monitor.
   // -------------------------
 
-  #if defined(DEBUG) || defined(TEST_CONTROLLER)
+  #if defined(DEBUG) || defined(TEST_CONTROLLER) || defined(SERIAL_CONSOLE)
   Serial.begin(115200);
   #if !defined(__MIPSEL__)
   while (!Serial);
@@ -146,6 +213,43 @@ void setup() {
   domeMotor.begin();
   marcduino.begin();
 
+  // ----------------------------------------------------
+  // Register the peripherals with the scheduler. The
+  // controller is read once per pass and each peripheral
+  // runs at its own rate from that single input frame.
+  // ----------------------------------------------------
+
+  scheduler.addTask(driveTask, cfgScheduler.get(iDriveTask), "Drive");
+  scheduler.addTask(domeTask, cfgScheduler.get(iDomeTask), "Dome");
+  scheduler.addTask(marcduinoTask, cfgScheduler.get(iMarcduinoTask), "Marcduino");
+
+  domeMotor.attachCue(domeCue);
+  marcduino.attachDomeRoutine(domeRoutine);
+
+  scheduler.attachOnDisconnect(driveDisconnect);
+  scheduler.attachOnDisconnect(domeDisconnect);
+  scheduler.attachOnDisconnect(marcduinoDisconnect);
+
+  scheduler.attachQueue(&mdDomeQueue);
+  scheduler.attachQueue(&mdBodyQueue);
+  scheduler.attachQueue(&motorBus);
+
+  scheduler.attachTimeline(&timeline);
+
+  #if defined(SERIAL_CONSOLE)
+  console.attachTimeline(&timeline);
+  console.attachQueue(&mdDomeQueue, "Dome");
+  console.attachQueue(&mdBodyQueue, "Body");
+  console.attachQueue(&motorBus, "Motor");
+  console.attachDevices(&controller.devices);
+  console.attachSend(consoleSend);
+  console.attachAction(consoleAction);
+  console.attachOnChange(consoleChange);
+  #if defined(PROFILE_LOOP)
+  console.attachProfiler(scheduler.profiler());
+  #endif
+  #endif
+
   // --------------
   // Setup is done.
   // --------------
@@ -160,47 +264,101 @@ void setup() {
 }
 
 void loop() {
+  scheduler.run();
 
-  /* ========================
-   *      DRIVE/STEERING
-   * ======================== */
-  if ( controller.isDisconnecting() ) {
-    // Stop the drive motors when we lose the controller.
-    driveMotor.stop();
-    Serial.println(F("Disconnected drive."));
-    controller.disconnecting();
-  } else if ( controller.read() ) {
-    driveMotor.interpretController();
-  }
+  #if defined(SERIAL_CONSOLE)
+  console.run();
+  #endif
+}
 
-  /* =======================
-   *      DOME ROTATION
-   * ======================= */
-  if ( controller.isDisconnecting() ) {
-    // Stop the dome motor when we lose the controller.
-    domeMotor.stop();
-    Serial.println(F("Disconnected dome."));
-    controller.disconnecting();
-  } else if ( controller.read() ) {
-    domeMotor.interpretController();
-    if ( domeMotor.isAutomationRunning() ) {
-      domeMotor.runAutomation();
-    }
-  }
 
-  /* ===========================
-   *          MARCDUINO
-   * =========================== */
-  if ( controller.isDisconnecting() ) {
-    // Put Marcduino into Quiet mode when we lose the controller.
-    marcduino.quietMode();
-    Serial.println(F("Disconnected Marcduino."));
-    controller.disconnecting();
-  } else if ( controller.read() ) {
-    marcduino.interpretController();
-    if ( marcduino.isCustomPanelRunning() ) {
-      marcduino.runCustomPanelRoutine();
-    }
-    marcduino.runAutomation();
+/* ============================================================
+ *                  S C H E D U L E D   T A S K S
+ * ============================================================ */
+
+/* ========================
+ *      DRIVE/STEERING
+ * ======================== */
+void driveTask(const Input_Frame_Struct* frame) {
+  driveMotor.interpretController(frame);
+}
+
+void driveDisconnect(void) {
+  // Stop the drive motors when we lose the controller, and start
+  // their ramp over from rest for when it comes back.
+  driveMotor.disconnect();
+
+  #if defined(DEBUG)
+  Debug.print(DBG_INFO, F("BLACBox"), F("driveDisconnect()"), F("Disconnected drive."));
+  #endif
+}
+
+/* =======================
+ *      DOME ROTATION
+ * ======================= */
+void domeTask(const Input_Frame_Struct* frame) {
+  domeMotor.interpretController(frame);
+  domeMotor.runAutomation();
+  domeMotor.runPositioning();
+}
+
+void domeCue(byte action, byte arg1, byte arg2) {
+  // A dome routine reached a keyframe with a cue. Marcduino plays it.
+  marcduino.runAction(action, arg1, arg2);
+}
+
+void domeRoutine(byte routineNumber) {
+  // A Marcduino button combo asked for a dome routine.
+  domeMotor.playRoutine(routineNumber);
+}
+
+void domeDisconnect(void) {
+  // Stop the dome motor when we lose the controller.
+  domeMotor.stopRoutine();
+  domeMotor.stop();
+
+  #if defined(DEBUG)
+  Debug.print(DBG_INFO, F("BLACBox"), F("domeDisconnect()"), F("Disconnected dome."));
+  #endif
+}
+
+/* ===========================
+ *          MARCDUINO
+ * =========================== */
+void marcduinoTask(const Input_Frame_Struct* frame) {
+  marcduino.interpretController(frame);
+}
+
+void marcduinoDisconnect(void) {
+  // Put Marcduino into Quiet mode when we lose the controller.
+  marcduino.quietMode();
+
+  #if defined(DEBUG)
+  Debug.print(DBG_INFO, F("BLACBox"), F("marcduinoDisconnect()"), F("Disconnected Marcduino."));
+  #endif
+}
+
+/* ===========================
+ *           CONSOLE
+ * =========================== */
+void consoleSend(const char* command, byte location) {
+  // A Marcduino command typed into the console.
+  marcduino.sendCommand(command, location);
+}
+
+void consoleAction(byte action, byte arg1, byte arg2) {
+  marcduino.runAction(action, arg1, arg2);
+}
+
+void consoleChange(const Config_Section* section, byte index) {
+  // Most settings are read as they are used. The sticks, the drive ramp and
+  // the dome keep their own copies, so hand those a change.
+  if ( section == &cfgController ) {
+    controller.applySettings();
+    driveMotor.applySettings();
+  } else if ( section == &cfgDriveMotion ) {
+    driveMotor.applySettings();
+  } else if ( section == &cfgDome || section == &cfgDomeTimings || section == &cfgDomePosition ) {
+    domeMotor.applySettings();
   }
 }
@@ -18,7 +18,8 @@
 #ifndef __BLACBOX_SECURITY_H__
 #define __BLACBOX_SECURITY_H__
 
-#include <Arduino.h>
+#include "src/hal/Hal.h"
+#include "src/controller/AuthorizedDevices.h"
 
 /* ---------- Instructions ----------
  * Connect the Arduino Mega to a computer running the Arduino IDE.
@@ -28,20 +29,23 @@
  *  lines will display the MAC address of the device. Note this address.
  *  
  * Add each unique MAC address follow the examples below.
- *  List each address to the authorizedMACAddresses array.
+ *  List each address in the authorizedMACAddresses array, in any order, as
+ *  MAC_ADDRESS("00:1B:FB:63:A1:5C"). An address in any other form will not
+ *  compile. Leave a slot you do not need as MAC_UNSET.
+ *
+ * A controller can also be authorized without uploading the sketch again.
+ *  Hold PS alone for three seconds on a controller that is already connected,
+ *  or type "pair" into the serial console, then connect the new controller
+ *  within a minute. "devices" lists every authorized controller, and "unpair"
+ *  removes one that was added this way.
  * ---------------------------------- */
 
 // =================================================================
 
-const char ps3nav_addr1[] PROGMEM = "xx:xx:xx:xx:xx:xx";
-const char ps3nav_addr2[] PROGMEM = "yy:yy:yy:yy:yy:yy";
-const char ps3_addr1[]    PROGMEM = "zz:zz:zz:zz:zz:zz";
-const char ps4_addr1[]    PROGMEM = "aa:aa:aa:aa:aa:aa";
-
-const char * authorizedMACAddresses[] = {
-  ps3nav_addr1,
-  ps3nav_addr2,
-  ps3_addr1,
-  ps4_addr1
+const Mac_Address_Struct authorizedMACAddresses[] PROGMEM = {
+  MAC_UNSET,   // PS3 Navigation #1
+  MAC_UNSET,   // PS3 Navigation #2
+  MAC_UNSET,   // PS3
+  MAC_UNSET    // PS4
 };
 #endif
@@ -9,6 +9,19 @@
 #ifndef __BLACBOX_SETTINGS_H__
 #define __BLACBOX_SETTINGS_H__
 
+#include "src/hal/Hal.h"
+
+// ========================================
+//          Saved Settings Version
+// ========================================
+
+// The settings below are the defaults and are kept in flash. Settings changed
+// at run time may be saved to EEPROM, and are used in place of these after a
+// reset. Saved settings are only used when they match this version and the
+// size of the settings below. Raise the version when you add, remove, or
+// reorder a setting so an old saved image is not read into the wrong places.
+
+const uint16_t CONFIG_VERSION = 1;
 
 // ========================================
 //            Controller Settings
@@ -22,14 +35,22 @@
 #define PS4_CONTROLLER
 //#define PS5_CONTROLLER
 
-const int controllerSettings[] = {
+const int controllerSettings[] PROGMEM = {
    0      // Drive stick side.       : Set to 0=left, or 1=right.
  , 1      // Dome stick side         : Set to 0=left, or 1=right (opposite of the drive stick side).
- , 8      // Joystick dead zone      : Set to an integer (recommended < 10).
- , 3      // Number of peripherals   : Set to 1, 2, or 3; Used when processing a disconnect event.
+ , 8      // Joystick dead zone      : Set to an integer (recommended < 10). Measured as a circle around center.
+ , 0      // Drive response curve    : Set to 0=linear, 1=expo, or 2=S-curve. Suggested: 1 for finer control at low speed.
+ , 0      // Dome response curve     : Set to 0=linear, 1=expo, or 2=S-curve.
+ , 0      // Drive curve, walk       : Set to 0-100 (percent). Higher is gentler near center. Suggested with expo: 60.
+ , 0      // Drive curve, jog        : Set to 0-100 (percent). Suggested with expo: 40.
+ , 0      // Drive curve, run        : Set to 0-100 (percent). Suggested with expo: 20.
+ , 0      // Drive curve, sprint     : Set to 0-100 (percent). Suggested with expo: 0.
+ , 0      // Dome curve              : Set to 0-100 (percent).
+ , 0      // Joystick filter         : Set to 0=none, 1=one-pole, or 2=median of three. Suggested: 1 for a jittery stick.
+ , 50     // Filter weight           : Set to 1-100 (percent). Weight of each new reading in the one-pole filter. Suggested: 50.
 };
 
-const unsigned long controllerTimings[] = {
+const unsigned long controllerTimings[] PROGMEM = {
    300    // Lag time to kill motors : Set to a time in milliseconds. Kill the drive motors when lag time exceeds this value.
  , 10000  // Lag time to disconnect  : Set to a time in milliseconds. Disconnect the controller when lag exceeds this value.
  , 200    // Lag time to reconnect   : Set to a time in milliseconds. Reconnect the controller when lag exceeds this value.
@@ -47,37 +68,113 @@ const unsigned long controllerTimings[] = {
 const bool pair = false;       // Perform controller pairing
 #endif
 
+// ========================================
+//             Console Settings
+// ========================================
+
+// With the console on, commands typed into the serial monitor (115200 baud) read
+// and change settings while the droid runs. Type "help" for the list. Leave it
+// commented out to keep the serial monitor for debug output alone.
+
+//#define SERIAL_CONSOLE
+
+// ========================================
+//            Scheduler Settings
+// ========================================
+
+// The controller is read once per pass through loop(). Each peripheral
+// then interprets that input at its own fixed rate.
+
+const unsigned long schedulerTimings[] PROGMEM = {
+   5      // Drive task period       : Set to a time in milliseconds. How often drive input is interpreted.
+ , 10     // Dome task period        : Set to a time in milliseconds. How often dome input and automation run.
+ , 50     // Marcduino task period   : Set to a time in milliseconds. How often Marcduino input and automation run.
+ , 10000  // Profiler report        : Set to a time in milliseconds. How often loop timing is printed when PROFILE_LOOP is defined.
+};
+
+// ========================================
+//          Serial Queue Settings
+// ========================================
+
+// Every outbound serial link is fronted by a queue so a slow port never holds up
+// the loop. Set each depth in bytes. A command that does not fit is dropped, so
+// make the Marcduino dome queue large enough for your longest burst of commands.
+
+const uint16_t MD_DOME_QUEUE_DEPTH = 128;   // Marcduino dome (Serial1).
+const uint16_t MD_BODY_QUEUE_DEPTH = 64;    // Marcduino body master (Serial3).
+const uint16_t MOTOR_QUEUE_DEPTH   = 64;    // Non-packet traffic on the Syren10 and drive motor bus (Serial2).
+
+// ========================================
+//          Show Timeline Settings
+// ========================================
+
+// Timed effects (sequences, panel routines, holoprojector moves) wait on one shared
+// timeline. Set how many events may wait at once. An event that does not fit is
+// dropped. A custom panel routine needs one event per step while it runs.
+
+const byte TIMELINE_DEPTH = 32;
+
 // ========================================
 //           Drive System Settings
 // ========================================
 
-const int driveMotorSettings[] = {
-   0      // Motor driver            : Set to 0=Roboteq SBL2360 or SBL1360, 1=Sabertooth (not yet supported).
+// Uncomment one of the following options for the drive motor controller.
+
+#define ROBOTEQ_DRIVE
+//#define SABERTOOTH_DRIVE
+
+const int driveMotorSettings[] PROGMEM = {
+   0      // Motor driver            : Set to 0=Roboteq SBL2360 or SBL1360, 1=Sabertooth. Must match the choice above.
  , 0      // Use dead man switch     : Set to 0=false, 1=true.
- , 25     // Serial latency (in ms)  : Set to 25 ms for HardwareSerial, 50+ ms for SoftwareSerial.
+ , 25     // Serial latency (in ms)  : Gap between sends while the stick moves slowly. 25 ms for HardwareSerial, 50+ ms for SoftwareSerial.
  , 7      // Servo dead zone         : Similar to joystick dead zone, but for the servo value range.
+ , 2      // Output threshold        : Smallest change in motor output worth sending.
+ , 200    // Keep-alive (in ms)      : Resend an unchanged output this often so the motor controller's watchdog stays fed.
+ , 10     // Minimum latency (in ms) : Shortest gap between sends while the stick moves fast.
 };
 
-const byte driveMotorPins[] = {
-   44     // Drive pin #1 : Pulse1/Throttle (Roboteq) or Left foot (Sabertooth).
- , 45     // Drive pin #2 : Pulse2/Steering (Roboteq) or Right foot (Sabertooth).
+const int driveMotionSettings[] PROGMEM = {
+   // Drive output runs from 0 to 1000. Rates are per second. 0 jerk = no jerk limit.
+   1000   // Walk acceleration       : Output gained per second, speeding up.
+ , 2000   // Walk deceleration       : Output shed per second, slowing down.
+ , 4000   // Walk jerk               : How fast the acceleration itself may change. Softens starts and stops.
+ , 1500   // Jog acceleration
+ , 2500   // Jog deceleration
+ , 6000   // Jog jerk
+ , 2000   // Run acceleration
+ , 3000   // Run deceleration
+ , 8000   // Run jerk
+ , 3000   // Sprint acceleration
+ , 4000   // Sprint deceleration
+ , 0      // Sprint jerk
+ , 5000   // Emergency deceleration  : Used when the deadman is released or the drive stick is disabled. 0=stop at once.
+};
+
+const byte driveMotorPins[] PROGMEM = {
+   44     // Drive pin #1 : Pulse1/Throttle (Roboteq only).
+ , 45     // Drive pin #2 : Pulse2/Steering (Roboteq only).
  , 46     // Script pin   : Pulse3/Script (Roboteq only).
  , 47     // Deadman pin  : Digital pin for dead man switch.
 };
 
-const byte roboteqSettings[] = {
-   0      // Roboteq communication mode : Set to 0=Pulse, 1=RS232 (Serial, not yet supported).  
+const byte roboteqSettings[] PROGMEM = {
+   0      // Roboteq communication mode : Set to 0=Pulse, 1=RS232 (Serial).
  , 0      // Tank-style drive mixing    : Set to 0=false (for SBL2360), 1=true (for SBL1360).
+ , 40     // Current limit (amps)       : RS232 only. Above this, drive is held at the walk profile. 0=off.
+ , 22     // Low battery (volts)        : RS232 only. Below this, drive is held at the walk profile. 0=off.
 };
 
-const int sabertoothSettings[] = {
-   70     // Drive speed, normal    : Set to a value between 0=stop, 127=full speed.
- , 110    // Drive speed, overdrive : Set to a value between 0=stop, 127=full speed.
+const int sabertoothSettings[] PROGMEM = {
+   50     // Walk speed             : Set to a value between 0=stop, 127=full speed.
+ , 70     // Jog speed              : Set to a value between 0=stop, 127=full speed.
+ , 90     // Run speed              : Set to a value between 0=stop, 127=full speed.
+ , 110    // Sprint speed           : Set to a value between 0=stop, 127=full speed.
  , 50     // Turn speed.            : Recommend beginner: 40 to 50, experienced: 50+
           //                           Higher values spin in place faster. Lower values are easier to control.
- , 1      // Ramping                : Lower values take longer to speed up. Change this by increments of 1.
  , 128    // Sabertooth address     : Values 128-135 allowed.  128 is typical.
  , 1      // Rotation inversion     : Set to -1 if you need to invert the rotation direction.
+ , 500    // Serial timeout (in ms) : The Sabertooth stops by itself when nothing arrives for this long. 0=off.
+          //                           Keep this above the drive keep-alive.
 };
 
 
@@ -85,7 +182,7 @@ const int sabertoothSettings[] = {
 //              Dome Settings
 // ========================================
 
-const byte domeMotorSettings[] = {
+const byte domeMotorSettings[] PROGMEM = {
    0      // Motor driver           : Set to 0=Syren10, no other driver supported yet.
  , 100    // Manual speed           : When sending to the dome motor driver over serial, set this to a number up to 127.
  , 49     // Automated speed min    : Minimum auto dome speed to allow automation to run.
@@ -94,13 +191,26 @@ const byte domeMotorSettings[] = {
  , 25     // Serial latency (in ms) : 25 ms for HardwareSerial, 50+ ms for SoftwareSerial.
 };
 
-const unsigned long domeMotorTimings[] = {
+const unsigned long domeMotorTimings[] PROGMEM = {
    1999   // Time for 360 turn min  :  Set to a time in milliseconds. Minimum time allowed for dome to turn a full 360 degrees.
  , 8001   // Time for 360 turn max  :  Set to a time in milliseconds. Maximum time allowed for dome to turn a full 360 degrees.
  , 2000   // Time for 360 turn      :  Set to a time between the minimum and maximum allowed values.
 };
 
-const int syrenSettings[] = {
+const int domePositionSettings[] PROGMEM = {
+   // Angles are in tenths of a degree. 0 is the dome facing front.
+   0      // Position sensor        : Set to 0=none (timed estimate), 1=home switch, 2=quadrature encoder.
+ , 2      // Encoder pin A          : Interrupt pin (2, 3, 18, 19, 20, or 21 on a Mega).
+ , 4      // Encoder pin B          : Any digital pin.
+ , 3      // Home switch pin        : Interrupt pin for a hall-effect switch that pulls low at home. 0=none.
+ , 0      // Encoder counts         : Encoder counts (channel A edges) per full dome turn.
+ , 0      // Home switch angle      : Where the home switch sits, measured from front.
+ , 300    // Ramp zone              : Start slowing down this far from the target angle.
+ , 25     // Creep speed            : Slowest speed that still turns the dome.
+ , 20     // Arrival tolerance      : Stop when this close to the target angle.
+};
+
+const int syrenSettings[] PROGMEM = {
    129    // Syren10 address.    :  Values 128-135 allowed.  129 is typical.
 };
 
@@ -108,7 +218,7 @@ const int syrenSettings[] = {
 //            Marcduino Settings
 // ========================================
 
-const byte marcduinoSettings[] = {
+const byte marcduinoSettings[] PROGMEM = {
    0    // FX control system           : Set to 0=Marcduino, no other system supported yet.
  , 1    // Marcduino body master used  : Set to 0=false, 1=true.
  , 1    // Marcduino sound master      : Set to 0=dome, 1=body.
@@ -117,10 +227,15 @@ const byte marcduinoSettings[] = {
  , 0    // Magic panel used            : Set to 0=false, 1=true.
  , 2    // Body panels on servos       : Set to a value between 0 and 10.
  , 10   // Dome panels on servos       : Set to a value between 0 and 10.
- , 3    // Holoprojectors on servos    : Set to a value between 0 and 3.
+ , 3    // Holoprojectors on servos    : Set to a value between 0 and 9.
  , 2    // HP automation delay min     : Set to a time in seconds. Minimum time between automated holoprojector movements.
  , 10   // HP automation delay max     : Set to a time in seconds. Maximum time between automated holoprojector movements.
  , 0    // Feather radio used          : Set to 0=false, 1=true.
+ , 0    // HP automation at startup    : Set to 0=false, 1=true. A button combo can also turn it on and off.
+ , 60   // HP random move weight       : Relative chance an automated holoprojector moves.
+ , 25   // HP flicker weight           : Relative chance an automated holoprojector flickers.
+ , 15   // HP on-board lights weight   : Relative chance an automated holoprojector plays its light sequence.
+ , 3    // HP effect time              : Set to a time in seconds (up to 99). Length of a flicker or light sequence.
 };
 
 #endif
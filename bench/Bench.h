@@ -0,0 +1,71 @@
+/* =================================================================================
+ *    B.L.A.C.Box: Brian Lubkeman's Astromech Controller
+ * =================================================================================
+ * Bench.h - Timing helpers for the host benchmarks
+ * Created by Brian Lubkeman, 16 June 2021
+ * Inspired by S.H.A.D.O.W. controller code written by KnightShade
+ * Released into the public domain.
+ * =================================================================================
+ *
+ * The benchmarks run on the simulated clock, so the work done is the same every
+ * run. Only the time it takes is measured, in nanoseconds of the workstation's
+ * own clock. The numbers compare one version of the code with another on the
+ * same machine. They say nothing about how fast a Mega is.
+ */
+#ifndef __BLACBOX_BENCH_H__
+#define __BLACBOX_BENCH_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+typedef unsigned long long Bench_Time;
+
+// =====================
+//      benchNow()
+// =====================
+static inline Bench_Time benchNow(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (Bench_Time)now.tv_sec * 1000000000ULL + (Bench_Time)now.tv_nsec;
+}
+
+static int m_compareTimes(const void* a, const void* b)
+{
+  Bench_Time x = *(const Bench_Time*)a;
+  Bench_Time y = *(const Bench_Time*)b;
+  return ( x < y ? -1 : ( x > y ? 1 : 0 ) );
+}
+
+// =======================
+//      benchReport()
+// =======================
+// Sorts the samples in place and prints one line: count, mean, p50, p99 and max.
+
+static void benchReport(const char* name, Bench_Time samples[], size_t count)
+{
+  if ( count == 0 ) {
+    return;
+  }
+
+  Bench_Time total = 0;
+  for (size_t i = 0; i < count; i++) {
+    total += samples[i];
+  }
+  qsort(samples, count, sizeof(Bench_Time), m_compareTimes);
+
+  printf("%-24s %9lu %9llu %9llu %9llu %9llu\n",
+         name,
+         (unsigned long)count,
+         total / count,
+         samples[count / 2],
+         samples[(count * 99) / 100],
+         samples[count - 1]);
+}
+
+static void benchHeader(void)
+{
+  printf("%-24s %9s %9s %9s %9s %9s (ns)\n", "", "count", "mean", "p50", "p99", "max");
+}
+#endif
@@ -0,0 +1,151 @@
+/* =================================================================================
+ *    B.L.A.C.Box: Brian Lubkeman's Astromech Controller
+ * =================================================================================
+ * bench_capture.cpp - Time of controller input capture, template against virtual
+ * Created by Brian Lubkeman, 16 June 2021
+ * Inspired by S.H.A.D.O.W. controller code written by KnightShade
+ * Released into the public domain.
+ * =================================================================================
+ *
+ * Captures the same buttons and sticks two ways, through the member templates in
+ * Controller.h:
+ *
+ *   Template  Pad is the final controller class, as each read() passes itself.
+ *             Every button and hat query is a direct call.
+ *   Virtual   Pad is Controller, reached through a pointer the compiler cannot
+ *             see through, as the capture path was before the templates. Every
+ *             query goes through the vtable.
+ *
+ * Each sample is 1000 captures, with the buttons and hats moving on each one.
+ * Only time is compared. Flash size is not: the host has no AVR toolchain, and
+ * a workstation binary says nothing about what the Mega build uses. On the Mega
+ * an indirect call costs more against the work around it than it does here.
+ */
+#include "Bench.h"
+#include "../Settings.h"
+#include "../src/controller/Controller.h"
+
+#define SECTION(name, defaults) Config_Section name(&config, defaults, sizeof(defaults) / sizeof(defaults[0]))
+
+Config config(CONFIG_VERSION);
+SECTION(cfgController, controllerSettings);
+SECTION(cfgControllerTimings, controllerTimings);
+
+// ------------------------------------------------------------------------------
+// A controller that answers from a state the benchmark sets, the way
+// Controller_Script does. Final, like the PS controllers, so the template path
+// binds straight to it.
+// ------------------------------------------------------------------------------
+
+class Bench_Pad final : public Controller
+{
+  private:
+    uint32_t m_buttons;
+    uint32_t m_clicks;
+    byte m_hat[4];
+
+  public:
+    Bench_Pad(void) : Controller(&cfgController, &cfgControllerTimings), m_buttons(0), m_clicks(0)
+    {
+      m_hat[0] = m_hat[1] = m_hat[2] = m_hat[3] = 127;
+    }
+
+    void setState(uint32_t buttons, byte x, byte y)
+    {
+      m_clicks  = buttons & ~m_buttons;
+      m_buttons = buttons;
+      m_hat[0] = m_hat[2] = x;
+      m_hat[1] = m_hat[3] = y;
+    }
+
+    void captureDirect(void)
+    {
+      m_captureButtons(this);
+      m_captureFrame(this);
+    }
+
+    void captureVirtual(Controller* pad)
+    {
+      m_captureButtons(pad);
+      m_captureFrame(pad);
+    }
+
+    int frameSum(void)  { return m_frame.driveX + m_frame.driveY + m_frame.domeX + (int)(m_frame.pressed & 0xFF); }
+
+    virtual bool getButtonPress(int buttonEnum)  { return (m_buttons >> buttonEnum) & 1; }
+    virtual bool getButtonClick(int buttonEnum)
+    {
+      uint32_t bit = (uint32_t)1 << buttonEnum;
+      if ( m_clicks & bit ) {
+        m_clicks &= ~bit;
+        return true;
+      }
+      return false;
+    }
+    virtual int  getAnalogHat(int stickEnum)     { return ( stickEnum >= 0 && stickEnum < 4 ? m_hat[stickEnum] : 127 ); }
+};
+
+static Bench_Pad pad;
+
+// The virtual path reads its pad through here, so calls through it stay indirect.
+
+static Controller* volatile s_basePad = &pad;
+
+const int BENCH_SAMPLES = 200;
+const int BENCH_CAPTURES = 1000;
+
+static Bench_Time s_templateTimes[BENCH_SAMPLES];
+static Bench_Time s_virtualTimes[BENCH_SAMPLES];
+
+// ===================
+//      m_state()
+// ===================
+// The input for one capture: a few buttons held, and the sticks sweeping.
+
+static void m_state(int n)
+{
+  uint32_t buttons = ((uint32_t)n * 2654435761UL) >> 15;
+  pad.setState(buttons & (((uint32_t)1 << BUTTON_COUNT) - 1), (byte)(n * 7), (byte)(255 - n * 3));
+}
+
+// ===============
+//      main()
+// ===============
+int main(void)
+{
+  pad.begin();
+
+  // The sums keep the compiler from dropping the work, and show both paths
+  // captured the same thing.
+
+  long templateSum = 0;
+  long virtualSum = 0;
+
+  for (int sample = 0; sample < BENCH_SAMPLES; sample++) {
+
+    Bench_Time start = benchNow();
+    for (int i = 0; i < BENCH_CAPTURES; i++) {
+      m_state(i);
+      pad.captureDirect();
+      templateSum += pad.frameSum();
+    }
+    s_templateTimes[sample] = benchNow() - start;
+
+    start = benchNow();
+    for (int i = 0; i < BENCH_CAPTURES; i++) {
+      m_state(i);
+      pad.captureVirtual(s_basePad);
+      virtualSum += pad.frameSum();
+    }
+    s_virtualTimes[sample] = benchNow() - start;
+  }
+
+  printf("%d samples of %d captures (sums %ld, %ld)\n\n", BENCH_SAMPLES, BENCH_CAPTURES, templateSum / BENCH_SAMPLES, virtualSum / BENCH_SAMPLES);
+  benchHeader();
+  benchReport("Template capture", s_templateTimes, BENCH_SAMPLES);
+  benchReport("Virtual capture", s_virtualTimes, BENCH_SAMPLES);
+
+  // Both paths must see the same input the same way.
+
+  return ( templateSum == virtualSum ? 0 : 1 );
+}
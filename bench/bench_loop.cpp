@@ -0,0 +1,136 @@
+/* =================================================================================
+ *    B.L.A.C.Box: Brian Lubkeman's Astromech Controller
+ * =================================================================================
+ * bench_loop.cpp - Times scheduler passes of the whole sketch
+ * Created by Brian Lubkeman, 16 June 2021
+ * Inspired by S.H.A.D.O.W. controller code written by KnightShade
+ * Released into the public domain.
+ * =================================================================================
+ *
+ * Runs the sketch for one simulated minute at one pass per millisecond, played
+ * from a fixed script: connect, enable the drive, sweep both sticks, click a few
+ * Marcduino buttons, and drop the connection at the end. Every pass of loop() is
+ * timed. The work done is printed too, so a change that alters what the loop
+ * does is not mistaken for one that makes it faster.
+ *
+ * Debug output is turned down to errors once setup() is done, so the numbers
+ * are for the control code and not for printing.
+ */
+#include "Bench.h"
+#include "../Settings.h"
+#include "../src/controller/Controller.h"
+#include "../src/scheduler/Scheduler.h"
+
+void setup(void);
+void loop(void);
+
+extern Controller_Script controller;
+extern Scheduler scheduler;
+extern Config_Section cfgScheduler;
+
+#define BIT(button) ((uint32_t)1 << (button))
+
+const unsigned long BENCH_RUN_TIME  = 60000;     // Simulated ms.
+const unsigned long BENCH_PASS_TIME = 1000;      // Simulated us per pass.
+const byte          BENCH_MAX_STEPS = 200;
+
+static Script_Step_Struct s_script[BENCH_MAX_STEPS];
+static byte s_stepCount = 0;
+static Bench_Time s_samples[BENCH_RUN_TIME];
+
+// ===================
+//      m_step()
+// ===================
+static void m_step(unsigned long time, bool connected, byte driveX, byte driveY, byte domeX, uint32_t buttons)
+{
+  if ( s_stepCount >= BENCH_MAX_STEPS ) {
+    return;
+  }
+  Script_Step_Struct* step = &s_script[s_stepCount++];
+  step->time = time;
+  step->connected = connected;
+  step->hat[LeftHatX]  = driveX;
+  step->hat[LeftHatY]  = driveY;
+  step->hat[RightHatX] = domeX;
+  step->hat[RightHatY] = 127;
+  step->buttons = buttons;
+}
+
+// ======================
+//      m_toStdout()
+// ======================
+static void m_toStdout(const byte* buffer, size_t length)
+{
+  fwrite(buffer, 1, length, stdout);
+}
+
+// =========================
+//      m_buildScript()
+// =========================
+static void m_buildScript(void)
+{
+  // Connect, then hold PS and click R4 to enable the drive.
+
+  m_step(0,    false, 127, 127, 127, 0);
+  m_step(500,  true,  127, 127, 127, 0);
+  m_step(1000, true,  127, 127, 127, BIT(PS));
+  m_step(1100, true,  127, 127, 127, BIT(PS) | BIT(R4));
+  m_step(1200, true,  127, 127, 127, 0);
+
+  // Sweep the sticks every half second. Every fifth step clicks a
+  // Marcduino button, in turn.
+
+  const uint32_t clicks[] = { BIT(UP), BIT(RIGHT), BIT(DOWN), BIT(LEFT) };
+  unsigned long time = 1500;
+  byte n = 0;
+
+  while ( time < BENCH_RUN_TIME - 2000 && s_stepCount < BENCH_MAX_STEPS - 2 ) {
+    byte phase = (n * 37) & 0xFF;
+    uint32_t buttons = ( (n % 5) == 4 ? clicks[(n / 5) % 4] : 0 );
+    m_step(time, true, phase, 255 - phase, (n * 53) & 0xFF, buttons);
+    time += 500;
+    n++;
+  }
+
+  // Center the sticks, then lose the controller.
+
+  m_step(time, true, 127, 127, 127, 0);
+  m_step(time + 1000, false, 127, 127, 127, 0);
+}
+
+// ===============
+//      main()
+// ===============
+int main(void)
+{
+  setup();
+  Debug.setDebugLevel(DBG_ERROR);
+
+  // The scheduler's own report would reset the profiler part way through.
+
+  cfgScheduler.set(iProfileReport, BENCH_RUN_TIME * 2);
+
+  m_buildScript();
+  controller.play(s_script, s_stepCount);
+
+  unsigned long passes = 0;
+  while ( Hal_Clock::millis() < BENCH_RUN_TIME ) {
+    Bench_Time start = benchNow();
+    loop();
+    s_samples[passes++] = benchNow() - start;
+    Hal_Clock::advance(BENCH_PASS_TIME);
+  }
+
+  printf("Simulated %lu ms, %lu passes, %u script steps\n", BENCH_RUN_TIME, passes, s_stepCount);
+  printf("Bytes sent: dome %lu, motor %lu, body %lu\n\n", Serial1.txCount(), Serial2.txCount(), Serial3.txCount());
+
+  benchHeader();
+  benchReport("loop()", s_samples, passes);
+
+  // The scheduler's profiler, as PROFILE_LOOP prints it on the droid.
+
+  printf("\nScheduler profile, host time:\n");
+  Serial.onTransmit(m_toStdout);
+  scheduler.profiler()->report(&Serial);
+  return 0;
+}
@@ -0,0 +1,272 @@
+/* =================================================================================
+ *    B.L.A.C.Box: Brian Lubkeman's Astromech Controller
+ * =================================================================================
+ * bench_marcduino.cpp - Heap use and time of building Marcduino commands
+ * Created by Brian Lubkeman, 16 June 2021
+ * Inspired by S.H.A.D.O.W. controller code written by KnightShade
+ * Released into the public domain.
+ * =================================================================================
+ *
+ * Sends the same dome panel and holoprojector commands two ways, with debug
+ * output on, and counts every malloc(), realloc() and operator new on the way:
+ *
+ *   String   The old path, ":OP" + m_leftPad(n) + '\r' passed to m_sendCommand(),
+ *            built with Legacy_String below. It allocates the way the Arduino
+ *            core's String does: exactly the length needed, grown on every
+ *            append, with no small-string buffer.
+ *   Encoder  Marcduino::runAction(), as the sketch sends commands today.
+ *
+ * The program fails if the encoder allocates at all.
+ */
+#include "Bench.h"
+#include "../Settings.h"
+#include "../src/controller/Controller.h"
+#include "../src/marcduino/Marcduino.h"
+
+#include <new>
+
+/* ================================================================================
+ *                                Allocation Counter
+ * ================================================================================ */
+
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_realloc(void* pointer, size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+
+static bool s_counting = false;
+static unsigned long s_allocations = 0;
+
+extern "C" void* malloc(size_t size)
+{
+  if ( s_counting ) { s_allocations++; }
+  return __libc_malloc(size);
+}
+
+extern "C" void* realloc(void* pointer, size_t size)
+{
+  if ( s_counting ) { s_allocations++; }
+  return __libc_realloc(pointer, size);
+}
+
+extern "C" void* calloc(size_t count, size_t size)
+{
+  if ( s_counting ) { s_allocations++; }
+  return __libc_calloc(count, size);
+}
+
+void* operator new(size_t size)
+{
+  if ( s_counting ) { s_allocations++; }
+  void* pointer = __libc_malloc(size);
+  if ( pointer == NULL ) {
+    throw std::bad_alloc();
+  }
+  return pointer;
+}
+
+void operator delete(void* pointer) noexcept              { free(pointer); }
+void operator delete(void* pointer, size_t size) noexcept { free(pointer); }
+
+/* ================================================================================
+ *                                  Legacy String
+ * ================================================================================ */
+
+// Only what the old command builders used.
+
+class Legacy_String
+{
+  private:
+    char* m_buffer;
+    unsigned int m_length;
+    unsigned int m_capacity;
+
+    void m_reserve(unsigned int size)
+    {
+      if ( m_buffer != NULL && m_capacity >= size ) {
+        return;
+      }
+      m_buffer = (char*)realloc(m_buffer, size + 1);
+      m_capacity = size;
+    }
+
+  public:
+    Legacy_String(void) : m_buffer(NULL), m_length(0), m_capacity(0) {}
+    Legacy_String(const char* text) : m_buffer(NULL), m_length(0), m_capacity(0) { concat(text); }
+    Legacy_String(const Legacy_String& other) : m_buffer(NULL), m_length(0), m_capacity(0) { concat(other.c_str()); }
+    Legacy_String(Legacy_String&& other) : m_buffer(other.m_buffer), m_length(other.m_length), m_capacity(other.m_capacity) { other.m_buffer = NULL; }
+    ~Legacy_String(void) { free(m_buffer); }
+
+    const char* c_str(void) const { return ( m_buffer != NULL ? m_buffer : "" ); }
+    unsigned int length(void) const { return m_length; }
+
+    void concat(const char* text)
+    {
+      unsigned int add = strlen(text);
+      m_reserve(m_length + add);
+      memcpy(m_buffer + m_length, text, add + 1);
+      m_length += add;
+    }
+    void concat(char c)                      { char text[2] = { c, '\0' }; concat(text); }
+    void concat(unsigned int n)              { char text[8]; snprintf(text, sizeof(text), "%u", n); concat(text); }
+
+    Legacy_String& operator+=(const char* text) { concat(text); return *this; }
+    Legacy_String& operator+=(char c)           { concat(c); return *this; }
+    Legacy_String& operator+=(unsigned int n)   { concat(n); return *this; }
+
+    void remove(unsigned int index, unsigned int count)
+    {
+      memmove(m_buffer + index, m_buffer + index + count, m_length - index - count + 1);
+      m_length -= count;
+    }
+    int indexOf(const char* text) const
+    {
+      const char* found = strstr(c_str(), text);
+      return ( found != NULL ? (int)(found - c_str()) : -1 );
+    }
+};
+
+// "*ON" + String makes a new String from the literal, then appends.
+
+static Legacy_String operator+(const char* left, const Legacy_String& right)
+{
+  Legacy_String out(left);
+  out.concat(right.c_str());
+  return out;
+}
+
+static Legacy_String operator+(Legacy_String&& left, char right)
+{
+  left.concat(right);
+  return static_cast<Legacy_String&&>(left);
+}
+
+static Legacy_String m_leftPad(uint8_t n, char c = '0', uint8_t width = 2)
+{
+  Legacy_String out;
+  for (int i = 0; i < width; i++) {
+    out += c;
+  }
+  out += (unsigned int)n;
+  out.remove(0, out.length() - width);
+  return out;
+}
+
+static void m_legacySend(Legacy_String inStr, Hal_SerialPort* targetSerial)
+{
+  if ( inStr.indexOf(":CPR") > -1 || inStr.length() == 0 ) {
+    return;
+  }
+  targetSerial->print(inStr.c_str());
+
+  Legacy_String msg = inStr;
+  msg += " to dome via Serial";
+  char buff[50];
+  strncpy(buff, msg.c_str(), sizeof(buff) - 1);
+  buff[sizeof(buff) - 1] = '\0';
+  Debug.print(DBG_INFO, F("Marcduino"), F("m_sendCommand()"), buff);
+}
+
+/* ================================================================================
+ *                                  The Benchmark
+ * ================================================================================ */
+
+byte mdDomeBuffer[256];
+byte mdBodyBuffer[64];
+SerialQueue mdDomeQueue(Serial1, mdDomeBuffer, sizeof(mdDomeBuffer));
+SerialQueue mdBodyQueue(Serial3, mdBodyBuffer, sizeof(mdBodyBuffer));
+SerialQueue &MD_Dome_Serial = mdDomeQueue;
+SerialQueue &MD_Body_Serial = mdBodyQueue;
+
+Config config(CONFIG_VERSION);
+Config_Section cfgController(&config, controllerSettings, sizeof(controllerSettings) / sizeof(controllerSettings[0]));
+Config_Section cfgControllerTimings(&config, controllerTimings, sizeof(controllerTimings) / sizeof(controllerTimings[0]));
+Config_Section cfgMarcduino(&config, marcduinoSettings, sizeof(marcduinoSettings) / sizeof(marcduinoSettings[0]));
+
+Timeline_Event_Struct timelineEvents[TIMELINE_DEPTH];
+Timeline timeline(timelineEvents, TIMELINE_DEPTH);
+Controller_Script controller(&cfgController, &cfgControllerTimings);
+Marcduino marcduino(&controller, &cfgMarcduino, &timeline);
+
+const unsigned long BENCH_ROUNDS   = 2000;
+const byte          BENCH_COMMANDS = 4;   // Panel open, panel close, HP on, HP off.
+
+static Bench_Time s_legacyTimes[BENCH_ROUNDS * BENCH_COMMANDS];
+static Bench_Time s_encoderTimes[BENCH_ROUNDS * BENCH_COMMANDS];
+
+// ========================
+//      m_runLegacy()
+// ========================
+static void m_runLegacy(byte command, byte n)
+{
+  switch (command) {
+    case 0 : { m_legacySend(Legacy_String(":OP" + m_leftPad(n) + '\r'), &Serial1); break; }
+    case 1 : { m_legacySend(Legacy_String(":CL" + m_leftPad(n) + '\r'), &Serial1); break; }
+    case 2 : { m_legacySend(Legacy_String("*ON" + m_leftPad(n % 4) + '\r'), &Serial1); break; }
+    case 3 : { m_legacySend(Legacy_String("*OF" + m_leftPad(n % 4) + '\r'), &Serial1); break; }
+  }
+}
+
+// =========================
+//      m_runEncoder()
+// =========================
+static void m_runEncoder(byte command, byte n)
+{
+  switch (command) {
+    case 0 : { marcduino.runAction(aDomePanelOpen, n, 0);    break; }
+    case 1 : { marcduino.runAction(aDomePanelClose, n, 0);   break; }
+    case 2 : { marcduino.runAction(aHpLightOn, n % 4, 0);    break; }
+    case 3 : { marcduino.runAction(aHpLightOff, n % 4, 0);   break; }
+  }
+  mdDomeQueue.drain();
+}
+
+// ===============
+//      main()
+// ===============
+int main(void)
+{
+  marcduino.begin();
+  Debug.setDebugLevel(DBG_VERBOSE);
+
+  unsigned long legacyAllocations = 0;
+  unsigned long encoderAllocations = 0;
+  unsigned long sample = 0;
+
+  for (unsigned long round = 0; round < BENCH_ROUNDS; round++) {
+    for (byte command = 0; command < BENCH_COMMANDS; command++) {
+      byte n = 1 + (round % 10);
+
+      s_allocations = 0;
+      s_counting = true;
+      Bench_Time start = benchNow();
+      m_runLegacy(command, n);
+      s_legacyTimes[sample] = benchNow() - start;
+      s_counting = false;
+      legacyAllocations += s_allocations;
+
+      s_allocations = 0;
+      s_counting = true;
+      start = benchNow();
+      m_runEncoder(command, n);
+      s_encoderTimes[sample] = benchNow() - start;
+      s_counting = false;
+      encoderAllocations += s_allocations;
+
+      sample++;
+    }
+  }
+
+  printf("%lu commands each way, debug output on\n", sample);
+  printf("Heap calls per command: String %.1f, encoder %.1f\n\n",
+         (double)legacyAllocations / sample, (double)encoderAllocations / sample);
+
+  benchHeader();
+  benchReport("String", s_legacyTimes, sample);
+  benchReport("Encoder", s_encoderTimes, sample);
+
+  if ( encoderAllocations != 0 ) {
+    printf("\nFAIL: the encoder allocated %lu times\n", encoderAllocations);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,137 @@
+/* =================================================================================
+ *    B.L.A.C.Box: Brian Lubkeman's Astromech Controller
+ * =================================================================================
+ * bench_mixer.cpp - Time of the Roboteq BHD mixer, integer against float
+ * Created by Brian Lubkeman, 16 June 2021
+ * Inspired by S.H.A.D.O.W. controller code written by KnightShade
+ * Released into the public domain.
+ * =================================================================================
+ *
+ * Mixes every one of the 65536 throttle and steering positions, with the
+ * integer mixer in DriveMotor_Roboteq and with the float mixer it replaced.
+ * Each sample is one full sweep. On the Mega the float version also pulls in
+ * the soft-float library; a workstation has a float unit, so the gap here is
+ * smaller than on the droid.
+ */
+#include "Bench.h"
+#include "../Settings.h"
+#include "../src/driveMotor/DriveMotor.h"
+
+#define SECTION(name, defaults) Config_Section name(&config, defaults, sizeof(defaults) / sizeof(defaults[0]))
+
+Config config(CONFIG_VERSION);
+SECTION(cfgController, controllerSettings);
+SECTION(cfgControllerTimings, controllerTimings);
+SECTION(cfgDrive, driveMotorSettings);
+SECTION(cfgDriveMotion, driveMotionSettings);
+SECTION(cfgDrivePins, driveMotorPins);
+SECTION(cfgRoboteq, roboteqSettings);
+
+byte motorBuffer[64];
+SerialQueue motorQueue(Serial2, motorBuffer, sizeof(motorBuffer));
+SerialQueue &DriveMotor_Serial = motorQueue;
+
+Controller_Script controller(&cfgController, &cfgControllerTimings);
+
+class Roboteq_Probe : public DriveMotor_Roboteq
+{
+  public:
+    Roboteq_Probe(void) : DriveMotor_Roboteq(&controller, &cfgDrive, &cfgDrivePins, &cfgDriveMotion, &cfgRoboteq) {}
+
+    void mix(byte throttle, byte steering)  { m_mixBHD(throttle, steering); }
+    int left(void)                          { return m_input1; }
+    int right(void)                         { return m_input2; }
+};
+
+static Roboteq_Probe roboteq;
+
+// =====================
+//      m_floatMix()
+// =====================
+// The float mixer as it was, down to the servo values.
+
+static void m_floatMix(byte throttle, byte steering, const Joystick* stick, int* input1, int* input2)
+{
+  if ( throttle == stick->center && steering == stick->center ) {
+    *input1 = *input2 = 90;
+    return;
+  }
+
+  int xInt = 0;
+  int yInt = 0;
+
+  if ( throttle < stick->center ) { yInt = map(throttle, stick->minValue, (stick->center - stick->deadZone), 100, 1); }
+  else                            { yInt = map(throttle, (stick->center + stick->deadZone), stick->maxValue, -1, -100); }
+  if ( steering < stick->center ) { xInt = map(steering, stick->minValue, (stick->center - stick->deadZone), -100, -1); }
+  else                            { xInt = map(steering, (stick->center + stick->deadZone), stick->maxValue, 1, 100); }
+
+  float xFloat = xInt;
+  float yFloat = yInt;
+
+  if ( yInt > (xInt + 100) ) {
+    xFloat = -100 / (1 - (yFloat / xFloat));
+    yFloat = xFloat + 100;
+  } else if ( yInt > (100 - xInt) ) {
+    xFloat = -100 / (-1 - (yFloat / xFloat));
+    yFloat = -xFloat + 100;
+  } else if ( yInt < (-xInt - 100) ) {
+    xFloat = 100 / (-1 - (yFloat / xFloat));
+    yFloat = -xFloat - 100;
+  } else if ( yInt < (xInt - 100) ) {
+    xFloat = 100 / (1 - (yFloat / xFloat));
+    yFloat = xFloat - 100;
+  }
+
+  float leftSpeed = ((xFloat + yFloat - 100) / 2) + 100;
+  leftSpeed = (leftSpeed - 50) * 2;
+  float rightSpeed = ((yFloat - xFloat - 100) / 2) + 100;
+  rightSpeed = (rightSpeed - 50) * 2;
+
+  *input1 = map(leftSpeed, -100, 100, 180, 0);
+  *input2 = map(rightSpeed, -100, 100, 180, 0);
+}
+
+const int BENCH_SWEEPS = 50;
+
+static Bench_Time s_integerTimes[BENCH_SWEEPS];
+static Bench_Time s_floatTimes[BENCH_SWEEPS];
+
+// ===============
+//      main()
+// ===============
+int main(void)
+{
+  // The sums keep the compiler from dropping the work.
+
+  long integerSum = 0;
+  long floatSum = 0;
+
+  for (int sweep = 0; sweep < BENCH_SWEEPS; sweep++) {
+
+    Bench_Time start = benchNow();
+    for (int throttle = 0; throttle < 256; throttle++) {
+      for (int steering = 0; steering < 256; steering++) {
+        roboteq.mix(throttle, steering);
+        integerSum += roboteq.left() + roboteq.right();
+      }
+    }
+    s_integerTimes[sweep] = benchNow() - start;
+
+    start = benchNow();
+    for (int throttle = 0; throttle < 256; throttle++) {
+      for (int steering = 0; steering < 256; steering++) {
+        int input1;
+        int input2;
+        m_floatMix(throttle, steering, &controller.driveStick, &input1, &input2);
+        floatSum += input1 + input2;
+      }
+    }
+    s_floatTimes[sweep] = benchNow() - start;
+  }
+
+  printf("%d sweeps of 65536 stick positions (sums %ld, %ld)\n\n", BENCH_SWEEPS, integerSum / BENCH_SWEEPS, floatSum / BENCH_SWEEPS);
+  benchHeader();
+  benchReport("Integer mixer", s_integerTimes, BENCH_SWEEPS);
+  benchReport("Float mixer", s_floatTimes, BENCH_SWEEPS);
+  return 0;
+}
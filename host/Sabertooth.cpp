@@ -0,0 +1,82 @@
+/* =================================================================================
+ *    B.L.A.C.Box: Brian Lubkeman's Astromech Controller
+ * =================================================================================
+ * Sabertooth.cpp - Host build stand-in for the Dimension Engineering Sabertooth library
+ * Created by Brian Lubkeman, 16 June 2021
+ * Inspired by S.H.A.D.O.W. controller code written by KnightShade
+ * Released into the public domain.
+ */
+#include "Sabertooth.h"
+
+/* ================================================================================
+ *                                 Sabertooth Class
+ * ================================================================================ */
+
+// =====================
+//      Constructor
+// =====================
+Sabertooth::Sabertooth(byte address, SabertoothStream& port)
+{
+  m_address = address;
+  m_port = &port;
+}
+
+byte Sabertooth::address(void) const              { return m_address; }
+SabertoothStream& Sabertooth::port(void) const    { return *m_port; }
+
+// ===================
+//      command()
+// ===================
+void Sabertooth::command(byte command, byte value) const
+{
+  byte packet[4];
+  packet[0] = m_address;
+  packet[1] = command;
+  packet[2] = value;
+  packet[3] = (m_address + command + value) & 0x7F;
+  m_port->write(packet, 4);
+}
+
+// ==============================
+//      Motion commands
+// ==============================
+
+// Commands 0/1 and 4/5 run motors 1 and 2 forward/back. 8/9 drive and 10/11
+// turn in mixed mode. The value is the power, 0-127.
+
+void Sabertooth::m_throttleCommand(byte command, int power) const
+{
+  power = constrain(power, -126, 126);
+  this->command(command, (byte)abs(power));
+}
+
+void Sabertooth::motor(int power) const                 { motor(1, power); }
+void Sabertooth::drive(int power) const                 { m_throttleCommand(power < 0 ? 9 : 8, power); }
+void Sabertooth::turn(int power) const                  { m_throttleCommand(power < 0 ? 11 : 10, power); }
+
+void Sabertooth::motor(byte motor, int power) const
+{
+  if ( motor < 1 || motor > 2 ) {
+    return;
+  }
+  m_throttleCommand((motor == 2 ? 4 : 0) + (power < 0 ? 1 : 0), power);
+}
+
+void Sabertooth::stop(void) const
+{
+  motor(1, 0);
+  motor(2, 0);
+}
+
+// ==============================
+//      Setting commands
+// ==============================
+void Sabertooth::setTimeout(int milliseconds) const
+{
+  command(14, (byte)((constrain(milliseconds, 0, 12700) + 99) / 100));
+}
+
+void Sabertooth::setRamping(byte value) const
+{
+  command(16, (byte)constrain(value, 0, 80));
+}
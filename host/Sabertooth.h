@@ -0,0 +1,47 @@
+/* =================================================================================
+ *    B.L.A.C.Box: Brian Lubkeman's Astromech Controller
+ * =================================================================================
+ * Sabertooth.h - Host build stand-in for the Dimension Engineering Sabertooth library
+ * Created by Brian Lubkeman, 16 June 2021
+ * Inspired by S.H.A.D.O.W. controller code written by KnightShade
+ * Released into the public domain.
+ * =================================================================================
+ *
+ * Writes the same packetized serial bytes as the library does on the droid:
+ * address, command, value and a 7-bit checksum. Only the calls the sketch makes
+ * are here.
+ */
+#ifndef __BLACBOX_HOST_SABERTOOTH_H__
+#define __BLACBOX_HOST_SABERTOOTH_H__
+
+#include "../src/hal/Hal.h"
+
+typedef Hal_Stream SabertoothStream;
+
+/* ================================================================================
+ *                                 Sabertooth Class
+ * ================================================================================ */
+class Sabertooth
+{
+  private:
+    byte m_address;
+    SabertoothStream* m_port;
+
+    void m_throttleCommand(byte command, int power) const;
+
+  public:
+    Sabertooth(byte address, SabertoothStream& port);
+
+    byte address(void) const;
+    SabertoothStream& port(void) const;
+
+    void command(byte command, byte value) const;
+    void motor(int power) const;
+    void motor(byte motor, int power) const;
+    void drive(int power) const;
+    void turn(int power) const;
+    void stop(void) const;
+    void setTimeout(int milliseconds) const;
+    void setRamping(byte value) const;
+};
+#endif
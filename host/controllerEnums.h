@@ -0,0 +1,50 @@
+/* =================================================================================
+ *    B.L.A.C.Box: Brian Lubkeman's Astromech Controller
+ * =================================================================================
+ * controllerEnums.h - Host build stand-in for the USB Host Shield 2.0 enums
+ * Created by Brian Lubkeman, 16 June 2021
+ * Inspired by S.H.A.D.O.W. controller code written by KnightShade
+ * Released into the public domain.
+ * =================================================================================
+ *
+ * The host build has no USB Host Shield library. This holds the button and stick
+ * enums the sketch uses, with the library's values, so a scripted controller lays
+ * out its button masks the same way a PS controller does on the droid.
+ */
+#ifndef __BLACBOX_HOST_CONTROLLER_ENUMS_H__
+#define __BLACBOX_HOST_CONTROLLER_ENUMS_H__
+
+enum ButtonEnum {
+  UP       = 0,
+  RIGHT    = 1,
+  DOWN     = 2,
+  LEFT     = 3,
+
+  SELECT   = 4,
+  START    = 5,
+  L3       = 6,
+  R3       = 7,
+
+  L2       = 8,
+  R2       = 9,
+  L1       = 10,
+  R1       = 11,
+  TRIANGLE = 12,
+  CIRCLE   = 13,
+  CROSS    = 14,
+  SQUARE   = 15,
+
+  PS       = 16,
+
+  SHARE    = 4,   // PS4
+  OPTIONS  = 5,
+  CREATE   = 4,   // PS5
+};
+
+enum AnalogHatEnum {
+  LeftHatX  = 0,
+  LeftHatY  = 1,
+  RightHatX = 2,
+  RightHatY = 3,
+};
+#endif
@@ -0,0 +1,88 @@
+/* =================================================================================
+ *    B.L.A.C.Box: Brian Lubkeman's Astromech Controller
+ * =================================================================================
+ * main.cpp - Runs the sketch on a PC
+ * Created by Brian Lubkeman, 16 June 2021
+ * Inspired by S.H.A.D.O.W. controller code written by KnightShade
+ * Released into the public domain.
+ * =================================================================================
+ *
+ * Calls setup() once and then loop() forever, as the Arduino core does. Each pass
+ * moves the simulated clock forward one millisecond. Whatever is typed on stdin
+ * arrives on Serial, and whatever the sketch prints on Serial goes to stdout, so
+ * the console can be driven by hand or from a file:
+ *
+ *     blacbox_sketch < commands.txt
+ *
+ * Once stdin runs out the sketch keeps running for one more simulated second,
+ * so the last command's output is printed, and then the program ends.
+ */
+#include "../src/hal/Hal.h"
+
+#include <poll.h>
+#include <unistd.h>
+
+void setup(void);
+void loop(void);
+
+const unsigned long HOST_PASS_TIME = 1000;    // Simulated time per pass (us).
+const unsigned long HOST_RUN_OUT   = 1000;    // Passes run after stdin ends.
+const int           HOST_READ_SIZE = 64;      // Most bytes moved to Serial per pass.
+
+// =====================
+//      m_toStdout()
+// =====================
+static void m_toStdout(const byte* buffer, size_t length)
+{
+  fwrite(buffer, 1, length, stdout);
+  fflush(stdout);
+}
+
+// ===============
+//      main()
+// ===============
+int main(void)
+{
+  Serial.onTransmit(m_toStdout);
+
+  bool interactive = isatty(STDIN_FILENO);
+  bool inputDone = false;
+  unsigned long runOut = 0;
+
+  setup();
+
+  while ( ! inputDone || runOut < HOST_RUN_OUT ) {
+
+    // -------------------------------------------------------
+    // Move what stdin has ready to Serial, leaving room in its
+    // receive buffer. Never wait for input.
+    // -------------------------------------------------------
+
+    if ( ! inputDone && Serial.available() < (HAL_SERIAL_BUFFER_SIZE - HOST_READ_SIZE) ) {
+      struct pollfd input = { STDIN_FILENO, POLLIN, 0 };
+      if ( poll(&input, 1, 0) > 0 ) {
+        byte buffer[HOST_READ_SIZE];
+        ssize_t length = read(STDIN_FILENO, buffer, sizeof(buffer));
+        if ( length > 0 ) {
+          Serial.inject(buffer, (size_t)length);
+        } else {
+          inputDone = true;
+        }
+      }
+    }
+
+    loop();
+    Hal_Clock::advance(HOST_PASS_TIME);
+
+    if ( inputDone ) {
+      runOut++;
+    }
+
+    // Typed input runs in real time.
+
+    if ( interactive ) {
+      usleep(HOST_PASS_TIME);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,418 @@
+/* =================================================================================
+ *    B.L.A.C.Box: Brian Lubkeman's Astromech Controller
+ * =================================================================================
+ * Config.cpp - Flash-resident settings with saved changes in EEPROM
+ * Created by Brian Lubkeman, 16 June 2021
+ * Inspired by S.H.A.D.O.W. controller code written by KnightShade
+ * Released into the public domain.
+ */
+#include "Config.h"
+
+/* ================================================================================
+ *                               Config Section Class
+ * ================================================================================ */
+
+// =====================
+//      Constructor
+// =====================
+Config_Section::Config_Section(Config* config, const byte defaults[], byte count)
+{
+  m_config = config;
+  m_defaults = defaults;
+  m_width = sizeof(byte);
+  m_count = count;
+  m_offset = 0;
+  m_config->add(this);
+}
+
+Config_Section::Config_Section(Config* config, const int defaults[], byte count)
+{
+  m_config = config;
+  m_defaults = defaults;
+  m_width = sizeof(int16_t);
+  m_count = count;
+  m_offset = 0;
+  m_config->add(this);
+}
+
+Config_Section::Config_Section(Config* config, const unsigned long defaults[], byte count)
+{
+  m_config = config;
+  m_defaults = defaults;
+  m_width = sizeof(uint32_t);
+  m_count = count;
+  m_offset = 0;
+  m_config->add(this);
+}
+
+// ===============
+//      get()
+// ===============
+long Config_Section::get(byte index) const
+{
+  if ( index >= m_count ) {
+    return 0;
+  }
+
+  if ( ! m_config->m_checked ) {
+    m_config->m_check();
+  }
+
+  // An unsaved change wins, then the saved image, then the default.
+
+  if ( m_config->m_editCount > 0 ) {
+    int edit = m_config->m_findEdit(this, index);
+    if ( edit >= 0 ) {
+      return m_config->m_edits[edit].value;
+    }
+  }
+  return getSaved(index);
+}
+
+// ======================
+//      getDefault()
+// ======================
+long Config_Section::getDefault(byte index) const
+{
+  if ( index >= m_count ) {
+    return 0;
+  }
+
+  if ( m_width == sizeof(byte) ) {
+    return pgm_read_byte((const byte*)m_defaults + index);
+  } else if ( m_width == sizeof(int16_t) ) {
+    return (int16_t)pgm_read_word((const int*)m_defaults + index);
+  }
+  return (long)pgm_read_dword((const unsigned long*)m_defaults + index);
+}
+
+// ====================
+//      getSaved()
+// ====================
+long Config_Section::getSaved(byte index) const
+{
+  if ( index >= m_count ) {
+    return 0;
+  }
+
+  if ( ! m_config->m_checked ) {
+    m_config->m_check();
+  }
+
+  if ( ! m_config->m_saved ) {
+    return getDefault(index);
+  }
+
+  // ----------------------------------------------------------
+  // Values are stored low byte first, the same as they sit in
+  // memory. Two byte values are signed, the others unsigned.
+  // ----------------------------------------------------------
+
+  uint16_t address = CONFIG_EEPROM_BASE + sizeof(Config_Header_Struct) + m_offset + (index * m_width);
+  uint32_t value = 0;
+  for (byte i = 0; i < m_width; i++) {
+    value |= (uint32_t)Hal_Eeprom::read(address + i) << (8 * i);
+  }
+
+  if ( m_width == sizeof(int16_t) ) {
+    return (int16_t)value;
+  }
+  return (long)value;
+}
+
+// ===============
+//      set()
+// ===============
+bool Config_Section::set(byte index, long value)
+{
+  if ( index >= m_count || ! fits(value) ) {
+    return false;
+  }
+
+  if ( ! m_config->m_checked ) {
+    m_config->m_check();
+  }
+
+  // ------------------------------------------------------------
+  // Keep the change in SRAM. A value put back to what is saved
+  // needs no entry, which also frees room for another change.
+  // ------------------------------------------------------------
+
+  Config* config = m_config;
+  int edit = config->m_findEdit(this, index);
+
+  if ( value == getSaved(index) ) {
+    if ( edit >= 0 ) {
+      config->m_edits[edit] = config->m_edits[--config->m_editCount];
+    }
+    return true;
+  }
+
+  if ( edit < 0 ) {
+    if ( config->m_editCount >= CONFIG_MAX_EDITS ) {
+      return false;
+    }
+    edit = config->m_editCount++;
+    config->m_edits[edit].section = this;
+    config->m_edits[edit].index = index;
+  }
+  config->m_edits[edit].value = value;
+  return true;
+}
+
+// ================
+//      fits()
+// ================
+bool Config_Section::fits(long value) const
+{
+  // Whether the setting's type can hold the value.
+
+  return ! ( (m_width == sizeof(byte) && (value < 0 || value > 255)) ||
+             (m_width == sizeof(int16_t) && (value < -32768L || value > 32767L)) ||
+             (m_width == sizeof(uint32_t) && value < 0) );
+}
+
+// =================
+//      count()
+// =================
+byte Config_Section::count(void) const
+{
+  return m_count;
+}
+
+// =================
+//      width()
+// =================
+byte Config_Section::width(void) const
+{
+  return m_width;
+}
+
+/* ================================================================================
+ *                                   Config Class
+ * ================================================================================ */
+
+// =====================
+//      Constructor
+// =====================
+Config::Config(uint16_t version)
+{
+  m_sectionCount = 0;
+  m_version = version;
+  m_length = 0;
+  m_checked = false;
+  m_saved = false;
+  m_editCount = 0;
+}
+
+// ====================
+//      Destructor
+// ====================
+Config::~Config(void) {}
+
+// ===============
+//      add()
+// ===============
+bool Config::add(Config_Section* section)
+{
+  if ( m_sectionCount >= CONFIG_MAX_SECTIONS || m_checked ) {
+
+    #if defined(DEBUG)
+    Debug.print(DBG_ERROR, F("Config"), F("add()"), F("Section not added"));
+    #endif
+
+    return false;
+  }
+
+  section->m_offset = m_length;
+  m_length += section->m_count * section->m_width;
+  m_sections[m_sectionCount++] = section;
+  return true;
+}
+
+// ================
+//      save()
+// ================
+bool Config::save(void)
+{
+  if ( ! m_checked ) {
+    m_check();
+  }
+
+  if ( CONFIG_EEPROM_BASE + sizeof(Config_Header_Struct) + m_length > Hal_Eeprom::length() - CONFIG_EEPROM_RESERVED ) {
+    return false;
+  }
+
+  // -----------------------------------------------------------
+  // Invalidate the header first. A reset part way through leaves
+  // no valid image rather than a header over half-written data.
+  // Each setting is read before its own bytes are written, so the
+  // image can be rewritten in place. Only bytes that change are
+  // written, so a save after a few changes is quick.
+  // -----------------------------------------------------------
+
+  Hal_Eeprom::update(CONFIG_EEPROM_BASE, 0xFF);
+  Hal_Eeprom::update(CONFIG_EEPROM_BASE + 1, 0xFF);
+
+  uint16_t saved = CONFIG_EEPROM_BASE + sizeof(Config_Header_Struct);
+  for (byte s = 0; s < m_sectionCount; s++) {
+    Config_Section* section = m_sections[s];
+    uint16_t address = saved + section->m_offset;
+
+    for (byte index = 0; index < section->m_count; index++) {
+      uint32_t value = (uint32_t)section->get(index);
+      for (byte i = 0; i < section->m_width; i++) {
+        Hal_Eeprom::update(address++, (byte)(value >> (8 * i)));
+      }
+    }
+  }
+
+  Config_Header_Struct header;
+  header.magic   = CONFIG_MAGIC;
+  header.version = m_version;
+  header.length  = m_length;
+  header.crc     = m_crc(saved, m_length);
+
+  const byte* bytes = (const byte*)&header;
+  for (int i = sizeof(header) - 1; i >= 0; i--) {
+    Hal_Eeprom::update(CONFIG_EEPROM_BASE + i, bytes[i]);
+  }
+
+  m_saved = true;
+  m_editCount = 0;
+
+  #if defined(DEBUG)
+  Debug.print(DBG_INFO, F("Config"), F("save()"), F("Settings saved"));
+  #endif
+
+  return true;
+}
+
+// ===========================
+//      restoreDefaults()
+// ===========================
+void Config::restoreDefaults(void)
+{
+  if ( ! m_checked ) {
+    m_check();
+  }
+
+  Hal_Eeprom::update(CONFIG_EEPROM_BASE, 0xFF);
+  Hal_Eeprom::update(CONFIG_EEPROM_BASE + 1, 0xFF);
+  m_saved = false;
+  m_editCount = 0;
+
+  #if defined(DEBUG)
+  Debug.print(DBG_INFO, F("Config"), F("restoreDefaults()"), F("Using the default settings"));
+  #endif
+}
+
+// ========================
+//      isCustomized()
+// ========================
+bool Config::isCustomized(void)
+{
+  if ( ! m_checked ) {
+    m_check();
+  }
+  return ( m_saved || m_editCount > 0 );
+}
+
+// ===================
+//      isDirty()
+// ===================
+bool Config::isDirty(void)
+{
+  return ( m_editCount > 0 );
+}
+
+// ========================
+//      sectionCount()
+// ========================
+byte Config::sectionCount(void)
+{
+  return m_sectionCount;
+}
+
+// ===================
+//      section()
+// ===================
+Config_Section* Config::section(byte index)
+{
+  if ( index >= m_sectionCount ) {
+    return NULL;
+  }
+  return m_sections[index];
+}
+
+// ===================
+//      m_check()
+// ===================
+void Config::m_check(void)
+{
+  m_checked = true;
+  m_saved = false;
+
+  if ( CONFIG_EEPROM_BASE + sizeof(Config_Header_Struct) + m_length > Hal_Eeprom::length() - CONFIG_EEPROM_RESERVED ) {
+
+    #if defined(DEBUG)
+    Debug.print(DBG_ERROR, F("Config"), F("m_check()"), F("Settings do not fit in EEPROM"));
+    #endif
+
+    return;
+  }
+
+  Config_Header_Struct header;
+  byte* bytes = (byte*)&header;
+  for (byte i = 0; i < sizeof(header); i++) {
+    bytes[i] = Hal_Eeprom::read(CONFIG_EEPROM_BASE + i);
+  }
+
+  uint16_t saved = CONFIG_EEPROM_BASE + sizeof(Config_Header_Struct);
+  if ( header.magic != CONFIG_MAGIC || header.version != m_version || header.length != m_length || header.crc != m_crc(saved, m_length) ) {
+
+    #if defined(DEBUG)
+    if ( header.magic == CONFIG_MAGIC ) {
+      Debug.print(DBG_WARNING, F("Config"), F("m_check()"), F("Saved settings do not match this sketch. Using defaults."));
+    }
+    #endif
+
+    return;
+  }
+
+  m_saved = true;
+
+  #if defined(DEBUG)
+  Debug.print(DBG_INFO, F("Config"), F("m_check()"), F("Using saved settings"));
+  #endif
+}
+
+// ======================
+//      m_findEdit()
+// ======================
+int Config::m_findEdit(const Config_Section* section, byte index)
+{
+  for (byte i = 0; i < m_editCount; i++) {
+    if ( m_edits[i].section == section && m_edits[i].index == index ) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// =================
+//      m_crc()
+// =================
+uint16_t Config::m_crc(uint16_t address, uint16_t length)
+{
+  // CRC-16/CCITT-FALSE, one bit at a time. Only run at startup and on save().
+
+  uint16_t crc = 0xFFFF;
+  for (uint16_t i = 0; i < length; i++) {
+    crc ^= (uint16_t)Hal_Eeprom::read(address + i) << 8;
+    for (byte bit = 0; bit < 8; bit++) {
+      crc = ( crc & 0x8000 ) ? (crc << 1) ^ 0x1021 : (crc << 1);
+    }
+  }
+  return crc;
+}
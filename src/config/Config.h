@@ -0,0 +1,120 @@
+/* =================================================================================
+ *    B.L.A.C.Box: Brian Lubkeman's Astromech Controller
+ * =================================================================================
+ * Config.h - Flash-resident settings with saved changes in EEPROM
+ * Created by Brian Lubkeman, 16 June 2021
+ * Inspired by S.H.A.D.O.W. controller code written by KnightShade
+ * Released into the public domain.
+ * =================================================================================
+ *
+ * The settings arrays in Settings.h live in PROGMEM and are the defaults. Each one
+ * is wrapped in a Config_Section, and every peripheral reads its settings through
+ * Config_Section::get() instead of indexing an array in SRAM.
+ *
+ * The EEPROM holds the saved settings behind a header with a version, their length
+ * and a CRC. At startup a valid saved image is read in place of the defaults, so
+ * tuning done at an event survives a reset. An image whose version, length or CRC
+ * does not match is ignored, and the defaults are used instead.
+ *
+ * Changes made with set() take effect at once, and are kept in a small table in
+ * SRAM. Writing EEPROM takes over 3 ms a byte, far too long for a pass of the
+ * loop, so nothing is written until save() is called. Only then do the changes
+ * last past a reset.
+ *
+ * Every Config_Section must be declared before anything reads a setting. The first
+ * read checks the saved image against the full list of sections.
+ */
+#ifndef __BLACBOX_CONFIG_H__
+#define __BLACBOX_CONFIG_H__
+
+#include "../toolbox/DebugUtils.h"
+#include "../hal/Hal.h"
+
+#define DEBUG
+
+const uint16_t CONFIG_MAGIC           = 0xB1AC;
+const uint16_t CONFIG_EEPROM_BASE     = 0;     // Where the saved image starts.
+const uint16_t CONFIG_EEPROM_RESERVED = 64;    // Left free at the end of EEPROM for paired controllers.
+const byte     CONFIG_MAX_SECTIONS    = 16;
+const byte     CONFIG_MAX_EDITS       = 12;    // Changes held in SRAM until save().
+
+typedef struct {
+  uint16_t magic;
+  uint16_t version;
+  uint16_t length;
+  uint16_t crc;
+} Config_Header_Struct;
+
+class Config;
+class Config_Section;
+
+typedef struct {
+  const Config_Section* section;
+  byte index;
+  long value;
+} Config_Edit_Struct;
+
+/* ================================================================================
+ *                               Config Section Class
+ * ================================================================================ */
+class Config_Section
+{
+  private:
+    Config* m_config;
+    const void* m_defaults;
+    byte m_width;
+    byte m_count;
+    uint16_t m_offset;
+
+    friend class Config;
+
+  public:
+    Config_Section(Config* config, const byte defaults[], byte count);
+    Config_Section(Config* config, const int defaults[], byte count);
+    Config_Section(Config* config, const unsigned long defaults[], byte count);
+
+    long get(byte index) const;
+    long getDefault(byte index) const;
+    long getSaved(byte index) const;
+    bool set(byte index, long value);
+    bool fits(long value) const;
+
+    byte count(void) const;
+    byte width(void) const;
+};
+
+/* ================================================================================
+ *                                   Config Class
+ * ================================================================================ */
+class Config
+{
+  private:
+    Config_Section* m_sections[CONFIG_MAX_SECTIONS];
+    byte m_sectionCount;
+    uint16_t m_version;
+    uint16_t m_length;
+    bool m_checked;
+    bool m_saved;
+    Config_Edit_Struct m_edits[CONFIG_MAX_EDITS];
+    byte m_editCount;
+
+    void m_check(void);
+    int m_findEdit(const Config_Section* section, byte index);
+    uint16_t m_crc(uint16_t address, uint16_t length);
+
+    friend class Config_Section;
+
+  public:
+    Config(uint16_t version);
+    ~Config(void);
+
+    bool add(Config_Section* section);
+    bool save(void);
+    void restoreDefaults(void);
+
+    bool isCustomized(void);
+    bool isDirty(void);
+    byte sectionCount(void);
+    Config_Section* section(byte index);
+};
+#endif
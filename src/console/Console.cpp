@@ -0,0 +1,705 @@
+/* =================================================================================
+ *    B.L.A.C.Box: Brian Lubkeman's Astromech Controller
+ * =================================================================================
+ * Console.cpp - Serial console for tuning settings and checking the loop
+ * Created by Brian Lubkeman, 16 June 2021
+ * Inspired by S.H.A.D.O.W. controller code written by KnightShade
+ * Released into the public domain.
+ */
+#include "Console.h"
+
+const char CONSOLE_HELP[] PROGMEM =
+  "help                        This list.\r\n"
+  "list                        Setting sections and their sizes.\r\n"
+  "get <section> [index]       Show one setting, or a whole section.\r\n"
+  "set <section> <index> <n>   Change a setting now. Pins, addresses, the\r\n"
+  "                            dome sensor, the dead man switch and stick\r\n"
+  "                            sides only change after a reset.\r\n"
+  "save                        Keep changed settings past a reset.\r\n"
+  "defaults                    Go back to the settings in Settings.h.\r\n"
+  "md <command>                Send a command to the dome Marcduino.\r\n"
+  "mb <command>                Send a command to the body Marcduino.\r\n"
+  "act <action> [arg1] [arg2]  Run a Marcduino action by number.\r\n"
+  "stats                       Loop timing, timeline and queue counters.\r\n"
+  "devices                     List the authorized controllers.\r\n"
+  "pair                        Authorize the next new controller to connect.\r\n"
+  "unpair <address>            Remove a paired controller, e.g. 00:1B:FB:63:A1:5C\r\n";
+
+/* ================================================================================
+ *                                  Console Class
+ * ================================================================================ */
+
+// =====================
+//      Constructor
+// =====================
+Console::Console(Hal_SerialPort& port, Config* config, PGM_P sectionNames)
+{
+  m_port = &port;
+  m_config = config;
+  m_sectionNames = sectionNames;
+
+  m_profiler = NULL;
+  m_timeline = NULL;
+  m_queueCount = 0;
+  m_devices = NULL;
+
+  m_onSend = NULL;
+  m_onAction = NULL;
+  m_onChange = NULL;
+
+  m_length = 0;
+  m_overflow = false;
+}
+
+// ====================
+//      Destructor
+// ====================
+Console::~Console(void) {}
+
+// ==========================
+//      attachProfiler()
+// ==========================
+void Console::attachProfiler(LoopProfiler* profiler)
+{
+  m_profiler = profiler;
+}
+
+// ==========================
+//      attachTimeline()
+// ==========================
+void Console::attachTimeline(Timeline* timeline)
+{
+  m_timeline = timeline;
+}
+
+// =======================
+//      attachQueue()
+// =======================
+bool Console::attachQueue(SerialQueue* queue, const char* name)
+{
+  if ( m_queueCount >= CONSOLE_MAX_QUEUES ) {
+    return false;
+  }
+
+  m_queues[m_queueCount] = queue;
+  m_queueNames[m_queueCount] = name;
+  m_queueCount++;
+  return true;
+}
+
+// =========================
+//      attachDevices()
+// =========================
+void Console::attachDevices(Authorized_Devices* devices)
+{
+  m_devices = devices;
+}
+
+// ======================
+//      attachSend()
+// ======================
+void Console::attachSend(Console_Send_Callback callback)
+{
+  m_onSend = callback;
+}
+
+// ========================
+//      attachAction()
+// ========================
+void Console::attachAction(Console_Action_Callback callback)
+{
+  m_onAction = callback;
+}
+
+// ==========================
+//      attachOnChange()
+// ==========================
+void Console::attachOnChange(Console_Change_Callback callback)
+{
+  m_onChange = callback;
+}
+
+// ===============
+//      run()
+// ===============
+void Console::run(void)
+{
+  // Nothing typed, nothing to do.
+
+  if ( m_port->available() <= 0 ) {
+    return;
+  }
+
+  // ----------------------------------------------------------------
+  // Take what has arrived, a few characters at a time. A line longer
+  // than the buffer is thrown away whole when it ends.
+  // ----------------------------------------------------------------
+
+  for (byte i = 0; i < CONSOLE_READ_PER_PASS; i++) {
+
+    int value = m_port->read();
+    if ( value < 0 ) {
+      return;
+    }
+    char c = (char)value;
+
+    if ( c == '\r' || c == '\n' ) {
+      if ( m_overflow ) {
+        m_print(PSTR("Line too long"));
+        m_newline();
+      } else if ( m_length > 0 ) {
+        m_line[m_length] = '\0';
+        m_execute();
+      }
+      m_length = 0;
+      m_overflow = false;
+      return;
+    }
+
+    if ( c == '\b' || c == 0x7F ) {
+      if ( m_length > 0 ) {
+        m_length--;
+      }
+      continue;
+    }
+
+    if ( m_length >= CONSOLE_LINE_SIZE - 1 ) {
+      m_overflow = true;
+      continue;
+    }
+    m_line[m_length++] = c;
+  }
+}
+
+// =====================
+//      m_execute()
+// =====================
+void Console::m_execute(void)
+{
+  // -------------------------------------------------------------
+  // Marcduino commands may hold spaces, so everything after md or
+  // mb is sent as typed. Every other command is split into words.
+  // -------------------------------------------------------------
+
+  char* text = m_line;
+  while ( *text == ' ' ) {
+    text++;
+  }
+
+  if ( (strncmp(text, "md ", 3) == 0) || (strncmp(text, "mb ", 3) == 0) ) {
+    m_send(text + 3, ( text[1] == 'b' ? 1 : 0 ));
+    return;
+  }
+
+  char* args[CONSOLE_MAX_ARGS];
+  byte argCount = m_split(text, args);
+  if ( argCount == 0 ) {
+    return;
+  }
+
+  if ( strcmp(args[0], "help") == 0 ) {
+    m_help();
+  } else if ( strcmp(args[0], "list") == 0 ) {
+    m_list();
+  } else if ( strcmp(args[0], "get") == 0 ) {
+    m_get(argCount, args);
+  } else if ( strcmp(args[0], "set") == 0 ) {
+    m_set(argCount, args);
+  } else if ( strcmp(args[0], "save") == 0 ) {
+    if ( m_config->save() ) {
+      m_print(PSTR("Saved"));
+    } else {
+      m_print(PSTR("Settings do not fit in EEPROM"));
+    }
+    m_newline();
+  } else if ( strcmp(args[0], "defaults") == 0 ) {
+    m_config->restoreDefaults();
+    m_print(PSTR("Using the settings in Settings.h. Reset to apply them everywhere."));
+    m_newline();
+  } else if ( strcmp(args[0], "act") == 0 ) {
+    m_action(argCount, args);
+  } else if ( strcmp(args[0], "stats") == 0 ) {
+    m_stats();
+  } else if ( strcmp(args[0], "devices") == 0 ) {
+    m_listDevices();
+  } else if ( strcmp(args[0], "pair") == 0 ) {
+    m_pair();
+  } else if ( strcmp(args[0], "unpair") == 0 ) {
+    m_unpair(argCount, args);
+  } else {
+    m_print(PSTR("Unknown command. Type help for a list."));
+    m_newline();
+  }
+}
+
+// ===================
+//      m_split()
+// ===================
+byte Console::m_split(char* text, char* args[])
+{
+  byte count = 0;
+
+  while ( *text != '\0' && count < CONSOLE_MAX_ARGS ) {
+    while ( *text == ' ' ) {
+      *text++ = '\0';
+    }
+    if ( *text == '\0' ) {
+      break;
+    }
+    args[count++] = text;
+    while ( *text != '\0' && *text != ' ' ) {
+      text++;
+    }
+  }
+  return count;
+}
+
+// =========================
+//      m_parseNumber()
+// =========================
+bool Console::m_parseNumber(const char* text, long* value)
+{
+  bool negative = false;
+  if ( *text == '-' ) {
+    negative = true;
+    text++;
+  }
+  if ( *text == '\0' ) {
+    return false;
+  }
+
+  long result = 0;
+  for ( ; *text != '\0'; text++) {
+    if ( *text < '0' || *text > '9' ) {
+      return false;
+    }
+    result = (result * 10) + (*text - '0');
+  }
+
+  *value = ( negative ? -result : result );
+  return true;
+}
+
+// =========================
+//      m_findSection()
+// =========================
+Config_Section* Console::m_findSection(const char* name, byte* number)
+{
+  // A section may be given by its number.
+
+  long value;
+  if ( m_parseNumber(name, &value) ) {
+    if ( value < 0 || value >= m_config->sectionCount() ) {
+      return NULL;
+    }
+    *number = value;
+    return m_config->section(value);
+  }
+
+  // Otherwise, walk the names in flash, one word per section.
+
+  if ( m_sectionNames == NULL ) {
+    return NULL;
+  }
+
+  PGM_P p = m_sectionNames;
+  for (byte s = 0; s < m_config->sectionCount(); s++) {
+
+    byte i = 0;
+    char c = pgm_read_byte(p);
+    while ( c != '\0' && c != ' ' && c == name[i] ) {
+      i++;
+      c = pgm_read_byte(p + i);
+    }
+    if ( name[i] == '\0' && (c == '\0' || c == ' ') ) {
+      *number = s;
+      return m_config->section(s);
+    }
+
+    // Skip to the next name.
+    while ( c != '\0' && c != ' ' ) {
+      i++;
+      c = pgm_read_byte(p + i);
+    }
+    if ( c == '\0' ) {
+      return NULL;
+    }
+    p += i + 1;
+  }
+  return NULL;
+}
+
+// ==================
+//      m_help()
+// ==================
+void Console::m_help(void)
+{
+  m_print(CONSOLE_HELP);
+}
+
+// ==================
+//      m_list()
+// ==================
+void Console::m_list(void)
+{
+  for (byte s = 0; s < m_config->sectionCount(); s++) {
+    m_printNumber(s);
+    m_print(PSTR("  "));
+    m_printSectionName(s);
+    m_print(PSTR("  ("));
+    m_printNumber(m_config->section(s)->count());
+    m_print(PSTR(" settings)"));
+    m_newline();
+  }
+
+  if ( m_config->isDirty() ) {
+    m_print(PSTR("Changes are not saved."));
+  } else if ( m_config->isCustomized() ) {
+    m_print(PSTR("Using saved settings."));
+  } else {
+    m_print(PSTR("Using the settings in Settings.h."));
+  }
+  m_newline();
+}
+
+// =================
+//      m_get()
+// =================
+void Console::m_get(byte argCount, char* args[])
+{
+  byte number = 0;
+  Config_Section* section = ( argCount > 1 ? m_findSection(args[1], &number) : NULL );
+  if ( section == NULL ) {
+    m_print(PSTR("Unknown section. Type list for the sections."));
+    m_newline();
+    return;
+  }
+
+  if ( argCount == 2 ) {
+    for (byte i = 0; i < section->count(); i++) {
+      m_showSetting(number, section, i);
+    }
+    return;
+  }
+
+  long index;
+  if ( ! m_parseNumber(args[2], &index) || index < 0 || index >= section->count() ) {
+    m_print(PSTR("Index out of range"));
+    m_newline();
+    return;
+  }
+  m_showSetting(number, section, index);
+}
+
+// =================
+//      m_set()
+// =================
+void Console::m_set(byte argCount, char* args[])
+{
+  if ( argCount < 4 ) {
+    m_print(PSTR("Usage: set <section> <index> <value>"));
+    m_newline();
+    return;
+  }
+
+  byte number = 0;
+  Config_Section* section = m_findSection(args[1], &number);
+  if ( section == NULL ) {
+    m_print(PSTR("Unknown section. Type list for the sections."));
+    m_newline();
+    return;
+  }
+
+  long index;
+  long value;
+  if ( ! m_parseNumber(args[2], &index) || index < 0 || index >= section->count() ) {
+    m_print(PSTR("Index out of range"));
+    m_newline();
+    return;
+  }
+  if ( ! m_parseNumber(args[3], &value) ) {
+    m_print(PSTR("Not a number"));
+    m_newline();
+    return;
+  }
+
+  if ( ! section->fits(value) ) {
+    m_print(PSTR("Out of range for this setting"));
+    m_newline();
+    return;
+  }
+  if ( ! section->set(index, value) ) {
+    m_print(PSTR("Too many unsaved changes. Type save first."));
+    m_newline();
+    return;
+  }
+
+  if ( m_onChange != NULL ) {
+    m_onChange(section, index);
+  }
+  m_showSetting(number, section, index);
+}
+
+// ==================
+//      m_send()
+// ==================
+void Console::m_send(char* text, byte location)
+{
+  while ( *text == ' ' ) {
+    text++;
+  }
+
+  if ( m_onSend == NULL || *text == '\0' ) {
+    return;
+  }
+  m_onSend(text, location);
+}
+
+// ====================
+//      m_action()
+// ====================
+void Console::m_action(byte argCount, char* args[])
+{
+  long values[3] = { 0, 0, 0 };
+
+  if ( argCount < 2 ) {
+    m_print(PSTR("Usage: act <action> [arg1] [arg2]"));
+    m_newline();
+    return;
+  }
+
+  for (byte i = 1; i < argCount && i <= 3; i++) {
+    if ( ! m_parseNumber(args[i], &values[i - 1]) || values[i - 1] < 0 || values[i - 1] > 255 ) {
+      m_print(PSTR("Each number must be 0-255"));
+      m_newline();
+      return;
+    }
+  }
+
+  if ( m_onAction != NULL ) {
+    m_onAction(values[0], values[1], values[2]);
+  }
+}
+
+// ===================
+//      m_stats()
+// ===================
+void Console::m_stats(void)
+{
+  if ( m_timeline != NULL ) {
+    m_print(PSTR("Timeline   pending "));
+    m_printNumber(m_timeline->pending());
+    m_print(PSTR("  high "));
+    m_printNumber(m_timeline->highWater());
+    m_print(PSTR("  free "));
+    m_printNumber(m_timeline->available());
+    m_print(PSTR("  dropped "));
+    m_printNumber(m_timeline->dropped());
+    m_newline();
+  }
+
+  for (byte i = 0; i < m_queueCount; i++) {
+    m_print(PSTR("Queue "));
+    m_printText(m_queueNames[i]);
+    m_print(PSTR("  depth "));
+    m_printNumber(m_queues[i]->depth());
+    m_print(PSTR("  high "));
+    m_printNumber(m_queues[i]->highWater());
+    m_print(PSTR("  dropped "));
+    m_printNumber(m_queues[i]->dropped());
+    m_newline();
+  }
+
+  if ( m_profiler != NULL ) {
+    m_profiler->report(m_port);
+  } else {
+    m_print(PSTR("Loop timing needs PROFILE_LOOP defined in Scheduler.h."));
+    m_newline();
+  }
+}
+
+// =========================
+//      m_listDevices()
+// =========================
+void Console::m_listDevices(void)
+{
+  if ( m_devices == NULL ) {
+    return;
+  }
+
+  byte address[MAC_ADDRESS_SIZE];
+
+  for (byte i = 0; i < m_devices->tableCount(); i++) {
+    m_devices->tableEntry(i, address);
+    if ( Authorized_Devices::isUnset(address) ) {
+      continue;
+    }
+    m_printAddress(address);
+    m_print(PSTR("  Security.h"));
+    m_newline();
+  }
+  for (byte i = 0; i < m_devices->pairedCount(); i++) {
+    m_devices->paired(i, address);
+    m_printAddress(address);
+    m_print(PSTR("  paired"));
+    m_newline();
+  }
+  if ( m_devices->isPairing() ) {
+    m_print(PSTR("Waiting for a new controller"));
+    m_newline();
+  }
+}
+
+// ==================
+//      m_pair()
+// ==================
+void Console::m_pair(void)
+{
+  if ( m_devices == NULL ) {
+    return;
+  }
+
+  if ( m_devices->pairedCount() >= PAIRED_MAX_DEVICES ) {
+    m_print(PSTR("No room. Unpair a controller first."));
+    m_newline();
+    return;
+  }
+
+  m_devices->startPairing(PAIRING_TIME);
+  m_print(PSTR("Connect the new controller within a minute"));
+  m_newline();
+}
+
+// ====================
+//      m_unpair()
+// ====================
+void Console::m_unpair(byte argCount, char* args[])
+{
+  byte address[MAC_ADDRESS_SIZE];
+
+  if ( m_devices == NULL ) {
+    return;
+  }
+
+  if ( argCount < 2 || ! Authorized_Devices::parse(args[1], address) ) {
+    m_print(PSTR("Usage: unpair XX:XX:XX:XX:XX:XX"));
+    m_newline();
+    return;
+  }
+
+  if ( m_devices->remove(address) ) {
+    m_print(PSTR("Removed"));
+  } else {
+    m_print(PSTR("Not a paired controller"));
+  }
+  m_newline();
+}
+
+// =========================
+//      m_showSetting()
+// =========================
+void Console::m_showSetting(byte number, Config_Section* section, byte index)
+{
+  m_printSectionName(number);
+  m_print(PSTR("["));
+  m_printNumber(index);
+  m_print(PSTR("] = "));
+  m_printNumber(section->get(index));
+
+  long fallback = section->getDefault(index);
+  if ( section->get(index) != fallback ) {
+    m_print(PSTR("  (default "));
+    m_printNumber(fallback);
+    m_print(PSTR(")"));
+  }
+  m_newline();
+}
+
+// ==============================
+//      m_printSectionName()
+// ==============================
+void Console::m_printSectionName(byte number)
+{
+  // Find the name in flash. Fall back to the number when there is none.
+
+  PGM_P p = m_sectionNames;
+  for (byte s = 0; p != NULL && s < number; s++) {
+    char c;
+    while ( (c = pgm_read_byte(p)) != '\0' && c != ' ' ) {
+      p++;
+    }
+    p = ( c == '\0' ? NULL : p + 1 );
+  }
+
+  if ( p == NULL || pgm_read_byte(p) == '\0' ) {
+    m_printNumber(number);
+    return;
+  }
+
+  char c;
+  while ( (c = pgm_read_byte(p++)) != '\0' && c != ' ' ) {
+    m_port->write((byte)c);
+  }
+}
+
+// ===================
+//      m_print()
+// ===================
+void Console::m_print(PGM_P text)
+{
+  char c;
+  while ( (c = pgm_read_byte(text++)) != '\0' ) {
+    m_port->write((byte)c);
+  }
+}
+
+// =======================
+//      m_printText()
+// =======================
+void Console::m_printText(const char* text)
+{
+  while ( *text != '\0' ) {
+    m_port->write((byte)*text++);
+  }
+}
+
+// =========================
+//      m_printNumber()
+// =========================
+void Console::m_printNumber(long value)
+{
+  char digits[12];
+  byte count = 0;
+  unsigned long magnitude = ( value < 0 ? -(unsigned long)value : value );
+
+  do {
+    digits[count++] = '0' + (magnitude % 10);
+    magnitude /= 10;
+  } while ( magnitude > 0 );
+
+  if ( value < 0 ) {
+    m_port->write((byte)'-');
+  }
+  while ( count > 0 ) {
+    m_port->write((byte)digits[--count]);
+  }
+}
+
+// ==========================
+//      m_printAddress()
+// ==========================
+void Console::m_printAddress(const byte address[])
+{
+  char text[MAC_TEXT_SIZE];
+  Authorized_Devices::format(address, text);
+  m_printText(text);
+}
+
+// =====================
+//      m_newline()
+// =====================
+void Console::m_newline(void)
+{
+  m_port->write((byte)'\r');
+  m_port->write((byte)'\n');
+}
@@ -0,0 +1,105 @@
+/* =================================================================================
+ *    B.L.A.C.Box: Brian Lubkeman's Astromech Controller
+ * =================================================================================
+ * Console.h - Serial console for tuning settings and checking the loop
+ * Created by Brian Lubkeman, 16 June 2021
+ * Inspired by S.H.A.D.O.W. controller code written by KnightShade
+ * Released into the public domain.
+ * =================================================================================
+ *
+ * Type a line into the serial monitor and press enter. Type "help" for the
+ * commands. With the console you can read and change any setting, save changes
+ * to EEPROM, send a Marcduino command, and print the loop, timeline and serial
+ * queue counters. Controllers can be authorized and removed without a reflash.
+ *
+ * Input is read a few characters per pass into a fixed line buffer and never
+ * waits. A line runs once its carriage return or newline arrives. When nothing
+ * has been typed, run() only checks whether the port has input.
+ *
+ * Sections are named by a PROGMEM string of space-separated names, in the order
+ * the sections were added to the config. A section can also be given by number.
+ */
+#ifndef __BLACBOX_CONSOLE_H__
+#define __BLACBOX_CONSOLE_H__
+
+#include "../hal/Hal.h"
+#include "../hal/SerialQueue.h"
+#include "../config/Config.h"
+#include "../scheduler/Timeline.h"
+#include "../toolbox/LoopProfiler.h"
+#include "../controller/AuthorizedDevices.h"
+
+const byte CONSOLE_LINE_SIZE     = 64;   // Longest line, including its terminator.
+const byte CONSOLE_MAX_ARGS      = 4;
+const byte CONSOLE_MAX_QUEUES    = 4;
+const byte CONSOLE_READ_PER_PASS = 16;   // Most characters taken in one pass.
+
+typedef void (*Console_Send_Callback)(const char* command, byte location);  // location: 0=dome, 1=body.
+typedef void (*Console_Action_Callback)(byte action, byte arg1, byte arg2);
+typedef void (*Console_Change_Callback)(const Config_Section* section, byte index);
+
+/* ================================================================================
+ *                                  Console Class
+ * ================================================================================ */
+class Console
+{
+  private:
+    Hal_SerialPort* m_port;
+    Config* m_config;
+    PGM_P m_sectionNames;
+
+    LoopProfiler* m_profiler;
+    Timeline* m_timeline;
+    SerialQueue* m_queues[CONSOLE_MAX_QUEUES];
+    const char* m_queueNames[CONSOLE_MAX_QUEUES];
+    byte m_queueCount;
+    Authorized_Devices* m_devices;
+
+    Console_Send_Callback m_onSend;
+    Console_Action_Callback m_onAction;
+    Console_Change_Callback m_onChange;
+
+    char m_line[CONSOLE_LINE_SIZE];
+    byte m_length;
+    bool m_overflow;
+
+    void m_execute(void);
+    byte m_split(char* text, char* args[]);
+    bool m_parseNumber(const char* text, long* value);
+    Config_Section* m_findSection(const char* name, byte* number);
+
+    void m_help(void);
+    void m_list(void);
+    void m_get(byte argCount, char* args[]);
+    void m_set(byte argCount, char* args[]);
+    void m_send(char* text, byte location);
+    void m_action(byte argCount, char* args[]);
+    void m_stats(void);
+    void m_listDevices(void);
+    void m_pair(void);
+    void m_unpair(byte argCount, char* args[]);
+
+    void m_showSetting(byte number, Config_Section* section, byte index);
+    void m_printSectionName(byte number);
+
+    void m_print(PGM_P text);
+    void m_printText(const char* text);
+    void m_printNumber(long value);
+    void m_printAddress(const byte address[]);
+    void m_newline(void);
+
+  public:
+    Console(Hal_SerialPort& port, Config* config, PGM_P sectionNames);
+    ~Console(void);
+
+    void attachProfiler(LoopProfiler* profiler);
+    void attachTimeline(Timeline* timeline);
+    bool attachQueue(SerialQueue* queue, const char* name);
+    void attachDevices(Authorized_Devices* devices);
+    void attachSend(Console_Send_Callback callback);
+    void attachAction(Console_Action_Callback callback);
+    void attachOnChange(Console_Change_Callback callback);
+
+    void run(void);
+};
+#endif
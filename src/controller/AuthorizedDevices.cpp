@@ -0,0 +1,305 @@
+/* =================================================================================
+ *    B.L.A.C.Box: Brian Lubkeman's Astromech Controller
+ * =================================================================================
+ * AuthorizedDevices.cpp - The controllers allowed to connect to the droid
+ * Created by Brian Lubkeman, 16 June 2021
+ * Inspired by S.H.A.D.O.W. controller code written by KnightShade
+ * Released into the public domain.
+ */
+#include "AuthorizedDevices.h"
+
+// ---------------------------------------------------------------
+// EEPROM layout, at the end of EEPROM where Config never writes:
+//   magic, count, then count packed addresses with no gaps.
+// ---------------------------------------------------------------
+
+/* ================================================================================
+ *                             Authorized Devices Class
+ * ================================================================================ */
+
+// =====================
+//      Constructor
+// =====================
+Authorized_Devices::Authorized_Devices(const Mac_Address_Struct table[], byte count)
+{
+  m_table = table;
+  m_tableCount = count;
+  m_pairing = false;
+  m_pairingStart = 0;
+  m_pairingTime = 0;
+}
+
+// ====================
+//      Destructor
+// ====================
+Authorized_Devices::~Authorized_Devices(void) {}
+
+// ========================
+//      isAuthorized()
+// ========================
+bool Authorized_Devices::isAuthorized(const byte address[])
+{
+  // An unfilled Security.h slot must not let in a controller that
+  // reports no address.
+
+  if ( isUnset(address) ) {
+    return false;
+  }
+  return ( m_inTable(address) || m_findPaired(address) >= 0 );
+}
+
+// =====================
+//      authorize()
+// =====================
+bool Authorized_Devices::authorize(const byte address[])
+{
+  // --------------------------------------------------------
+  // A known controller is let in. While pairing, the first
+  // unknown controller is saved and let in, ending pairing.
+  // --------------------------------------------------------
+
+  if ( isAuthorized(address) ) {
+    return true;
+  }
+
+  if ( ! isPairing() ) {
+    return false;
+  }
+
+  m_pairing = false;
+  return add(address);
+}
+
+// ===============
+//      add()
+// ===============
+bool Authorized_Devices::add(const byte address[])
+{
+  if ( isUnset(address) ) {
+    return false;
+  }
+
+  if ( isAuthorized(address) ) {
+    return true;
+  }
+
+  byte count = pairedCount();
+  if ( count >= PAIRED_MAX_DEVICES ) {
+    return false;
+  }
+
+  uint16_t slot = m_slotAddress(count);
+  for (byte i = 0; i < MAC_ADDRESS_SIZE; i++) {
+    Hal_Eeprom::update(slot + i, address[i]);
+  }
+
+  // Write the count and magic last, so a reset part way leaves the table as it was.
+
+  Hal_Eeprom::update(m_base() + 1, count + 1);
+  Hal_Eeprom::update(m_base(), PAIRED_MAGIC);
+  return true;
+}
+
+// ==================
+//      remove()
+// ==================
+bool Authorized_Devices::remove(const byte address[])
+{
+  // Only paired controllers can be removed. Security.h is in flash.
+
+  int found = m_findPaired(address);
+  if ( found < 0 ) {
+    return false;
+  }
+
+  // Move the last entry into the gap, then shorten the table.
+
+  byte last = pairedCount() - 1;
+  uint16_t to = m_slotAddress(found);
+  uint16_t from = m_slotAddress(last);
+  for (byte i = 0; i < MAC_ADDRESS_SIZE; i++) {
+    Hal_Eeprom::update(to + i, Hal_Eeprom::read(from + i));
+  }
+  Hal_Eeprom::update(m_base() + 1, last);
+  return true;
+}
+
+// =======================
+//      pairedCount()
+// =======================
+byte Authorized_Devices::pairedCount(void)
+{
+  // A fresh or foreign EEPROM holds no paired controllers.
+
+  if ( Hal_Eeprom::read(m_base()) != PAIRED_MAGIC ) {
+    return 0;
+  }
+  byte count = Hal_Eeprom::read(m_base() + 1);
+  return ( count > PAIRED_MAX_DEVICES ? PAIRED_MAX_DEVICES : count );
+}
+
+// ==================
+//      paired()
+// ==================
+bool Authorized_Devices::paired(byte slot, byte address[])
+{
+  if ( slot >= pairedCount() ) {
+    return false;
+  }
+
+  uint16_t from = m_slotAddress(slot);
+  for (byte i = 0; i < MAC_ADDRESS_SIZE; i++) {
+    address[i] = Hal_Eeprom::read(from + i);
+  }
+  return true;
+}
+
+// ======================
+//      tableCount()
+// ======================
+byte Authorized_Devices::tableCount(void)
+{
+  return m_tableCount;
+}
+
+// ======================
+//      tableEntry()
+// ======================
+void Authorized_Devices::tableEntry(byte index, byte address[])
+{
+  memcpy_P(address, m_table[index].address, MAC_ADDRESS_SIZE);
+}
+
+// ========================
+//      startPairing()
+// ========================
+void Authorized_Devices::startPairing(unsigned long duration)
+{
+  m_pairing = true;
+  m_pairingStart = Hal_Clock::millis();
+  m_pairingTime = duration;
+}
+
+// =======================
+//      stopPairing()
+// =======================
+void Authorized_Devices::stopPairing(void)
+{
+  m_pairing = false;
+}
+
+// =====================
+//      isPairing()
+// =====================
+bool Authorized_Devices::isPairing(void)
+{
+  if ( m_pairing && (Hal_Clock::millis() - m_pairingStart) >= m_pairingTime ) {
+    m_pairing = false;
+  }
+  return m_pairing;
+}
+
+// ===================
+//      isUnset()
+// ===================
+bool Authorized_Devices::isUnset(const byte address[])
+{
+  for (byte i = 0; i < MAC_ADDRESS_SIZE; i++) {
+    if ( address[i] != 0 ) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// =================
+//      parse()
+// =================
+bool Authorized_Devices::parse(const char* text, byte address[])
+{
+  // Accepts "00:1B:FB:63:A1:5C" in either case, and refuses anything else.
+
+  for (byte pair = 0; pair < MAC_ADDRESS_SIZE; pair++) {
+    const char* p = text + (3 * pair);
+    byte value = 0;
+
+    for (byte i = 0; i < 2; i++) {
+      char c = p[i];
+      if ( ! macIsHex(c) ) {
+        return false;
+      }
+      value = (value << 4) | macNibble(c);
+    }
+
+    char separator = p[2];
+    if ( (pair < MAC_ADDRESS_SIZE - 1 && separator != ':') || (pair == MAC_ADDRESS_SIZE - 1 && separator != '\0') ) {
+      return false;
+    }
+    address[MAC_ADDRESS_SIZE - 1 - pair] = value;
+  }
+  return true;
+}
+
+// ==================
+//      format()
+// ==================
+void Authorized_Devices::format(const byte address[], char text[])
+{
+  const char digits[] = "0123456789ABCDEF";
+
+  for (byte pair = 0; pair < MAC_ADDRESS_SIZE; pair++) {
+    byte value = address[MAC_ADDRESS_SIZE - 1 - pair];
+    text[3 * pair]       = digits[value >> 4];
+    text[(3 * pair) + 1] = digits[value & 0x0F];
+    text[(3 * pair) + 2] = ( pair < MAC_ADDRESS_SIZE - 1 ? ':' : '\0' );
+  }
+}
+
+// ==================
+//      m_base()
+// ==================
+uint16_t Authorized_Devices::m_base(void)
+{
+  return Hal_Eeprom::length() - CONFIG_EEPROM_RESERVED;
+}
+
+// =========================
+//      m_slotAddress()
+// =========================
+uint16_t Authorized_Devices::m_slotAddress(byte slot)
+{
+  return m_base() + 2 + (slot * MAC_ADDRESS_SIZE);
+}
+
+// ========================
+//      m_findPaired()
+// ========================
+int Authorized_Devices::m_findPaired(const byte address[])
+{
+  byte count = pairedCount();
+
+  for (byte slot = 0; slot < count; slot++) {
+    uint16_t from = m_slotAddress(slot);
+    byte i = 0;
+    while ( i < MAC_ADDRESS_SIZE && Hal_Eeprom::read(from + i) == address[i] ) {
+      i++;
+    }
+    if ( i == MAC_ADDRESS_SIZE ) {
+      return slot;
+    }
+  }
+  return -1;
+}
+
+// =====================
+//      m_inTable()
+// =====================
+bool Authorized_Devices::m_inTable(const byte address[])
+{
+  for (byte i = 0; i < m_tableCount; i++) {
+    if ( memcmp_P(address, m_table[i].address, MAC_ADDRESS_SIZE) == 0 ) {
+      return true;
+    }
+  }
+  return false;
+}
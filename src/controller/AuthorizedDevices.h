@@ -0,0 +1,122 @@
+/* =================================================================================
+ *    B.L.A.C.Box: Brian Lubkeman's Astromech Controller
+ * =================================================================================
+ * AuthorizedDevices.h - The controllers allowed to connect to the droid
+ * Created by Brian Lubkeman, 16 June 2021
+ * Inspired by S.H.A.D.O.W. controller code written by KnightShade
+ * Released into the public domain.
+ * =================================================================================
+ *
+ * A controller is authorized when its MAC address is listed in Security.h, or has
+ * been paired since. The Security.h list is kept in flash as packed 6-byte
+ * addresses. MAC_ADDRESS() turns the readable "00:1B:FB:63:A1:5C" form into that
+ * packed form when the sketch is compiled, and text in any other form will not
+ * compile. A slot not yet filled in is MAC_UNSET, which matches no controller.
+ * Addresses are compared directly against the Bluetooth dongle's, with no
+ * formatting or String use.
+ *
+ * Paired controllers are kept in a small table at the end of EEPROM. Pairing
+ * mode is started from the serial console, or by holding PS alone on a
+ * controller that is already connected. The next unknown controller to connect
+ * within the time allowed is added, so a new controller needs no reflash.
+ */
+#ifndef __BLACBOX_AUTHORIZED_DEVICES_H__
+#define __BLACBOX_AUTHORIZED_DEVICES_H__
+
+#include "../hal/Hal.h"
+#include "../config/Config.h"
+
+const byte MAC_ADDRESS_SIZE   = 6;
+const byte MAC_TEXT_SIZE      = 18;    // "XX:XX:XX:XX:XX:XX" and its terminator.
+const byte PAIRED_MAX_DEVICES = 8;
+const byte PAIRED_MAGIC       = 0xA7;
+const unsigned long PAIRING_TIME = 60000;  // How long pairing mode waits for a new controller (ms).
+
+// Bytes run in the order the Bluetooth dongle reports them, last pair of the text first.
+
+typedef struct {
+  byte address[MAC_ADDRESS_SIZE];
+} Mac_Address_Struct;
+
+// ---------------------------------------------------------------------
+// Compile-time parser for MAC_ADDRESS(). The text must be six pairs of
+// hex digits split by colons, or the sketch does not compile.
+// ---------------------------------------------------------------------
+
+constexpr bool macIsHex(char c)
+{
+  return ( (c >= '0' && c <= '9') || (c >= 'A' && c <= 'F') || (c >= 'a' && c <= 'f') );
+}
+
+constexpr bool macValid(const char* text, byte i = 0)
+{
+  return ( i == MAC_TEXT_SIZE - 1 ? text[i] == '\0' :
+           (i % 3) == 2 ? text[i] == ':' && macValid(text, i + 1) :
+           macIsHex(text[i]) && macValid(text, i + 1) );
+}
+
+constexpr byte macNibble(char c)
+{
+  return ( (c >= '0' && c <= '9') ? c - '0' :
+           (c >= 'A' && c <= 'F') ? c - 'A' + 10 : c - 'a' + 10 );
+}
+
+constexpr byte macByte(const char* text, byte pair)
+{
+  return (byte)((macNibble(text[3 * pair]) << 4) | macNibble(text[(3 * pair) + 1]));
+}
+
+template <bool valid>
+struct Mac_Text_Check
+{
+  static_assert(valid, "MAC_ADDRESS() takes the form \"00:1B:FB:63:A1:5C\". Use MAC_UNSET for an empty slot.");
+  static constexpr byte none = 0;
+};
+
+#define MAC_ADDRESS(text) { { (byte)(macByte(text, 5) + Mac_Text_Check<macValid(text)>::none), macByte(text, 4), macByte(text, 3), macByte(text, 2), macByte(text, 1), macByte(text, 0) } }
+
+// No controller reports an all-zero address, so it marks a slot not yet filled in.
+
+#define MAC_UNSET { { 0, 0, 0, 0, 0, 0 } }
+
+/* ================================================================================
+ *                             Authorized Devices Class
+ * ================================================================================ */
+class Authorized_Devices
+{
+  private:
+    const Mac_Address_Struct* m_table;
+    byte m_tableCount;
+
+    bool m_pairing;
+    unsigned long m_pairingStart;
+    unsigned long m_pairingTime;
+
+    uint16_t m_base(void);
+    uint16_t m_slotAddress(byte slot);
+    int m_findPaired(const byte address[]);
+    bool m_inTable(const byte address[]);
+
+  public:
+    Authorized_Devices(const Mac_Address_Struct table[], byte count);
+    ~Authorized_Devices(void);
+
+    bool isAuthorized(const byte address[]);
+    bool authorize(const byte address[]);
+
+    bool add(const byte address[]);
+    bool remove(const byte address[]);
+    byte pairedCount(void);
+    bool paired(byte slot, byte address[]);
+    byte tableCount(void);
+    void tableEntry(byte index, byte address[]);
+
+    void startPairing(unsigned long duration);
+    void stopPairing(void);
+    bool isPairing(void);
+
+    static bool isUnset(const byte address[]);
+    static bool parse(const char* text, byte address[]);
+    static void format(const byte address[], char text[]);
+};
+#endif
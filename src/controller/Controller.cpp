@@ -16,15 +16,37 @@
 // =====================
 //      Constructor
 // =====================
-Controller::Controller(const int settings[], const unsigned long timings[])
-  : m_Usb(),
+Controller::Controller(const Config_Section* settings, const Config_Section* timings)
+  :
+    #if defined(ARDUINO)
+    m_Usb(),
     m_Btd(&m_Usb),
-    driveStick(settings[iDriveSide], settings[iDeadZone], this),
-    domeStick(settings[iDomeSide], settings[iDeadZone], this),
-    button(this)
+    #endif
+    driveStick(settings->get(iDriveSide), settings->get(iDeadZone), this),
+    domeStick(settings->get(iDomeSide), settings->get(iDeadZone), this),
+    button(this),
+    devices(authorizedMACAddresses, sizeof(authorizedMACAddresses) / sizeof(authorizedMACAddresses[0]))
 {
   pSettings = settings;
   pTimings = timings;
+
+  applySettings();
+
+  m_connectionStatus = NONE;
+  m_disconnectEvent = false;
+  m_frame.readTime = 0;
+  m_frame.connectionStatus = NONE;
+  m_frame.driveX = driveStick.center;
+  m_frame.driveY = driveStick.center;
+  m_frame.domeX = domeStick.center;
+  m_frame.pressed = 0;
+  m_frame.clicked = 0;
+
+  m_eventHead = 0;
+  m_pairingHoldStart = 0;
+  m_pairingHolding = false;
+  m_pairingHeld = false;
+  subscribe(&button);
 }
 
 // ====================
@@ -32,6 +54,21 @@ Controller::Controller(const int settings[], const unsigned long timings[])
 // ====================
 Controller::~Controller(void) {}
 
+// =========================
+//      applySettings()
+// =========================
+void Controller::applySettings(void)
+{
+  // Dead zones, curves and filters may be changed while running.
+  // Stick sides are only read at startup.
+
+  driveStick.deadZone = constrain((int)pSettings->get(iDeadZone), 0, driveStick.center - 1);
+  domeStick.deadZone  = constrain((int)pSettings->get(iDeadZone), 0, domeStick.center - 1);
+
+  driveStick.configure(pSettings->get(iDriveCurve), pSettings->get(iCurveWalk), pSettings->get(iStickFilter), pSettings->get(iFilterWeight));
+  domeStick.configure(pSettings->get(iDomeCurve), pSettings->get(iCurveDome), pSettings->get(iStickFilter), pSettings->get(iFilterWeight));
+}
+
 // =================
 //      begin()
 // =================
@@ -41,6 +78,7 @@ void Controller::begin(void)
   // Start the USB host.
   // -------------------
 
+  #if defined(ARDUINO)
   if (m_Usb.Init() == -1) {
 
     #if defined(DEBUG)
@@ -53,6 +91,7 @@ void Controller::begin(void)
   #if defined(DEBUG)
   Debug.print(DBG_ERROR, F("Controller"), F("begin()"), F("Bluetooth Library Started"));
   #endif
+  #endif
 }
 
 // ============================
@@ -64,29 +103,28 @@ byte Controller::connectionStatus(void)
 }
 
 // ===========================
-//      isDisconnecting()
+//      disconnectEvent()
 // ===========================
-bool Controller::isDisconnecting(void)
+bool Controller::disconnectEvent(void)
 {
-  return (m_disconnectCount > 0 ? true : false);
+  // -------------------------------------------------------------------
+  // Report a lost connection exactly once. The scheduler calls this after
+  // each read and fans the event out to every peripheral.
+  // -------------------------------------------------------------------
+
+  if ( m_disconnectEvent ) {
+    m_disconnectEvent = false;
+    return true;
+  }
+  return false;
 }
 
-// =========================
-//      disconnecting()
-// =========================
-void Controller::disconnecting(void)
+// =================
+//      frame()
+// =================
+const Input_Frame_Struct* Controller::frame(void)
 {
-  // ----------------------------------------------------------------------------------
-  // In loop(), each peripheral is given an opportunity to act on the disconnect event.
-  // This function tracks how many peripherals have acted, and resets the count after
-  // all have done so.
-  // ----------------------------------------------------------------------------------
-
-  if ( m_disconnectCount == pSettings[iPeripheralCount] ) {
-    m_disconnectCount = 0;
-    return;
-  }
-  m_disconnectCount++;
+  return &m_frame;
 }
 
 byte Controller::getType(void)
@@ -98,30 +136,16 @@ byte Controller::getType(void)
 // ========================
 //      m_authorized()
 // ========================
+#if defined(ARDUINO)
 bool Controller::m_authorized(void)
 {
-  bool authorized = false;
-
-  String btAddress = "";
-  for(int8_t i = 5; i >= 0; i--) {
-    if (btAddress.length() > 0) btAddress +=(":");
-    if (m_Btd.disc_bdaddr[i]<0x10) btAddress +="0";
-    btAddress += String(m_Btd.disc_bdaddr[i], HEX);
-  }
-  btAddress.toUpperCase();
+  bool authorized = devices.authorize(m_Btd.disc_bdaddr);
 
   #if defined(DEBUG)
-  Debug.print(DBG_INFO, F("Controller"), F("m_authorized()"), F("MAC address:"), btAddress);
-  #endif
+  char text[MAC_TEXT_SIZE];
+  Authorized_Devices::format(m_Btd.disc_bdaddr, text);
+  Debug.print(DBG_INFO, F("Controller"), F("m_authorized()"), F("MAC address:"), text);
 
-  for (byte i = 0; i < sizeof(authorizedMACAddresses); i++) {
-    if (btAddress == m_getPgmString(authorizedMACAddresses[i])) {
-      authorized = true;
-      break;
-    }
-  }
-
-  #if defined(DEBUG)
   if ( authorized ) {
     Debug.print(DBG_INFO, F("Controller"), F("m_authorized()"), F("Controller authorized"));
   } else {
@@ -131,21 +155,7 @@ bool Controller::m_authorized(void)
 
   return authorized;
 }
-
-// =============================
-//      m_getPgmString()
-// =============================
-static String Controller::m_getPgmString(const char * inValue)
-{
-  // This function takes in a pointer to a char array that has been
-  // stored in program memory and returns its string content.
-
-  String outValue = "";
-  for (byte k = 0; k < strlen_P(inValue); k++) {
-    outValue += (char)pgm_read_byte_near(inValue + k);
-  }
-  return outValue;
-}
+#endif
 
 // =================================
 //      m_setConnectionStatus()
@@ -154,14 +164,14 @@ void Controller::m_setConnectionStatus(byte status)
 {
   // -----------------------------------------------------------------------
   // Input: NONE (0), HALF (1) or FULL (2)
-  // When we lose the controller, start the disconnecting counter.
-  // In loop(), each peripheral will be given a chance to act on this event.
+  // When we lose the controller, raise the disconnect event.
+  // The scheduler hands this event to each peripheral.
   // -----------------------------------------------------------------------
   
   if ( m_connectionStatus != NONE && status == NONE ) {
-    m_disconnectCount = 1;
+    m_disconnectEvent = true;
   }
-  m_connectionStatus = status;  
+  m_connectionStatus = (connection_status_e)status;  
 }
 
 // ===============================
@@ -170,7 +180,7 @@ void Controller::m_setConnectionStatus(byte status)
 void Controller::m_initCriticalFault(byte idx)
 {
   m_faultData[idx].badData          = 0;
-  m_faultData[idx].lastMsgTime      = millis();
+  m_faultData[idx].lastMsgTime      = Hal_Clock::millis();
   m_faultData[idx].pluggedStateTime = 0;
   m_faultData[idx].reconnect        = true;
 
@@ -198,6 +208,132 @@ void Controller::m_resetCriticalFault(byte idx)
   #endif
 }
 
+// ======================
+//      subscribe()
+// ======================
+void Controller::subscribe(Button* pButton)
+{
+  // ---------------------------------------------------------
+  // Start a new reader at the head of the event queue. Clicks
+  // from before it subscribed are of no interest to it.
+  // ---------------------------------------------------------
+
+  pButton->m_cursor    = m_eventHead;
+  pButton->m_dropped   = 0;
+  pButton->m_clicked   = 0;
+  pButton->m_held      = 0;
+  pButton->m_eventTime = 0;
+}
+
+// ======================
+//      eventHead()
+// ======================
+uint16_t Controller::eventHead(void)
+{
+  return m_eventHead;
+}
+
+// ==================
+//      event()
+// ==================
+const Input_Event_Struct* Controller::event(uint16_t sequence)
+{
+  return &m_events[sequence & (CONTROLLER_EVENT_QUEUE_SIZE - 1)];
+}
+
+// ===========================
+//      m_recordButtons()
+// ===========================
+void Controller::m_recordButtons(uint32_t pressed, uint32_t clicked)
+{
+  // The masks come from m_captureButtons() in Controller.h.
+
+  m_frame.pressed = pressed;
+  m_frame.clicked = clicked;
+
+  // ---------------------------------------------------------------
+  // Queue any clicks along with the buttons held at the same time.
+  // When full, the oldest event is overwritten. A reader that falls
+  // that far behind learns so through Button::dropped().
+  // ---------------------------------------------------------------
+
+  if ( clicked != 0 ) {
+    Input_Event_Struct* e = &m_events[m_eventHead & (CONTROLLER_EVENT_QUEUE_SIZE - 1)];
+    e->time    = Hal_Clock::millis();
+    e->clicked = clicked;
+    e->pressed = pressed;
+    m_eventHead++;
+  }
+
+  // The controller's own button reads the queue like everyone else.
+
+  button.update();
+
+  m_checkPairing(pressed);
+}
+
+// ==========================
+//      m_checkPairing()
+// ==========================
+void Controller::m_checkPairing(uint32_t pressed)
+{
+  // -----------------------------------------------------------------
+  // Holding PS, or the second Nav's PS, with nothing else starts
+  // pairing, so a new controller can be added without the console.
+  // Only a controller that is already authorized can get this far.
+  // It starts once per hold.
+  // -----------------------------------------------------------------
+
+  if ( pressed != ((uint32_t)1 << PS) && pressed != ((uint32_t)1 << PS2) ) {
+    m_pairingHolding = false;
+    m_pairingHeld = false;
+    return;
+  }
+
+  if ( ! m_pairingHolding ) {
+    m_pairingHolding = true;
+    m_pairingHoldStart = Hal_Clock::millis();
+    return;
+  }
+
+  if ( m_pairingHeld || (Hal_Clock::millis() - m_pairingHoldStart) < CONTROLLER_PAIRING_HOLD ) {
+    return;
+  }
+  m_pairingHeld = true;
+
+  if ( devices.pairedCount() >= PAIRED_MAX_DEVICES ) {
+    #if defined(DEBUG)
+    Debug.print(DBG_WARNING, F("Controller"), F("m_checkPairing()"), F("No room to pair another controller"));
+    #endif
+    return;
+  }
+
+  devices.startPairing(PAIRING_TIME);
+
+  #if defined(DEBUG)
+  Debug.print(DBG_INFO, F("Controller"), F("m_checkPairing()"), F("Pairing. Connect the new controller within a minute."));
+  #endif
+}
+
+// =========================
+//      m_recordFrame()
+// =========================
+void Controller::m_recordFrame(void)
+{
+  // ---------------------------------------------------------------
+  // Called at the end of a successful read(), once the sticks have
+  // been processed. The peripherals work from this snapshot rather
+  // than querying the controller again.
+  // ---------------------------------------------------------------
+
+  m_frame.readTime = Hal_Clock::millis();
+  m_frame.connectionStatus = m_connectionStatus;
+
+  m_frame.driveX = driveStick.steering();
+  m_frame.driveY = driveStick.throttle();
+  m_frame.domeX = domeStick.rotation();
+}
+
 // =================================
 //      m_detectCriticalFault()
 // =================================
@@ -209,7 +345,7 @@ bool Controller::m_detectCriticalFault(void)
   
   if ( connected() ) {
 
-    currentTime = millis();
+    currentTime = Hal_Clock::millis();
     lastMsgTime = m_lastReadTime;
     lagTime = currentTime - lastMsgTime;
 
@@ -218,7 +354,7 @@ bool Controller::m_detectCriticalFault(void)
     // -----------------------
 
     if (m_faultData[0].reconnect ) {
-      if (lagTime < pTimings[iLagReconnect] ) {
+      if (lagTime < pTimings->get(iLagReconnect) ) {
        m_faultData[0].reconnect = false;
       }
       lastMsgTime = currentTime;
@@ -238,13 +374,13 @@ bool Controller::m_detectCriticalFault(void)
     // Disconnect after too much lag.
     // ------------------------------
 
-    if ( lagTime > pTimings[iLagDisconnect] ) {
+    if ( lagTime > pTimings->get(iLagDisconnect) ) {
 
       #if defined(DEBUG)
       Debug.print(DBG_WARNING, F("Controller"), F("m_detectCriticalFault()"), F("Disconnecting due to lag time."));
-      Debug.print(DBG_WARNING, F("  Current time:  "), (String)currentTime);
-      Debug.print(DBG_WARNING, F("  Last msg time: "), (String)lastMsgTime);
-      Debug.print(DBG_WARNING, F("  Lag:           "), (String)lagTime);
+      Debug.print(DBG_WARNING, F("  Current time:  "), (long)currentTime);
+      Debug.print(DBG_WARNING, F("  Last msg time: "), (long)lastMsgTime);
+      Debug.print(DBG_WARNING, F("  Lag:           "), (long)lagTime);
       #endif
       
       m_disconnect();
@@ -254,7 +390,7 @@ bool Controller::m_detectCriticalFault(void)
     // Stop the drive motors after too much lag.
     // -----------------------------------------
 
-    if ( lagTime > pTimings[iLagKillMotor] ) {
+    if ( lagTime > pTimings->get(iLagKillMotor) ) {
 
       #if defined(DEBUG)
       Debug.print(DBG_WARNING, F("Controller"), F("m_detectCriticalFault()"), F("Stopping drive motors due to lag."));
@@ -279,7 +415,7 @@ bool Controller::m_detectCriticalFault(void)
         // Has the desired amount of time between failed checks passed?
         // ------------------------------------------------------------
 
-        unsigned long interval = ( connected() ? pTimings[iLongInterval] : pTimings[iShortInterval]);
+        unsigned long interval = ( connected() ? pTimings->get(iLongInterval) : pTimings->get(iShortInterval));
         if ( currentTime > ( m_faultData[0].pluggedStateTime + interval )) {
 
           // -------------------------------------------------------
@@ -302,7 +438,7 @@ bool Controller::m_detectCriticalFault(void)
         // Start the state machine.
         // ------------------------
 
-       m_faultData[0].pluggedStateTime = millis();
+       m_faultData[0].pluggedStateTime = Hal_Clock::millis();
       }
 
     } else {
@@ -344,6 +480,11 @@ bool Controller::m_detectCriticalFault(void)
 Button::Button(Controller* pController)
 {
   m_controller = pController;
+  m_cursor    = 0;
+  m_dropped   = 0;
+  m_clicked   = 0;
+  m_held      = 0;
+  m_eventTime = 0;
 }
 
 // ====================
@@ -354,10 +495,81 @@ Button::~Button(void) {}
 // ============================
 //      Get button actions
 // ============================
-bool Button::clicked(int buttonEnum)     { return m_controller->getButtonClick(buttonEnum); }
-bool Button::pressed(int buttonEnum)     { return m_controller->getButtonPress(buttonEnum); }
+bool Button::pressed(int buttonEnum)     { return (m_controller->frame()->pressed >> buttonEnum) & 1; }
 byte Button::analogValue(int buttonEnum) { return m_controller->getAnalogButton(buttonEnum); }
 
+bool Button::clicked(int buttonEnum)
+{
+  // A click in the current event is reported once, then cleared.
+
+  uint32_t bit = (uint32_t)1 << buttonEnum;
+  if ( m_clicked & bit ) {
+    m_clicked &= ~bit;
+    return true;
+  }
+  return false;
+}
+
+bool Button::held(int buttonEnum)
+{
+  // Was the button held down when the current event's click happened?
+
+  return (m_held >> buttonEnum) & 1;
+}
+
+// ====================
+//      update()
+// ====================
+bool Button::update(void)
+{
+  // ----------------------------------------------------------------
+  // Move to the next queued click event. Any clicks not consumed from
+  // the previous event were for somebody else and are let go. Call
+  // this once before looking at clicked() or held().
+  // ----------------------------------------------------------------
+
+  m_clicked = 0;
+  m_held = 0;
+
+  uint16_t head = m_controller->eventHead();
+
+  while ( m_cursor != head ) {
+
+    // Fell behind by more than the queue holds. Skip to the oldest kept.
+
+    uint16_t behind = head - m_cursor;
+    if ( behind > CONTROLLER_EVENT_QUEUE_SIZE ) {
+      m_dropped += behind - CONTROLLER_EVENT_QUEUE_SIZE;
+      m_cursor = head - CONTROLLER_EVENT_QUEUE_SIZE;
+    }
+
+    const Input_Event_Struct* e = m_controller->event(m_cursor);
+    m_cursor++;
+
+    // A click from long ago would only surprise the user. Skip it.
+
+    if ( (Hal_Clock::millis() - e->time) > CONTROLLER_EVENT_MAX_AGE ) {
+      continue;
+    }
+
+    m_clicked   = e->clicked;
+    m_held      = e->pressed;
+    m_eventTime = e->time;
+    return true;
+  }
+
+  return false;
+}
+
+// ============================
+//      Button snapshots
+// ============================
+uint32_t Button::pressedMask(void)       { return m_controller->frame()->pressed; }
+uint32_t Button::clickedMask(void)       { return m_clicked; }
+uint32_t Button::heldMask(void)          { return m_held; }
+unsigned long Button::eventTime(void)    { return m_eventTime; }
+uint16_t Button::dropped(void)           { return m_dropped; }
+
 /* ================================================================================
  *                                  Joystick Class
  * ================================================================================ */
@@ -369,7 +581,11 @@ Joystick::Joystick(const byte argSide, const int argDeadZone, Controller* pContr
 {
   m_controller = pController;
   side = argSide;
-  deadZone = argDeadZone;
+  deadZone = constrain(argDeadZone, 0, center - 1);
+
+  m_value[0] = center;
+  m_value[1] = center;
+  configure(CURVE_LINEAR, 0, FILTER_NONE, 100);
 }
 
 // ====================
@@ -380,7 +596,7 @@ Joystick::~Joystick(void) {}
 // ===================
 //      getSide()
 // ===================
-String Joystick::getSide(void)
+const char* Joystick::getSide(void)
 {
   if ( side == 0 ) {
     return "Left";
@@ -389,6 +605,169 @@ String Joystick::getSide(void)
   }
 }
 
+// ===================
+//      configure()
+// ===================
+void Joystick::configure(byte curveType, byte strength, byte filterType, byte filterWeight)
+{
+  m_curveType    = curveType;
+  m_filterType   = filterType;
+  m_filterWeight = constrain(filterWeight, 1, 100);
+  m_primed       = false;
+
+  for (byte axis = 0; axis < 2; axis++) {
+    m_smoothed[axis] = center << 4;
+    m_historyIndex[axis] = 0;
+    for (byte i = 0; i < 3; i++) {
+      m_history[axis][i] = center;
+    }
+  }
+
+  setStrength(strength);
+}
+
+// =====================
+//      setStrength()
+// =====================
+void Joystick::setStrength(byte strength)
+{
+  // ---------------------------------------------------------------
+  // Build the response curve once, here, rather than on every frame.
+  // Each entry blends the straight line with the chosen shape:
+  //   Expo     - t^3, gentle near center and full speed at the end.
+  //   S-curve  - 3t^2 - 2t^3, gentle at both ends.
+  // Strength is the percentage of the shape in the blend.
+  // ---------------------------------------------------------------
+
+  if ( strength > 100 ) {
+    strength = 100;
+  }
+
+  const long full = JOYSTICK_CURVE_SIZE - 1;
+
+  for (int i = 0; i < JOYSTICK_CURVE_SIZE; i++) {
+
+    long shaped;
+    switch (m_curveType) {
+      case CURVE_EXPO :   { shaped = ((long)i * i * i) / (full * full); break; }
+      case CURVE_SCURVE : { shaped = (3L * i * i * full - 2L * i * i * i) / (full * full); break; }
+      default :           { shaped = i; break; }
+    }
+
+    m_curve[i] = (((long)(100 - strength) * i) + ((long)strength * shaped)) / 100;
+  }
+}
+
+// ==================
+//      m_filter()
+// ==================
+byte Joystick::m_filter(byte axis, byte raw)
+{
+  // -----------------------------------------------------------------
+  // Knock down Bluetooth jitter before anything else sees the stick.
+  // The one-pole filter works in sixteenths of a step so that small
+  // weights still move it.
+  // -----------------------------------------------------------------
+
+  switch (m_filterType) {
+
+    case FILTER_ONE_POLE : {
+      int target = (int)raw << 4;
+      if ( ! m_primed ) {
+        m_smoothed[axis] = target;
+      } else {
+        m_smoothed[axis] += ((long)(target - m_smoothed[axis]) * m_filterWeight) / 100;
+      }
+      return (m_smoothed[axis] + 8) >> 4;
+    }
+
+    case FILTER_MEDIAN : {
+      byte* h = m_history[axis];
+      h[m_historyIndex[axis]] = raw;
+      m_historyIndex[axis] = (m_historyIndex[axis] + 1) % 3;
+      if ( ! m_primed ) {
+        h[0] = h[1] = h[2] = raw;
+      }
+      byte lo = min(h[0], h[1]);
+      byte hi = max(h[0], h[1]);
+      return max(lo, min(hi, h[2]));
+    }
+
+    default :
+      return raw;
+  }
+}
+
+// =================
+//      isqrt()
+// =================
+static int isqrt(long n)
+{
+  long root = 0;
+  long bit = 1L << 16;
+
+  while ( bit > n ) {
+    bit >>= 2;
+  }
+  while ( bit != 0 ) {
+    if ( n >= root + bit ) {
+      n -= root + bit;
+      root = (root >> 1) + bit;
+    } else {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+  return (int)root;
+}
+
+// ===================
+//      m_process()
+// ===================
+void Joystick::m_process(byte x, byte y, bool twoAxis)
+{
+  // -----------------------------------------------------------------
+  // Filter, then apply a round dead zone, then the response curve.
+  // The output keeps the raw 0-255 scale with 127 as center, so every
+  // consumer can treat "equal to center" as "in the dead zone".
+  // -----------------------------------------------------------------
+
+  int d[2];
+  d[0] = (int)m_filter(0, x) - center;
+  d[1] = ( twoAxis ? (int)m_filter(1, y) - center : 0 );
+  m_primed = true;
+
+  // ----------------------------------------------------------------
+  // A square dead zone makes diagonals creep. Measure the distance
+  // from center instead, and rescale what is left over so motion
+  // starts from zero at the edge of the dead zone.
+  // ----------------------------------------------------------------
+
+  long r2 = ((long)d[0] * d[0]) + ((long)d[1] * d[1]);
+  if ( r2 == 0 || r2 < ((long)deadZone * deadZone) ) {
+    m_value[0] = center;
+    m_value[1] = center;
+    return;
+  }
+
+  int r = isqrt(r2);
+  long span = (long)r * (center - deadZone);
+
+  for (byte axis = 0; axis < 2; axis++) {
+
+    long scaled = ((long)d[axis] * (r - deadZone) * center) / span;
+    byte magnitude = m_curve[min(abs(scaled), (long)(JOYSTICK_CURVE_SIZE - 1))];
+
+    // The low side reaches 0 at 127 steps. The high side needs 128 to reach 255.
+
+    if ( scaled < 0 ) {
+      m_value[axis] = center - magnitude;
+    } else {
+      m_value[axis] = center + ((magnitude * (maxValue - center)) + (center / 2)) / center;
+    }
+  }
+}
+
 // ==================
 //      m_getX()
 // ==================
@@ -436,7 +815,7 @@ Joystick_Drive::~Joystick_Drive(void) {}
 // ====================
 int Joystick_Drive::steering(void)
 {
-  return m_getX();
+  return m_value[0];
 }
 
 // ====================
@@ -444,7 +823,27 @@ int Joystick_Drive::steering(void)
 // ====================
 int Joystick_Drive::throttle(void)
 {
-  return m_getY();
+  return m_value[1];
+}
+
+// ===================
+//      process()
+// ===================
+void Joystick_Drive::process(byte x, byte y)
+{
+  m_process(x, y, true);
+}
+
+// ======================
+//      setProfile()
+// ======================
+void Joystick_Drive::setProfile(byte speedProfile)
+{
+  // Each speed profile has its own curve strength.
+
+  if ( speedProfile <= SPRINT ) {
+    setStrength(m_controller->pSettings->get(iCurveWalk + speedProfile));
+  }
 }
 
 /* ================================================================================
@@ -466,7 +865,15 @@ Joystick_Dome::~Joystick_Dome(void) {}
 // ====================
 byte Joystick_Dome::rotation(void)
 {
-  return m_getX();
+  return m_value[0];
+}
+
+// ===================
+//      process()
+// ===================
+void Joystick_Dome::process(byte x)
+{
+  m_process(x, center, false);
 }
 
 #if defined(TEST_CONTROLLER)
@@ -9,13 +9,17 @@
 #ifndef __BLACBOX_CONTROLLER_H__
 #define __BLACBOX_CONTROLLER_H__
 
-#include <Arduino.h>
+#include "../hal/Hal.h"
+#if defined(ARDUINO)
 #include <usbhub.h>
 #include <BTD.h>
 #include <PS5BT.h>
 #include <PS4BT.h>
 #include <PS3BT.h>
+#endif
 #include "controllerEnums.h"
+#include "../config/Config.h"
+#include "AuthorizedDevices.h"
 #include "../toolbox/DebugUtils.h"
 
 #define DEBUG
@@ -33,7 +37,15 @@ enum controller_setting_index_e {
   iDriveSide,       // 0 - Drive stick side
   iDomeSide,        // 1 - Dome stick side
   iDeadZone,        // 2 - Joystick dead zone
-  iPeripheralCount  // 3 - Number of peripherals (drive, dome, Marcduino)
+  iDriveCurve,      // 3 - Drive stick response curve
+  iDomeCurve,       // 4 - Dome stick response curve
+  iCurveWalk,       // 5 - Drive curve strength in the walk profile
+  iCurveJog,        // 6 - Drive curve strength in the jog profile
+  iCurveRun,        // 7 - Drive curve strength in the run profile
+  iCurveSprint,     // 8 - Drive curve strength in the sprint profile
+  iCurveDome,       // 9 - Dome curve strength
+  iStickFilter,     // 10 - Joystick jitter filter
+  iFilterWeight     // 11 - Weight of a new sample in the one-pole filter
 };
 
 enum controller_timing_index_e {
@@ -50,6 +62,32 @@ enum connection_status_e {
   FULL
 };
 
+// -------------------------------------------------------------------
+// One snapshot of controller input, captured once per successful read.
+// Every peripheral interprets the same frame within a scheduler pass.
+// -------------------------------------------------------------------
+
+struct Input_Frame_Struct {
+  unsigned long readTime;   // Time the frame was captured.
+  byte connectionStatus;    // NONE, HALF, or FULL.
+  byte driveX;              // Drive stick steering position.
+  byte driveY;              // Drive stick throttle position.
+  byte domeX;               // Dome stick rotation position.
+  uint32_t pressed;         // One bit per button held down, indexed by button enum.
+  uint32_t clicked;         // One bit per button clicked since the previous read.
+};
+
+// ------------------------------------------------------------------
+// Clicks are also queued as timestamped events. Each subscriber reads
+// the queue at its own pace, so nobody can steal another's click.
+// ------------------------------------------------------------------
+
+struct Input_Event_Struct {
+  unsigned long time;       // Time of the read that saw the click.
+  uint32_t clicked;         // Buttons clicked in that read.
+  uint32_t pressed;         // Buttons held down in that read.
+};
+
 enum speed_profile_e {
   WALK,
   JOG,
@@ -68,6 +106,43 @@ const int L4  = 8;
 const int R4  = 9;
 const int PS2 = 17;
 
+enum joystick_curve_e {
+  CURVE_LINEAR,
+  CURVE_EXPO,
+  CURVE_SCURVE
+};
+
+enum joystick_filter_e {
+  FILTER_NONE,
+  FILTER_ONE_POLE,
+  FILTER_MEDIAN
+};
+
+const byte JOYSTICK_CURVE_SIZE = 128;   // One entry per step away from center.
+
+const byte BUTTON_COUNT                      = 18;    // UP (0) through PS2 (17).
+const byte CONTROLLER_EVENT_QUEUE_SIZE       = 16;    // Must be a power of two.
+const unsigned long CONTROLLER_EVENT_MAX_AGE = 1000;  // Older clicks are ignored (ms).
+const unsigned long CONTROLLER_PAIRING_HOLD  = 3000;  // Hold PS alone this long to start pairing (ms).
+
+// -----------------------------------------------------------------
+// Button masks hold one bit per button enum value. PS2 is this
+// sketch's own number for the second Nav's PS button, so every real
+// button the sketch reads must sit below it, and it below
+// BUTTON_COUNT, all in 32 bits. The real values come from the USB
+// Host Shield library's ButtonEnum.
+// -----------------------------------------------------------------
+
+static_assert(BUTTON_COUNT <= 32, "Button masks are 32 bits wide.");
+static_assert(PS2 < BUTTON_COUNT, "PS2 is past BUTTON_COUNT.");
+static_assert(UP < PS2 && RIGHT < PS2 && DOWN < PS2 && LEFT < PS2,
+              "A direction button is not below PS2.");
+static_assert(TRIANGLE < PS2 && CIRCLE < PS2 && CROSS < PS2 && SQUARE < PS2,
+              "A face button is not below PS2.");
+static_assert(SELECT < PS2 && START < PS2 && L1 < PS2 && R1 < PS2 && L2 < PS2 && R2 < PS2 && L3 < PS2 && R3 < PS2,
+              "A shoulder or stick button is not below PS2.");
+static_assert(PS < PS2 && L4 < PS2 && R4 < PS2, "A PS or Nav button is not below PS2.");
+
 /* ================================================================================
  *                                 Joystick Classes
  * ================================================================================ */
@@ -76,8 +151,20 @@ class Joystick
   protected:
     Controller* m_controller;
 
+    byte m_curveType;
+    byte m_filterType;
+    byte m_filterWeight;
+    byte m_curve[JOYSTICK_CURVE_SIZE];
+    int m_smoothed[2];
+    byte m_history[2][3];
+    byte m_historyIndex[2];
+    bool m_primed;
+    byte m_value[2];
+
     byte m_getX(void);
     byte m_getY(void);
+    byte m_filter(byte axis, byte raw);
+    void m_process(byte x, byte y, bool twoAxis);
 
     #if defined(TEST_CONTROLLER)
     void m_appendString(String* inString);
@@ -93,7 +180,9 @@ class Joystick
     const int maxValue = 255;
     int deadZone;
 
-    String getSide(void);
+    const char* getSide(void);
+    void configure(byte curveType, byte strength, byte filterType, byte filterWeight);
+    void setStrength(byte strength);
 
     #if defined(TEST_CONTROLLER)
     void display(String* out);
@@ -106,6 +195,8 @@ class Joystick_Drive : public Joystick
     Joystick_Drive(const byte side, const int deadZone, Controller* pCcontroller);
     ~Joystick_Drive(void);
 
+    void process(byte x, byte y);
+    void setProfile(byte speedProfile);
     int steering(void);
     int throttle(void);
 };
@@ -116,6 +207,7 @@ class Joystick_Dome : public Joystick
     Joystick_Dome(const byte side, const int deadZone, Controller* pCcontroller);
     ~Joystick_Dome(void);
 
+    void process(byte x);
     byte rotation(void);
 };
 
@@ -126,6 +218,13 @@ class Button
 {
   private:
     Controller* m_controller;
+    uint16_t m_cursor;
+    uint16_t m_dropped;
+    uint32_t m_clicked;
+    uint32_t m_held;
+    unsigned long m_eventTime;
+
+    friend class Controller;
 
     #if defined(TEST_CONTROLLER)
     void m_appendString(String* inString, const String addString);
@@ -139,6 +238,14 @@ class Button
     bool pressed(int buttonEnum);
     byte analogValue(int buttonEnum);
 
+    bool update(void);
+    bool held(int buttonEnum);
+    uint32_t pressedMask(void);
+    uint32_t clickedMask(void);
+    uint32_t heldMask(void);
+    unsigned long eventTime(void);
+    uint16_t dropped(void);
+
     #if defined(TEST_CONTROLLER)
     bool hasBasePressed(void);
     void display(String* out);
@@ -154,24 +261,40 @@ class Button
 class Controller
 {
   protected:
+    #if defined(ARDUINO)
     USB m_Usb;
     BTD m_Btd;
+    #endif
     byte m_type;
     connection_status_e m_connectionStatus;
     CriticalFault_Struct m_faultData[2];
     unsigned long m_lagTime;
     unsigned long m_lastReadTime;
-    byte m_disconnectCount;
-
+    bool m_disconnectEvent;
+    Input_Frame_Struct m_frame;
+    Input_Event_Struct m_events[CONTROLLER_EVENT_QUEUE_SIZE];
+    uint16_t m_eventHead;
+    unsigned long m_pairingHoldStart;
+    bool m_pairingHolding;
+    bool m_pairingHeld;
+
+    #if defined(ARDUINO)
     bool m_authorized(void);
-    String m_getPgmString(const char *);
+    #endif
     void m_setConnectionStatus(byte n);
     void m_initCriticalFault(byte idx);
     void m_resetCriticalFault(byte idx);
+    void m_recordButtons(uint32_t pressed, uint32_t clicked);
+    void m_checkPairing(uint32_t pressed);
+    void m_recordFrame(void);
+
+    template <class Pad> void m_captureButtons(Pad* pad);
+    template <class Pad> void m_captureFrame(Pad* pad);
+    template <class Pad> byte m_readHat(Pad* pad, byte side, byte axis);
 
     virtual void m_connect(void) {};
     virtual void m_disconnect(void) {};
-    virtual bool m_getUsbStatus(void) {};
+    virtual bool m_getUsbStatus(void) { return false; };
     virtual bool m_detectCriticalFault(void);
 
     #if defined(TEST_CONTROLLER)
@@ -179,34 +302,40 @@ class Controller
     #endif
 
   public:
-    Controller(const int settings[], const unsigned long timings[]);
+    Controller(const Config_Section* settings, const Config_Section* timings);
     ~Controller(void);
 
-    int* pSettings;
-    unsigned long* pTimings;
+    const Config_Section* pSettings;
+    const Config_Section* pTimings;
     Joystick_Drive driveStick;
     Joystick_Dome domeStick;
     Button button;
+    Authorized_Devices devices;
 
     void begin(void);
+    void applySettings(void);
     byte connectionStatus(void);
-    void disconnecting(void);
-    bool isDisconnecting(void);
+    bool disconnectEvent(void);
+    const Input_Frame_Struct* frame(void);
+    void subscribe(Button* pButton);
+    uint16_t eventHead(void);
+    const Input_Event_Struct* event(uint16_t sequence);
     byte  getType(void);
 
-    virtual bool read(void) {};
-    virtual bool connected(void) {};
-    virtual bool getButtonClick(int buttonEnum) {};
-    virtual bool getButtonPress(int buttonEnum) {};
-    virtual int  getAnalogButton(int buttonEnum) {};
-    virtual int  getAnalogHat(int stickEnum) {};
+    virtual bool read(void) { return false; };
+    virtual bool connected(void) { return false; };
+    virtual bool getButtonClick(int buttonEnum) { return false; };
+    virtual bool getButtonPress(int buttonEnum) { return false; };
+    virtual int  getAnalogButton(int buttonEnum) { return 0; };
+    virtual int  getAnalogHat(int stickEnum) { return 127; };
     virtual void setLed(bool driveEnabled, byte speedProfile) {};
 };
 
+#if defined(ARDUINO)
 /* ================================================================================
  *                                  PS3Nav Controller
  * ================================================================================ */
-class Controller_PS3Nav : public Controller
+class Controller_PS3Nav final : public Controller
 {
   private:
     PS3BT m_controller;
@@ -221,7 +350,7 @@ class Controller_PS3Nav : public Controller
     virtual bool m_detectCriticalFault(PS3BT * pController);
 
   public:
-    Controller_PS3Nav(const int settings[], const unsigned long timings[]);
+    Controller_PS3Nav(const Config_Section* settings, const Config_Section* timings);
     virtual ~Controller_PS3Nav(void);
 
     static Controller_PS3Nav* Controller_PS3Nav::anchor;
@@ -240,7 +369,7 @@ class Controller_PS3Nav : public Controller
 /* ================================================================================
  *                                  PS3 Controller
  * ================================================================================ */
-class Controller_PS3 : public Controller
+class Controller_PS3 final : public Controller
 {
   private:
     PS3BT m_controller;
@@ -252,7 +381,7 @@ class Controller_PS3 : public Controller
     virtual bool m_getUsbStatus(void);
 
   public:
-    Controller_PS3(const int settings[], const unsigned long timings[]);
+    Controller_PS3(const Config_Section* settings, const Config_Section* timings);
     virtual ~Controller_PS3(void);
 
     static Controller_PS3* Controller_PS3::anchor;
@@ -271,7 +400,7 @@ class Controller_PS3 : public Controller
 /* ================================================================================
  *                                  PS4 Controller
  * ================================================================================ */
-class Controller_PS4 : public Controller
+class Controller_PS4 final : public Controller
 {
   private:
     PS4BT m_controller;
@@ -283,7 +412,7 @@ class Controller_PS4 : public Controller
     virtual bool m_getUsbStatus(void);
 
   public:
-    Controller_PS4(const int settings[], const unsigned long timings[], bool pair=false);
+    Controller_PS4(const Config_Section* settings, const Config_Section* timings, bool pair=false);
     virtual ~Controller_PS4(void);
 
     static Controller_PS4* Controller_PS4::anchor;
@@ -302,7 +431,7 @@ class Controller_PS4 : public Controller
 /* ================================================================================
  *                                  PS5 Controller
  * ================================================================================ */
-class Controller_PS5 : public Controller
+class Controller_PS5 final : public Controller
 {
   private:
     PS5BT m_controller;
@@ -314,7 +443,7 @@ class Controller_PS5 : public Controller
     virtual bool m_getUsbStatus(void);
 
   public:
-    Controller_PS5(const int settings[], const unsigned long timings[], bool pair=false);
+    Controller_PS5(const Config_Section* settings, const Config_Section* timings, bool pair=false);
     virtual ~Controller_PS5(void);
 
     static Controller_PS5* Controller_PS5::anchor;
@@ -329,5 +458,115 @@ class Controller_PS5 : public Controller
     virtual int  getAnalogHat(int stickEnum);
     virtual void setLed(bool driveEnabled, byte speedProfile);
 };
+#endif
+
+/* ================================================================================
+ *                                Scripted Controller
+ * ================================================================================ */
+
+// ------------------------------------------------------------------------------
+// Input played from a script instead of a Bluetooth controller. The host build
+// uses it in place of a PS controller so the whole sketch runs on a workstation
+// from repeatable input, and any build can use it to bench test without a
+// controller. Each step holds until the next one's time comes around.
+// ------------------------------------------------------------------------------
+
+struct Script_Step_Struct {
+  unsigned long time;       // When the step starts, in ms after play().
+  bool connected;           // False drops the connection, as a controller going out of range.
+  byte hat[4];              // LeftHatX, LeftHatY, RightHatX, RightHatY. 127 is centered.
+  uint32_t buttons;         // One bit per button held down, indexed by button enum.
+};
 
+class Controller_Script final : public Controller
+{
+  private:
+    const Script_Step_Struct* m_script;
+    byte m_stepCount;
+    byte m_nextStep;
+    unsigned long m_startTime;
+
+    Script_Step_Struct m_state;
+    uint32_t m_previousButtons;
+    uint32_t m_clicks;
+
+  public:
+    Controller_Script(const Config_Section* settings, const Config_Section* timings);
+    virtual ~Controller_Script(void);
+
+    void begin(void);
+    void play(const Script_Step_Struct script[], byte count);
+    void apply(const Script_Step_Struct* step);
+    bool finished(void);
+
+    virtual bool read(void);
+    virtual bool connected(void);
+    virtual bool getButtonClick(int buttonEnum);
+    virtual bool getButtonPress(int buttonEnum);
+    virtual int  getAnalogButton(int buttonEnum);
+    virtual int  getAnalogHat(int stickEnum);
+    virtual void setLed(bool driveEnabled, byte speedProfile);
+};
+
+/* ================================================================================
+ *                              Input Capture Templates
+ * ================================================================================ */
+
+// ------------------------------------------------------------------------------
+// Each controller's read() passes itself in as Pad. The controller classes are
+// final, so every getButtonPress(), getButtonClick() and getAnalogHat() below is
+// a direct call the compiler can inline. The input path then costs no virtual
+// calls. The virtual functions stay for everyone else.
+// ------------------------------------------------------------------------------
+
+// ============================
+//      m_captureButtons()
+// ============================
+template <class Pad>
+void Controller::m_captureButtons(Pad* pad)
+{
+  // -------------------------------------------------------------
+  // Ask the controller about each button exactly once per read.
+  // Everything else works from these two masks.
+  // -------------------------------------------------------------
+
+  uint32_t pressed = 0;
+  uint32_t clicked = 0;
+
+  for (byte i = 0; i < BUTTON_COUNT; i++) {
+    if ( pad->getButtonPress(i) ) {
+      pressed |= ((uint32_t)1 << i);
+    }
+    if ( pad->getButtonClick(i) ) {
+      clicked |= ((uint32_t)1 << i);
+    }
+  }
+
+  m_recordButtons(pressed, clicked);
+}
+
+// ==========================
+//      m_captureFrame()
+// ==========================
+template <class Pad>
+void Controller::m_captureFrame(Pad* pad)
+{
+  driveStick.process(m_readHat(pad, driveStick.side, 0), m_readHat(pad, driveStick.side, 1));
+  domeStick.process(m_readHat(pad, domeStick.side, 0));
+  m_recordFrame();
+}
+
+// =====================
+//      m_readHat()
+// =====================
+template <class Pad>
+byte Controller::m_readHat(Pad* pad, byte side, byte axis)
+{
+  if ( side == 0 ) {
+    return pad->getAnalogHat(axis == 0 ? LeftHatX : LeftHatY);
+  } else if ( side == 1 ) {
+    return pad->getAnalogHat(axis == 0 ? RightHatX : RightHatY);
+  }
+  return 127;
+}
 #endif
@@ -15,7 +15,7 @@
 // =====================
 //      Constructor
 // =====================
-Controller_PS3Nav::Controller_PS3Nav(const int settings[], const unsigned long timings[])
+Controller_PS3Nav::Controller_PS3Nav(const Config_Section* settings, const Config_Section* timings)
   : Controller(settings, timings),
     m_controller(&m_Btd),
     m_secondController(&m_Btd)
@@ -49,10 +49,10 @@ void Controller_PS3Nav::begin(void)
 
   #if defined(DEBUG)
   Debug.print(DBG_INFO, F("Controller_PS3Nav"), F("m_onInitConnect()"), F("Ready to connect a PS3 Nav controller"));
-  Debug.print(DBG_VERBOSE, F("\n  Drive stick: "), (String)driveStick.getSide());
-  Debug.print(DBG_VERBOSE, F("\n    Dead zone: "), (String)driveStick.deadZone);
-  Debug.print(DBG_VERBOSE, F("\n   Dome stick: "), (String)domeStick.getSide());
-  Debug.print(DBG_VERBOSE, F("\n    Dead zone: "), (String)domeStick.deadZone);
+  Debug.print(DBG_VERBOSE, F("\n  Drive stick: "), driveStick.getSide());
+  Debug.print(DBG_VERBOSE, F("\n    Dead zone: "), (long)driveStick.deadZone);
+  Debug.print(DBG_VERBOSE, F("\n   Dome stick: "), domeStick.getSide());
+  Debug.print(DBG_VERBOSE, F("\n    Dead zone: "), (long)domeStick.deadZone);
   #endif
 }
 
@@ -228,7 +228,7 @@ bool Controller_PS3Nav::read()
       return false;
     }
   }
-  m_faultData[0].lastReadTime = millis();
+  m_faultData[0].lastReadTime = Hal_Clock::millis();
 
   m_Usb.Task();
   if ( ! connected(&m_secondController) ) {
@@ -239,15 +239,22 @@ bool Controller_PS3Nav::read()
       return false;
     }
   }
-  m_faultData[1].lastReadTime = millis();
+  m_faultData[1].lastReadTime = Hal_Clock::millis();
+
+  // ------------------------------------------------------
+  // Take one snapshot of the buttons. Everything below and
+  // every peripheral works from this snapshot.
+  // ------------------------------------------------------
+
+  m_captureButtons(this);
 
   // -----------------------------------
   // Look for user-requested disconnect.
   // -----------------------------------
 
-  if ( getButtonPress(L2) || getButtonPress(R2) ) {
+  if ( button.pressed(L2) || button.pressed(R2) ) {
 
-    if ( getButtonPress(PS2) ) {
+    if ( button.pressed(PS2) ) {
 
       #if defined(DEBUG)
       String msg = F("Disconnecting");
@@ -258,7 +265,7 @@ bool Controller_PS3Nav::read()
 
       m_disconnect(&m_secondController);
 
-    } else if ( getButtonPress(PS) ) {
+    } else if ( button.pressed(PS) ) {
 
       #if defined(DEBUG)
       Debug.print(DBG_INFO, F("Controller_PS3Nav"), F("read()"), F("Disconnecting"), F(" due to user request"));
@@ -276,10 +283,11 @@ bool Controller_PS3Nav::read()
   //m_scrollInput();  // Uncomment only one of these at a time.
   #endif
 
-  // -------------
-  // Read is done.
-  // -------------
+  // ---------------------------------------
+  // Read is done. Capture the input frame.
+  // ---------------------------------------
 
+  m_captureFrame(this);
   return true;
 }
 
@@ -360,7 +368,7 @@ bool Controller_PS3Nav::m_detectCriticalFault(PS3BT * pController)
   }
 
   if ( connected(pController) ) {
-    currentTime = millis();
+    currentTime = Hal_Clock::millis();
     m_faultData[idx].lastMsgTime = pController->getLastMessageTime();
     lagTime = 0;
 
@@ -369,7 +377,7 @@ bool Controller_PS3Nav::m_detectCriticalFault(PS3BT * pController)
     // -----------------------
 
     if ( m_faultData[idx].reconnect ) {
-      if ( lagTime < pTimings[iLagReconnect] ) {
+      if ( lagTime < pTimings->get(iLagReconnect) ) {
         m_faultData[idx].reconnect = false;
       }
       m_faultData[idx].lastMsgTime = currentTime;
@@ -389,13 +397,13 @@ bool Controller_PS3Nav::m_detectCriticalFault(PS3BT * pController)
     // Disconnect after too much lag.
     // ------------------------------
 
-    if ( lagTime > pTimings[iLagDisconnect] ) {
+    if ( lagTime > pTimings->get(iLagDisconnect) ) {
 
       #if defined(DEBUG)
       Debug.print(DBG_WARNING, F("Controller_PS3Nav"), F("m_detectCriticalFault()"), F("Disconnecting due to lag time."));
-      Debug.print(DBG_VERBOSE, F("  Current time:  "), (String)currentTime);
-      Debug.print(DBG_VERBOSE, F("  Last msg time: "), (String)lastMsgTime);
-      Debug.print(DBG_VERBOSE, F("  Lag:           "), (String)lagTime);
+      Debug.print(DBG_VERBOSE, F("  Current time:  "), (long)currentTime);
+      Debug.print(DBG_VERBOSE, F("  Last msg time: "), (long)lastMsgTime);
+      Debug.print(DBG_VERBOSE, F("  Lag:           "), (long)lagTime);
       #endif
       
       m_disconnect(pController);
@@ -408,7 +416,7 @@ bool Controller_PS3Nav::m_detectCriticalFault(PS3BT * pController)
     // ---------------------------------------------------------------
 
     if ( idx == 0 ) {
-      if ( lagTime > pTimings[iLagKillMotor] ) {
+      if ( lagTime > pTimings->get(iLagKillMotor) ) {
   
         #if defined(DEBUG)
         Debug.print(DBG_WARNING, F("Controller_PS3Nav"), F("m_detectCriticalFault()"), F("Stopping drive motors due to lag."));
@@ -434,7 +442,7 @@ bool Controller_PS3Nav::m_detectCriticalFault(PS3BT * pController)
         // Has the desired amount of time between failed checks passed?
         // ------------------------------------------------------------
         
-        unsigned long interval = ( connected(pController) ? pTimings[iLongInterval] : pTimings[iShortInterval]);
+        unsigned long interval = ( connected(pController) ? pTimings->get(iLongInterval) : pTimings->get(iShortInterval));
         if ( currentTime > ( m_faultData[idx].pluggedStateTime + interval )) {
 
           // We have our second failed check.
@@ -455,7 +463,7 @@ bool Controller_PS3Nav::m_detectCriticalFault(PS3BT * pController)
         // Start the state machine.
         // ------------------------
 
-        m_faultData[idx].pluggedStateTime = millis();
+        m_faultData[idx].pluggedStateTime = Hal_Clock::millis();
       }
 
     } else {
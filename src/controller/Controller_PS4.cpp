@@ -15,7 +15,7 @@
 // =====================
 //      Constructor
 // =====================
-Controller_PS4::Controller_PS4(const int settings[], const unsigned long timings[], bool pair=false)
+Controller_PS4::Controller_PS4(const Config_Section* settings, const Config_Section* timings, bool pair=false)
   : Controller(settings, timings),
     m_controller(&m_Btd, pair)
 {
@@ -47,10 +47,10 @@ void Controller_PS4::begin(void)
 
   #if defined(DEBUG)
   Debug.print(DBG_INFO, F("Controller_PS4"), F("m_onInitConnect()"), F("Ready to connect a PS4 controller"));
-  Debug.print(DBG_VERBOSE, F("  Drive stick: "), (String)driveStick.getSide());
-  Debug.print(DBG_VERBOSE, F("    Dead zone: "), (String)driveStick.deadZone);
-  Debug.print(DBG_VERBOSE, F("   Dome stick: "), (String)domeStick.getSide());
-  Debug.print(DBG_VERBOSE, F("    Dead zone: "), (String)domeStick.deadZone);
+  Debug.print(DBG_VERBOSE, F("  Drive stick: "), driveStick.getSide());
+  Debug.print(DBG_VERBOSE, F("    Dead zone: "), (long)driveStick.deadZone);
+  Debug.print(DBG_VERBOSE, F("   Dome stick: "), domeStick.getSide());
+  Debug.print(DBG_VERBOSE, F("    Dead zone: "), (long)domeStick.deadZone);
   #endif
 }
 
@@ -191,13 +191,20 @@ bool Controller_PS4::read()
   if ( ! connected() ) {
     return false;
   }
-  m_faultData[0].lastReadTime = millis();
+  m_faultData[0].lastReadTime = Hal_Clock::millis();
+
+  // ------------------------------------------------------
+  // Take one snapshot of the buttons. Everything below and
+  // every peripheral works from this snapshot.
+  // ------------------------------------------------------
+
+  m_captureButtons(this);
 
   // -----------------------------------
   // Look for user-requested disconnect.
   // -----------------------------------
 
-  if ( button.clicked(PS) && ( button.pressed(L2) || button.pressed(R2) ) ) {
+  if ( button.clicked(PS) && ( button.held(L2) || button.held(R2) ) ) {
 
     #if defined(DEBUG)
     Debug.print(DBG_INFO, F("Controller_PS4"), F("read()"), F("Disconnecting due to user request"));
@@ -214,10 +221,11 @@ bool Controller_PS4::read()
   //m_scrollInput();  // Uncomment only one of these at a time.
   #endif
 
-  // -------------
-  // Read is done.
-  // -------------
+  // ---------------------------------------
+  // Read is done. Capture the input frame.
+  // ---------------------------------------
 
+  m_captureFrame(this);
   return true;
 }
 
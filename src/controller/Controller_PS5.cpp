@@ -15,7 +15,7 @@
 // =====================
 //      Constructor
 // =====================
-Controller_PS5::Controller_PS5(const int settings[], const unsigned long timings[], bool pair=false)
+Controller_PS5::Controller_PS5(const Config_Section* settings, const Config_Section* timings, bool pair=false)
   : Controller(settings, timings),
     m_controller(&m_Btd, pair)
 {
@@ -47,10 +47,10 @@ void Controller_PS5::begin(void)
 
   #if defined(DEBUG)
   Debug.print(DBG_INFO, F("Controller_PS5"), F("m_onInitConnect()"), F("Ready to connect a PS5 controller"));
-  Debug.print(DBG_VERBOSE, F("\n  Drive stick: "), (String)driveStick.getSide());
-  Debug.print(DBG_VERBOSE, F("\n    Dead zone: "), (String)driveStick.deadZone);
-  Debug.print(DBG_VERBOSE, F("\n   Dome stick: "), (String)domeStick.getSide());
-  Debug.print(DBG_VERBOSE, F("\n    Dead zone: "), (String)domeStick.deadZone);
+  Debug.print(DBG_VERBOSE, F("\n  Drive stick: "), driveStick.getSide());
+  Debug.print(DBG_VERBOSE, F("\n    Dead zone: "), (long)driveStick.deadZone);
+  Debug.print(DBG_VERBOSE, F("\n   Dome stick: "), domeStick.getSide());
+  Debug.print(DBG_VERBOSE, F("\n    Dead zone: "), (long)domeStick.deadZone);
   #endif
 }
 
@@ -183,13 +183,20 @@ bool Controller_PS5::read()
   if ( ! connected() ) {
     return false;
   }
-  m_faultData[0].lastReadTime = millis();
+  m_faultData[0].lastReadTime = Hal_Clock::millis();
+
+  // ------------------------------------------------------
+  // Take one snapshot of the buttons. Everything below and
+  // every peripheral works from this snapshot.
+  // ------------------------------------------------------
+
+  m_captureButtons(this);
 
   // -----------------------------------
   // Look for user-requested disconnect.
   // -----------------------------------
 
-  if ( button.clicked(PS) && ( button.pressed(L2) || button.pressed(R2) ) ) {
+  if ( button.clicked(PS) && ( button.held(L2) || button.held(R2) ) ) {
 
     #if defined(DEBUG)
     Debug.print(DBG_INFO, F("Controller_PS5"), F("read()"), F("Disconnecting due to user request"));
@@ -206,10 +213,11 @@ bool Controller_PS5::read()
   //m_scrollInput();  // Uncomment only one of these at a time.
   #endif
 
-  // -------------
-  // Read is done.
-  // -------------
+  // ---------------------------------------
+  // Read is done. Capture the input frame.
+  // ---------------------------------------
 
+  m_captureFrame(this);
   return true;
 }
 
@@ -0,0 +1,164 @@
+/* =================================================================================
+ *    B.L.A.C.Box: Brian Lubkeman's Astromech Controller
+ * =================================================================================
+ * Controller_Script.cpp - Controller input played from a script
+ * Created by Brian Lubkeman, 16 June 2021
+ * Inspired by S.H.A.D.O.W. controller code written by KnightShade
+ * Released into the public domain.
+ */
+#include "Controller.h"
+
+/* ================================================================================
+ *                                Scripted Controller
+ * ================================================================================ */
+
+// =====================
+//      Constructor
+// =====================
+Controller_Script::Controller_Script(const Config_Section* settings, const Config_Section* timings)
+  : Controller(settings, timings)
+{
+  m_type = 2;   // Reads like a PS4: SHARE and OPTIONS labels, no second controller.
+
+  m_script = NULL;
+  m_stepCount = 0;
+  m_nextStep = 0;
+  m_startTime = 0;
+
+  m_state.time = 0;
+  m_state.connected = false;
+  for (byte i = 0; i < 4; i++) {
+    m_state.hat[i] = 127;
+  }
+  m_state.buttons = 0;
+
+  m_previousButtons = 0;
+  m_clicks = 0;
+}
+
+// ====================
+//      Destructor
+// ====================
+Controller_Script::~Controller_Script(void) {}
+
+// =================
+//      begin()
+// =================
+void Controller_Script::begin(void)
+{
+  Controller::begin();
+
+  #if defined(DEBUG)
+  Debug.print(DBG_INFO, F("Controller_Script"), F("begin()"), F("Input comes from a script"));
+  #endif
+}
+
+// ================
+//      play()
+// ================
+void Controller_Script::play(const Script_Step_Struct script[], byte count)
+{
+  m_script = script;
+  m_stepCount = count;
+  m_nextStep = 0;
+  m_startTime = Hal_Clock::millis();
+}
+
+// =================
+//      apply()
+// =================
+void Controller_Script::apply(const Script_Step_Struct* step)
+{
+  // ---------------------------------------------------------
+  // Take on a step's input now. A change in connection is
+  // handled just as a Bluetooth connect or drop would be.
+  // ---------------------------------------------------------
+
+  if ( step->connected && ! m_state.connected ) {
+    m_initCriticalFault(0);
+    m_setConnectionStatus(FULL);
+  } else if ( ! step->connected && m_state.connected ) {
+    m_setConnectionStatus(NONE);
+  }
+
+  m_state = *step;
+}
+
+// ====================
+//      finished()
+// ====================
+bool Controller_Script::finished(void)
+{
+  return ( m_nextStep >= m_stepCount );
+}
+
+// ================
+//      read()
+// ================
+bool Controller_Script::read(void)
+{
+  // Move to every step whose time has come.
+
+  while ( m_nextStep < m_stepCount && (Hal_Clock::millis() - m_startTime) >= m_script[m_nextStep].time ) {
+    apply(&m_script[m_nextStep]);
+    m_nextStep++;
+  }
+
+  if ( ! connected() ) {
+    return false;
+  }
+  m_faultData[0].lastReadTime = Hal_Clock::millis();
+
+  // ------------------------------------------------------
+  // A button clicks as it goes down, as it does on the PS
+  // controllers. Each click is handed out once.
+  // ------------------------------------------------------
+
+  m_clicks = m_state.buttons & ~m_previousButtons;
+  m_previousButtons = m_state.buttons;
+
+  m_captureButtons(this);
+  m_captureFrame(this);
+  return true;
+}
+
+// =====================
+//      connected()
+// =====================
+bool Controller_Script::connected(void)
+{
+  return m_state.connected;
+}
+
+// ==============================
+//      Get Button Functions
+// ==============================
+bool Controller_Script::getButtonPress(int buttonEnum)
+{
+  return (m_state.buttons >> buttonEnum) & 1;
+}
+
+bool Controller_Script::getButtonClick(int buttonEnum)
+{
+  uint32_t bit = (uint32_t)1 << buttonEnum;
+  if ( m_clicks & bit ) {
+    m_clicks &= ~bit;
+    return true;
+  }
+  return false;
+}
+
+int Controller_Script::getAnalogButton(int buttonEnum)
+{
+  return ( getButtonPress(buttonEnum) ? 255 : 0 );
+}
+
+int Controller_Script::getAnalogHat(int stickEnum)
+{
+  return ( stickEnum >= 0 && stickEnum < 4 ? m_state.hat[stickEnum] : 127 );
+}
+
+// ==================
+//      setLed()
+// ==================
+void Controller_Script::setLed(bool driveEnabled, byte speedProfile) {}
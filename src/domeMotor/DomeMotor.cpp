@@ -6,8 +6,8 @@
  * Inspired by S.H.A.D.O.W. controller code written by KnightShade
  * Released into the public domain.
  */
-#include <Arduino.h>
 #include "DomeMotor.h"
+#include "DomeMotor_Routines.h"
 
 
 /* ================================================================================
@@ -16,24 +16,36 @@
 // =====================
 //      Constructor
 // =====================
-DomeMotor::DomeMotor(Controller* pController, const byte settings[], const unsigned long timings[])
+DomeMotor::DomeMotor(Controller* pController, const Config_Section* settings, const Config_Section* timings, const Config_Section* positionSettings)
+  : m_button(pController),
+    m_position(positionSettings)
 {
   m_controller = pController;
   m_settings = settings;
   m_timings  = timings;
 
   m_domeStick = &m_controller->domeStick;
-  m_button = &m_controller->button;
 
   m_rotationStatus = STOPPED;
 
-  m_targetPosition = 0;  // (0 - 359) - degrees in a circle, 0 = home
-  m_stopTurnTime   = 0;
+  m_targetPosition = 0;  // (0 - 3599) - tenths of a degree, 0 = home
   m_startTurnTime  = 0;
   m_previousTime   = 0;
 
   m_automationRunning = false;
   m_automationSettingsInvalid = false;
+
+  m_seeking    = false;
+  m_seekTarget = 0;
+  m_seekSpeed  = 0;
+  m_seekMaxSpeed = 0;
+  m_seekSentTime = 0;
+
+  m_routineStage = ROUTINE_IDLE;
+  m_routineStep  = 0;
+  m_routinePass  = 0;
+  m_dwellUntil   = 0;
+  m_cue = NULL;
 }
 
 // ====================
@@ -46,39 +58,68 @@ DomeMotor::~DomeMotor() {}
 // =================
 void DomeMotor::begin(void)
 {
+  // ---------------------------------------------------------
+  // Get our own copy of the button clicks from the controller.
+  // ---------------------------------------------------------
+
+  m_controller->subscribe(&m_button);
+
   // ---------------------------------------------------
   // Prepare the random number seed for dome automation.
   // ---------------------------------------------------
 
-  randomSeed(analogRead(0));
+  randomSeed(Hal_Pin::analog(0));
+
+  // ----------------------------------------------------------
+  // Start tracking the dome position, then take up the settings
+  // that may also change while running.
+  // ----------------------------------------------------------
+
+  m_position.begin();
+  applySettings();
+}
+
+// =========================
+//      applySettings()
+// =========================
+void DomeMotor::applySettings(void)
+{
+  // ----------------------------------------------------------------
+  // Speeds and timings may be changed while running. The position
+  // sensor, its pins and the Syren10 address are only read at startup.
+  // ----------------------------------------------------------------
 
-  // ----------------------------------
   // Validate dome automation settings.
-  // ----------------------------------
 
-  if ( m_timings[iTurn360] < m_timings[iTurn360Min] ||
-       m_timings[iTurn360] > m_timings[iTurn360Max] ||
-       m_settings[iAutoSpeed] < m_settings[iAutoSpeedMin] ||
-       m_settings[iAutoSpeed] > m_settings[iAutoSpeedMax] ) {
+  m_automationSettingsInvalid = false;
+
+  if ( m_timings->get(iTurn360) < m_timings->get(iTurn360Min) ||
+       m_timings->get(iTurn360) > m_timings->get(iTurn360Max) ||
+       m_settings->get(iAutoSpeed) < m_settings->get(iAutoSpeedMin) ||
+       m_settings->get(iAutoSpeed) > m_settings->get(iAutoSpeedMax) ) {
 
     m_automationSettingsInvalid = true;
 
     #if defined(DEBUG)
-    Debug.print(DBG_ERROR, F("DomeMotor"), F("begin()"), F("Invalid settings"));
-    Debug.print(DBG_VERBOSE, F("  Turn time: "),  (String)m_timings[iTurn360]);
-    Debug.print(DBG_VERBOSE, F("\t Min: "),       (String)m_timings[iTurn360Min]);
-    Debug.print(DBG_VERBOSE, F("\t Max: "),       (String)m_timings[iTurn360Max]);
-    Debug.print(DBG_VERBOSE, F("  Dome speed: "), (String)m_settings[iAutoSpeed]);
-    Debug.print(DBG_VERBOSE, F("\t Min: "),       (String)m_settings[iAutoSpeedMin]);
-    Debug.print(DBG_VERBOSE, F("\t Max: "),       (String)m_settings[iAutoSpeedMax]);
+    Debug.print(DBG_ERROR, F("DomeMotor"), F("applySettings()"), F("Invalid settings"));
+    Debug.print(DBG_VERBOSE, F("  Turn time: "),  (long)m_timings->get(iTurn360));
+    Debug.print(DBG_VERBOSE, F("\t Min: "),       (long)m_timings->get(iTurn360Min));
+    Debug.print(DBG_VERBOSE, F("\t Max: "),       (long)m_timings->get(iTurn360Max));
+    Debug.print(DBG_VERBOSE, F("  Dome speed: "), (long)m_settings->get(iAutoSpeed));
+    Debug.print(DBG_VERBOSE, F("\t Min: "),       (long)m_settings->get(iAutoSpeedMin));
+    Debug.print(DBG_VERBOSE, F("\t Max: "),       (long)m_settings->get(iAutoSpeedMax));
     #endif
   }
+
+  // The timed position estimate needs the full turn time at automated speed.
+
+  m_position.applySettings(m_timings->get(iTurn360), m_settings->get(iAutoSpeed));
 }
 
 // ===============================
 //      interpretController()
 // ===============================
-void DomeMotor::interpretController(void)
+void DomeMotor::interpretController(const Input_Frame_Struct* frame)
 {
 /* ===============================================
  *
@@ -93,11 +134,23 @@ void DomeMotor::interpretController(void)
  *
  * =============================================== */  
 
+  // ----------------------------------------
+  // Take the next click event, if there is one.
+  // ----------------------------------------
+
+  m_button.update();
+
+  // ---------------------------------
+  // Bring the dome position up to date.
+  // ---------------------------------
+
+  m_position.update(Hal_Clock::millis());
+
   // -------------------------------------------
   // When no controller is found stop the motor.
   // -------------------------------------------
 
-  if ( m_controller->connectionStatus() == NONE ) {
+  if ( frame->connectionStatus == NONE ) {
     #if defined(DEBUG)
     Debug.print(DBG_WARNING, F("DomeMotor"), F("interpretController()"), F("No controller"));
     #endif
@@ -109,10 +162,11 @@ void DomeMotor::interpretController(void)
   // Look for dome automation enable/disable.
   // ----------------------------------------
 
-  if ( m_button->pressed(L2) || m_button->pressed(R2) ) {
-    if ( m_button->clicked(L4) && isAutomationRunning() ) {
+  if ( m_button.held(L2) || m_button.held(R2) ) {
+    if ( m_button.clicked(L4) && (isAutomationRunning() || isRoutineRunning()) ) {
+      stopRoutine();
       m_automationOff();
-    } else if ( m_button->clicked(R4) && ! isAutomationRunning() ) {
+    } else if ( m_button.clicked(R4) && ! isAutomationRunning() ) {
       m_automationOn();
     }
   }
@@ -121,8 +175,8 @@ void DomeMotor::interpretController(void)
   // Flood control. Don't overload the motor controller with excessive input.
   // ------------------------------------------------------------------------
 
-  unsigned long currentTime = millis();
-  if ( (currentTime - m_previousTime) < (m_settings[iDomeLatency] * 2) ) {
+  unsigned long currentTime = Hal_Clock::millis();
+  if ( (currentTime - m_previousTime) < (m_settings->get(iDomeLatency) * 2) ) {
     return;
   }
   m_previousTime = currentTime;
@@ -134,8 +188,8 @@ void DomeMotor::interpretController(void)
   // When L1|R1 is pressed, anticipate L3|R3 being pressed.
   // When this happens, do not read the stick position.
 
-  if ( (m_domeStick->side == left && m_button->pressed(L1)) ||
-       (m_domeStick->side == right && m_button->pressed(R1)) ) {
+  if ( (m_domeStick->side == left && m_button.pressed(L1)) ||
+       (m_domeStick->side == right && m_button.pressed(R1)) ) {
     return;
   }
 
@@ -147,24 +201,27 @@ void DomeMotor::interpretController(void)
 
   if ( m_controller->getType() != 0 ) {
     // The controller is a PS3, PS4, or PS5 controller.
-    stickPosition = m_domeStick->rotation();
-  } else if ( m_controller->connectionStatus() == FULL ) {
+    stickPosition = frame->domeX;
+  } else if ( frame->connectionStatus == FULL ) {
     // The controller is a pair of PS3 Move Navigations.
-    stickPosition = m_domeStick->rotation();
-  } else if ( m_button->pressed(L2) ) {
+    stickPosition = frame->domeX;
+  } else if ( m_button.pressed(L2) ) {
     // The controller is a single PS3 Move Navigation.
-    stickPosition = m_domeStick->rotation();
+    stickPosition = frame->domeX;
   } else {
     return;
   }
 
   // -----------------------------------------------------
-  // A stick within its dead zone is the same as centered.
-  // Stop dome rotation when the stick is centered.
+  // The controller has already applied the dead zone.
+  // Stop dome rotation when the stick is centered, unless
+  // the dome is on its way to an angle.
   // -----------------------------------------------------
   
-  if ( abs(stickPosition - m_domeStick->center) < m_domeStick->deadZone ) {
-    stop();
+  if ( stickPosition == m_domeStick->center ) {
+    if ( ! m_seeking ) {
+      stop();
+    }
     return;
   }
 
@@ -172,7 +229,7 @@ void DomeMotor::interpretController(void)
   // Convert the joystick position to a rotation speed.
   // --------------------------------------------------
 
-  int rotationSpeed = map(stickPosition, m_domeStick->minValue, m_domeStick->maxValue, -m_settings[iDomeSpeed], m_settings[iDomeSpeed]);
+  int rotationSpeed = map(stickPosition, m_domeStick->minValue, m_domeStick->maxValue, -m_settings->get(iDomeSpeed), m_settings->get(iDomeSpeed));
 
   // -------------------------------------------
   // Turn off dome automation if manually moved.
@@ -181,15 +238,161 @@ void DomeMotor::interpretController(void)
   if ( rotationSpeed != 0 && isAutomationRunning() ) {
     m_automationOff();
   }
+  if ( isRoutineRunning() ) {
+    stopRoutine();
+  }
+  m_seeking = false;
 
   // --------------------------
   // Send the rotation command.
   // --------------------------
 
+  m_setSpeed(rotationSpeed);
+}
+
+// ================
+//      stop()
+// ================
+void DomeMotor::stop(void)
+{
+  m_seeking = false;
+  m_position.setSpeed(0);
+  m_stopDome();
+}
+
+// ======================
+//      m_setSpeed()
+// ======================
+void DomeMotor::m_setSpeed(int rotationSpeed)
+{
+  // Every rotation command goes through here so the position
+  // estimate always knows the speed the dome was told to turn.
+
+  m_position.setSpeed(rotationSpeed);
   m_rotateDome(rotationSpeed);
 }
 
 
+// ============================================
+//          Dome positioning functions
+// ============================================
+
+
+// ================
+//      goTo()
+// ================
+void DomeMotor::goTo(int angle, int speed)
+{
+  // A speed of 0 turns at the automated speed.
+
+  m_seekTarget = DomePosition::wrap(angle);
+  m_seekSpeed  = 0;
+  m_seekMaxSpeed = ( speed > 0 ? min(speed, (int)m_settings->get(iAutoSpeedMax)) : m_settings->get(iAutoSpeed) );
+  m_seeking    = true;
+
+  #if defined(DEBUG)
+  Debug.print(DBG_VERBOSE, F("DomeMotor"), F("goTo()"), F("From "), (long)m_position.angle());
+  Debug.print(DBG_VERBOSE, F("  To: "), (long)m_seekTarget);
+  #endif
+}
+
+// ======================
+//      returnHome()
+// ======================
+void DomeMotor::returnHome(void)
+{
+  goTo(0);
+}
+
+// =====================
+//      isTurning()
+// =====================
+bool DomeMotor::isTurning(void)
+{
+  return m_seeking;
+}
+
+// ====================
+//      position()
+// ====================
+int DomeMotor::position(void)
+{
+  return m_position.angle();
+}
+
+// ==========================
+//      runPositioning()
+// ==========================
+void DomeMotor::runPositioning(void)
+{
+  if ( ! m_seeking ) {
+    return;
+  }
+
+  unsigned long currentTime = Hal_Clock::millis();
+  m_position.update(currentTime);
+
+  const Config_Section* positionSettings = m_position.settings();
+  int remaining = DomePosition::difference(m_position.angle(), m_seekTarget);
+
+  // -------------------------------------
+  // Close enough. Stop and call it done.
+  // -------------------------------------
+
+  if ( abs(remaining) <= positionSettings->get(iArriveTolerance) ) {
+    stop();
+
+    #if defined(DEBUG)
+    Debug.print(DBG_VERBOSE, F("DomeMotor"), F("runPositioning()"), F("Arrived at "), (long)m_position.angle());
+    #endif
+    return;
+  }
+
+  // -----------------------------------------------------------------
+  // Send a new speed when it changes, no faster than the motor
+  // controller's serial latency allows. Resend an unchanged speed
+  // every DOME_KEEP_ALIVE, or the Syren10's serial timeout would stop
+  // the dome part way through a long turn. The seek keeps its own send
+  // time, so it never holds off the stick's flood control.
+  // -----------------------------------------------------------------
+
+  int rotationSpeed = m_seekSpeedFor(remaining);
+  unsigned long sinceSent = currentTime - m_seekSentTime;
+
+  if ( rotationSpeed == m_seekSpeed && sinceSent < DOME_KEEP_ALIVE ) {
+    return;
+  }
+  if ( m_seekSpeed != 0 && sinceSent < (unsigned long)m_settings->get(iDomeLatency) ) {
+    return;
+  }
+  m_seekSentTime = currentTime;
+  m_seekSpeed = rotationSpeed;
+  m_setSpeed(rotationSpeed);
+}
+
+// ==========================
+//      m_seekSpeedFor()
+// ==========================
+int DomeMotor::m_seekSpeedFor(int remaining)
+{
+  // ------------------------------------------------------------------
+  // Full automated speed until the dome is inside the ramp zone, then
+  // slow in proportion to the angle left, but never below creep speed.
+  // ------------------------------------------------------------------
+
+  const Config_Section* positionSettings = m_position.settings();
+  int distance = abs(remaining);
+  int speed = m_seekMaxSpeed;
+
+  if ( distance < positionSettings->get(iRampZone) ) {
+    speed = (int)(((long)speed * distance) / positionSettings->get(iRampZone));
+    speed = max(speed, (int)positionSettings->get(iCreepSpeed));
+  }
+
+  return ( remaining < 0 ? -speed : speed );
+}
+
+
 // ============================================
 //          Dome automation functions
 // ============================================
@@ -224,6 +427,10 @@ void DomeMotor::m_automationOff(void)
   m_rotationStatus = STOPPED;
   m_targetPosition = 0;
 
+  if ( m_seeking ) {
+    stop();
+  }
+
   #if defined(DEBUG)
   Debug.print(DBG_INFO, F("DomeMotor"), F("automationOff()"), F("Dome automation"), F("disabled."));
   #endif
@@ -242,6 +449,20 @@ void DomeMotor::runAutomation(void)
     return;
   }
 
+  // ------------------------------------------------------------
+  // A routine, however it was started, takes over from the random
+  // turns until it finishes.
+  // ------------------------------------------------------------
+
+  if ( isRoutineRunning() ) {
+    m_runRoutine();
+    return;
+  }
+
+  if ( ! isAutomationRunning() ) {
+    return;
+  }
+
   // ------------------------------------------------------------
   // Call the function appropriate to the current rotation cycle.
   // ------------------------------------------------------------
@@ -264,7 +485,7 @@ void DomeMotor::runAutomation(void)
 // =========================
 void DomeMotor::m_automationInit(void)
 {
-  unsigned long currentTime = millis();
+  unsigned long currentTime = Hal_Clock::millis();
 
   if ( m_targetPosition == 0 ) {
 
@@ -273,14 +494,7 @@ void DomeMotor::m_automationInit(void)
     // -----------------------------------------------
 
     m_startTurnTime = currentTime + (random(3, 11) * 1000); // Wait 3-10 seconds before turning.
-    m_targetPosition = random(5,354);
-    if ( m_targetPosition < 180 ) {
-      m_stopTurnTime = m_startTurnTime + ((int)m_targetPosition / (float)360.0 * (unsigned long)m_timings[iTurn360]);
-      m_turnDirection = 1;
-    } else {
-      m_stopTurnTime = m_startTurnTime + (((float)360.0 - (int)m_targetPosition) / (float)360.0 * (unsigned long)m_timings[iTurn360]);
-      m_turnDirection = -1;
-    }
+    m_targetPosition = random(50, 3540);
 
   } else {
 
@@ -289,12 +503,6 @@ void DomeMotor::m_automationInit(void)
     // ----------------------------------------------
 
     m_startTurnTime = currentTime + (random(1,6) * 1000); // Wait 1-5 seconds before returning home.
-    if ( m_targetPosition < 180 ) {
-      m_stopTurnTime = m_startTurnTime + ((int)m_targetPosition / (float)360.0 * (unsigned long)m_timings[iTurn360]);
-    } else {
-      m_stopTurnTime = m_startTurnTime + (((float)360 - (int)m_targetPosition) / (float)360.0 * (unsigned long)m_timings[iTurn360]);
-    }
-    m_turnDirection *= -1;
     m_targetPosition = 0;
   }
 
@@ -306,10 +514,9 @@ void DomeMotor::m_automationInit(void)
 
   #if defined(DEBUG)
   Debug.print(DBG_VERBOSE, F("DomeMotor"), F("m_automationInit()"), F("Turn set"));
-  Debug.print(DBG_VERBOSE, F("  Current time: "),    (String)currentTime);
-  Debug.print(DBG_VERBOSE, F("  Target position: "), (String)m_targetPosition);
-  Debug.print(DBG_VERBOSE, F("  Next start time: "), (String)m_startTurnTime);
-  Debug.print(DBG_VERBOSE, F("  Next stop time:  "), (String)m_stopTurnTime);
+  Debug.print(DBG_VERBOSE, F("  Current time: "),    (long)currentTime);
+  Debug.print(DBG_VERBOSE, F("  Target position: "), (long)m_targetPosition);
+  Debug.print(DBG_VERBOSE, F("  Next start time: "), (long)m_startTurnTime);
   #endif
 }
 
@@ -318,7 +525,15 @@ void DomeMotor::m_automationInit(void)
 // ==========================
 void DomeMotor::m_automationReady(void)
 {
-  if (m_startTurnTime < millis()) {
+  if ( (long)(Hal_Clock::millis() - m_startTurnTime) >= 0 ) {
+
+    // --------------------------------------------------------
+    // Head for the target. From here on the dome position, not
+    // the clock, decides when the turn is done.
+    // --------------------------------------------------------
+
+    m_startTurnTime = Hal_Clock::millis();
+    goTo(m_targetPosition);
 
     // ---------------------------
     // Advance the rotation cycle.
@@ -337,35 +552,208 @@ void DomeMotor::m_automationReady(void)
 // ===========================
 void DomeMotor::m_automationTurn(void)
 {
-  if ( millis() < m_stopTurnTime ) {
+  if ( m_seeking ) {
 
-    // ------------------------------------------------------
-    // Actively turn the dome until it reaches its stop time.
-    // ------------------------------------------------------
+    // ----------------------------------------------------------------
+    // Still turning. A half turn should never take as long as two full
+    // turns. If it does, the dome is stuck or the estimate is lost.
+    // ----------------------------------------------------------------
+
+    if ( (Hal_Clock::millis() - m_startTurnTime) < (m_timings->get(iTurn360) * 2) ) {
+      return;
+    }
+
+    stop();
 
     #if defined(DEBUG)
-    Debug.print(DBG_INFO, F("DomeMotor"), F("m_automationTurn()"), F("Turning"));
+    Debug.print(DBG_WARNING, F("DomeMotor"), F("m_automationTurn()"), F("Turn timed out"));
     #endif
+  }
+
+  #if defined(DEBUG)
+  Debug.print(DBG_INFO, F("DomeMotor"), F("m_automationTurn()"), F("Stop turning"));
+  #endif
+
+  // ---------------------------
+  // Advance the rotation cycle.
+  // ---------------------------
+
+  m_rotationStatus = STOPPED;
+}
+
+
+// ============================================
+//          Dome routine functions
+// ============================================
 
-    int rotationSpeed = m_settings[iAutoSpeed] * m_turnDirection;
-    m_rotateDome(rotationSpeed);
-  } 
-  else {
 
-    // -------------------------------
-    // Turn completed. Stop the motor.
-    // -------------------------------
+// =====================
+//      attachCue()
+// =====================
+void DomeMotor::attachCue(Dome_Cue_Callback callback)
+{
+  m_cue = callback;
+}
 
+// ============================
+//      isRoutineRunning()
+// ============================
+bool DomeMotor::isRoutineRunning(void)
+{
+  return ( m_routineStage != ROUTINE_IDLE );
+}
+
+// =======================
+//      playRoutine()
+// =======================
+void DomeMotor::playRoutine(byte routineNumber)
+{
+  // --------------------------------------------------------------
+  // Routines are numbered from 1. Ignore any we do not have, and
+  // do not play while the automation settings are invalid.
+  // --------------------------------------------------------------
+
+  if ( routineNumber == 0 || routineNumber > DOME_ROUTINE_COUNT || m_automationSettingsInvalid ) {
     #if defined(DEBUG)
-    Debug.print(DBG_INFO, F("DomeMotor"), F("m_automationTurn()"), F("Stop turning"));
+    Debug.print(DBG_WARNING, F("DomeMotor"), F("playRoutine()"), F("No routine "), (long)routineNumber);
     #endif
+    return;
+  }
 
+  memcpy_P(&m_routine, &domeRoutines[routineNumber - 1], sizeof(m_routine));
+  if ( m_routine.count == 0 ) {
+    return;
+  }
+
+  // ------------------------------------------------------------------
+  // Random automation picks up again from home once the routine ends.
+  // ------------------------------------------------------------------
+
+  m_rotationStatus = STOPPED;
+  m_targetPosition = 0;
+
+  m_routineStep = 0;
+  m_routinePass = 0;
+  m_startKeyframe();
+
+  #if defined(DEBUG)
+  Debug.print(DBG_INFO, F("DomeMotor"), F("playRoutine()"), F("Playing routine "), (long)routineNumber);
+  #endif
+}
+
+// =======================
+//      stopRoutine()
+// =======================
+void DomeMotor::stopRoutine(void)
+{
+  if ( m_routineStage == ROUTINE_IDLE ) {
+    return;
+  }
+
+  m_routineStage = ROUTINE_IDLE;
+  if ( m_seeking ) {
     stop();
+  }
 
-    // ---------------------------
-    // Advance the rotation cycle.
-    // ---------------------------
+  #if defined(DEBUG)
+  Debug.print(DBG_INFO, F("DomeMotor"), F("stopRoutine()"), F("Routine stopped"));
+  #endif
+}
+
+// ===========================
+//      m_startKeyframe()
+// ===========================
+void DomeMotor::m_startKeyframe(void)
+{
+  memcpy_P(&m_keyframe, &m_routine.keyframes[m_routineStep], sizeof(m_keyframe));
+
+  // ------------------------------------------------------------------
+  // Add the random variation now, so each pass looks a little different.
+  // ------------------------------------------------------------------
+
+  if ( m_keyframe.dwellSpread > 0 ) {
+    m_keyframe.dwell += random(0, (long)m_keyframe.dwellSpread + 1);
+  }
+
+  if ( m_keyframe.angle == DOME_STAY ) {
+    m_routineStage = ROUTINE_MOVING;
+    return;
+  }
 
-    m_rotationStatus = STOPPED;
+  int angle = m_keyframe.angle;
+  if ( m_keyframe.spread > 0 ) {
+    angle += random(-m_keyframe.spread, m_keyframe.spread + 1);
+  }
+
+  int speed = 0;
+  if ( m_keyframe.speed > 0 ) {
+    speed = max(((int)m_settings->get(iAutoSpeed) * m_keyframe.speed) / 100, 1);
+  }
+
+  m_startTurnTime = Hal_Clock::millis();
+  goTo(angle, speed);
+  m_routineStage = ROUTINE_MOVING;
+}
+
+// ========================
+//      m_runRoutine()
+// ========================
+void DomeMotor::m_runRoutine(void)
+{
+  unsigned long currentTime = Hal_Clock::millis();
+
+  switch ( m_routineStage ) {
+
+    case ROUTINE_MOVING:
+
+      // ------------------------------------------------------------
+      // Wait for the dome to arrive, with the same safeguard as the
+      // random turns. Then fire the cue and start holding still.
+      // ------------------------------------------------------------
+
+      if ( m_seeking ) {
+        if ( (currentTime - m_startTurnTime) < (m_timings->get(iTurn360) * 2) ) {
+          return;
+        }
+        #if defined(DEBUG)
+        Debug.print(DBG_WARNING, F("DomeMotor"), F("m_runRoutine()"), F("Turn timed out"));
+        #endif
+        stopRoutine();
+        return;
+      }
+
+      if ( m_keyframe.action != 0 && m_cue != NULL ) {
+        m_cue(m_keyframe.action, m_keyframe.arg1, m_keyframe.arg2);
+      }
+
+      m_dwellUntil = currentTime + m_keyframe.dwell;
+      m_routineStage = ROUTINE_DWELLING;
+      break;
+
+    case ROUTINE_DWELLING:
+
+      if ( (long)(currentTime - m_dwellUntil) < 0 ) {
+        return;
+      }
+
+      // ---------------------------------------------------------
+      // On to the next keyframe, the next pass, or we are done.
+      // ---------------------------------------------------------
+
+      m_routineStep++;
+      if ( m_routineStep >= m_routine.count ) {
+        m_routineStep = 0;
+        m_routinePass++;
+        if ( m_routine.repeats != 0 && m_routinePass >= m_routine.repeats ) {
+          m_routineStage = ROUTINE_IDLE;
+
+          #if defined(DEBUG)
+          Debug.print(DBG_INFO, F("DomeMotor"), F("m_runRoutine()"), F("Routine complete"));
+          #endif
+          return;
+        }
+      }
+      m_startKeyframe();
+      break;
   }
 }
@@ -12,10 +12,12 @@
 #include <Sabertooth.h>
 #include "../toolbox/DebugUtils.h"
 #include "../controller/Controller.h"
+#include "../hal/SerialQueue.h"
+#include "DomePosition.h"
 
 #define DEBUG
 
-extern HardwareSerial &DomeMotor_Serial;
+extern SerialQueue &DomeMotor_Serial;
 
 enum automation_stage_e {
   STOPPED,
@@ -23,6 +25,43 @@ enum automation_stage_e {
   TURNING
 };
 
+enum routine_stage_e {
+  ROUTINE_IDLE,
+  ROUTINE_MOVING,
+  ROUTINE_DWELLING
+};
+
+// -------------------------------------------------------------------
+// A dome routine is a list of keyframes played in order. Each keyframe
+// turns the dome to an angle, fires an optional cue when it arrives,
+// then holds still for a while. The cue is a Marcduino action and its
+// arguments (see marcduino_action_e). Routines live in PROGMEM, in
+// DomeMotor_Routines.h.
+// -------------------------------------------------------------------
+
+const int DOME_STAY = -1;   // Keyframe angle that leaves the dome where it is.
+
+const unsigned long DOME_KEEP_ALIVE = 100;  // Resend an unchanged seek speed this often (ms). Well inside the Syren10's 300 ms timeout.
+
+typedef struct {
+  int angle;                // Tenths of a degree from front, or DOME_STAY.
+  int spread;               // Random variation of the angle, plus or minus (tenths).
+  byte speed;               // Percent of automated speed. 0 = automated speed.
+  unsigned int dwell;       // Time to hold after arriving (ms).
+  unsigned int dwellSpread; // Random extra hold time, up to this (ms).
+  byte action;              // Cue fired on arrival. 0 = none.
+  byte arg1;
+  byte arg2;
+} Dome_Keyframe_Struct;
+
+typedef struct {
+  const Dome_Keyframe_Struct* keyframes;
+  byte count;
+  byte repeats;             // Times to play the routine. 0 = loop until stopped.
+} Dome_Routine_Struct;
+
+typedef void (*Dome_Cue_Callback)(byte action, byte arg1, byte arg2);
+
 enum domeMotor_setting_index_e {
   iDomeMotorDriver,   // 0 - Dome motor driver.
   iDomeSpeed,         // 1 - Dome speed.
@@ -45,39 +84,71 @@ class DomeMotor
 {
   protected:
     Controller* m_controller;
-    byte* m_settings;
-    unsigned long* m_timings;
+    const Config_Section* m_settings;
+    const Config_Section* m_timings;
 
     Joystick_Dome* m_domeStick;
-    Button* m_button;
+    Button m_button;
+    DomePosition m_position;
 
     bool m_domeStopped;
     byte m_rotationStatus;
-    byte m_turnDirection;
-    unsigned int m_targetPosition;
-    unsigned long m_stopTurnTime;
+    int m_targetPosition;
     unsigned long m_startTurnTime;
     unsigned long m_previousTime;
     bool m_automationRunning;
     bool m_automationSettingsInvalid;
 
+    bool m_seeking;
+    int m_seekTarget;
+    int m_seekSpeed;
+    int m_seekMaxSpeed;
+    unsigned long m_seekSentTime;
+
+    Dome_Routine_Struct m_routine;
+    Dome_Keyframe_Struct m_keyframe;
+    byte m_routineStage;
+    byte m_routineStep;
+    byte m_routinePass;
+    unsigned long m_dwellUntil;
+    Dome_Cue_Callback m_cue;
+
+    void m_runRoutine(void);
+    void m_startKeyframe(void);
+
     void m_automationOn(void);
     void m_automationOff(void);
     void m_automationInit(void);
     void m_automationReady(void);
     void m_automationTurn(void);
 
+    void m_setSpeed(int rotationSpeed);
+    int  m_seekSpeedFor(int remaining);
+
     virtual void m_rotateDome(int rotationSpeed) {};
+    virtual void m_stopDome(void) {};
 
   public:
-    DomeMotor(Controller* pController, const byte settings[], const unsigned long timings[]);
+    DomeMotor(Controller* pController, const Config_Section* settings, const Config_Section* timings, const Config_Section* positionSettings);
     ~DomeMotor(void);
     void begin(void);
-    void interpretController(void);
+    void applySettings(void);
+    void interpretController(const Input_Frame_Struct* frame);
     void runAutomation(void);
     bool isAutomationRunning(void);
 
-    virtual void stop(void) {};
+    void goTo(int angle, int speed = 0);
+    void returnHome(void);
+    void runPositioning(void);
+    bool isTurning(void);
+    int  position(void);
+
+    void playRoutine(byte routineNumber);
+    void stopRoutine(void);
+    bool isRoutineRunning(void);
+    void attachCue(Dome_Cue_Callback callback);
+
+    void stop(void);
 };
 /* ================================================================================
  *                              Syren10 Dome Motor Class
@@ -86,15 +157,14 @@ class DomeMotor_Syren10 : public DomeMotor
 {
   private:
     Sabertooth m_syren;
-    int* m_syrenSettings;
+    const Config_Section* m_syrenSettings;
 
     virtual void m_rotateDome(int rotationSpeed);
+    virtual void m_stopDome(void);
 
   public:
-    DomeMotor_Syren10(Controller* pController, const byte settings[], const unsigned long timings[], const int syrenSettings[]);
+    DomeMotor_Syren10(Controller* pController, const Config_Section* settings, const Config_Section* timings, const Config_Section* positionSettings, const Config_Section* syrenSettings);
     virtual ~DomeMotor_Syren10(void);
     void begin(void);
-
-    virtual void stop(void);
 };
 #endif
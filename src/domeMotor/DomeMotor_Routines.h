@@ -0,0 +1,47 @@
+/* =================================================================================
+ *    B.L.A.C.Box: Brian Lubkeman's Astromech Controller
+ * =================================================================================
+ * DomeMotor_Routines.h - Keyframed dome routines.
+ * Created by Brian Lubkeman, 16 June 2021
+ * Inspired by S.H.A.D.O.W. controller code written by KnightShade
+ * Released into the public domain.
+ */
+
+#ifndef _DOME_MOTOR_ROUTINES_H_
+#define _DOME_MOTOR_ROUTINES_H_
+
+#include "../marcduino/Marcduino.h"
+
+// ---------------------------------------------------------------------------------
+// Each keyframe is: angle, angle spread, speed %, dwell, dwell spread, then a cue
+// (Marcduino action, arg1, arg2) fired when the dome arrives. Angles are tenths of
+// a degree from front. These samples assume larger angles turn the dome right, so
+// 2700 looks left. To add a routine, write its keyframes and add a row to
+// domeRoutines. Routines are numbered from 1 in the order listed there.
+// ---------------------------------------------------------------------------------
+
+// Routine 1: Look left, pause, scream, then come back home. Plays once.
+
+const Dome_Keyframe_Struct lookAndScream[] PROGMEM = {
+  { 2700,      100, 100, 600,  400,  aNone,     0,          0 },
+  { DOME_STAY, 0,   0,   2500, 0,    aSequence, SEQ_SCREAM, 0 },
+  { 0,         0,   60,  0,    0,    aNone,     0,          0 }
+};
+
+// Routine 2: Slowly look around the room, glancing with the holoprojectors. Loops.
+
+const Dome_Keyframe_Struct patrol[] PROGMEM = {
+  { 450,       150, 50,  1500, 2000, aHpRandomMove, 0, 0 },
+  { 0,         100, 50,  1000, 1000, aNone,         0, 0 },
+  { 3150,      150, 50,  1500, 2000, aHpRandomMove, 0, 0 },
+  { 0,         100, 50,  2000, 3000, aNone,         0, 0 }
+};
+
+const Dome_Routine_Struct domeRoutines[] PROGMEM = {
+  { lookAndScream, sizeof(lookAndScream) / sizeof(lookAndScream[0]), 1 },
+  { patrol,        sizeof(patrol) / sizeof(patrol[0]),               0 }
+};
+
+const byte DOME_ROUTINE_COUNT = sizeof(domeRoutines) / sizeof(domeRoutines[0]);
+
+#endif
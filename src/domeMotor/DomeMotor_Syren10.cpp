@@ -6,10 +6,10 @@
  * Inspired by S.H.A.D.O.W. controller code written by KnightShade
  * Released into the public domain.
  */
-#include <Arduino.h>
 #include "DomeMotor.h"
 
 const int SYREN10_BAUD_RATE = 9600;     // It is strongly recommended not to change this.
+const int SYREN10_TIMEOUT   = 300;      // The Syren10 stops the dome on its own after this long (ms) without a command.
 
 enum syren10_setting_index_e {
    iAddress   // 0 - Syren10 address.
@@ -24,11 +24,12 @@ enum syren10_setting_index_e {
 // =====================
 DomeMotor_Syren10::DomeMotor_Syren10 (
     Controller* pController,
-    const byte settings[],
-    const unsigned long timings[],
-    const int syrenSettings[] )
-  : DomeMotor(pController, settings, timings),
-    m_syren(syrenSettings[iAddress], DomeMotor_Serial)
+    const Config_Section* settings,
+    const Config_Section* timings,
+    const Config_Section* positionSettings,
+    const Config_Section* syrenSettings )
+  : DomeMotor(pController, settings, timings, positionSettings),
+    m_syren(syrenSettings->get(iAddress), DomeMotor_Serial)
 {
   m_controller = pController;
   m_syrenSettings = syrenSettings;
@@ -56,18 +57,18 @@ void DomeMotor_Syren10::begin(void)
   // -------------------------------------
 
   DomeMotor_Serial.begin(SYREN10_BAUD_RATE);
-  m_syren.setTimeout(300);
+  m_syren.setTimeout(SYREN10_TIMEOUT);
   m_syren.stop();
 
   #if defined(DEBUG)
-  Debug.print(DBG_INFO, F("DomeMotor_Syren10"), F("Syren10 motor controller started"));
+  Debug.print(DBG_INFO, F("DomeMotor_Syren10"), F("begin()"), F("Syren10 motor controller started"));
   #endif
 }
 
-// ================
-//      stop()
-// ================
-void DomeMotor_Syren10::stop(void)
+// ======================
+//      m_stopDome()
+// ======================
+void DomeMotor_Syren10::m_stopDome(void)
 {
   if ( m_domeStopped ) {
     return;
@@ -77,7 +78,7 @@ void DomeMotor_Syren10::stop(void)
   m_domeStopped = true;
 
   #if defined(DEBUG)
-  Debug.print(DBG_INFO, F("DomeMotor_Syren10"), F("stop()"), F("Stopped dome motor"));
+  Debug.print(DBG_INFO, F("DomeMotor_Syren10"), F("m_stopDome()"), F("Stopped dome motor"));
   #endif
 }
 
@@ -95,9 +96,9 @@ void DomeMotor_Syren10::m_rotateDome(int rotationSpeed)
       Debug.print(DBG_VERBOSE, F("DomeMotor_Syren10"), F("m_rotateDome()"), F("Stopping dome"));
     else {
       if ( rotationSpeed < 0 ) {
-        Debug.print(DBG_VERBOSE, F("DomeMotor_Syren10"), F("m_rotateDome()"), F("Rotate dome at speed "), (String)rotationSpeed);
+        Debug.print(DBG_VERBOSE, F("DomeMotor_Syren10"), F("m_rotateDome()"), F("Rotate dome at speed "), (long)rotationSpeed);
       } else {
-        Debug.print(DBG_VERBOSE, F("DomeMotor_Syren10"), F("m_rotateDome()"), F("Rotate dome at speed "), (String)rotationSpeed);
+        Debug.print(DBG_VERBOSE, F("DomeMotor_Syren10"), F("m_rotateDome()"), F("Rotate dome at speed "), (long)rotationSpeed);
       }
     }
   }
@@ -0,0 +1,274 @@
+/* =================================================================================
+ *    B.L.A.C.Box: Brian Lubkeman's Astromech Controller
+ * =================================================================================
+ * DomePosition.cpp - Dome angle estimator with optional encoder and home sensor
+ * Created by Brian Lubkeman, 16 June 2021
+ * Inspired by S.H.A.D.O.W. controller code written by KnightShade
+ * Released into the public domain.
+ */
+#include "DomePosition.h"
+
+DomePosition* DomePosition::anchor = NULL;
+
+/* ================================================================================
+ *                              Dome Position Class
+ * ================================================================================ */
+
+// =====================
+//      Constructor
+// =====================
+DomePosition::DomePosition(const Config_Section* settings)
+{
+  m_settings = settings;
+  m_turnTime = 0;
+  m_turnSpeed = 0;
+
+  m_speed = 0;
+  m_angle = 0;
+  m_residual = 0;
+  m_lastTime = 0;
+
+  m_sensor = SENSOR_NONE;
+  m_encoderCounts = 0;
+  m_encoderPinA = Hal_Pin::fast(0);
+  m_encoderPinB = Hal_Pin::fast(0);
+
+  m_encoderCount = 0;
+  m_homeSeen = false;
+  m_encoderOrigin = 0;
+  m_originAngle = 0;
+  m_lastCorrection = 0;
+  m_homed = false;
+}
+
+// ====================
+//      Destructor
+// ====================
+DomePosition::~DomePosition(void) {}
+
+// =================
+//      begin()
+// =================
+void DomePosition::begin(void)
+{
+  // ----------------------------------------------------------------
+  // The dome is assumed to start out facing front. The sensor and its
+  // pins are only read here, at startup.
+  // ----------------------------------------------------------------
+
+  m_lastTime = Hal_Clock::millis();
+  m_sensor   = m_settings->get(iPositionSensor);
+
+  anchor = this;
+
+  // -------------------------------------------------------------
+  // The encoder interrupt fires on every edge, so its pins are
+  // looked up here, once, rather than read from settings there.
+  // -------------------------------------------------------------
+
+  if ( m_sensor == SENSOR_ENCODER ) {
+    Hal_Pin::mode(m_settings->get(iEncoderPinA), INPUT_PULLUP);
+    Hal_Pin::mode(m_settings->get(iEncoderPinB), INPUT_PULLUP);
+    m_encoderPinA = Hal_Pin::fast(m_settings->get(iEncoderPinA));
+    m_encoderPinB = Hal_Pin::fast(m_settings->get(iEncoderPinB));
+    Hal_Pin::attachInterrupt(m_settings->get(iEncoderPinA), m_onEncoder, CHANGE);
+  }
+
+  if ( m_sensor != SENSOR_NONE && m_settings->get(iHomePin) != 0 ) {
+    Hal_Pin::mode(m_settings->get(iHomePin), INPUT_PULLUP);
+    Hal_Pin::attachInterrupt(m_settings->get(iHomePin), m_onHome, FALLING);
+  }
+}
+
+// =========================
+//      applySettings()
+// =========================
+void DomePosition::applySettings(unsigned long turnTime, int turnSpeed)
+{
+  // The timed model needs how long a full turn takes, and at which
+  // speed. These and the encoder counts may be changed while running.
+
+  m_turnTime      = turnTime;
+  m_turnSpeed     = turnSpeed;
+  m_encoderCounts = m_settings->get(iEncoderCounts);
+}
+
+// ======================
+//      m_onEncoder()
+// ======================
+void DomePosition::m_onEncoder(void)
+{
+  // -------------------------------------------------------------
+  // Runs on every edge of channel A. When A and B differ, A led
+  // and the dome turned toward larger angles.
+  // -------------------------------------------------------------
+
+  if ( anchor == NULL ) {
+    return;
+  }
+
+  if ( Hal_Pin::readFast(&anchor->m_encoderPinA) != Hal_Pin::readFast(&anchor->m_encoderPinB) ) {
+    anchor->m_encoderCount++;
+  } else {
+    anchor->m_encoderCount--;
+  }
+}
+
+// ===================
+//      m_onHome()
+// ===================
+void DomePosition::m_onHome(void)
+{
+  if ( anchor != NULL ) {
+    anchor->m_homeSeen = true;
+  }
+}
+
+// ========================
+//      m_readEncoder()
+// ========================
+int32_t DomePosition::m_readEncoder(void)
+{
+  // A long takes several instructions to read on the AVR. Read until
+  // two reads agree so an interrupt in the middle cannot tear it.
+
+  int32_t count;
+  do {
+    count = m_encoderCount;
+  } while ( count != m_encoderCount );
+  return count;
+}
+
+// ==================
+//      update()
+// ==================
+void DomePosition::update(unsigned long currentTime)
+{
+  unsigned long elapsed = currentTime - m_lastTime;
+  m_lastTime = currentTime;
+
+  if ( m_sensor == SENSOR_ENCODER && m_encoderCounts > 0 ) {
+
+    // ---------------------------------------------------------
+    // The encoder is the truth. Count from the last known angle.
+    // ---------------------------------------------------------
+
+    int32_t counts = m_readEncoder() - m_encoderOrigin;
+
+    // Whole turns leave the angle where it was. Move the origin past
+    // them, so the count scaled below is under one turn and cannot
+    // overflow, however far the dome turns without a home switch.
+
+    int32_t turns = counts / m_encoderCounts;
+    m_encoderOrigin += turns * m_encoderCounts;
+    counts -= turns * m_encoderCounts;
+
+    m_angle = wrap(m_originAngle + (counts * DOME_FULL_TURN) / m_encoderCounts);
+
+  } else if ( m_turnTime > 0 && m_turnSpeed > 0 ) {
+
+    // ------------------------------------------------------------------
+    // Timed model. The angle moves by speed / turnSpeed of a full turn
+    // every turnTime ms. The remainder carries over so slow speeds and
+    // short steps still add up exactly.
+    // ------------------------------------------------------------------
+
+    if ( elapsed > DOME_MAX_STEP ) {
+      elapsed = DOME_MAX_STEP;
+    }
+
+    long denominator = (long)m_turnTime * m_turnSpeed;
+    m_residual += (long)m_speed * DOME_FULL_TURN * (long)elapsed;
+
+    long moved = m_residual / denominator;
+    m_residual -= moved * denominator;
+    m_angle = wrap(m_angle + moved);
+  }
+
+  // ----------------------------------------------------------------
+  // Passing the home switch tells us exactly where we are. Remember
+  // how far off the estimate was, for tuning the full turn time.
+  // ----------------------------------------------------------------
+
+  if ( m_homeSeen ) {
+    m_homeSeen = false;
+
+    int homeAngle = wrap(m_settings->get(iHomeAngle));
+    m_lastCorrection = difference(m_angle, homeAngle);
+    m_angle = homeAngle;
+    m_residual = 0;
+    m_homed = true;
+
+    m_encoderOrigin = m_readEncoder();
+    m_originAngle = homeAngle;
+  }
+}
+
+// ====================
+//      setSpeed()
+// ====================
+void DomePosition::setSpeed(int speed)
+{
+  // Account for time spent at the old speed before switching.
+
+  update(Hal_Clock::millis());
+  m_speed = speed;
+}
+
+// =================
+//      angle()
+// =================
+int DomePosition::angle(void)
+{
+  return m_angle;
+}
+
+// =================
+//      homed()
+// =================
+bool DomePosition::homed(void)
+{
+  return m_homed;
+}
+
+// ==========================
+//      lastCorrection()
+// ==========================
+int DomePosition::lastCorrection(void)
+{
+  return m_lastCorrection;
+}
+
+// ====================
+//      settings()
+// ====================
+const Config_Section* DomePosition::settings(void)
+{
+  return m_settings;
+}
+
+// ================
+//      wrap()
+// ================
+int DomePosition::wrap(long tenths)
+{
+  tenths %= DOME_FULL_TURN;
+  if ( tenths < 0 ) {
+    tenths += DOME_FULL_TURN;
+  }
+  return (int)tenths;
+}
+
+// ======================
+//      difference()
+// ======================
+int DomePosition::difference(int from, int to)
+{
+  // Shortest signed turn from one angle to another, -1799 to 1800.
+
+  int delta = wrap((long)to - from);
+  if ( delta > DOME_HALF_TURN ) {
+    delta -= DOME_FULL_TURN;
+  }
+  return delta;
+}
@@ -0,0 +1,96 @@
+/* =================================================================================
+ *    B.L.A.C.Box: Brian Lubkeman's Astromech Controller
+ * =================================================================================
+ * DomePosition.h - Dome angle estimator with optional encoder and home sensor
+ * Created by Brian Lubkeman, 16 June 2021
+ * Inspired by S.H.A.D.O.W. controller code written by KnightShade
+ * Released into the public domain.
+ * =================================================================================
+ *
+ * Angles are whole tenths of a degree, 0 to 3599, with 0 as the dome facing
+ * front. Positive speeds turn toward larger angles.
+ *
+ * Without sensors, the angle comes from the commanded speed and the time a full
+ * turn takes at automated speed. A hall-effect home switch snaps the estimate
+ * back to a known angle each time it passes. A quadrature encoder replaces the
+ * timed estimate altogether. Both sensors are read by interrupt.
+ */
+#ifndef __BLACBOX_DOME_POSITION_H__
+#define __BLACBOX_DOME_POSITION_H__
+
+#include "../hal/Hal.h"
+#include "../config/Config.h"
+
+const int DOME_FULL_TURN = 3600;            // Tenths of a degree.
+const int DOME_HALF_TURN = 1800;
+const unsigned long DOME_MAX_STEP = 1000;   // Longest gap the timed model integrates (ms).
+
+enum dome_sensor_e {
+  SENSOR_NONE,      // Timed estimate only.
+  SENSOR_HOME,      // Timed estimate, corrected by a home switch.
+  SENSOR_ENCODER    // Quadrature encoder, with an optional home switch.
+};
+
+enum domePosition_setting_index_e {
+  iPositionSensor,  // 0 - Position sensor.
+  iEncoderPinA,     // 1 - Encoder channel A pin (interrupt capable).
+  iEncoderPinB,     // 2 - Encoder channel B pin.
+  iHomePin,         // 3 - Home switch pin (interrupt capable). 0 = none.
+  iEncoderCounts,   // 4 - Encoder counts per dome turn.
+  iHomeAngle,       // 5 - Angle of the home switch from front.
+  iRampZone,        // 6 - Angle from target where the dome starts slowing.
+  iCreepSpeed,      // 7 - Slowest speed that still turns the dome.
+  iArriveTolerance  // 8 - Close enough to call the target reached.
+};
+
+/* ================================================================================
+ *                              Dome Position Class
+ * ================================================================================ */
+class DomePosition
+{
+  private:
+    const Config_Section* m_settings;
+    unsigned long m_turnTime;
+    int m_turnSpeed;
+
+    int m_speed;
+    int m_angle;
+    long m_residual;
+    unsigned long m_lastTime;
+
+    byte m_sensor;
+    int32_t m_encoderCounts;
+    Hal_Fast_Pin_Struct m_encoderPinA;
+    Hal_Fast_Pin_Struct m_encoderPinB;
+
+    volatile int32_t m_encoderCount;   // 32 bits, as a long is on the Mega.
+    volatile bool m_homeSeen;
+    int32_t m_encoderOrigin;
+    int m_originAngle;
+    int m_lastCorrection;
+    bool m_homed;
+
+    int32_t m_readEncoder(void);
+    static void m_onEncoder(void);
+    static void m_onHome(void);
+
+  public:
+    DomePosition(const Config_Section* settings);
+    ~DomePosition(void);
+
+    static DomePosition* anchor;
+
+    void begin(void);
+    void applySettings(unsigned long turnTime, int turnSpeed);
+    void update(unsigned long currentTime);
+    void setSpeed(int speed);
+
+    int  angle(void);
+    bool homed(void);
+    int  lastCorrection(void);
+    const Config_Section* settings(void);
+
+    static int wrap(long tenths);
+    static int difference(int from, int to);
+};
+#endif
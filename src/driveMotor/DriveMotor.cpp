@@ -6,7 +6,6 @@
  * Inspired by S.H.A.D.O.W. controller code written by KnightShade
  * Released into the public domain.
  */
-#include <Arduino.h>
 #include "DriveMotor.h"
 
 
@@ -16,19 +15,24 @@
 // =====================
 //      Constructor
 // =====================
-DriveMotor::DriveMotor(Controller* pController, const int settings[], const byte pins[])
+DriveMotor::DriveMotor(Controller* pController, const Config_Section* settings, const Config_Section* pins, const Config_Section* motionSettings)
+  : m_button(pController)
 {
-  m_controller = pController;
-  m_settings   = settings;
-  m_pins       = pins;
+  m_controller     = pController;
+  m_settings       = settings;
+  m_pins           = pins;
+  m_motionSettings = motionSettings;
 
   m_driveStick = &m_controller->driveStick;
-  m_button = &m_controller->button;
 
   driveEnabled   = true;
   driveStopped   = true;
   speedProfile   = WALK;
   prevConnStatus = NONE;
+
+  m_previousTime   = 0;
+  m_previousInput1 = m_servoCenter;
+  m_previousInput2 = m_servoCenter;
 }
 
 // ====================
@@ -41,19 +45,25 @@ DriveMotor::~DriveMotor() {}
 // =================
 void DriveMotor::begin()
 {
+  // ---------------------------------------------------------
+  // Get our own copy of the button clicks from the controller.
+  // ---------------------------------------------------------
+
+  m_controller->subscribe(&m_button);
+
   // --------------------------------
   // Set up a deadman switch, or not.
   // --------------------------------
 
-  pinMode(m_pins[iDeadManPin],OUTPUT);
+  Hal_Pin::mode(m_pins->get(iDeadManPin), OUTPUT);
 
-  if ( m_settings[iDeadMan] ) {
+  if ( m_settings->get(iDeadMan) ) {
 
     #if defined(DEBUG)
     Debug.print(DBG_INFO, F("DriveMotor"), F("begin()"), F("Dead man switch enabled."));
     #endif
   
-    digitalWrite(m_pins[iDeadManPin],LOW);
+    Hal_Pin::write(m_pins->get(iDeadManPin), LOW);
 
   } else {
 
@@ -61,21 +71,68 @@ void DriveMotor::begin()
     Debug.print(DBG_INFO, F("DriveMotor"), F("begin()"), F("Dead man switch disabled."));
     #endif
   
-    digitalWrite(m_pins[iDeadManPin],HIGH);
+    Hal_Pin::write(m_pins->get(iDeadManPin), HIGH);
 
   }
+
+  // Start with the response curve and ramping of the initial speed profile.
+
+  applySettings();
+}
+
+// ======================
+//      disconnect()
+// ======================
+void DriveMotor::disconnect(void)
+{
+  // ----------------------------------------------------------------
+  // Stop the motors, and start the ramp over from rest. Otherwise a
+  // controller coming back with the stick centred would pick up the
+  // ramp where it was cut off, and the droid would lurch off at its
+  // old speed before slowing down.
+  // ----------------------------------------------------------------
+
+  stop();
+  m_motion.reset();
+}
+
+// =========================
+//      applySettings()
+// =========================
+void DriveMotor::applySettings(void)
+{
+  // The curve strength and ramping of the speed profile may be changed
+  // while running. Pins and the dead man switch are only read at startup.
+
+  m_driveStick->setProfile(speedProfile);
+  m_setMotionLimits();
 }
 
 // ===============================
 //      interpretController()
 // ===============================
-void DriveMotor::interpretController(void)
+void DriveMotor::interpretController(const Input_Frame_Struct* frame)
 {
-  // -------------------------------------------------
-  // Do nothing when there is no controller connected.
-  // -------------------------------------------------
+  // ------------------------------------------------------
+  // Keep the link to the motor controller serviced, even
+  // while there is no controller input to act on.
+  // ------------------------------------------------------
+
+  m_serviceLink();
+
+  // ----------------------------------------
+  // Take the next click event, if there is one.
+  // ----------------------------------------
+
+  m_button.update();
+
+  // ------------------------------------------------------
+  // With no controller there is nothing more to do. The
+  // motors were stopped, and the ramp put back to rest, by
+  // disconnect() when it went.
+  // ------------------------------------------------------
 
-  byte connStatus = m_controller->connectionStatus();
+  byte connStatus = frame->connectionStatus;
   if ( connStatus == NONE ) {
 
     if ( prevConnStatus != NONE ) {
@@ -99,26 +156,26 @@ void DriveMotor::interpretController(void)
 
   // ----------------------------------------------------
   // When pressing L1|R1, do not read the joystick as we
-  // anticipate L3|R3 being pressed. When L1+L3|R+R3 _is_
-  // pressed, look for a change in the speed profile.
+  // anticipate L3|R3 being pressed. When L3|R3 is clicked
+  // while L1|R1 is held, change the speed profile.
   // ----------------------------------------------------
 
   switch (m_driveStick->side) {
 
   	case left:
-  	  if ( m_button->pressed(L1) ) {
-  	    if ( m_button->clicked(L3) ) {
-  	      m_setSpeedProfile();
-  	    }
+  	  if ( m_button.held(L1) && m_button.clicked(L3) ) {
+  	    m_setSpeedProfile();
+  	  }
+  	  if ( m_button.pressed(L1) ) {
   	    return;
   	  }
   	  break;
 
   	case right:
-  	  if ( m_button->pressed(R1) ) {
-  	    if ( m_button->clicked(R3) ) {
-  	      m_setSpeedProfile();
-  	    }
+  	  if ( m_button.held(R1) && m_button.clicked(R3) ) {
+  	    m_setSpeedProfile();
+  	  }
+  	  if ( m_button.pressed(R1) ) {
   	    return;
   	  }
   	  break;
@@ -131,9 +188,9 @@ void DriveMotor::interpretController(void)
   // Look for enabling/disabling the drive stick.
   // --------------------------------------------
 
-  if ( m_button->pressed(PS) || m_button->pressed(PS2) ) {
+  if ( m_button.held(PS) || m_button.held(PS2) ) {
 
-    if ( driveEnabled && m_button->clicked(L4) ) {
+    if ( driveEnabled && m_button.clicked(L4) ) {
 
       #if defined(DEBUG)
       Debug.print(DBG_INFO, F("DriveMotor"), F("interpretController()"), F("Drive motor disabled"));
@@ -142,7 +199,7 @@ void DriveMotor::interpretController(void)
       driveEnabled = false;
       m_controller->setLed(driveEnabled, speedProfile);
 
-    } else if ( ! driveEnabled && m_button->clicked(R4) ) {
+    } else if ( ! driveEnabled && m_button.clicked(R4) ) {
       
       #if defined(DEBUG)
       Debug.print(DBG_INFO, F("DriveMotor"), F("interpretController()"), F("Drive motor enabled"));
@@ -154,9 +211,12 @@ void DriveMotor::interpretController(void)
     }
   }
 
-  // -------------------------------------------------
-  // Stop the motors when the drive stick is disabled.
-  // -------------------------------------------------
+  // ------------------------------------------------------------------
+  // Bring the motors to a stop at the emergency rate when the drive
+  // stick is disabled, or a deadman switch is in use but not pressed.
+  // Otherwise, head for the drive joystick steering (X) and throttle (Y)
+  // positions.
+  // ------------------------------------------------------------------
 
   if ( ! driveEnabled ) {
 
@@ -164,56 +224,39 @@ void DriveMotor::interpretController(void)
     Debug.print(DBG_VERBOSE, F("DriveMotor"), F("interpretController"), F("Stop due to disabled stick."));
     #endif
 
-    stop();
-    return;
-  }
-
-  // ----------------------------------------------------------------
-  // Stop the motors when a deadman switch is in use but not pressed.
-  // ----------------------------------------------------------------
+    m_motion.emergencyStop();
 
-  if ( m_settings[iDeadMan] && ! m_isDeadmanPressed() ) {
+  } else if ( m_settings->get(iDeadMan) && ! m_isDeadmanPressed() ) {
 
     #if defined(DEBUG)
     Debug.print(DBG_VERBOSE, F("DriveMotor"), F("interpretController"), F("Stop due to deadman switch."));
     #endif
 
-    stop();
-    return;
-  }
+    m_motion.emergencyStop();
 
-  // ------------------------------------------------------------------------
-  // Flood control. Don't overload the motor controller with excessive input.
-  // ------------------------------------------------------------------------
+  } else {
+
+    m_motion.setTarget(m_stickToMotion(frame->driveY), m_stickToMotion(frame->driveX));
 
-  unsigned long currentTime = millis();
-  if ( (currentTime - m_previousTime) <= m_settings[iDriveLatency] ) {
-    return;
   }
-  m_previousTime = currentTime;
 
   // ---------------------------------------------------------------
-  // Get the drive joystick steering (X) and throttle (Y) positions.
+  // The motion profile ramps toward the target on its own clock, so
+  // the ramp is the same however often this runs. Flood control
+  // happens in m_drive() through m_outputDue(), once the output to
+  // the motor controller is known.
   // ---------------------------------------------------------------
 
-  m_steering = m_driveStick->steering();
-  m_throttle = m_driveStick->throttle();
+  m_motion.update(Hal_Clock::millis());
 
-  // -----------------------------------------------------------
-  // A stick within its dead zone is treated the same as center.
-  // -----------------------------------------------------------
-  
-  if ( abs(m_steering - m_driveStick->center) < m_driveStick->deadZone ) {
-    m_steering = m_driveStick->center;
-  }
-  if ( abs(m_throttle - m_driveStick->center) < m_driveStick->deadZone ) {
-    m_throttle = m_driveStick->center;
-  }
+  m_throttle = m_motionToStick(m_motion.value(0));
+  m_steering = m_motionToStick(m_motion.value(1));
 
-  // -------------------------------------------
-  // Stop the motors when the stick is centered.
-  // Otherwise, send the drive command.
-  // -------------------------------------------
+  // ----------------------------------------------------------
+  // Stop the motors once the ramped output reaches center. The
+  // controller has already applied the dead zone, filter and
+  // curve. Otherwise, send the drive command.
+  // ----------------------------------------------------------
 
   if ( m_steering == m_driveStick->center && m_throttle == m_driveStick->center ) {
     stop();
@@ -223,17 +266,60 @@ void DriveMotor::interpretController(void)
 
 }
 
+// ============================
+//      m_stickToMotion()
+// ============================
+int DriveMotor::m_stickToMotion(int stick)
+{
+  // Stick 0-255 (center 127) to motion -1000 to 1000.
+
+  int offset = stick - m_driveStick->center;
+
+  if ( offset < 0 ) {
+    return ((long)offset * MOTION_FULL_SCALE) / (m_driveStick->center - m_driveStick->minValue);
+  }
+  return ((long)offset * MOTION_FULL_SCALE) / (m_driveStick->maxValue - m_driveStick->center);
+}
+
+// ============================
+//      m_motionToStick()
+// ============================
+int DriveMotor::m_motionToStick(int motion)
+{
+  // Motion -1000 to 1000 back to stick 0-255, rounded to the nearest step.
+
+  long half = MOTION_FULL_SCALE / 2;
+
+  if ( motion < 0 ) {
+    return m_driveStick->center + ((long)motion * (m_driveStick->center - m_driveStick->minValue) - half) / MOTION_FULL_SCALE;
+  }
+  return m_driveStick->center + ((long)motion * (m_driveStick->maxValue - m_driveStick->center) + half) / MOTION_FULL_SCALE;
+}
+
+// ==============================
+//      m_setMotionLimits()
+// ==============================
+void DriveMotor::m_setMotionLimits(void)
+{
+  // Each speed profile has its own acceleration, deceleration and jerk.
+
+  byte base = speedProfile * MOTION_SETTINGS_PER_PROFILE;
+
+  m_motion.setLimits(m_motionSettings->get(base + iAccel), m_motionSettings->get(base + iDecel), m_motionSettings->get(base + iJerk));
+  m_motion.setEmergencyDecel(m_motionSettings->get(iEmergencyDecel));
+}
+
 // ================================
 //      m_setSpeedProfile()
 // ================================
 void DriveMotor::m_setSpeedProfile(void)
 {
-  if ( m_settings[iMotorDriver] == 0 && m_controller->getType() > 0 ) {
+  if ( m_controller->getType() > 0 ) {
     
-    // ---------------------------------------------------------------------
-    // For PS3, PS4, and PS5 controllers using the Roboteq motor controller,
-    // the full spectrum of speed profiles is available. Cycle through it.
-    // ---------------------------------------------------------------------
+    // --------------------------------------------------------------------
+    // For PS3, PS4, and PS5 controllers, the full spectrum of speed
+    // profiles is available with either motor controller. Cycle through it.
+    // --------------------------------------------------------------------
 
     if ( speedProfile == SPRINT ) {
       speedProfile = WALK;
@@ -256,6 +342,8 @@ void DriveMotor::m_setSpeedProfile(void)
   }
 
   m_controller->setLed(driveEnabled, speedProfile);
+  m_driveStick->setProfile(speedProfile);
+  m_setMotionLimits();
   m_writeScript();
 
   #if defined(DEBUG)
@@ -279,6 +367,59 @@ void DriveMotor::m_setSpeedProfile(void)
   #endif
 }
 
+// ========================
+//      m_outputDue()
+// ========================
+bool DriveMotor::m_outputDue(int output1, int output2)
+{
+  // ------------------------------------------------------------------
+  // Flood control. Only send when the output has moved by at least the
+  // threshold, or when the keep-alive interval is up so the motor
+  // controller's watchdog stays fed.
+  // ------------------------------------------------------------------
+
+  unsigned long elapsed = Hal_Clock::millis() - m_previousTime;
+
+  if ( elapsed >= (unsigned long)m_settings->get(iDriveRefresh) ) {
+    return true;
+  }
+
+  int threshold = max((int)m_settings->get(iDriveThreshold), 1);
+  int change = max(abs(output1 - m_previousInput1), abs(output2 - m_previousInput2));
+
+  if ( change < threshold ) {
+    return false;
+  }
+
+  // ---------------------------------------------------------------
+  // A stick moving fast builds up a large change quickly. Halve the
+  // wait for each doubling of the change past the threshold, down to
+  // the minimum latency.
+  // ---------------------------------------------------------------
+
+  unsigned long interval = m_settings->get(iDriveLatency);
+  unsigned long minimum  = m_settings->get(iDriveMinLatency);
+
+  for (long step = 2L * threshold; change >= step && interval > minimum; step *= 2) {
+    interval /= 2;
+  }
+  if ( interval < minimum ) {
+    interval = minimum;
+  }
+
+  return ( elapsed >= interval );
+}
+
+// =========================
+//      m_outputSent()
+// =========================
+void DriveMotor::m_outputSent(int output1, int output2)
+{
+  m_previousInput1 = output1;
+  m_previousInput2 = output2;
+  m_previousTime   = Hal_Clock::millis();
+}
+
 // =============================
 //      m_isDeadmanPressed()
 // =============================
@@ -297,11 +438,11 @@ bool DriveMotor::m_isDeadmanPressed(void)
       // We have dual Nav controllers. L2 or R2 is the deadman switch.
       // -------------------------------------------------------------
 
-      if ( m_button->pressed(L2) || m_button->pressed(R2) ) {
-        digitalWrite(m_pins[iDeadMan], HIGH);
+      if ( m_button.pressed(L2) || m_button.pressed(R2) ) {
+        Hal_Pin::write(m_pins->get(iDeadManPin), HIGH);
         return true;
       } else {
-        digitalWrite(m_pins[iDeadMan], LOW);
+        Hal_Pin::write(m_pins->get(iDeadManPin), LOW);
         return false;
       }
 
@@ -311,11 +452,11 @@ bool DriveMotor::m_isDeadmanPressed(void)
       // We have a single Nav controller. L1 is the deadman switch.
       // ----------------------------------------------------------
 
-      if ( m_button->pressed(L1) ) {
-        digitalWrite(m_pins[iDeadMan], HIGH);
+      if ( m_button.pressed(L1) ) {
+        Hal_Pin::write(m_pins->get(iDeadManPin), HIGH);
         return true;
       } else {
-        digitalWrite(m_pins[iDeadMan], LOW);
+        Hal_Pin::write(m_pins->get(iDeadManPin), LOW);
         return false;
       }
 
@@ -327,11 +468,11 @@ bool DriveMotor::m_isDeadmanPressed(void)
     // For PS3, PS4, or PS5 controllers, L2 or R2 is the deadman switch.
     // -----------------------------------------------------------------
 
-    if ( m_button->pressed(L2) || m_button->pressed(R2) ) {
-      digitalWrite(m_pins[iDeadMan], HIGH);
+    if ( m_button.pressed(L2) || m_button.pressed(R2) ) {
+      Hal_Pin::write(m_pins->get(iDeadManPin), HIGH);
       return true;
     } else {
-      digitalWrite(m_pins[iDeadMan], LOW);
+      Hal_Pin::write(m_pins->get(iDeadManPin), LOW);
       return false;
     }
 
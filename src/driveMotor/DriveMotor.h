@@ -9,19 +9,23 @@
 #ifndef __BLACBOX_DRIVE_MOTOR_H__
 #define __BLACBOX_DRIVE_MOTOR_H__
 
-#include <Servo.h>
 #include "../toolbox/DebugUtils.h"
 #include "../controller/Controller.h"
+#include "../hal/SerialQueue.h"
+#include "MotionProfile.h"
 
 #define DEBUG
 
-extern HardwareSerial &DriveMotor_Serial;
+extern SerialQueue &DriveMotor_Serial;
 
 enum driveMotor_setting_index_e {
    iMotorDriver   // 0 - Motor driver.
  , iDeadMan       // 1 - Use dead man switch.
  , iDriveLatency  // 2 - Serial latency.
  , iServoDeadZone // 3 - Servo dead zone
+ , iDriveThreshold  // 4 - Output change worth sending.
+ , iDriveRefresh    // 5 - Keep-alive interval.
+ , iDriveMinLatency // 6 - Shortest interval while the stick moves fast.
 };
 
 enum driveMotor_pin_index_e {
@@ -31,18 +35,32 @@ enum driveMotor_pin_index_e {
  , iDeadManPin  // 3 - Dead man switch pin
 };
 
+const byte ROBOTEQ_REPLY_SIZE = 24;
+
 enum roboteq_setting_index_e {
    iCommMode      // 0 - Roboteq communication mode.
  , iMixing        // 1 - Tank-style mixing
+ , iAmpLimit      // 2 - Motor current that forces the walk profile.
+ , iLowVoltage    // 3 - Battery voltage that forces the walk profile.
 };
 
+typedef struct {
+  int motorAmps[2];         // Tenths of an amp for each channel (?A).
+  int batteryVolts;         // Tenths of a volt (?V).
+  int temperature[3];       // Degrees C for the MCU and each channel (?T).
+  byte faultFlags;          // Fault flags (?FF). Zero when healthy.
+  unsigned long updateTime; // When any of the above last changed.
+} Roboteq_Telemetry_Struct;
+
 enum sabertooth_setting_index_e {
-   iDriveSpeed      // 0 - Normal drive speed
- , iOverdriveSpeed  // 1 - Overdrive speed
- , iTurnSpeed       // 2 - Turn speed
- , iRamping         // 3 - Ramping
- , iAddress         // 4 - Sabertooth address
- , iInvertTurn      // 5 - Invert turn direction.
+   iWalkSpeed       // 0 - Top drive speed in the walk profile
+ , iJogSpeed        // 1 - Top drive speed in the jog profile
+ , iRunSpeed        // 2 - Top drive speed in the run profile
+ , iSprintSpeed     // 3 - Top drive speed in the sprint profile
+ , iTurnSpeed       // 4 - Turn speed
+ , iAddress         // 5 - Sabertooth address
+ , iInvertTurn      // 6 - Invert turn direction.
+ , iSerialTimeout   // 7 - Sabertooth serial timeout
 };
 
 
@@ -53,11 +71,13 @@ class DriveMotor
 {
   protected:
     Controller * m_controller;
-    int* m_settings;
-    byte* m_pins;
+    const Config_Section* m_settings;
+    const Config_Section* m_pins;
+    const Config_Section* m_motionSettings;
+    MotionProfile m_motion;
 
     Joystick_Drive* m_driveStick;
-    Button* m_button;
+    Button m_button;
 
     bool driveEnabled;
     bool driveStopped;
@@ -78,15 +98,23 @@ class DriveMotor
 
     bool m_isDeadmanPressed(void);
     void m_setSpeedProfile(void);
+    void m_setMotionLimits(void);
+    int m_stickToMotion(int stick);
+    int m_motionToStick(int motion);
+    bool m_outputDue(int output1, int output2);
+    void m_outputSent(int output1, int output2);
 
     virtual void m_drive(void) {};
     virtual void m_writeScript(void) {};
+    virtual void m_serviceLink(void) {};
 
   public:
-    DriveMotor(Controller* pController, const int settings[], const byte pins[]);
+    DriveMotor(Controller* pController, const Config_Section* settings, const Config_Section* pins, const Config_Section* motionSettings);
     virtual ~DriveMotor(void);
     void begin(void);
-    void interpretController(void);
+    void applySettings(void);
+    void interpretController(const Input_Frame_Struct* frame);
+    void disconnect(void);
     virtual void stop(void) {};
 };
 
@@ -96,25 +124,42 @@ class DriveMotor
 class DriveMotor_Roboteq : public DriveMotor
 {
   protected:
-    Servo m_pulse1Signal;
-    Servo m_pulse2Signal;
-    Servo m_scriptSignal;
-    byte* m_roboteqSettings;
+    Hal_Servo m_pulse1Signal;
+    Hal_Servo m_pulse2Signal;
+    Hal_Servo m_scriptSignal;
+    const Config_Section* m_roboteqSettings;
+
+    unsigned long m_lastReplyTime;
+    bool m_linkUp;
+    char m_reply[ROBOTEQ_REPLY_SIZE];
+    byte m_replyLength;
+
+    Roboteq_Telemetry_Struct m_telemetry;
+    byte m_nextQuery;
+    unsigned long m_lastQueryTime;
+    bool m_derated;
 
     void m_analogToServo(int steering, int throttle);
     void m_writePulse(int input1, int input2);
     void m_writePulse(int input);
     void m_mixBHD(byte stickX, byte stickY);
-    void m_writeSerial(String inStr);
+    void m_writeSerial(const char* inStr);
+    void m_writeGo(int input1, int input2);
+    void m_parseReply(void);
+    byte m_parseFields(const char* text, int fields[], byte maxFields);
+    void m_sendQuery(void);
+    void m_checkDerate(void);
 
     virtual void m_drive(void);
     virtual void m_writeScript(void);
+    virtual void m_serviceLink(void);
 
   public:
-    DriveMotor_Roboteq(Controller* pController, const int settings[], const byte pins[], const byte roboteqSettings[]);
+    DriveMotor_Roboteq(Controller* pController, const Config_Section* settings, const Config_Section* pins, const Config_Section* motionSettings, const Config_Section* roboteqSettings);
     virtual ~DriveMotor_Roboteq(void);
     void begin(void);
     virtual void stop(void);
+    const Roboteq_Telemetry_Struct* telemetry(void);
 };
 
 /* ================================================================================
@@ -125,18 +170,16 @@ class DriveMotor_Sabertooth : public DriveMotor
 {
   protected:
     Sabertooth m_sabertooth;
-    Servo leftFootSignal;
-    Servo rightFootSignal;
-    byte* m_sabertoothSettings;
+    const Config_Section* m_sabertoothSettings;
+    int m_lastDrive;
+    int m_lastTurn;
 
-    void m_fastRampDown(byte driveSpeed, int stickSpeed);
-    void m_rampDown(byte driveSpeed, int stickSpeed);
-    void m_rampUp(byte driveSpeed, int stickSpeed);
+    int m_stickToSpeed(int stick, int limit);
 
     virtual void m_drive(void);
 
   public:
-    DriveMotor_Sabertooth(Controller* pController, const int settings[], const byte pins[], const byte sabertoothSettings[]);
+    DriveMotor_Sabertooth(Controller* pController, const Config_Section* settings, const Config_Section* pins, const Config_Section* motionSettings, const Config_Section* sabertoothSettings);
     virtual ~DriveMotor_Sabertooth(void);
     void begin(void);
     virtual void stop(void);
@@ -6,10 +6,20 @@
  * Inspired by S.H.A.D.O.W. controller code written by KnightShade
  * Released into the public domain.
  */
-#include <Arduino.h>
 #include "DriveMotor.h"
 
-const int ROBOTEQ_BAUD_RATE = 115200;     // I strongly recommend not changing this.
+const unsigned long ROBOTEQ_BAUD_RATE = 115200;  // I strongly recommend not changing this.
+const unsigned long ROBOTEQ_LINK_TIMEOUT = 1000;  // The link is considered lost after this long (ms) without a reply.
+const int ROBOTEQ_COMMAND_RANGE = 1000;           // !G takes -1000 to 1000.
+const unsigned long ROBOTEQ_QUERY_PERIOD = 100;   // One telemetry query goes out this often (ms), in turn.
+
+enum roboteq_query_e {
+  qAmps,
+  qVolts,
+  qTemperature,
+  qFaults,
+  QUERY_COUNT
+};
 
 enum comm_mode_e {
   Pulse,
@@ -21,6 +31,50 @@ enum mixing_e {
   bySketch
 };
 
+// ---------------------------------------------------------------------------------
+// The float version of the BHD mixer landed one short of an exact whole number for
+// these |x|,|y| mixing inputs. The integer mixer applies the same correction so
+// its servo output is identical for every stick position. The table came from
+// running the float formula over every x and y from -100 to 100. The error is
+// symmetric in sign, so only magnitudes are kept.
+// ---------------------------------------------------------------------------------
+
+const byte MIX_FLOAT_EDGE_COUNT = 29;
+const byte mixFloatEdges[MIX_FLOAT_EDGE_COUNT][2] PROGMEM = {
+  { 39, 65 }, { 42, 70 }, { 45, 75 }, { 48, 80 }, { 51, 69 }, { 51, 85 }, { 54, 90 }, { 57, 95 },
+  { 60, 100 }, { 63, 42 }, { 66, 44 }, { 68, 92 }, { 69, 46 }, { 69, 51 }, { 72, 48 }, { 75, 50 },
+  { 78, 52 }, { 81, 54 }, { 81, 69 }, { 84, 56 }, { 87, 58 }, { 90, 60 }, { 91, 13 }, { 92, 68 },
+  { 93, 62 }, { 96, 64 }, { 98, 14 }, { 99, 11 }, { 99, 66 }
+};
+
+// Same result as map(), but in 16-bit math. Every stick range fits.
+
+static int mapAxis(int value, int inMin, int inMax, int outMin, int outMax)
+{
+  return (value - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+// Divide for a clipped diamond edge, pulling exact results toward zero where the
+// float version did.
+
+static int mixDivide(int numerator, int denominator, int x, int y)
+{
+  int quotient = numerator / denominator;
+
+  if ( quotient == 0 || (numerator % denominator) != 0 ) {
+    return quotient;
+  }
+
+  byte absX = abs(x);
+  byte absY = abs(y);
+  for (byte i = 0; i < MIX_FLOAT_EDGE_COUNT; i++) {
+    if ( pgm_read_byte(&mixFloatEdges[i][0]) == absX && pgm_read_byte(&mixFloatEdges[i][1]) == absY ) {
+      return ( quotient > 0 ? quotient - 1 : quotient + 1 );
+    }
+  }
+  return quotient;
+}
+
 /* ================================================================================
  *                         Roboteq Motor Controller Class
  * ================================================================================ */
@@ -30,12 +84,22 @@ enum mixing_e {
 // =====================
 DriveMotor_Roboteq::DriveMotor_Roboteq
   ( Controller* pController,
-    const int settings[],
-    const byte pins[],
-    const byte roboteqSettings[] )
-  : DriveMotor(pController, settings, pins)
+    const Config_Section* settings,
+    const Config_Section* pins,
+    const Config_Section* motionSettings,
+    const Config_Section* roboteqSettings )
+  : DriveMotor(pController, settings, pins, motionSettings)
 {
   m_roboteqSettings = roboteqSettings;
+
+  m_lastReplyTime = 0;
+  m_linkUp = false;
+  m_replyLength = 0;
+
+  memset(&m_telemetry, 0, sizeof(m_telemetry));
+  m_nextQuery = qAmps;
+  m_lastQueryTime = 0;
+  m_derated = false;
 }
 
 // ====================
@@ -58,23 +122,24 @@ void DriveMotor_Roboteq::begin(void)
   // Start communication with the Roboteq.
   // -------------------------------------
 
-  m_scriptSignal.attach(m_pins[iScriptPin]);
+  m_scriptSignal.attach(m_pins->get(iScriptPin));
 
-  if ( m_roboteqSettings[iCommMode] == Pulse ) {
+  if ( m_roboteqSettings->get(iCommMode) == Pulse ) {
 
     // Pulse mode
 
-    m_pulse1Signal.attach(m_pins[iDrivePin1]);
+    m_pulse1Signal.attach(m_pins->get(iDrivePin1));
     m_pulse1Signal.write(m_servoCenter);
 
-    m_pulse2Signal.attach(m_pins[iDrivePin2]);
+    m_pulse2Signal.attach(m_pins->get(iDrivePin2));
     m_pulse2Signal.write(m_servoCenter);
 
-  } else if ( m_settings[iCommMode] == RS232 ) {
+  } else if ( m_roboteqSettings->get(iCommMode) == RS232 ) {
 
     // RS232 (Serial) mode
 
     DriveMotor_Serial.begin(ROBOTEQ_BAUD_RATE);
+    m_lastReplyTime = Hal_Clock::millis();
 
   } else {
 
@@ -109,17 +174,17 @@ void DriveMotor_Roboteq::stop(void)
   // Send the stop command.
   // ----------------------
 
-  if ( m_settings[iCommMode] == Pulse ) {
+  if ( m_roboteqSettings->get(iCommMode) == Pulse ) {
 
     // Pulse mode
 
     m_writePulse(m_servoCenter);
 
-  } else if ( m_settings[iCommMode] == RS232 ) {
+  } else if ( m_roboteqSettings->get(iCommMode) == RS232 ) {
 
     // RS232 (Serial) mode
 
-    m_writeSerial(F("!MS 1_!MS 2\\r"));
+    m_writeSerial("!MS 1_!MS 2\r");
 
   } else {
 
@@ -133,6 +198,7 @@ void DriveMotor_Roboteq::stop(void)
   // ------------------------
 
   driveStopped = true;
+  m_outputSent(m_servoCenter, m_servoCenter);
 }
 
 // ===================
@@ -140,31 +206,35 @@ void DriveMotor_Roboteq::stop(void)
 // ===================
 void DriveMotor_Roboteq::m_drive(void)
 {
+  // -------------------------------------------------------------
+  // Do not drive a Roboteq that has not answered for a while. The
+  // first second after begin() is allowed, for its first reply.
+  // -------------------------------------------------------------
+
+  if ( m_roboteqSettings->get(iCommMode) == RS232 && ! m_linkUp &&
+       (Hal_Clock::millis() - m_lastReplyTime) > ROBOTEQ_LINK_TIMEOUT ) {
+    stop();
+    return;
+  }
+
   // ---------------------------------------------------------------------------
   // Get the inputs based on the throttle and steering values from the joystick.
   // ---------------------------------------------------------------------------
 
-  if ( m_roboteqSettings[iMixing] == byDriver ) {
+  if ( m_roboteqSettings->get(iMixing) == byDriver ) {
 
     // Mixing is done by the motor driver.
 
     m_analogToServo(m_throttle, m_steering);
 
   	#if defined(DEBUG)
-  	String msg = (String)m_input1;
-  	msg += F("/");
-  	msg += (String)m_input2;
-  	msg += F(" (");
-  	msg += (String)(544 + round(m_input1 * 10.311));
-  	msg += F("/");
-  	msg += (String)(544 + round(m_input2 * 10.311));
-  	msg += F(")");
-  	char buff[22];
-  	msg.toCharArray(buff, 22);
-  	Debug.print(DBG_VERBOSE, F("DriveMotor_Roboteq"), F("m_drive()"), F("Throttle/Steering: "), (String)buff);
+  	char buff[32];
+  	snprintf(buff, sizeof(buff), "%d/%d (%ld/%ld)", m_input1, m_input2,
+  	         544 + (((long)m_input1 * 10311 + 500) / 1000), 544 + (((long)m_input2 * 10311 + 500) / 1000));
+  	Debug.print(DBG_VERBOSE, F("DriveMotor_Roboteq"), F("m_drive()"), F("Throttle/Steering: "), buff);
   	#endif
 	
-  } else if ( m_roboteqSettings[iMixing] == bySketch ) {
+  } else if ( m_roboteqSettings->get(iMixing) == bySketch ) {
 
     // Mixing is handled by this sketch.
 
@@ -183,11 +253,21 @@ void DriveMotor_Roboteq::m_drive(void)
 
   driveStopped = false;
 
+  // ------------------------------------------------------------
+  // Leave the Roboteq alone until there is something new to say,
+  // or until iDriveRefresh is up. That resend is the only keep-
+  // alive, and it feeds the Roboteq's own serial watchdog.
+  // ------------------------------------------------------------
+
+  if ( ! m_outputDue(m_input1, m_input2) ) {
+    return;
+  }
+
   // -------------------------------
   // Send the values to the Roboteq.
   // -------------------------------
 
-  switch (m_settings[iCommMode]) {
+  switch (m_roboteqSettings->get(iCommMode)) {
 
     case Pulse:
       // Pulse mode
@@ -196,9 +276,7 @@ void DriveMotor_Roboteq::m_drive(void)
 
     case RS232:
       // RS232 (Serial) mode
-      char cmd[22];
-      sprintf(cmd, "!G 1 %i_!G 2 %i\\r", m_input1, m_input2);
-      m_writeSerial(cmd);
+      m_writeGo(m_input1, m_input2);
       break;
 
     default:
@@ -207,11 +285,10 @@ void DriveMotor_Roboteq::m_drive(void)
   }
 
   // ----------------------------
-  // Remember the stick position.
+  // Remember what was last sent.
   // ----------------------------
 
-  m_previousInput1 = m_input1;
-  m_previousInput2 = m_input2;
+  m_outputSent(m_input1, m_input2);
 }
 
 // ===========================
@@ -230,10 +307,10 @@ void DriveMotor_Roboteq::m_analogToServo(int throttle, int steering)
   // The check the dead zone once more. This time checking the servo range.
   // ----------------------------------------------------------------------
 
-  if ( abs(m_input1 - m_servoCenter) < m_settings[iServoDeadZone] ) {
+  if ( abs(m_input1 - m_servoCenter) < m_settings->get(iServoDeadZone) ) {
     m_input1 = m_servoCenter;
   }
-  if ( abs(m_input2 - m_servoCenter) < m_settings[iServoDeadZone] ) {
+  if ( abs(m_input2 - m_servoCenter) < m_settings->get(iServoDeadZone) ) {
     m_input2 = m_servoCenter;
   }
 }
@@ -263,10 +340,13 @@ void DriveMotor_Roboteq::m_writePulse(int input)
 void DriveMotor_Roboteq::m_writeScript(void)
 {
 
-  int output = 45 + (speedProfile * 45);	// yields: WALK = 45, JOG = 90, RUN = 135, SPRINT = 180;
+  // While telemetry shows a problem, hold the Roboteq at the walk profile.
+
+  byte profile = ( m_derated ? WALK : speedProfile );
+  int output = 45 + (profile * 45);	// yields: WALK = 45, JOG = 90, RUN = 135, SPRINT = 180;
 
   #if defined(DEBUG)
-  Debug.print(DBG_VERBOSE, F("DriveMotor_Roboteq"), F("m_writeScript()"), F("Speed profile: "), (String)output);
+  Debug.print(DBG_VERBOSE, F("DriveMotor_Roboteq"), F("m_writeScript()"), F("Speed profile: "), (long)output);
   #endif
 
   m_scriptSignal.write(output);
@@ -294,56 +374,324 @@ void DriveMotor_Roboteq::m_mixBHD(byte throttle, byte steering) {
 
   }
 
-  int xInt = 0;
-  int yInt = 0;
+  // ------------------------------------------------------------------
+  // Everything stays in 16-bit integers. Inside the diamond, left is
+  // x + y and right is y - x. Outside it, the point is pulled back along
+  // its line to the nearest edge, which pins one side at +/-100. The
+  // output matches the float mixer exactly.
+  // ------------------------------------------------------------------
+
+  // ---------------------------------------------------------------
+  // The stick mapping is the float mixer's own, dead zone and all, so
+  // that it stays exact. Off center on one axis only, the centered
+  // axis maps through the dead zone the way the float mixer did.
+  // ---------------------------------------------------------------
+
+  int x;
+  int y;
 
   if (throttle < m_driveStick->center) {
-    yInt = map(throttle, m_driveStick->minValue, (m_driveStick->center - m_driveStick->deadZone), 100, 1);
+    y = mapAxis(throttle, m_driveStick->minValue, (m_driveStick->center - m_driveStick->deadZone), 100, 1);
   } else {
-    yInt = map(throttle, (m_driveStick->center + m_driveStick->deadZone), m_driveStick->maxValue, -1, -100);
+    y = mapAxis(throttle, (m_driveStick->center + m_driveStick->deadZone), m_driveStick->maxValue, -1, -100);
   }
 
   if (steering < m_driveStick->center) {
-    xInt = map(steering, m_driveStick->minValue, (m_driveStick->center - m_driveStick->deadZone), -100, -1);
+    x = mapAxis(steering, m_driveStick->minValue, (m_driveStick->center - m_driveStick->deadZone), -100, -1);
   } else {
-    xInt = map(steering, (m_driveStick->center + m_driveStick->deadZone), m_driveStick->maxValue, 1, 100);
+    x = mapAxis(steering, (m_driveStick->center + m_driveStick->deadZone), m_driveStick->maxValue, 1, 100);
   }
 
-  float xFloat = xInt;
-  float yFloat = yInt;
-
-  if ( yInt > (xInt + 100) ) {
-    xFloat = -100 / (1 - (yFloat / xFloat));
-    yFloat = xFloat + 100;
-  } else if ( yInt > (100 - xInt) ) {
-    xFloat = -100 / (-1 - (yFloat / xFloat));
-    yFloat = -xFloat + 100;
-  } else if (yInt < (-xInt - 100)) {
-    xFloat = 100 / (-1 - (yFloat / xFloat));
-    yFloat = -xFloat - 100;
-  } else if (yInt < (xInt - 100)) {
-    xFloat = 100 / (1 - (yFloat / xFloat));
-    yFloat = xFloat - 100;
+  int leftSpeed;
+  int rightSpeed;
+
+  if ( y > (x + 100) ) {
+    leftSpeed = mixDivide(100 * (x + y), (y - x), x, y);
+    rightSpeed = 100;
+  } else if ( y > (100 - x) ) {
+    leftSpeed = 100;
+    rightSpeed = mixDivide(100 * (y - x), (x + y), x, y);
+  } else if ( y < (-x - 100) ) {
+    leftSpeed = -100;
+    rightSpeed = mixDivide(100 * (x - y), (x + y), x, y);
+  } else if ( y < (x - 100) ) {
+    leftSpeed = mixDivide(100 * (x + y), (x - y), x, y);
+    rightSpeed = -100;
+  } else {
+    leftSpeed = x + y;
+    rightSpeed = y - x;
   }
 
-  float leftSpeed = ((xFloat + yFloat - 100) / 2) + 100;
-  leftSpeed = (leftSpeed - 50) * 2;
-
-  float rightSpeed = ((yFloat - xFloat - 100) / 2) + 100;
-  rightSpeed = (rightSpeed - 50) * 2;
+  // Same as map(speed, -100, 100, m_servoMax, m_servoMin) with the range halved to stay in 16 bits.
 
-  m_input1=map(leftSpeed, -100, 100, m_servoMax, m_servoMin);
-  m_input2=map(rightSpeed, -100, 100, m_servoMax, m_servoMin);
+  m_input1 = m_servoMax - (((leftSpeed + 100) * ((m_servoMax - m_servoMin) / 2)) / 100);
+  m_input2 = m_servoMax - (((rightSpeed + 100) * ((m_servoMax - m_servoMin) / 2)) / 100);
 }
 
 // =======================
 //      m_writeSerial()
 // =======================
-void DriveMotor_Roboteq::m_writeSerial(String inStr)
+void DriveMotor_Roboteq::m_writeSerial(const char* inStr)
+{
+  // The serial queue never blocks, and the whole command goes in one write.
+
+  DriveMotor_Serial.write((const byte*)inStr, strlen(inStr));
+}
+
+// =====================
+//      m_writeGo()
+// =====================
+void DriveMotor_Roboteq::m_writeGo(int input1, int input2)
+{
+  // ---------------------------------------------------------------
+  // Convert from the servo range (0-180, center 90) to the -1000 to
+  // 1000 range of !G. Both channels go out in one command.
+  // ---------------------------------------------------------------
+
+  int command1 = map(input1, m_servoMin, m_servoMax, -ROBOTEQ_COMMAND_RANGE, ROBOTEQ_COMMAND_RANGE);
+  int command2 = map(input2, m_servoMin, m_servoMax, -ROBOTEQ_COMMAND_RANGE, ROBOTEQ_COMMAND_RANGE);
+
+  char cmd[28];
+  snprintf(cmd, sizeof(cmd), "!G 1 %d_!G 2 %d\r", command1, command2);
+  m_writeSerial(cmd);
+}
+
+// =========================
+//      m_serviceLink()
+// =========================
+void DriveMotor_Roboteq::m_serviceLink(void)
+{
+  if ( m_roboteqSettings->get(iCommMode) != RS232 ) {
+    return;
+  }
+
+  // ---------------------------------------------------------
+  // Take in whatever reply bytes have arrived. A full line is
+  // parsed when its carriage return shows up. A line too long
+  // for the buffer is dropped whole rather than cut short.
+  // ---------------------------------------------------------
+
+  while ( DriveMotor_Serial.available() > 0 ) {
+    char c = DriveMotor_Serial.read();
+    if ( c == '\r' ) {
+      if ( m_replyLength < ROBOTEQ_REPLY_SIZE ) {
+        m_reply[m_replyLength] = '\0';
+        m_parseReply();
+      }
+      m_replyLength = 0;
+    } else if ( m_replyLength < ROBOTEQ_REPLY_SIZE - 1 ) {
+      m_reply[m_replyLength++] = c;
+    } else {
+      m_replyLength = ROBOTEQ_REPLY_SIZE;
+    }
+  }
+
+  unsigned long currentTime = Hal_Clock::millis();
+
+  // ---------------------------------------------
+  // Ask for one piece of telemetry at a time.
+  // ---------------------------------------------
+
+  if ( (currentTime - m_lastQueryTime) >= ROBOTEQ_QUERY_PERIOD ) {
+    m_sendQuery();
+    m_lastQueryTime = currentTime;
+  }
+
+  // ---------------------------------------------------------
+  // Watch for the Roboteq going quiet. Without replies there
+  // is no telling what it is doing, so stop the motors and
+  // hold the walk profile. m_drive() keeps them stopped until
+  // the Roboteq answers again.
+  // ---------------------------------------------------------
+
+  if ( m_linkUp && (currentTime - m_lastReplyTime) > ROBOTEQ_LINK_TIMEOUT ) {
+    m_linkUp = false;
+
+    #if defined(DEBUG)
+    Debug.print(DBG_ERROR, F("DriveMotor_Roboteq"), F("m_serviceLink()"), F("Roboteq link lost"));
+    #endif
+
+    m_checkDerate();
+    stop();
+  }
+}
+
+// ========================
+//      m_parseReply()
+// ========================
+void DriveMotor_Roboteq::m_parseReply(void)
+{
+  // ---------------------------------------------------------
+  // The Roboteq echoes each command, then answers "+" when it
+  // accepts a command or "-" when it rejects one. Any of these
+  // show the link is alive.
+  // ---------------------------------------------------------
+
+  if ( m_replyLength == 0 ) {
+    return;
+  }
+
+  m_lastReplyTime = Hal_Clock::millis();
+
+  if ( ! m_linkUp ) {
+    m_linkUp = true;
+
+    #if defined(DEBUG)
+    Debug.print(DBG_INFO, F("DriveMotor_Roboteq"), F("m_parseReply()"), F("Roboteq link up"));
+    #endif
+  }
+
+  if ( m_reply[0] == '-' ) {
+
+    #if defined(DEBUG)
+    Debug.print(DBG_WARNING, F("DriveMotor_Roboteq"), F("m_parseReply()"), F("Command rejected"));
+    #endif
+
+    return;
+  }
+
+  // ---------------------------------------------------------
+  // Query answers look like "A=12:13". Echoed commands start
+  // with ! or ? and carry no data, so they fall through here.
+  // ---------------------------------------------------------
+
+  char* equals = strchr(m_reply, '=');
+  if ( equals == NULL || m_reply[0] == '!' || m_reply[0] == '?' ) {
+    return;
+  }
+  *equals = '\0';
+
+  int fields[3];
+  byte count = m_parseFields(equals + 1, fields, 3);
+  if ( count == 0 ) {
+    return;
+  }
+
+  if ( strcmp(m_reply, "A") == 0 ) {
+    m_telemetry.motorAmps[0] = fields[0];
+    m_telemetry.motorAmps[1] = ( count > 1 ? fields[1] : fields[0] );
+  } else if ( strcmp(m_reply, "V") == 0 && count > 1 ) {
+    m_telemetry.batteryVolts = fields[1];
+  } else if ( strcmp(m_reply, "T") == 0 ) {
+    for (byte i = 0; i < count; i++) {
+      m_telemetry.temperature[i] = fields[i];
+    }
+  } else if ( strcmp(m_reply, "FF") == 0 ) {
+    m_telemetry.faultFlags = fields[0];
+  } else {
+    return;
+  }
+
+  m_telemetry.updateTime = m_lastReplyTime;
+  m_checkDerate();
+}
+
+// =========================
+//      m_parseFields()
+// =========================
+byte DriveMotor_Roboteq::m_parseFields(const char* text, int fields[], byte maxFields)
 {
-  if (DriveMotor_Serial.available()) {
-    for (int i=0; i<inStr.length(); i++) {
-      DriveMotor_Serial.write(inStr[i]);
+  // Read colon separated, optionally signed integers. A number too
+  // big for an int on the Mega is held at the largest one.
+
+  byte count = 0;
+
+  while ( *text != '\0' && count < maxFields ) {
+
+    bool negative = false;
+    if ( *text == '-' ) {
+      negative = true;
+      text++;
+    }
+
+    if ( *text < '0' || *text > '9' ) {
+      break;
+    }
+
+    int value = 0;
+    while ( *text >= '0' && *text <= '9' ) {
+      if ( value <= (32767 - 9) / 10 ) {
+        value = (value * 10) + (*text - '0');
+      } else {
+        value = 32767;
+      }
+      text++;
+    }
+    fields[count++] = ( negative ? -value : value );
+
+    if ( *text != ':' ) {
+      break;
     }
+    text++;
+  }
+
+  return count;
+}
+
+// =======================
+//      m_sendQuery()
+// =======================
+void DriveMotor_Roboteq::m_sendQuery(void)
+{
+  switch (m_nextQuery) {
+    case qAmps:        { m_writeSerial("?A\r");  break; }
+    case qVolts:       { m_writeSerial("?V\r");  break; }
+    case qTemperature: { m_writeSerial("?T\r");  break; }
+    case qFaults:      { m_writeSerial("?FF\r"); break; }
+    default:           { break; }
+  }
+
+  m_nextQuery++;
+  if ( m_nextQuery >= QUERY_COUNT ) {
+    m_nextQuery = qAmps;
+  }
+}
+
+// =========================
+//      m_checkDerate()
+// =========================
+void DriveMotor_Roboteq::m_checkDerate(void)
+{
+  // ------------------------------------------------------------
+  // Over current, low battery, any fault or a lost link holds the
+  // Roboteq at the walk profile until every reading is back in
+  // range. A limit of 0 turns that check off.
+  // ------------------------------------------------------------
+
+  int ampLimit = m_roboteqSettings->get(iAmpLimit) * 10;
+  int lowVoltage = m_roboteqSettings->get(iLowVoltage) * 10;
+
+  bool derate = ( m_telemetry.faultFlags != 0 || ! m_linkUp );
+
+  if ( ampLimit > 0 &&
+       ( abs(m_telemetry.motorAmps[0]) >= ampLimit || abs(m_telemetry.motorAmps[1]) >= ampLimit ) ) {
+    derate = true;
   }
+
+  if ( lowVoltage > 0 && m_telemetry.batteryVolts > 0 && m_telemetry.batteryVolts < lowVoltage ) {
+    derate = true;
+  }
+
+  if ( derate == m_derated ) {
+    return;
+  }
+
+  m_derated = derate;
+  m_writeScript();
+
+  #if defined(DEBUG)
+  if ( m_derated ) {
+    Debug.print(DBG_WARNING, F("DriveMotor_Roboteq"), F("m_checkDerate()"), F("Derated to walk"));
+  } else {
+    Debug.print(DBG_INFO, F("DriveMotor_Roboteq"), F("m_checkDerate()"), F("Derate cleared"));
+  }
+  #endif
+}
+
+// =====================
+//      telemetry()
+// =====================
+const Roboteq_Telemetry_Struct* DriveMotor_Roboteq::telemetry(void)
+{
+  return &m_telemetry;
 }
@@ -6,12 +6,12 @@
  * Inspired by S.H.A.D.O.W. controller code written by KnightShade
  * Released into the public domain.
  */
-#include <Arduino.h>
 #include "DriveMotor.h"
 
 const int SABERTOOTH_BAUD_RATE = 9600;     // It is strongly recommended not to change this.
+const int SABERTOOTH_FULL_SPEED = 127;
 
-extern HardwareSerial &DriveMotor_Serial;
+extern SerialQueue &DriveMotor_Serial;
 
 
 /* ================================================================================
@@ -23,13 +23,17 @@ extern HardwareSerial &DriveMotor_Serial;
 // =====================
 DriveMotor_Sabertooth::DriveMotor_Sabertooth
   ( Controller* pController,
-    const int settings[],
-    const byte pins[],
-    const byte sabertoothSettings[])
-  : DriveMotor(pController, settings, pins)
-  , m_sabertooth(sabertoothSettings[iAddress], DriveMotor_Serial)
+    const Config_Section* settings,
+    const Config_Section* pins,
+    const Config_Section* motionSettings,
+    const Config_Section* sabertoothSettings)
+  : DriveMotor(pController, settings, pins, motionSettings)
+  , m_sabertooth(sabertoothSettings->get(iAddress), DriveMotor_Serial)
 {
   m_sabertoothSettings = sabertoothSettings;
+
+  m_lastDrive = 0;
+  m_lastTurn  = 0;
 }
 
 // ====================
@@ -52,15 +56,31 @@ void DriveMotor_Sabertooth::begin(void)
   // Start communication with the Sabertooth.
   // ----------------------------------------
 
-  leftFootSignal.attach(m_pins[iDrivePin1]);
-  leftFootSignal.write(m_servoCenter);
+  DriveMotor_Serial.begin(SABERTOOTH_BAUD_RATE);
 
-  rightFootSignal.attach(m_pins[iDrivePin2]);
-  rightFootSignal.write(m_servoCenter);
+  // ------------------------------------------------------------------
+  // The serial timeout is the hardware safety net. If the sketch stops
+  // talking, say after a crash, the Sabertooth stops the motors itself.
+  // The keep-alive must beat it or the droid will stutter.
+  // ------------------------------------------------------------------
 
-  DriveMotor_Serial.begin(SABERTOOTH_BAUD_RATE);
-  m_sabertooth.setTimeout(300);
-  m_sabertooth.stop();
+  m_sabertooth.setTimeout(m_sabertoothSettings->get(iSerialTimeout));
+
+  #if defined(DEBUG)
+  if ( m_sabertoothSettings->get(iSerialTimeout) > 0 && m_sabertoothSettings->get(iSerialTimeout) <= m_settings->get(iDriveRefresh) ) {
+    Debug.print(DBG_WARNING, F("DriveMotor_Sabertooth"), F("begin()"), F("Serial timeout is shorter than the keep-alive"));
+  }
+  #endif
+
+  // ---------------------------------------------------------------
+  // In mixed mode the Sabertooth waits for both a drive and a turn
+  // value before it moves at all. Start both at zero.
+  // ---------------------------------------------------------------
+
+  m_sabertooth.drive(0);
+  m_sabertooth.turn(0);
+  m_lastDrive = 0;
+  m_lastTurn  = 0;
 
   #if defined(DEBUG)
   Debug.print(DBG_INFO, F("DriveMotor_Sabertooth"), F("begin()"), F("Sabertooth motor controller started"));
@@ -84,11 +104,17 @@ void DriveMotor_Sabertooth::stop(void)
   Debug.print(DBG_WARNING, F("DriveMotor_Sabertooth"), F("stop()"), F("Stop drive motors"));
   #endif
 
-  // ----------------------
-  // Send the stop command.
-  // ----------------------
+  // ------------------------------------------------------------------
+  // Send the stop as a zero drive and zero turn. Unlike stop(), this
+  // keeps the Sabertooth in mixed mode. The motor bus sends both ahead
+  // of anything else waiting.
+  // ------------------------------------------------------------------
 
-  m_sabertooth.stop();
+  m_sabertooth.drive(0);
+  m_sabertooth.turn(0);
+  m_lastDrive = 0;
+  m_lastTurn  = 0;
+  m_outputSent(0, 0);
 
   // ------------------------
   // Update the drive status.
@@ -102,128 +128,73 @@ void DriveMotor_Sabertooth::stop(void)
 // ===================
 void DriveMotor_Sabertooth::m_drive(void)
 {
-  // ------------------------------
-  // Account for the speed profile.
-  // ------------------------------
-
-  byte driveSpeed = 0;
-  int stickSpeed = 0;
-
-  if (speedProfile == RUN) {
-    driveSpeed = m_sabertoothSettings[iOverdriveSpeed];
-  } else if (speedProfile == WALK) {
-    driveSpeed = m_sabertoothSettings[iDriveSpeed];
+  // ---------------------------------------------------------------
+  // Each speed profile has its own top speed. Ramping is already
+  // done by the motion profile in DriveMotor, so the throttle maps
+  // straight to a drive speed.
+  // ---------------------------------------------------------------
+
+  int maxSpeed = m_sabertoothSettings->get(iWalkSpeed + min(speedProfile, (byte)SPRINT));
+  int driveSpeed = m_stickToSpeed(m_throttle, maxSpeed);
+
+  // ------------------------------------------------------------
+  // Turn less sharply the faster we go. At full speed, only a
+  // quarter of the turn speed is available. Spinning in place
+  // gets all of it.
+  // ------------------------------------------------------------
+
+  int turnSpeed = m_sabertoothSettings->get(iTurnSpeed);
+  int turnLimit = turnSpeed - (((long)turnSpeed * 3 * abs(driveSpeed)) / (4 * SABERTOOTH_FULL_SPEED));
+  int turn = m_stickToSpeed(m_steering, turnLimit) * m_sabertoothSettings->get(iInvertTurn);
+
+  driveStopped = false;
+
+  // ------------------------------------------------------------------
+  // Flood control. When nothing changed, the send is a keep-alive and
+  // both values go out. Otherwise only the values that changed go out.
+  // Both packets are queued back to back so the Sabertooth applies
+  // them together.
+  // ------------------------------------------------------------------
+
+  if ( ! m_outputDue(driveSpeed, turn) ) {
+    return;
   }
-  stickSpeed = (map(m_throttle, 0, 255, -driveSpeed, driveSpeed));
 
-  // --------------------------
-  // Factor in ramping up/down.
-  // --------------------------
+  bool refresh = ( driveSpeed == m_lastDrive && turn == m_lastTurn );
 
-  if ( abs(m_throttle - m_driveStick->center) <  m_driveStick->deadZone ) {
-    m_fastRampDown(&driveSpeed, &stickSpeed);
-  } else {
-    driveStopped = false;
-    if ( driveSpeed < stickSpeed ) {
-      m_rampUp(&driveSpeed, &stickSpeed);
-    } else if ( driveSpeed > stickSpeed ) {
-      m_rampDown(&driveSpeed, &stickSpeed);
-    }
+  if ( refresh || driveSpeed != m_lastDrive ) {
+    m_sabertooth.drive(driveSpeed);
   }
-
-  // ---------------------
-  // Factor in spin speed.
-  // ---------------------
-
-  int turnNumber = 0;
-  byte turnSpeed = m_sabertoothSettings[iTurnSpeed];
-
-  if ( abs(driveSpeed) > 50)
-    turnNumber = (map(m_driveStick->steering(), 54, 200, -(turnSpeed/4), (turnSpeed/4)));
-  else if (turnNumber > 200)
-    turnNumber = (map(m_driveStick->steering(), 201, 255, (turnSpeed/3), turnSpeed));
-  else if (turnNumber <= 200 && turnNumber >= 54)
-    turnNumber = (map(m_driveStick->steering(), 54, 200, -(turnSpeed/3), (turnSpeed/3)));
-  else if (turnNumber < 54)
-    turnNumber = (map(m_driveStick->steering(), 0, 53, -turnSpeed, -(turnSpeed/3)));
-      
-  if ( abs(turnNumber) > 5 ) {
-    driveStopped = false;   
+  if ( refresh || turn != m_lastTurn ) {
+    m_sabertooth.turn(turn);
   }
 
-  // 
-
-  unsigned long currentTime = millis();
-
-  if ( (currentTime - m_previousTime) > m_settings[iDriveLatency] ) {
-
-    if ( driveSpeed != 0 || abs(turnNumber) > 5 ) {
-
-      char buff[21];
-      sprintf(buff, "Drive/Turn: %i/%i", driveSpeed, turnNumber);
-      Debug.print(DBG_VERBOSE, F("DriveMotor_Sabertooth"), F("m_drive()"), buff);
-
-      m_sabertooth.turn(turnNumber * m_sabertoothSettings[iInvertTurn]);
-      m_sabertooth.drive(driveSpeed);
-
-    } else {
-
-      if ( ! driveStopped ) {
-        stop();
-      }
-
-    }
-  }
+  #if defined(DEBUG)
+  char buff[21];
+  snprintf(buff, sizeof(buff), "Drive/Turn: %i/%i", driveSpeed, turn);
+  Debug.print(DBG_VERBOSE, F("DriveMotor_Sabertooth"), F("m_drive()"), buff);
+  #endif
 
-  m_previousTime = currentTime;
-  return true;
+  m_lastDrive = driveSpeed;
+  m_lastTurn  = turn;
+  m_outputSent(driveSpeed, turn);
 }
 
-void DriveMotor_Sabertooth::m_fastRampDown(byte driveSpeed, int stickSpeed)
+// ==========================
+//      m_stickToSpeed()
+// ==========================
+int DriveMotor_Sabertooth::m_stickToSpeed(int stick, int limit)
 {
-  char buff[22];
-
-  if ( abs(driveSpeed) > 50 ) {
-    if ( driveSpeed > 0 ) {
-      driveSpeed -= 3;
-    } else {
-      driveSpeed += 3;
-    }
-    sprintf(buff, "Drive/Stick: %i/%i", driveSpeed, stickSpeed);
-    Debug.print(DBG_VERBOSE, F("DriveMotor_Sabertooth"), F("m_fastRampDown"), buff);
-  } else if ( abs(driveSpeed) > 20 ) {
-    if ( driveSpeed > 0 ) {
-      driveSpeed -= 2;
-    } else {
-      driveSpeed += 2;
-    }
-    sprintf(buff, "Drive/Stick: %i/%i", driveSpeed, stickSpeed);
-    Debug.print(DBG_VERBOSE, F("DriveMotor_Sabertooth"), F("m_fastRampDown"), buff);
-  } else {
-    driveSpeed = 0;
-  }
-}
+  // ------------------------------------------------------------
+  // Map each half of the stick on its own so that center is an
+  // exact zero and both ends reach the full limit.
+  // ------------------------------------------------------------
 
-void DriveMotor_Sabertooth::m_rampDown(byte driveSpeed, int stickSpeed)
-{
-  if ( (driveSpeed - stickSpeed) > (m_sabertoothSettings[iRamping]+1) ) {
-    driveSpeed -= m_sabertoothSettings[iRamping];
-    char buff[22];
-    sprintf(buff, "Drive/Stick: %i/%i", driveSpeed, stickSpeed);
-    Debug.print(DBG_VERBOSE, F("DriveMotor_Sabertooth"), F("m_rampDown"), buff);
-  } else {
-    driveSpeed = stickSpeed;
-  }
-}
+  limit = constrain(limit, 0, SABERTOOTH_FULL_SPEED);
 
-void DriveMotor_Sabertooth::m_rampUp(byte driveSpeed, int stickSpeed)
-{
-  if ( (stickSpeed - driveSpeed) > (m_sabertoothSettings[iRamping]+1) ) {
-    driveSpeed += m_sabertoothSettings[iRamping];
-    char buff[22];
-    sprintf(buff, "Drive/Stick: %i/%i", driveSpeed, stickSpeed);
-    Debug.print(DBG_VERBOSE, F("DriveMotor_Sabertooth"), F("m_rampUp"), buff);
+  if ( stick < m_driveStick->center ) {
+    return map(stick, m_driveStick->minValue, m_driveStick->center, -limit, 0);
   } else {
-    driveSpeed = stickSpeed;
+    return map(stick, m_driveStick->center, m_driveStick->maxValue, 0, limit);
   }
 }
@@ -0,0 +1,247 @@
+/* =================================================================================
+ *    B.L.A.C.Box: Brian Lubkeman's Astromech Controller
+ * =================================================================================
+ * MotionProfile.cpp - Acceleration and jerk limited ramping for drive output
+ * Created by Brian Lubkeman, 16 June 2021
+ * Inspired by S.H.A.D.O.W. controller code written by KnightShade
+ * Released into the public domain.
+ */
+#include "MotionProfile.h"
+
+// =================
+//      isqrt()
+// =================
+static long isqrt(long n)
+{
+  long root = 0;
+  long bit = 1L << 30;
+
+  while ( bit > n ) {
+    bit >>= 2;
+  }
+  while ( bit != 0 ) {
+    if ( n >= root + bit ) {
+      n -= root + bit;
+      root = (root >> 1) + bit;
+    } else {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+  return root;
+}
+
+/* ================================================================================
+ *                              Motion Profile Class
+ * ================================================================================ */
+
+// =====================
+//      Constructor
+// =====================
+MotionProfile::MotionProfile(void)
+{
+  m_accel = MOTION_FULL_SCALE;
+  m_decel = MOTION_FULL_SCALE;
+  m_jerk  = 0;
+  m_emergencyDecel = 0;
+  m_lastTime = 0;
+  reset();
+}
+
+// ====================
+//      Destructor
+// ====================
+MotionProfile::~MotionProfile(void) {}
+
+// =====================
+//      setLimits()
+// =====================
+void MotionProfile::setLimits(int accel, int decel, int jerk)
+{
+  m_accel = max(accel, 1);
+  m_decel = max(decel, 1);
+  m_jerk  = max(jerk, 0);
+}
+
+// =============================
+//      setEmergencyDecel()
+// =============================
+void MotionProfile::setEmergencyDecel(int decel)
+{
+  m_emergencyDecel = max(decel, 0);
+}
+
+// =====================
+//      setTarget()
+// =====================
+void MotionProfile::setTarget(int target1, int target2)
+{
+  m_axis[0].target = constrain(target1, -MOTION_FULL_SCALE, MOTION_FULL_SCALE);
+  m_axis[1].target = constrain(target2, -MOTION_FULL_SCALE, MOTION_FULL_SCALE);
+  m_emergency = false;
+}
+
+// =========================
+//      emergencyStop()
+// =========================
+void MotionProfile::emergencyStop(void)
+{
+  // ------------------------------------------------------------------
+  // Head for zero at the emergency rate, ignoring jerk. An emergency
+  // rate of zero means stop on the spot, just as before ramping existed.
+  // ------------------------------------------------------------------
+
+  if ( m_emergencyDecel == 0 ) {
+    reset();
+    return;
+  }
+
+  m_axis[0].target = 0;
+  m_axis[1].target = 0;
+  m_emergency = true;
+}
+
+// =================
+//      reset()
+// =================
+void MotionProfile::reset(void)
+{
+  for (byte i = 0; i < MOTION_AXES; i++) {
+    m_axis[i].value  = 0;
+    m_axis[i].rate   = 0;
+    m_axis[i].target = 0;
+  }
+  m_emergency = false;
+
+  // The next update() starts the clock afresh.
+
+  m_started = false;
+}
+
+// ==================
+//      update()
+// ==================
+void MotionProfile::update(unsigned long currentTime)
+{
+  // ---------------------------------------------------------------
+  // Run as many fixed steps as time has passed. After a stall longer
+  // than MOTION_MAX_CATCHUP steps, drop the whole backlog and take a
+  // single step, so the output never leaps ahead all at once.
+  // ---------------------------------------------------------------
+
+  if ( ! m_started ) {
+    m_lastTime = currentTime;
+    m_started = true;
+    return;
+  }
+
+  unsigned long steps = (currentTime - m_lastTime) / MOTION_STEP_MS;
+
+  if ( steps > MOTION_MAX_CATCHUP ) {
+    steps = 1;
+    m_lastTime = currentTime;
+  } else {
+    m_lastTime += steps * MOTION_STEP_MS;
+  }
+
+  while ( steps > 0 ) {
+    for (byte i = 0; i < MOTION_AXES; i++) {
+      m_step(&m_axis[i]);
+    }
+    steps--;
+  }
+}
+
+// ==================
+//      m_step()
+// ==================
+void MotionProfile::m_step(Motion_Axis_Struct* axis)
+{
+  long goal  = (long)axis->target * 1000;
+  long error = goal - axis->value;
+
+  if ( error == 0 && axis->rate == 0 ) {
+    return;
+  }
+
+  // ----------------------------------------------------------------
+  // Moving further from zero is acceleration. Anything else, such as
+  // easing off or reversing, is deceleration.
+  // ----------------------------------------------------------------
+
+  long limit;
+  if ( m_emergency ) {
+    limit = m_emergencyDecel;
+  } else if ( (error > 0 && axis->value >= 0) || (error < 0 && axis->value <= 0) ) {
+    limit = m_accel;
+  } else {
+    limit = m_decel;
+  }
+
+  // ------------------------------------------------------------------
+  // The rate we would like: enough to arrive this step, capped by the
+  // limit. With a jerk limit, also slow enough that the rate can ease
+  // back to zero by the time the output arrives, which is sqrt(2*j*d).
+  // ------------------------------------------------------------------
+
+  long distance = abs(error);
+  long wanted = min(distance / (long)MOTION_STEP_MS, limit);
+  bool limitJerk = ( m_jerk > 0 && ! m_emergency );
+
+  if ( limitJerk ) {
+    wanted = min(wanted, isqrt(2L * m_jerk * (distance / 1000)));
+  }
+  if ( error < 0 ) {
+    wanted = -wanted;
+  }
+
+  // -----------------------------------------------------
+  // The jerk limit also caps how fast the rate can change.
+  // -----------------------------------------------------
+
+  if ( limitJerk ) {
+    long change = max(((long)m_jerk * MOTION_STEP_MS) / 1000, 1L);
+    axis->rate += constrain(wanted - axis->rate, -change, change);
+  } else {
+    axis->rate = wanted;
+  }
+
+  // --------------------------------------
+  // Move, and never overshoot the target.
+  // --------------------------------------
+
+  axis->value += axis->rate * (long)MOTION_STEP_MS;
+
+  if ( (error > 0 && axis->value >= goal) || (error < 0 && axis->value <= goal) ) {
+    axis->value = goal;
+    axis->rate = 0;
+  }
+}
+
+// =================
+//      value()
+// =================
+int MotionProfile::value(byte axis)
+{
+  if ( axis >= MOTION_AXES ) {
+    return 0;
+  }
+
+  // Round thousandths to the nearest whole step.
+
+  long v = m_axis[axis].value;
+  return (int)( v >= 0 ? (v + 500) / 1000 : (v - 500) / 1000 );
+}
+
+// ===================
+//      settled()
+// ===================
+bool MotionProfile::settled(void)
+{
+  for (byte i = 0; i < MOTION_AXES; i++) {
+    if ( m_axis[i].rate != 0 || m_axis[i].value != (long)m_axis[i].target * 1000 ) {
+      return false;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,72 @@
+/* =================================================================================
+ *    B.L.A.C.Box: Brian Lubkeman's Astromech Controller
+ * =================================================================================
+ * MotionProfile.h - Acceleration and jerk limited ramping for drive output
+ * Created by Brian Lubkeman, 16 June 2021
+ * Inspired by S.H.A.D.O.W. controller code written by KnightShade
+ * Released into the public domain.
+ * =================================================================================
+ *
+ * Each axis runs from -1000 (full reverse) to 1000 (full forward). The profile
+ * moves the output toward the stick target no faster than the acceleration
+ * limit, slows it no faster than the deceleration limit, and changes either rate
+ * no faster than the jerk limit. It steps on a fixed 10 ms clock, however often
+ * update() is called, so the ramp feels the same at any loop rate.
+ */
+#ifndef __BLACBOX_MOTION_PROFILE_H__
+#define __BLACBOX_MOTION_PROFILE_H__
+
+#include "../hal/Hal.h"
+
+const int MOTION_FULL_SCALE          = 1000;  // Output at full stick.
+const byte MOTION_AXES               = 2;
+const unsigned long MOTION_STEP_MS   = 10;    // Fixed timestep.
+const byte MOTION_MAX_CATCHUP        = 50;    // Longer gaps between updates are a stall, and are not replayed.
+
+enum motion_setting_index_e {
+   iAccel           // 0 - Acceleration (full scale = 1000, per second).
+ , iDecel           // 1 - Deceleration (per second).
+ , iJerk            // 2 - Jerk (per second, per second). 0 = no jerk limit.
+};
+
+const byte MOTION_SETTINGS_PER_PROFILE = 3;   // iAccel, iDecel, iJerk for each speed profile.
+const byte iEmergencyDecel             = 12;  // Follows the four speed profiles.
+
+typedef struct {
+  long value;               // Output, in thousandths of a step.
+  long rate;                // Output change per second.
+  int target;               // Where the output is headed.
+} Motion_Axis_Struct;
+
+/* ================================================================================
+ *                              Motion Profile Class
+ * ================================================================================ */
+class MotionProfile
+{
+  private:
+    Motion_Axis_Struct m_axis[MOTION_AXES];
+    int m_accel;
+    int m_decel;
+    int m_jerk;
+    int m_emergencyDecel;
+    bool m_emergency;
+    bool m_started;
+    unsigned long m_lastTime;
+
+    void m_step(Motion_Axis_Struct* axis);
+
+  public:
+    MotionProfile(void);
+    ~MotionProfile(void);
+
+    void setLimits(int accel, int decel, int jerk);
+    void setEmergencyDecel(int decel);
+    void setTarget(int target1, int target2);
+    void emergencyStop(void);
+    void reset(void);
+    void update(unsigned long currentTime);
+
+    int value(byte axis);
+    bool settled(void);
+};
+#endif
@@ -0,0 +1,295 @@
+/* =================================================================================
+ *    B.L.A.C.Box: Brian Lubkeman's Astromech Controller
+ * =================================================================================
+ * Hal.cpp - Host backend for the hardware abstraction layer
+ * Created by Brian Lubkeman, 16 June 2021
+ * Inspired by S.H.A.D.O.W. controller code written by KnightShade
+ * Released into the public domain.
+ */
+#include "Hal.h"
+
+#if !defined(ARDUINO)
+
+#include <string.h>
+#include <time.h>
+
+const byte HAL_PIN_COUNT = 70;   // Matches the Arduino Mega 2560.
+
+static unsigned long s_clockMicros = 0;
+static unsigned long s_randomState = 1;
+static int s_pinValues[HAL_PIN_COUNT];
+static Hal_Isr s_pinIsr[HAL_PIN_COUNT];
+static int s_pinIsrMode[HAL_PIN_COUNT];
+
+const uint16_t HAL_EEPROM_SIZE = 4096;  // Matches the Arduino Mega 2560.
+static byte s_eeprom[HAL_EEPROM_SIZE];
+static bool s_eepromErased = false;
+
+/* ================================================================================
+ *                                      Clock
+ * ================================================================================ */
+
+// The simulated clock only moves when advance() or set() is called. This keeps
+// every run of the loop on the host deterministic.
+
+unsigned long Hal_Clock::millis(void)                   { return s_clockMicros / 1000; }
+unsigned long Hal_Clock::micros(void)                   { return s_clockMicros; }
+void Hal_Clock::advance(unsigned long microseconds)     { s_clockMicros += microseconds; }
+void Hal_Clock::set(unsigned long microseconds)         { s_clockMicros = microseconds; }
+
+unsigned long Hal_Clock::stopwatch(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (unsigned long)now.tv_sec * 1000000UL + (unsigned long)(now.tv_nsec / 1000);
+}
+
+/* ================================================================================
+ *                                  Random Numbers
+ * ================================================================================ */
+
+// A small linear congruential generator. Every run with the same seed makes the
+// same choices, so a simulated show plays out the same way each time.
+
+void randomSeed(unsigned long seed)
+{
+  s_randomState = ( seed != 0 ? seed : 1 );
+}
+
+long random(long howBig)
+{
+  if ( howBig <= 0 ) {
+    return 0;
+  }
+  s_randomState = (s_randomState * 1103515245UL + 12345UL) & 0x7FFFFFFFUL;
+  return (long)((s_randomState >> 8) % (unsigned long)howBig);
+}
+
+long random(long howSmall, long howBig)
+{
+  if ( howSmall >= howBig ) {
+    return howSmall;
+  }
+  return howSmall + random(howBig - howSmall);
+}
+
+/* ================================================================================
+ *                                   Digital Pins
+ * ================================================================================ */
+
+void Hal_Pin::mode(byte pin, byte pinMode)
+{
+  // A pulled-up input reads high until something pulls it low.
+
+  if ( pinMode == INPUT_PULLUP ) {
+    write(pin, HIGH);
+  }
+}
+
+void Hal_Pin::write(byte pin, byte value)
+{
+  if ( pin < HAL_PIN_COUNT ) {
+    s_pinValues[pin] = value;
+  }
+}
+
+int Hal_Pin::read(byte pin)
+{
+  return ( pin < HAL_PIN_COUNT ? s_pinValues[pin] : 0 );
+}
+
+int Hal_Pin::analog(byte pin)
+{
+  return read(pin);
+}
+
+void Hal_Pin::attachInterrupt(byte pin, Hal_Isr isr, int mode)
+{
+  if ( pin < HAL_PIN_COUNT ) {
+    s_pinIsr[pin] = isr;
+    s_pinIsrMode[pin] = mode;
+  }
+}
+
+Hal_Fast_Pin_Struct Hal_Pin::fast(byte pin)
+{
+  Hal_Fast_Pin_Struct fastPin;
+  fastPin.pin = pin;
+  return fastPin;
+}
+
+bool Hal_Pin::readFast(const Hal_Fast_Pin_Struct* pin)
+{
+  return read(pin->pin) != 0;
+}
+
+void Hal_Pin::inject(byte pin, int value)
+{
+  // An injected edge runs the pin's interrupt, just as the hardware would.
+
+  if ( pin >= HAL_PIN_COUNT ) {
+    return;
+  }
+
+  int previous = s_pinValues[pin];
+  write(pin, value);
+
+  if ( s_pinIsr[pin] == NULL || (previous != 0) == (value != 0) ) {
+    return;
+  }
+  if ( s_pinIsrMode[pin] == CHANGE ||
+       (s_pinIsrMode[pin] == RISING && value != 0) ||
+       (s_pinIsrMode[pin] == FALLING && value == 0) ) {
+    s_pinIsr[pin]();
+  }
+}
+
+/* ================================================================================
+ *                                PWM / Servo Output
+ * ================================================================================ */
+
+Hal_Servo::Hal_Servo(void)
+{
+  m_pin = 0;
+  m_degrees = 90;
+  m_writeCount = 0;
+}
+
+void Hal_Servo::attach(byte pin)                        { m_pin = pin; }
+int  Hal_Servo::read(void)                              { return m_degrees; }
+unsigned long Hal_Servo::writeCount(void)               { return m_writeCount; }
+
+void Hal_Servo::write(int degrees)
+{
+  if ( degrees < 0 )   { degrees = 0; }
+  if ( degrees > 180 ) { degrees = 180; }
+  m_degrees = degrees;
+  m_writeCount++;
+}
+
+/* ================================================================================
+ *                                   Serial Ports
+ * ================================================================================ */
+
+size_t Hal_Stream::write(const byte* buffer, size_t length)
+{
+  size_t written = 0;
+  while ( length-- > 0 ) {
+    written += write(*buffer++);
+  }
+  return written;
+}
+
+size_t Hal_Stream::print(const char* text)
+{
+  return write((const byte*)text, strlen(text));
+}
+
+// Transmitted bytes are counted and discarded, or handed to onTransmit() when
+// set; the transmit side never blocks. Received bytes are whatever a test or
+// simulator inject()ed.
+
+Hal_SerialPort::Hal_SerialPort(void)
+{
+  m_rxHead = 0;
+  m_rxTail = 0;
+  m_baudRate = 0;
+  m_txCount = 0;
+  m_onTransmit = NULL;
+}
+
+void Hal_SerialPort::begin(unsigned long baudRate)      { m_baudRate = baudRate; }
+int Hal_SerialPort::availableForWrite(void)             { return HAL_SERIAL_BUFFER_SIZE; }
+unsigned long Hal_SerialPort::txCount(void)             { return m_txCount; }
+
+size_t Hal_SerialPort::write(byte value)
+{
+  return write(&value, 1);
+}
+
+size_t Hal_SerialPort::write(const byte* buffer, size_t length)
+{
+  m_txCount += length;
+  if ( m_onTransmit != NULL ) {
+    m_onTransmit(buffer, length);
+  }
+  return length;
+}
+
+int Hal_SerialPort::available(void)
+{
+  return (m_rxHead - m_rxTail + HAL_SERIAL_BUFFER_SIZE) % HAL_SERIAL_BUFFER_SIZE;
+}
+
+int Hal_SerialPort::peek(void)
+{
+  if ( m_rxHead == m_rxTail ) {
+    return -1;
+  }
+  return m_rx[m_rxTail];
+}
+
+int Hal_SerialPort::read(void)
+{
+  int value = peek();
+  if ( value >= 0 ) {
+    m_rxTail = (m_rxTail + 1) % HAL_SERIAL_BUFFER_SIZE;
+  }
+  return value;
+}
+
+void Hal_SerialPort::inject(const byte* buffer, size_t length)
+{
+  for (size_t i = 0; i < length; i++) {
+    int next = (m_rxHead + 1) % HAL_SERIAL_BUFFER_SIZE;
+    if ( next == m_rxTail ) {
+      return;
+    }
+    m_rx[m_rxHead] = buffer[i];
+    m_rxHead = next;
+  }
+}
+
+void Hal_SerialPort::onTransmit(Hal_Transmit_Callback callback)
+{
+  m_onTransmit = callback;
+}
+
+Hal_SerialPort Serial, Serial1, Serial2, Serial3;
+
+/* ================================================================================
+ *                                      EEPROM
+ * ================================================================================ */
+
+// A new part reads 0xFF everywhere. The host EEPROM starts out the same way.
+
+byte Hal_Eeprom::read(uint16_t address)
+{
+  if ( ! s_eepromErased ) {
+    erase();
+  }
+  return ( address < HAL_EEPROM_SIZE ? s_eeprom[address] : 0xFF );
+}
+
+void Hal_Eeprom::update(uint16_t address, byte value)
+{
+  if ( ! s_eepromErased ) {
+    erase();
+  }
+  if ( address < HAL_EEPROM_SIZE ) {
+    s_eeprom[address] = value;
+  }
+}
+
+uint16_t Hal_Eeprom::length(void)
+{
+  return HAL_EEPROM_SIZE;
+}
+
+void Hal_Eeprom::erase(void)
+{
+  memset(s_eeprom, 0xFF, HAL_EEPROM_SIZE);
+  s_eepromErased = true;
+}
+
+#endif
@@ -0,0 +1,259 @@
+/* =================================================================================
+ *    B.L.A.C.Box: Brian Lubkeman's Astromech Controller
+ * =================================================================================
+ * Hal.h - Thin hardware abstraction layer (clock, pins, servo output, serial)
+ * Created by Brian Lubkeman, 16 June 2021
+ * Inspired by S.H.A.D.O.W. controller code written by KnightShade
+ * Released into the public domain.
+ * =================================================================================
+ *
+ * Every peripheral reaches the hardware through these classes instead of calling
+ * millis(), pinMode(), Servo, EEPROM or HardwareSerial directly. On the Arduino each call
+ * is an inline pass-through and costs nothing. Without ARDUINO defined, the host
+ * backend in Hal.cpp is used instead: a simulated clock that only moves when told
+ * to, recorded pin and servo writes, an EEPROM and serial ports backed by memory
+ * buffers.
+ *
+ * Hal_Clock::stopwatch() is for timing code, not for scheduling. It counts
+ * microseconds of real time on both sides: micros() on the Arduino, and the
+ * workstation's own clock on the host, where the simulated clock stands still
+ * while code runs.
+ *
+ * This is the only file that includes Arduino.h. Everything else includes this
+ * one. On the host it also supplies the few pieces of the Arduino language the
+ * sketch leans on (F(), min(), max(), constrain(), map() and random()), with the
+ * same results as the Arduino core. random() is seeded the same way every run.
+ */
+#ifndef __BLACBOX_HAL_H__
+#define __BLACBOX_HAL_H__
+
+#if defined(ARDUINO)
+#include <Arduino.h>
+#include <Servo.h>
+#include <EEPROM.h>
+#else
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <type_traits>
+typedef uint8_t byte;
+
+// Flash access reads plain memory on the host.
+#define PROGMEM
+#define PGM_P const char*
+#define pgm_read_byte(p)  (*(const uint8_t*)(p))
+#define pgm_read_word(p)  (*(const uint16_t*)(p))
+#define pgm_read_dword(p) (*(const uint32_t*)(p))
+#define memcpy_P memcpy
+#define memcmp_P memcmp
+#define PSTR(s) (s)
+
+// Pin constants with the Arduino's values, for code built on the host.
+const byte LOW          = 0;
+const byte HIGH         = 1;
+const byte INPUT        = 0;
+const byte OUTPUT       = 1;
+const byte INPUT_PULLUP = 2;
+const int  CHANGE       = 1;
+const int  FALLING      = 2;
+const int  RISING       = 3;
+
+// Flash strings are ordinary strings on the host.
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper*>(s))
+
+// The Arduino core's helpers.
+template <class T, class U> inline typename std::common_type<T, U>::type min(T a, U b) { return ( a < b ? a : b ); }
+template <class T, class U> inline typename std::common_type<T, U>::type max(T a, U b) { return ( a > b ? a : b ); }
+template <class T, class L, class H> inline T constrain(T x, L low, H high) { return ( x < low ? low : ( x > high ? high : x ) ); }
+inline long map(long x, long inMin, long inMax, long outMin, long outMax) { return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin; }
+long random(long howBig);
+long random(long howSmall, long howBig);
+void randomSeed(unsigned long seed);
+#endif
+
+typedef void (*Hal_Isr)(void);
+
+// A pin resolved ahead of time, for reading inside an interrupt. On the Arduino
+// that is its input register and bit, so a read is one load and a mask.
+
+typedef struct {
+  #if defined(ARDUINO)
+  volatile uint8_t* input;
+  uint8_t mask;
+  #else
+  byte pin;
+  #endif
+} Hal_Fast_Pin_Struct;
+
+/* ================================================================================
+ *                                      Clock
+ * ================================================================================ */
+class Hal_Clock
+{
+  public:
+    static unsigned long millis(void);
+    static unsigned long micros(void);
+    static unsigned long stopwatch(void);
+
+    #if !defined(ARDUINO)
+    static void advance(unsigned long microseconds);
+    static void set(unsigned long microseconds);
+    #endif
+};
+
+/* ================================================================================
+ *                                   Digital Pins
+ * ================================================================================ */
+class Hal_Pin
+{
+  public:
+    static void mode(byte pin, byte pinMode);
+    static void write(byte pin, byte value);
+    static int  read(byte pin);
+    static int  analog(byte pin);
+    static void attachInterrupt(byte pin, Hal_Isr isr, int mode);
+
+    static Hal_Fast_Pin_Struct fast(byte pin);
+    static bool readFast(const Hal_Fast_Pin_Struct* pin);
+
+    #if !defined(ARDUINO)
+    static void inject(byte pin, int value);
+    #endif
+};
+
+/* ================================================================================
+ *                                PWM / Servo Output
+ * ================================================================================ */
+class Hal_Servo
+{
+  private:
+    #if defined(ARDUINO)
+    Servo m_servo;
+    #else
+    byte m_pin;
+    int m_degrees;
+    unsigned long m_writeCount;
+    #endif
+
+  public:
+    void attach(byte pin);
+    void write(int degrees);
+    int  read(void);
+
+    #if !defined(ARDUINO)
+    Hal_Servo(void);
+    unsigned long writeCount(void);
+    #endif
+};
+
+/* ================================================================================
+ *                                      EEPROM
+ * ================================================================================ */
+class Hal_Eeprom
+{
+  public:
+    static byte read(uint16_t address);
+    static void update(uint16_t address, byte value);
+    static uint16_t length(void);
+
+    #if !defined(ARDUINO)
+    static void erase(void);
+    #endif
+};
+
+/* ================================================================================
+ *                                   Serial Ports
+ * ================================================================================ */
+#if defined(ARDUINO)
+
+typedef HardwareSerial Hal_SerialPort;
+typedef Stream Hal_Stream;
+
+#else
+
+// Stand-in for Arduino's Stream so serial wrappers build on the host.
+
+class Hal_Stream
+{
+  public:
+    virtual size_t write(byte value) = 0;
+    virtual size_t write(const byte* buffer, size_t length);
+    virtual int available(void) = 0;
+    virtual int read(void) = 0;
+    virtual int peek(void) = 0;
+    virtual void flush(void) {}
+    size_t print(const char* text);
+};
+
+const int HAL_SERIAL_BUFFER_SIZE = 256;
+
+typedef void (*Hal_Transmit_Callback)(const byte* buffer, size_t length);
+
+class Hal_SerialPort : public Hal_Stream
+{
+  private:
+    byte m_rx[HAL_SERIAL_BUFFER_SIZE];
+    int m_rxHead;
+    int m_rxTail;
+    unsigned long m_baudRate;
+    unsigned long m_txCount;
+    Hal_Transmit_Callback m_onTransmit;
+
+  public:
+    Hal_SerialPort(void);
+
+    void begin(unsigned long baudRate);
+    virtual size_t write(byte value);
+    virtual size_t write(const byte* buffer, size_t length);
+    int availableForWrite(void);
+    virtual int available(void);
+    virtual int read(void);
+    virtual int peek(void);
+    operator bool(void) { return true; }
+
+    void inject(const byte* buffer, size_t length);
+    void onTransmit(Hal_Transmit_Callback callback);
+    unsigned long txCount(void);
+};
+
+extern Hal_SerialPort Serial, Serial1, Serial2, Serial3;
+
+#endif
+
+/* ================================================================================
+ *                            Arduino Inline Backend
+ * ================================================================================ */
+#if defined(ARDUINO)
+inline unsigned long Hal_Clock::millis(void)            { return ::millis(); }
+inline unsigned long Hal_Clock::micros(void)            { return ::micros(); }
+inline unsigned long Hal_Clock::stopwatch(void)         { return ::micros(); }
+
+inline void Hal_Pin::mode(byte pin, byte pinMode)       { ::pinMode(pin, pinMode); }
+inline void Hal_Pin::write(byte pin, byte value)        { ::digitalWrite(pin, value); }
+inline int  Hal_Pin::read(byte pin)                     { return ::digitalRead(pin); }
+inline int  Hal_Pin::analog(byte pin)                   { return ::analogRead(pin); }
+inline void Hal_Pin::attachInterrupt(byte pin, Hal_Isr isr, int mode) { ::attachInterrupt(digitalPinToInterrupt(pin), isr, mode); }
+
+inline Hal_Fast_Pin_Struct Hal_Pin::fast(byte pin)
+{
+  Hal_Fast_Pin_Struct fastPin;
+  fastPin.input = portInputRegister(digitalPinToPort(pin));
+  fastPin.mask  = digitalPinToBitMask(pin);
+  return fastPin;
+}
+inline bool Hal_Pin::readFast(const Hal_Fast_Pin_Struct* pin) { return (*pin->input & pin->mask) != 0; }
+
+inline byte Hal_Eeprom::read(uint16_t address)         { return EEPROM.read(address); }
+inline void Hal_Eeprom::update(uint16_t address, byte value) { EEPROM.update(address, value); }
+inline uint16_t Hal_Eeprom::length(void)                { return EEPROM.length(); }
+
+inline void Hal_Servo::attach(byte pin)                 { m_servo.attach(pin); }
+inline void Hal_Servo::write(int degrees)               { m_servo.write(degrees); }
+inline int  Hal_Servo::read(void)                       { return m_servo.read(); }
+#endif
+
+#endif
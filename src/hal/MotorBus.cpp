@@ -0,0 +1,273 @@
+/* =================================================================================
+ *    B.L.A.C.Box: Brian Lubkeman's Astromech Controller
+ * =================================================================================
+ * MotorBus.cpp - Arbiter for a serial port shared by packetized motor controllers
+ * Created by Brian Lubkeman, 16 June 2021
+ * Inspired by S.H.A.D.O.W. controller code written by KnightShade
+ * Released into the public domain.
+ */
+#include "MotorBus.h"
+
+/* ================================================================================
+ *                                 Motor Bus Class
+ * ================================================================================ */
+
+// =====================
+//      Constructor
+// =====================
+MotorBus::MotorBus(Hal_SerialPort& port, byte buffer[], uint16_t size)
+  : SerialQueue(port, buffer, size)
+{
+  for (byte i = 0; i < MOTORBUS_MAX_SLOTS; i++) {
+    m_slots[i].pending = false;
+    m_slots[i].urgent = false;
+  }
+  for (byte i = 0; i < MOTORBUS_ADDRESS_COUNT; i++) {
+    m_packetCount[i] = 0;
+    m_packetRate[i] = 0;
+  }
+  m_nextSlot = 0;
+  m_packetLength = 0;
+  m_windowStart = 0;
+  m_coalesced = 0;
+  m_rejected = 0;
+}
+
+// ====================
+//      Destructor
+// ====================
+MotorBus::~MotorBus(void) {}
+
+// =================
+//      write()
+// =================
+size_t MotorBus::write(byte value)
+{
+  // ----------------------------------------------------------
+  // An address byte starts a packet. The next three bytes are
+  // collected behind it. Anything else passes straight through.
+  // ----------------------------------------------------------
+
+  if ( value >= MOTORBUS_FIRST_ADDRESS && value < MOTORBUS_FIRST_ADDRESS + MOTORBUS_ADDRESS_COUNT ) {
+    if ( m_packetLength > 0 ) {
+      SerialQueue::write(m_packet, m_packetLength);
+    }
+    m_packet[0] = value;
+    m_packetLength = 1;
+    return 1;
+  }
+
+  if ( m_packetLength == 0 ) {
+    return SerialQueue::write(value);
+  }
+
+  m_packet[m_packetLength++] = value;
+  if ( m_packetLength == 4 ) {
+    m_acceptPacket();
+    m_packetLength = 0;
+  }
+  return 1;
+}
+
+size_t MotorBus::write(const byte* buffer, size_t length)
+{
+  for (size_t i = 0; i < length; i++) {
+    write(buffer[i]);
+  }
+  return length;
+}
+
+// =================
+//      drain()
+// =================
+void MotorBus::drain(void)
+{
+  m_updateRates();
+
+  // ----------------------------------------------------------
+  // Packets only go out whole. Urgent packets first, then the
+  // rest in turn so no one address can starve another.
+  // ----------------------------------------------------------
+
+  while ( m_port->availableForWrite() >= 4 ) {
+
+    byte slot = MOTORBUS_MAX_SLOTS;
+
+    for (byte i = 0; i < MOTORBUS_MAX_SLOTS; i++) {
+      if ( m_slots[i].pending && m_slots[i].urgent ) {
+        slot = i;
+        break;
+      }
+    }
+
+    if ( slot == MOTORBUS_MAX_SLOTS ) {
+      for (byte i = 0; i < MOTORBUS_MAX_SLOTS; i++) {
+        byte candidate = (m_nextSlot + i) % MOTORBUS_MAX_SLOTS;
+        if ( m_slots[candidate].pending ) {
+          slot = candidate;
+          m_nextSlot = (candidate + 1) % MOTORBUS_MAX_SLOTS;
+          break;
+        }
+      }
+    }
+
+    if ( slot == MOTORBUS_MAX_SLOTS ) {
+      break;
+    }
+
+    m_sendSlot(slot);
+  }
+
+  // Then whatever else was written to the port.
+
+  SerialQueue::drain();
+}
+
+// =============================
+//      Statistic accessors
+// =============================
+uint16_t MotorBus::packetRate(byte address)
+{
+  if ( address < MOTORBUS_FIRST_ADDRESS || address >= MOTORBUS_FIRST_ADDRESS + MOTORBUS_ADDRESS_COUNT ) {
+    return 0;
+  }
+  return m_packetRate[address - MOTORBUS_FIRST_ADDRESS];
+}
+unsigned long MotorBus::coalesced(void)   { return m_coalesced; }
+unsigned long MotorBus::rejected(void)    { return m_rejected; }
+
+// ========================
+//      m_acceptPacket()
+// ========================
+void MotorBus::m_acceptPacket(void)
+{
+  // A bad checksum means this was not really a packet. Send it as it came.
+
+  if ( ((m_packet[0] + m_packet[1] + m_packet[2]) & 0x7F) != m_packet[3] ) {
+    SerialQueue::write(m_packet, 4);
+    return;
+  }
+
+  bool urgent = m_isStop(m_packet);
+  byte slot = MOTORBUS_MAX_SLOTS;
+
+  // --------------------------------------------------------
+  // Replace what is pending for the same channel. Otherwise
+  // take a free slot. A stop may take a slot from non-urgent
+  // traffic when the table is full.
+  // --------------------------------------------------------
+
+  for (byte i = 0; i < MOTORBUS_MAX_SLOTS; i++) {
+    if ( m_slots[i].pending && m_sameChannel(m_slots[i].packet, m_packet) ) {
+      slot = i;
+      m_coalesced++;
+      break;
+    }
+  }
+
+  if ( slot == MOTORBUS_MAX_SLOTS ) {
+    for (byte i = 0; i < MOTORBUS_MAX_SLOTS; i++) {
+      if ( ! m_slots[i].pending ) {
+        slot = i;
+        break;
+      }
+    }
+  }
+
+  if ( slot == MOTORBUS_MAX_SLOTS && urgent ) {
+    for (byte i = 0; i < MOTORBUS_MAX_SLOTS; i++) {
+      if ( ! m_slots[i].urgent ) {
+        slot = i;
+        break;
+      }
+    }
+  }
+
+  if ( slot == MOTORBUS_MAX_SLOTS ) {
+    m_rejected++;
+    return;
+  }
+
+  for (byte i = 0; i < 4; i++) {
+    m_slots[slot].packet[i] = m_packet[i];
+  }
+  m_slots[slot].pending = true;
+  m_slots[slot].urgent = urgent;
+}
+
+// ==================
+//      m_isStop()
+// ==================
+bool MotorBus::m_isStop(const byte packet[])
+{
+  // Motor 1 (0, 1), motor 2 (4, 5), drive (8, 9) and turn (10, 11) at zero.
+
+  byte command = packet[1];
+  if ( packet[2] != 0 ) {
+    return false;
+  }
+  return ( command <= 1 || command == 4 || command == 5 || (command >= 8 && command <= 11) );
+}
+
+// =======================
+//      m_sameChannel()
+// =======================
+bool MotorBus::m_sameChannel(const byte a[], const byte b[])
+{
+  if ( a[0] != b[0] ) {
+    return false;
+  }
+
+  return ( m_channel(a[1]) == m_channel(b[1]) );
+}
+
+// ===================
+//      m_channel()
+// ===================
+byte MotorBus::m_channel(byte command)
+{
+  // ----------------------------------------------------------------
+  // Forward and reverse of one channel are the same channel: motor 1
+  // (0, 1), motor 2 (4, 5), drive (8, 9) and turn (10, 11). Every
+  // other command, such as the voltage limits (2, 3), stands alone.
+  // ----------------------------------------------------------------
+
+  switch (command) {
+    case 1 :  { return 0; }
+    case 5 :  { return 4; }
+    case 9 :  { return 8; }
+    case 11 : { return 10; }
+    default : { return command; }
+  }
+}
+
+// ====================
+//      m_sendSlot()
+// ====================
+void MotorBus::m_sendSlot(byte slot)
+{
+  m_port->write(m_slots[slot].packet, 4);
+  m_slots[slot].pending = false;
+  m_slots[slot].urgent = false;
+  m_packetCount[m_slots[slot].packet[0] - MOTORBUS_FIRST_ADDRESS]++;
+}
+
+// ========================
+//      m_updateRates()
+// ========================
+void MotorBus::m_updateRates(void)
+{
+  unsigned long currentTime = Hal_Clock::millis();
+  if ( (currentTime - m_windowStart) < MOTORBUS_RATE_WINDOW ) {
+    return;
+  }
+
+  // Packets per second for each address over the last window.
+
+  unsigned long elapsed = currentTime - m_windowStart;
+  for (byte i = 0; i < MOTORBUS_ADDRESS_COUNT; i++) {
+    m_packetRate[i] = ((unsigned long)m_packetCount[i] * 1000) / elapsed;
+    m_packetCount[i] = 0;
+  }
+  m_windowStart = currentTime;
+}
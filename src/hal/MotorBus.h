@@ -0,0 +1,77 @@
+/* =================================================================================
+ *    B.L.A.C.Box: Brian Lubkeman's Astromech Controller
+ * =================================================================================
+ * MotorBus.h - Arbiter for a serial port shared by packetized motor controllers
+ * Created by Brian Lubkeman, 16 June 2021
+ * Inspired by S.H.A.D.O.W. controller code written by KnightShade
+ * Released into the public domain.
+ * =================================================================================
+ *
+ * The Syren10 and Sabertooth share Serial2 and speak the same 4-byte packet
+ * format: address (128-135), command, value, checksum. The bus puts those bytes
+ * back together into packets and holds one pending packet per address and
+ * channel. A newer speed update for the same channel replaces the older one, so
+ * the dome cannot pile up packets ahead of the drive.
+ *
+ * A stop (a motor, drive or turn command with a value of 0) is urgent. It
+ * replaces anything pending for its channel and goes out before every other
+ * packet. Bytes that are not part of a packet pass through the ordinary queue.
+ */
+#ifndef __BLACBOX_MOTOR_BUS_H__
+#define __BLACBOX_MOTOR_BUS_H__
+
+#include "SerialQueue.h"
+
+const byte MOTORBUS_MAX_SLOTS       = 8;
+const byte MOTORBUS_FIRST_ADDRESS   = 128;
+const byte MOTORBUS_ADDRESS_COUNT   = 8;
+const unsigned long MOTORBUS_RATE_WINDOW = 1000;   // Milliseconds.
+
+typedef struct {
+  byte packet[4];
+  bool pending;
+  bool urgent;
+} Motor_Bus_Slot_Struct;
+
+/* ================================================================================
+ *                                 Motor Bus Class
+ * ================================================================================ */
+class MotorBus : public SerialQueue
+{
+  private:
+    Motor_Bus_Slot_Struct m_slots[MOTORBUS_MAX_SLOTS];
+    byte m_nextSlot;
+
+    byte m_packet[4];
+    byte m_packetLength;
+
+    uint16_t m_packetCount[MOTORBUS_ADDRESS_COUNT];
+    uint16_t m_packetRate[MOTORBUS_ADDRESS_COUNT];
+    unsigned long m_windowStart;
+    unsigned long m_coalesced;
+    unsigned long m_rejected;
+
+    void m_acceptPacket(void);
+    bool m_isStop(const byte packet[]);
+    bool m_sameChannel(const byte a[], const byte b[]);
+    static byte m_channel(byte command);
+    void m_sendSlot(byte slot);
+    void m_updateRates(void);
+
+  public:
+    MotorBus(Hal_SerialPort& port, byte buffer[], uint16_t size);
+    ~MotorBus(void);
+
+    virtual void drain(void);
+    virtual size_t write(byte value);
+    virtual size_t write(const byte* buffer, size_t length);
+
+    #if defined(ARDUINO)
+    using Print::write;
+    #endif
+
+    uint16_t packetRate(byte address);
+    unsigned long coalesced(void);
+    unsigned long rejected(void);
+};
+#endif
@@ -0,0 +1,132 @@
+/* =================================================================================
+ *    B.L.A.C.Box: Brian Lubkeman's Astromech Controller
+ * =================================================================================
+ * SerialQueue.cpp - Non-blocking outbound queue in front of a serial port
+ * Created by Brian Lubkeman, 16 June 2021
+ * Inspired by S.H.A.D.O.W. controller code written by KnightShade
+ * Released into the public domain.
+ */
+#include "SerialQueue.h"
+
+/* ================================================================================
+ *                               Serial Queue Class
+ * ================================================================================ */
+
+// =====================
+//      Constructor
+// =====================
+SerialQueue::SerialQueue(Hal_SerialPort& port, byte buffer[], uint16_t size)
+{
+  m_port = &port;
+  m_buffer = buffer;
+  m_size = size;
+  m_head = 0;
+  m_tail = 0;
+  m_count = 0;
+  resetCounters();
+}
+
+// ====================
+//      Destructor
+// ====================
+SerialQueue::~SerialQueue(void) {}
+
+// =================
+//      begin()
+// =================
+void SerialQueue::begin(unsigned long baudRate)
+{
+  m_port->begin(baudRate);
+}
+
+// =================
+//      write()
+// =================
+size_t SerialQueue::write(byte value)
+{
+  if ( m_count >= m_size ) {
+    m_dropped++;
+    return 0;
+  }
+  m_push(value);
+  return 1;
+}
+
+size_t SerialQueue::write(const byte* buffer, size_t length)
+{
+  // Keep commands whole. Drop the entire write when it does not fit.
+
+  if ( length > (size_t)(m_size - m_count) ) {
+    m_dropped += length;
+    return 0;
+  }
+  for (size_t i = 0; i < length; i++) {
+    m_push(buffer[i]);
+  }
+  return length;
+}
+
+// =================
+//      drain()
+// =================
+void SerialQueue::drain(void)
+{
+  // -------------------------------------------------------------
+  // Hand over only what the port can take without blocking. The
+  // port's own transmit interrupt sends it from there.
+  // -------------------------------------------------------------
+
+  int room = m_port->availableForWrite();
+
+  while ( m_count > 0 && room > 0 ) {
+    m_port->write(m_buffer[m_tail]);
+    m_tail = ( m_tail + 1 == m_size ? 0 : m_tail + 1 );
+    m_count--;
+    room--;
+  }
+}
+
+// =================
+//      flush()
+// =================
+void SerialQueue::flush(void)
+{
+  // Blocks until the queue is empty. Not for use inside the loop.
+
+  while ( m_count > 0 ) {
+    drain();
+  }
+}
+
+// ===================================
+//      Reads pass through untouched
+// ===================================
+int SerialQueue::available(void)  { return m_port->available(); }
+int SerialQueue::read(void)       { return m_port->read(); }
+int SerialQueue::peek(void)       { return m_port->peek(); }
+
+// ===================
+//      Counters
+// ===================
+uint16_t SerialQueue::depth(void)         { return m_count; }
+uint16_t SerialQueue::highWater(void)     { return m_highWater; }
+unsigned long SerialQueue::dropped(void)  { return m_dropped; }
+
+void SerialQueue::resetCounters(void)
+{
+  m_highWater = m_count;
+  m_dropped = 0;
+}
+
+// ==================
+//      m_push()
+// ==================
+void SerialQueue::m_push(byte value)
+{
+  m_buffer[m_head] = value;
+  m_head = ( m_head + 1 == m_size ? 0 : m_head + 1 );
+  m_count++;
+  if ( m_count > m_highWater ) {
+    m_highWater = m_count;
+  }
+}
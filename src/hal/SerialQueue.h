@@ -0,0 +1,63 @@
+/* =================================================================================
+ *    B.L.A.C.Box: Brian Lubkeman's Astromech Controller
+ * =================================================================================
+ * SerialQueue.h - Non-blocking outbound queue in front of a serial port
+ * Created by Brian Lubkeman, 16 June 2021
+ * Inspired by S.H.A.D.O.W. controller code written by KnightShade
+ * Released into the public domain.
+ * =================================================================================
+ *
+ * Writes go into a ring buffer and return at once. drain() moves only as many
+ * bytes into the port as its hardware buffer has room for, so the loop never
+ * waits on a slow link. A write that does not fit is dropped whole and counted,
+ * so a partial Marcduino or motor command is never sent. Reads pass straight
+ * through to the port.
+ */
+#ifndef __BLACBOX_SERIAL_QUEUE_H__
+#define __BLACBOX_SERIAL_QUEUE_H__
+
+#include "Hal.h"
+
+/* ================================================================================
+ *                               Serial Queue Class
+ * ================================================================================ */
+class SerialQueue : public Hal_Stream
+{
+  protected:
+    Hal_SerialPort* m_port;
+
+  private:
+    byte* m_buffer;
+    uint16_t m_size;
+    uint16_t m_head;
+    uint16_t m_tail;
+    uint16_t m_count;
+    uint16_t m_highWater;
+    unsigned long m_dropped;
+
+    void m_push(byte value);
+
+  public:
+    SerialQueue(Hal_SerialPort& port, byte buffer[], uint16_t size);
+    ~SerialQueue(void);
+
+    void begin(unsigned long baudRate);
+    virtual void drain(void);
+
+    virtual size_t write(byte value);
+    virtual size_t write(const byte* buffer, size_t length);
+    virtual int available(void);
+    virtual int read(void);
+    virtual int peek(void);
+    virtual void flush(void);
+
+    #if defined(ARDUINO)
+    using Print::write;
+    #endif
+
+    uint16_t depth(void);
+    uint16_t highWater(void);
+    unsigned long dropped(void);
+    void resetCounters(void);
+};
+#endif
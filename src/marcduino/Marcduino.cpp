@@ -6,9 +6,19 @@
  * Inspired by S.H.A.D.O.W. controller code written by KnightShade
  * Released into the public domain.
  */
-#include "Arduino.h"
+#include <string.h>
 #include "Marcduino.h"
 #include "Marcduino_Panel_Routines.h"
+#include "Marcduino_Command_Sets.h"
+
+Marcduino* Marcduino::anchor = NULL;
+
+// The base buttons, in the order of the command sets: index 0 is UP, 7 is SQUARE.
+
+const byte MARCDUINO_BASE_BUTTONS[8] = { UP, RIGHT, DOWN, LEFT, TRIANGLE, CIRCLE, CROSS, SQUARE };
+
+const uint32_t MARCDUINO_BASE_MASK = ((uint32_t)1 << UP) | ((uint32_t)1 << RIGHT) | ((uint32_t)1 << DOWN) | ((uint32_t)1 << LEFT)
+                                   | ((uint32_t)1 << TRIANGLE) | ((uint32_t)1 << CIRCLE) | ((uint32_t)1 << CROSS) | ((uint32_t)1 << SQUARE);
 
 /* ================================================================================
  *                               Marcduino Functions
@@ -16,15 +26,20 @@
 // =====================
 //      Constructor
 // =====================
-Marcduino::Marcduino(Controller* pController, const byte settings[])
+Marcduino::Marcduino(Controller* pController, const Config_Section* settings, Timeline* pTimeline)
+  : m_button(pController)
 {
   m_controller = pController;
   m_settings = settings;
-  m_button = &m_controller->button;
+  m_timeline = pTimeline;
+  anchor = this;
 
-  m_cprRunning = false;
   m_holoAutomationRunning = false;
   m_aurabesh = false;
+  m_domeRoutine = NULL;
+
+  m_command[0] = '\0';
+  m_commandLength = 0;
 }
 
 // ====================
@@ -37,32 +52,56 @@ Marcduino::~Marcduino() {}
 // =================
 void Marcduino::begin()
 {
+  // ---------------------------------------------------------
+  // Get our own copy of the button clicks from the controller.
+  // ---------------------------------------------------------
+
+  m_controller->subscribe(&m_button);
+
   // Start the Serial communication.
 
   MD_Dome_Serial.begin(MARCDUINO_BAUD_RATE);
-  if ( m_settings[iBodyMaster] ) {
+  if ( m_settings->get(iBodyMaster) ) {
     MD_Body_Serial.begin(MARCDUINO_BAUD_RATE);
   }
 
   #if defined(DEBUG)
-  if ( m_settings[iCmdSet] == 0 ) {
+  if ( m_settings->get(iCmdSet) == 0 ) {
     Debug.print(DBG_VERBOSE, F("Marcduino"), F("begin()"), F("Using SHADOW+MD command set"));
-  } else if ( m_settings[iCmdSet] == 1 ) {
+  } else if ( m_settings->get(iCmdSet) == 1 ) {
     Debug.print(DBG_VERBOSE, F("Marcduino"), F("begin()"), F("Using custom command set"));
   }
   #endif
+
+  // ----------------------------------------------------
+  // Start holoprojector automation if set to run from the
+  // start. Otherwise a button combo turns it on.
+  // ----------------------------------------------------
+
+  if ( m_settings->get(iHpAutomation) ) {
+    m_holoAutomationOn();
+  }
 }
 
 // ===============================
 //      interpretController()
 // ===============================
-void Marcduino::interpretController(void)
+void Marcduino::interpretController(const Input_Frame_Struct* frame)
 {
+  // ----------------------------------------------------------
+  // Work through one click event at a time. Only move on once
+  // every base button clicked in the current event is handled.
+  // ----------------------------------------------------------
+
+  if ( (m_button.clickedMask() & MARCDUINO_BASE_MASK) == 0 ) {
+    m_button.update();
+  }
+
   // ---------------------------------------
   // Do nothing when there is no controller.
   // ---------------------------------------
 
-  if ( m_controller->connectionStatus() == NONE ) {
+  if ( frame->connectionStatus == NONE ) {
     #if defined(DEBUG)
     Debug.print(DBG_VERBOSE, F("Marcduino"), F("interpretController()"), F("No controller"));
     #endif
@@ -77,119 +116,15 @@ void Marcduino::interpretController(void)
 
   #if defined(DEBUG)
   if ( m_buttonIndex > -1 ) {
-    Debug.print(DBG_VERBOSE, F("Marcduino"), F("interpretController()"), F("Button combo:"), (String)m_buttonIndex);
+    Debug.print(DBG_VERBOSE, F("Marcduino"), F("interpretController()"), F("Button combo:"), (long)m_buttonIndex);
   }
   #endif
 
-  if ( m_settings[iCmdSet] == 0 ) {
-
-    // These mappings should mimic the SHADOW+MD controls.
-
-    switch (m_buttonIndex) {
-      case 0 :  { quietMode();         break; } // UP
-      case 1 :  { m_midAwakeMode();    break; } // RIGHT
-      case 2 :  { m_fullAwakeMode();   break; } // DOWN
-      case 3 :  { m_awakePlusMode();   break; } // LEFT
-      case 4 :  { m_marchingAnts();    break; } // TRIANGLE
-      case 5 :  { m_bodyPanelClose(1); break; } // CIRCLE
-      case 6 :  { m_cantinaBeep();     break; } // CROSS
-      case 7 :  { m_bodyPanelOpen(1);  break; } // SQUARE
-      case 8 :  { m_leiaMessage();     break; } // L1/R1 + UP
-      case 9 :  { m_wave();            break; } // L1/R1 + RIGHT
-      case 10 : { m_cantinaDance();    break; } // L1/R1 + DOWN
-      case 11 : { m_wave2();           break; } // L1/R1 + LEFT
-      case 12 : { m_domePanelClose(1); break; } // L1/R1 + TRIANGLE
-      case 13 : { m_domePanelOpen(2);  break; } // L1/R1 + CIRCLE
-      case 14 : { m_domePanelOpen(1);  break; } // L1/R1 + CROSS
-      case 15 : { m_domePanelClose(2); break; } // L1/R1 + SQUARE
-      case 16 : { m_volumeUp();        break; } // SHARE/SELECT + UP
-      case 17 : { m_hpLightOn(0);      break; } // SHARE/SELECT + RIGHT
-      case 18 : { m_volumeDown();      break; } // SHARE/SELECT + DOWN
-      case 19 : { m_hpLightOff(0);     break; } // SHARE/SELECT + LEFT
-      case 20 : { m_volumeMid();       break; } // SHARE/SELECT + TRIANGLE
-      case 21 : { m_domePanelClose(0); break; } // SHARE/SELECT + CIRCLE
-      case 22 : { m_volumeMax();       break; } // SHARE/SELECT + CROSS
-      case 23 : { m_domePanelOpen(0);  break; } // SHARE/SELECT + SQUARE
-      case 24 : { m_disco();           break; } // OPTIONS/START + UP
-      case 25 : { m_fastWave();        break; } // OPTIONS/START + RIGHT
-      case 26 : { m_scream();          break; } // OPTIONS/START + DOWN
-      case 27 : { m_faint();           break; } // OPTIONS/START + LEFT
-      case 28 : { m_hpReset(0);        break; } // OPTIONS/START + TRIANGLE
-      case 29 : { m_hpLightOn(0);      break; } // OPTIONS/START + CIRCLE
-      case 30 : { m_hpRandomMove(0);   break; } // OPTIONS/START + CROSS
-      case 31 : { m_hpLightOff(0);     break; } // OPTIONS/START + SQUARE
-      case 32 : {                               // PS/PS2 + UP
-                  m_soundPlayTrack(8, 8);
-                  m_logicsStarWars();
-                  break; }
-      case 33 : {                               // PS/PS2 + RIGHT
-                  m_soundPlayTrack(8, 9);
-                  m_logicsReset(0);
-                  break; }
-      case 34 : {                               // PS/PS2 + DOWN
-                  m_soundPlayTrack(8, 10);
-                  m_logicsReset(0);
-                  break; }
-      case 35 : {                               // PS/PS2 + LEFT
-                  m_soundPlayTrack(8, 11);
-                  m_logicsReset(0);
-                  break; }
-      case 36 : { m_domePanelClose(3); break; } // PS/PS2 + TRIANGLE
-      case 37 : { m_domePanelOpen(4);  break; } // PS/PS2 + CIRCLE
-      case 38 : { m_domePanelOpen(3);  break; } // PS/PS2 + CROSS
-      case 39 : { m_domePanelClose(4); break; } // PS/PS2 + SQUARE
-      default : { break; }
-    }
-
-  } else if ( m_settings[iCmdSet] == 1 ) {
-
-    // This is where you may define your own button combo mappings.
-
-    switch (m_buttonIndex) {
-      case 0 :  { quietMode();             break; } // UP
-      case 1 :  { m_midAwakeMode();        break; } // RIGHT
-      case 2 :  { m_fullAwakeMode();       break; } // DOWN
-      case 3 :  { m_awakePlusMode();       break; } // LEFT
-      case 4 :  {                          break; } // TRIANGLE
-      case 5 :  {                          break; } // CIRCLE
-      case 6 :  {                          break; } // CROSS
-      case 7 :  {                          break; } // SQUARE
-      case 8 :  { m_volumeUp();            break; } // L1/R1 + UP
-      case 9 :  { m_hpReset(0);            break; } // L1/R1 + RIGHT
-      case 10 : { m_volumeDown();          break; } // L1/R1 + DOWN
-      case 11 : { m_hpRandomMove(0);       break; } // L1/R1 + LEFT
-      case 12 : { m_volumeMid();           break; } // L1/R1 + TRIANGLE
-      case 13 : { m_hpLightOn(0);          break; } // L1/R1 + CIRCLE
-      case 14 : { m_volumeMax();           break; } // L1/R1 + CROSS
-      case 15 : { m_hpLightOff(0);         break; } // L1/R1 + SQUARE
-      case 16 : { m_soundPlayTrack(1, 22); break; } // SHARE/SELECT + UP        : 022_Chatter-22.mp3
-      case 17 : { m_soundPlayTrack(2, 9);  break; } // SHARE/SELECT + RIGHT     : 034_Idle-09.mp3
-      case 18 : { m_soundPlayTrack(3, 6);  break; } // SHARE/SELECT + DOWN      : 056_Acknowledge-06.mp3
-      case 19 : { m_soundPlayTrack(4, 1);  break; } // SHARE/SELECT + LEFT      : 076_Engage-01.mp3
-      case 20 : { m_soundPlayTrack(1, 25); break; } // SHARE/SELECT + TRIANGLE  : 025_Chatter-25.mp3
-      case 21 : { m_soundPlayTrack(2, 17); break; } // SHARE/SELECT + CIRCLE    : 042_Idle-17.mp3
-      case 22 : { m_soundPlayTrack(3, 20); break; } // SHARE/SELECT + CROSS     : 070_ActionComplete-09.mp3
-      case 23 : { m_soundPlayTrack(7, 15); break; } // SHARE/SELECT + SQUARE    : 165_ThreatWarning-04.mp3
-      case 24 : { m_soundPlayTrack(4, 17); break; } // OPTIONS/START + UP       : 092_Alert-03.mp3
-      case 25 : { m_soundPlayTrack(8, 1);  break; } // OPTIONS/START + RIGHT    : 176_ImperialMarch.mp3
-      case 26 : { m_soundPlayTrack(6, 4);  break; } // OPTIONS/START + DOWN     : 129_Hurt-04.mp3
-      case 27 : { m_soundPlayTrack(8, 2);  break; } // OPTIONS/START + LEFT     : 177_DuelOfTheFates.mp3
-      case 28 : { m_soundPlayTrack(4, 22); break; } // OPTIONS/START + TRIANGLE : 097_Atack-01.mp3
-      case 29 : { m_soundPlayTrack(8, 3);  break; } // OPTIONS/START + CIRCLE   : 178_ImperialSuite.mp3
-      case 30 : { m_soundPlayTrack(7, 3);  break; } // OPTIONS/START + CROSS    : 153_Pain-03.mp3
-      case 31 : { m_soundPlayTrack(8, 4);  break; } // OPTIONS/START + SQUARE   : 179_GnRScream.mp3
-      case 32 : { m_bodyPanelOpen(1);      break; } // PS/PS2 + UP
-      case 33 : { m_bodyPanelClose(2);     break; } // PS/PS2 + RIGHT
-      case 34 : { m_bodyPanelClose(1);     break; } // PS/PS2 + DOWN
-      case 35 : { m_bodyPanelOpen(2);      break; } // PS/PS2 + LEFT
-      case 36 : {                          break; } // PS/PS2 + TRIANGLE
-      case 37 : {                          break; } // PS/PS2 + CIRCLE
-      case 38 : {                          break; } // PS/PS2 + CROSS
-      case 39 : {                          break; } // PS/PS2 + SQUARE
-      default : { break; }
-    }
+  if ( m_buttonIndex < 0 ) {
+    return;
+  }
 
-  } else {
+  if ( m_settings->get(iCmdSet) >= MARCDUINO_COMMAND_SETS ) {
 
     // Unknown command set setting.
 
@@ -199,6 +134,117 @@ void Marcduino::interpretController(void)
 
     return;
   }
+
+  // --------------------------------------------------
+  // Look up the combo in the command set and run it.
+  // --------------------------------------------------
+
+  Marcduino_Action_Struct entry;
+  memcpy_P(&entry, &marcduinoCommandSets[m_settings->get(iCmdSet)][m_buttonIndex], sizeof(entry));
+  runAction(entry.action, entry.arg1, entry.arg2);
+}
+
+// =====================
+//      runAction()
+// =====================
+void Marcduino::runAction(byte action, byte arg1, byte arg2)
+{
+  switch (action) {
+    case aSequence :         { m_runSequence(arg1);           break; }
+    case aBodyPanelOpen :    { m_bodyPanelOpen(arg1);         break; }
+    case aBodyPanelClose :   { m_bodyPanelClose(arg1);        break; }
+    case aDomePanelOpen :    { m_domePanelOpen(arg1);         break; }
+    case aDomePanelClose :   { m_domePanelClose(arg1);        break; }
+    case aHpLightOn :        { m_hpLightOn(arg1);             break; }
+    case aHpLightOff :       { m_hpLightOff(arg1);            break; }
+    case aHpReset :          { m_hpReset(arg1);               break; }
+    case aHpRandomMove :     { m_hpRandomMove(arg1);          break; }
+    case aVolumeUp :         { m_volumeUp();                  break; }
+    case aVolumeDown :       { m_volumeDown();                break; }
+    case aVolumeMid :        { m_volumeMid();                 break; }
+    case aVolumeMax :        { m_volumeMax();                 break; }
+    case aSound :            { m_soundPlayTrack(arg1, arg2);  break; }
+    case aSoundStarWars :    {
+                               m_soundPlayTrack(arg1, arg2);
+                               m_logicsStarWars();
+                               break; }
+    case aSoundLogicsReset : {
+                               m_soundPlayTrack(arg1, arg2);
+                               m_logicsReset(0);
+                               break; }
+    case aDomeRoutine :      {
+                               if ( m_domeRoutine != NULL ) {
+                                 m_domeRoutine(arg1);
+                               }
+                               break; }
+    case aSequenceBody :     { m_runSequenceBody(arg1);       break; }
+    case aPanelRoutine :     { m_startPanelRoutine(arg1);     break; }
+    case aPanelStepOpen :
+    case aPanelStepClose :   { m_runPanelStep(action, arg1, arg2); break; }
+    case aHoloAutomationOn : { m_holoAutomationOn();          break; }
+    case aHoloAutomationOff :{ m_holoAutomationOff();         break; }
+    case aHoloStep :         { m_holoStep(arg1);              break; }
+    case aQuiet :            { quietMode();                   break; }
+    default :                { break; }
+  }
+}
+
+// ==========================
+//      runActionLater()
+// ==========================
+bool Marcduino::runActionLater(unsigned long delay, byte action, byte arg1, byte arg2)
+{
+  // Put the action on the show timeline. quietMode() cancels
+  // anything still waiting.
+
+  if ( m_timeline == NULL ) {
+    return false;
+  }
+  return m_timeline->schedule(delay, m_onTimeline, action, arg1, arg2, tagMarcduino);
+}
+
+// =======================
+//      sendCommand()
+// =======================
+void Marcduino::sendCommand(const char* command, byte location)
+{
+  // Send a command as typed, such as ":SE01" or "$87", adding the
+  // carriage return that ends it. :CPRn still starts a panel routine.
+
+  strncpy(m_command, command, MARCDUINO_CMD_SIZE - 2);
+  m_command[MARCDUINO_CMD_SIZE - 2] = '\0';
+  m_commandLength = strlen(m_command);
+
+  if ( m_commandLength == 0 ) {
+    return;
+  }
+  if ( m_command[m_commandLength - 1] != '\r' ) {
+    m_command[m_commandLength++] = '\r';
+    m_command[m_commandLength] = '\0';
+  }
+
+  m_sendCommand(m_command, ( location == BODY_PANEL ? &MD_Body_Serial : &MD_Dome_Serial ));
+}
+
+// ========================
+//      m_onTimeline()
+// ========================
+void Marcduino::m_onTimeline(byte action, byte arg1, byte arg2)
+{
+  if ( anchor != NULL ) {
+    anchor->runAction(action, arg1, arg2);
+  }
+}
+
+// =============================
+//      attachDomeRoutine()
+// =============================
+void Marcduino::attachDomeRoutine(Marcduino_Routine_Callback callback)
+{
+  // The dome motor plays its own routines. This hands it the
+  // routine number when a combo asks for one.
+
+  m_domeRoutine = callback;
 }
 
 // ===============================
@@ -206,36 +252,36 @@ void Marcduino::interpretController(void)
 // ===============================
 int Marcduino::m_getButtonsPressed(void)
 {
-  int baseButton = -1;
+  // ---------------------------------------------------------
+  // Take the first base button clicked, in the order UP, RIGHT,
+  // DOWN, LEFT, TRIANGLE, CIRCLE, CROSS, SQUARE. Stop if none.
+  // ---------------------------------------------------------
 
-  // ------------------------------
-  // Look for pressed base buttons.
-  // Stop when none are pressed.
-  // ------------------------------
+  uint32_t clicks = m_button.clickedMask();
+  int baseButton = -1;
 
-  if ( m_button->clicked(UP) )            { baseButton = 0; }
-  else if ( m_button->clicked(RIGHT) )    { baseButton = 1; }
-  else if ( m_button->clicked(DOWN) )     { baseButton = 2; }
-  else if ( m_button->clicked(LEFT) )     { baseButton = 3; }
-  else if ( m_button->clicked(TRIANGLE) ) { baseButton = 4; }
-  else if ( m_button->clicked(CIRCLE) )   { baseButton = 5; }
-  else if ( m_button->clicked(CROSS) )    { baseButton = 6; }
-  else if ( m_button->clicked(SQUARE) )   { baseButton = 7; }
-  else {
-    return baseButton;
+  for (byte i = 0; i < 8; i++) {
+    if ( clicks & ((uint32_t)1 << MARCDUINO_BASE_BUTTONS[i]) ) {
+      baseButton = i;
+      break;
+    }
+  }
+  if ( baseButton < 0 ) {
+    return -1;
   }
+  m_button.clicked(MARCDUINO_BASE_BUTTONS[baseButton]);
 
-  // ----------------------------------
-  // Look for pressed modifier buttons.
-  // ----------------------------------
+  // ---------------------------------------------------------
+  // Look for modifier buttons held at the time of the click.
+  // ---------------------------------------------------------
 
+  uint32_t held = m_button.heldMask();
   int modifier = 0;
 
-  if ( m_button->pressed(L1) || 
-       m_button->pressed(R1) )      { modifier = 8;  }
-  else if ( m_button->pressed(L4) ) { modifier = 16; }
-  else if ( m_button->pressed(R4) ) { modifier = 24; }
-  else if ( m_button->pressed(PS) ) { modifier = 32; }
+  if ( held & (((uint32_t)1 << L1) | ((uint32_t)1 << R1)) ) { modifier = 8;  }
+  else if ( held & ((uint32_t)1 << L4) )                    { modifier = 16; }
+  else if ( held & ((uint32_t)1 << R4) )                    { modifier = 24; }
+  else if ( held & ((uint32_t)1 << PS) )                    { modifier = 32; }
 
   // ----------------------------
   // Return the calculated index.
@@ -247,31 +293,44 @@ int Marcduino::m_getButtonsPressed(void)
 // =========================
 //      m_sendCommand()
 // =========================
-void Marcduino::m_sendCommand(String inStr, HardwareSerial* targetSerial)
+void Marcduino::m_sendCommand(const char* inStr, SerialQueue* targetSerial)
 {
+  // --------------------------------------------------------
+  // Work on the command buffer so a custom panel routine can
+  // be cut out of the command without touching the caller.
+  // --------------------------------------------------------
+
+  if ( inStr != m_command ) {
+    strncpy(m_command, inStr, MARCDUINO_CMD_SIZE - 1);
+    m_command[MARCDUINO_CMD_SIZE - 1] = '\0';
+    m_commandLength = strlen(m_command);
+  }
+
   // ----------------------------------------------------------
   // Handle the special case of running a custom panel routine.
   // ----------------------------------------------------------
 
-  int pos = inStr.indexOf(":CPR");
-  if ( pos > -1 ) {
-    // Determine which custom panel routine to run.
-    switch (inStr.substring(pos+4, pos+5).toInt()) {
-      case 1:
-        m_startCustomPanelRoutine(sampleRoutine, sizeof(sampleRoutine));
-        break;
-      default:
-        return;
+  char* cpr = strstr(m_command, ":CPR");
+  if ( cpr != NULL ) {
+    // Determine which custom panel routine to run, from up to two digits.
+    byte routineNumber = 0;
+    for (byte i = 4; i < 6 && cpr[i] >= '0' && cpr[i] <= '9'; i++) {
+      routineNumber = (routineNumber * 10) + (cpr[i] - '0');
     }
-    // Remove the custom panel routine from the command.
-    inStr.remove(pos, 8);
+    m_startPanelRoutine(routineNumber);
+
+    // Remove the custom panel routine, through its carriage return, from the command.
+    char* next = strchr(cpr, '\r');
+    next = ( next == NULL ? cpr + strlen(cpr) : next + 1 );
+    memmove(cpr, next, strlen(next) + 1);
+    m_commandLength = strlen(m_command);
   }
 
   // --------------------------------------------------------------------
   // Stop when no command remains. Otherwise, continue with what remains.
   // --------------------------------------------------------------------
 
-  if ( inStr == "" ) {
+  if ( m_commandLength == 0 ) {
     return;
   }
 
@@ -280,153 +339,288 @@ void Marcduino::m_sendCommand(String inStr, HardwareSerial* targetSerial)
   //  or a Feather Radio (wireless) connection to the dome.
   // --------------------------------------------------------------
 
-  if ( m_settings[iRadio] ) {
+  if ( m_settings->get(iRadio) ) {
   
     if ( targetSerial == &MD_Dome_Serial ) {
 
       // Send one character at a time to the Feather Radio.
-      for (int i=0; i<inStr.length(); i++) {
-        targetSerial->write(inStr[i]);
+      for (byte i = 0; i < m_commandLength; i++) {
+        targetSerial->write(m_command[i]);
       }
 
       #if defined(DEBUG)
-      String msg = inStr + F(" to dome via Feather Radio");
-      char buff[50];
-      msg.toCharArray(buff, 50);
-      Debug.print(DBG_INFO, F("Marcduino"), F("m_sendCommand()"), buff);
+      Debug.print(DBG_INFO, F("Marcduino"), F("m_sendCommand()"), F("To dome via Feather Radio:"), m_command);
       #endif
   
       return;
     }
   }
 
-  targetSerial->print(inStr);
+  targetSerial->write((const uint8_t*)m_command, m_commandLength);
 
   #if defined(DEBUG)
-  String msg = inStr;
   if ( targetSerial == &MD_Dome_Serial ) {
-    msg += F(" to dome via Serial");
+    Debug.print(DBG_INFO, F("Marcduino"), F("m_sendCommand()"), F("To dome via Serial:"), m_command);
   } else if ( targetSerial == &MD_Body_Serial ) {
-    msg += F(" to body via Serial");
+    Debug.print(DBG_INFO, F("Marcduino"), F("m_sendCommand()"), F("To body via Serial:"), m_command);
   }
-  char buff[50];
-  msg.toCharArray(buff, 50);
-  Debug.print(DBG_INFO, F("Marcduino"), F("m_sendCommand()"), buff);
   #endif
 }
 
+// =====================
+//      m_sendSound()
+// =====================
+void Marcduino::m_sendSound(const char* inStr)
+{
+  if ( m_settings->get(iSoundMaster) == 1 ) {
+    m_sendCommand(inStr, &MD_Body_Serial);
+  } else {
+    m_sendCommand(inStr, &MD_Dome_Serial);
+  }
+}
+
 // ==================================
 //      Holoprojector Automation
 // ==================================
-void Marcduino::runAutomation(void)
+byte Marcduino::m_holoCount(void)
+{
+  return min((byte)m_settings->get(iHp), MARCDUINO_MAX_HP);
+}
+void Marcduino::m_holoAutomationOn(void)
+{
+  // ----------------------------------------------------------------
+  // Each holoprojector keeps one event on the timeline, due when it
+  // should act next. Nothing runs, and nothing is checked, in between.
+  // ----------------------------------------------------------------
+
+  if ( m_holoAutomationRunning || m_timeline == NULL ) {
+    return;
+  }
+
+  if ( m_holoCount() > m_timeline->available() ) {
+    #if defined(DEBUG)
+    Debug.print(DBG_WARNING, F("Marcduino"), F("m_holoAutomationOn()"), F("No room on the timeline"));
+    #endif
+    return;
+  }
+
+  m_holoAutomationRunning = true;
+  for (byte hp = 1; hp <= m_holoCount(); hp++) {
+    m_holoSchedule(hp, 0);
+  }
+
+  #if defined(DEBUG)
+  Debug.print(DBG_INFO, F("Marcduino"), F("m_holoAutomationOn()"), F("Holoprojector automation"), F("enabled."));
+  #endif
+}
+void Marcduino::m_holoAutomationOff(void)
 {
   if ( ! m_holoAutomationRunning ) {
     return;
   }
 
-  unsigned long currentTime;
-  for (int hp = 0; hp < m_settings[iHp]; hp++) {
+  m_holoAutomationRunning = false;
+  if ( m_timeline != NULL ) {
+    m_timeline->cancel(tagHolo);
+  }
 
-    // -----------------------------------------------------
-    // Set the random delay interval for this holoprojector.
-    // -----------------------------------------------------
+  #if defined(DEBUG)
+  Debug.print(DBG_INFO, F("Marcduino"), F("m_holoAutomationOff()"), F("Holoprojector automation"), F("disabled."));
+  #endif
+}
+bool Marcduino::m_holoSchedule(byte hpNumber, unsigned long extraTime)
+{
+  // Wait a random number of seconds, plus any time the last effect is still playing.
 
-    if (m_randomSeconds[hp] == 0) {
-      m_randomSeconds[hp] = random(m_settings[iHpDelayMin], m_settings[iHpDelayMax] + 1) * 1000;
-    }
+  unsigned long delay = random(m_settings->get(iHpDelayMin), m_settings->get(iHpDelayMax) + 1) * 1000UL;
+  return m_timeline->schedule(delay + extraTime, m_onTimeline, aHoloStep, hpNumber, 0, tagHolo);
+}
+void Marcduino::m_holoStep(byte hpNumber)
+{
+  if ( ! m_holoAutomationRunning || hpNumber == 0 || hpNumber > m_holoCount() ) {
+    return;
+  }
 
-    // --------------------------------------------------------------
-    // Move both horizontal and vertical servos to a random position.
-    // --------------------------------------------------------------
+  // ---------------------------------------------------------------
+  // Pick a behavior by weight. A flicker or on-board sequence plays
+  // for a while, so this holoprojector waits that much longer.
+  // ---------------------------------------------------------------
 
-    currentTime = millis();
-    if (currentTime > (m_lastRandomTime[hp] + m_randomSeconds[hp])) {
-      m_lastRandomTime[hp] = currentTime;
-      m_randomSeconds[hp] = 0;
-      m_hpRandomMove(hp);
-    }
+  int moveWeight    = m_settings->get(iHpMoveWeight);
+  int flickerWeight = m_settings->get(iHpFlickerWeight);
+  int onBoardWeight = m_settings->get(iHpOnBoardWeight);
+  int total = moveWeight + flickerWeight + onBoardWeight;
+
+  unsigned long extraTime = 0;
+  int pick = ( total > 0 ? random(total) : 0 );
+
+  if ( pick < moveWeight || total == 0 ) {
+    m_hpRandomMove(hpNumber);
+  } else if ( pick < moveWeight + flickerWeight ) {
+    m_hpFlicker(hpNumber, m_settings->get(iHpEffectTime));
+    extraTime = m_settings->get(iHpEffectTime) * 1000UL;
+  } else {
+    m_hpOnBoard(hpNumber, m_settings->get(iHpEffectTime));
+    extraTime = m_settings->get(iHpEffectTime) * 1000UL;
   }
+
+  // This event just left the timeline, so there is always room for the next.
+
+  m_holoSchedule(hpNumber, extraTime);
 }
 
 // ===============================
 //      Custom Panel Routines
 // ===============================
-bool Marcduino::isCustomPanelRunning(void)
-{
-  return m_cprRunning;
-}
-void Marcduino::runCustomPanelRoutine()
+bool Marcduino::m_startPanelRoutine(byte routineNumber)
 {
-  for (int i = 0; i < m_cprRowCount; i++) {
+  // ------------------------------------------------------------------
+  // Routines are numbered from 1. Each step gets one event on the
+  // timeline for its open. The open then schedules its own close, so a
+  // routine never needs more room than it has steps.
+  // ------------------------------------------------------------------
 
-    if ( m_cprRunningRoutine[i].completed ) {
-      continue;
-    }
+  if ( routineNumber == 0 || routineNumber > MARCDUINO_PANEL_ROUTINE_COUNT || m_timeline == NULL ) {
+    #if defined(DEBUG)
+    Debug.print(DBG_WARNING, F("Marcduino"), F("m_startPanelRoutine()"), F("No routine "), (long)routineNumber);
+    #endif
+    return false;
+  }
 
-    unsigned long currentTime = millis();
-    if ( currentTime <= (m_cprStartTime + m_cprRunningRoutine[i].startDelay) ) {
-      m_sendCommand(m_cprBuilCommand(":OP", m_cprRunningRoutine[i].panelNbr), &MD_Dome_Serial);
-      m_cprRunningRoutine[i].startedTime = currentTime;
-    } else if ( currentTime <= (m_cprRunningRoutine[i].startedTime + m_cprRunningRoutine[i].openDuration) ) {
-      m_sendCommand(m_cprBuilCommand(":CL", m_cprRunningRoutine[i].panelNbr), &MD_Dome_Serial);
-      m_cprRunningRoutine[i].completed = true;
-      m_cprCompletedCount++;
-    }
+  Panel_Routine_Struct routine;
+  memcpy_P(&routine, &marcduinoPanelRoutines[routineNumber - 1], sizeof(routine));
 
+  if ( routine.count > m_timeline->available() ) {
+    #if defined(DEBUG)
+    Debug.print(DBG_WARNING, F("Marcduino"), F("m_startPanelRoutine()"), F("No room on the timeline"));
+    #endif
+    return false;
   }
 
-  if ( m_cprCompletedCount == m_cprRowCount ) {
-    m_cprRunning = false;
+  for (byte i = 0; i < routine.count; i++) {
+    Panel_Step_Struct step;
+    memcpy_P(&step, &routine.steps[i], sizeof(step));
+    m_timeline->schedule(step.startDelay, m_onTimeline, aPanelStepOpen, routineNumber, i, tagPanelRoutine);
   }
+
+  #if defined(DEBUG)
+  Debug.print(DBG_VERBOSE, F("Marcduino"), F("m_startPanelRoutine()"), F("Routine "), (long)routineNumber);
+  #endif
+
+  return true;
 }
-void Marcduino::m_startCustomPanelRoutine(Panel_Routine_Struct routine[], int arraySize)
+void Marcduino::m_runPanelStep(byte action, byte routineNumber, byte step)
 {
-  if ( ! m_cprRunning ) {
-    m_cprRunning = true;
-    m_cprStartTime = millis();
-    m_cprCompletedCount = 0;
-    for (int i = 0; i < m_cprRowCount; i++) {
-      routine[i].startedTime = 0;
-      routine[i].completed = false;
-    }
-    m_cprRunningRoutine = routine;
-    m_cprRowCount = arraySize;
+  if ( routineNumber == 0 || routineNumber > MARCDUINO_PANEL_ROUTINE_COUNT ) {
+    return;
   }
-}
-String Marcduino::m_cprBuilCommand(String prefix, int panelNbr)
-{
-  if ( prefix != ":OP" && prefix != ":CL") {
-    return "";
+
+  Panel_Routine_Struct routine;
+  memcpy_P(&routine, &marcduinoPanelRoutines[routineNumber - 1], sizeof(routine));
+  if ( step >= routine.count ) {
+    return;
   }
 
-  String xx = "0";
-  xx += panelNbr;
+  Panel_Step_Struct row;
+  memcpy_P(&row, &routine.steps[step], sizeof(row));
 
-  String cmd = prefix;
-  cmd += xx.substring(xx.length()-2, xx.length()-1);
-  cmd += "\r";
+  if ( action == aPanelStepOpen ) {
 
-  return cmd;
-}
+    // The open just left the timeline, so there is always room for its close.
+
+    if ( row.location == BODY_PANEL ) {
+      m_bodyPanelOpen(row.panel);
+    } else {
+      m_domePanelOpen(row.panel);
+    }
+    m_timeline->schedule(row.openTime, m_onTimeline, aPanelStepClose, routineNumber, step, tagPanelRoutine);
 
+  } else {
+
+    if ( row.location == BODY_PANEL ) {
+      m_bodyPanelClose(row.panel);
+    } else {
+      m_domePanelClose(row.panel);
+    }
+  }
+}
+// ===================================================================================================
+// ===================================================================================================
+//
+// Command encoder
+//    Commands are assembled in a fixed buffer. Prefixes stay in flash and numbers are formatted in
+//    place, so sending a command never touches the heap.
+//
 // ===================================================================================================
 // ===================================================================================================
 
-String Marcduino::m_leftPad(uint8_t n, char c = '0', uint8_t width = 2)
+void Marcduino::m_cmdStart(PGM_P text)
 {
-  String out;
-  for (int i = 0; i < width; i++) {
-    out += c;
+  m_commandLength = 0;
+  m_command[0] = '\0';
+  m_cmdAppend(text);
+}
+void Marcduino::m_cmdAppend(PGM_P text)
+{
+  char c;
+  while ( m_commandLength < MARCDUINO_CMD_SIZE - 2 && (c = pgm_read_byte(text++)) != '\0' ) {
+    m_command[m_commandLength++] = c;
   }
-  out += n;
-  out.remove(0, out.length()-width);
-  return out;
+  m_command[m_commandLength] = '\0';
+}
+void Marcduino::m_cmdText(const char* text)
+{
+  while ( m_commandLength < MARCDUINO_CMD_SIZE - 2 && *text != '\0' ) {
+    m_command[m_commandLength++] = *text++;
+  }
+  m_command[m_commandLength] = '\0';
+}
+void Marcduino::m_cmdNumber(uint8_t n, uint8_t width)
+{
+  // ------------------------------------------------------------
+  // A width of zero writes only the digits needed. Otherwise the
+  // number is zero padded and, like before, only the last digits
+  // that fit the width are kept.
+  // ------------------------------------------------------------
+
+  char digits[3];
+  uint8_t count = 0;
+  do {
+    digits[count++] = '0' + (n % 10);
+    n /= 10;
+  } while ( n > 0 && count < 3 );
+
+  if ( width == 0 ) {
+    width = count;
+  }
+
+  for (uint8_t i = width; i > 0 && m_commandLength < MARCDUINO_CMD_SIZE - 2; i--) {
+    m_command[m_commandLength++] = ( i <= count ? digits[i - 1] : '0' );
+  }
+  m_command[m_commandLength] = '\0';
+}
+const char* Marcduino::m_cmdEnd(void)
+{
+  m_command[m_commandLength++] = '\r';
+  m_command[m_commandLength] = '\0';
+  return m_command;
+}
+const char* Marcduino::m_encode(PGM_P prefix, uint8_t n, uint8_t width)
+{
+  m_cmdStart(prefix);
+  m_cmdNumber(n, width);
+  return m_cmdEnd();
+}
+const char* Marcduino::m_encode(PGM_P command)
+{
+  m_cmdStart(command);
+  return m_cmdEnd();
 }
 
-bool Marcduino::m_inList(const uint8_t valueToFind, const uint8_t list[])
+bool Marcduino::m_inList(const uint8_t valueToFind, const uint8_t list[], size_t count)
 {
   bool out = false;
-  for (size_t i = 0; i < sizeof(list); i++ ) {
+  for (size_t i = 0; i < count; i++ ) {
     if ( list[i] == valueToFind ) {
       out = true;
       break;
@@ -446,53 +640,53 @@ bool Marcduino::m_inList(const uint8_t valueToFind, const uint8_t list[])
 
 void Marcduino::m_bodyPanelOpen(uint8_t panelNumber) 
 {
-  if ( panelNumber > m_settings[iBodyPanels] ) { return; }
-  m_sendCommand(String(":OP" + m_leftPad(panelNumber) + '\r'), &MD_Body_Serial);
+  if ( panelNumber > m_settings->get(iBodyPanels) ) { return; }
+  m_sendCommand(m_encode(PSTR(":OP"), panelNumber, 2), &MD_Body_Serial);
 }
 void Marcduino::m_bodyPanelClose(uint8_t panelNumber)
 {
-  if ( panelNumber > m_settings[iBodyPanels] ) { return; }
-  m_sendCommand(String(":CL" + m_leftPad(panelNumber) + '\r'), &MD_Body_Serial);
+  if ( panelNumber > m_settings->get(iBodyPanels) ) { return; }
+  m_sendCommand(m_encode(PSTR(":CL"), panelNumber, 2), &MD_Body_Serial);
 }
 void Marcduino::m_bodyPanelRemoteControl(uint8_t panelNumber)
 {
-  if ( panelNumber > m_settings[iBodyPanels] ) { return; }
-  m_sendCommand(String(":RC" + m_leftPad(panelNumber) + '\r'), &MD_Body_Serial);
+  if ( panelNumber > m_settings->get(iBodyPanels) ) { return; }
+  m_sendCommand(m_encode(PSTR(":RC"), panelNumber, 2), &MD_Body_Serial);
 }
 void Marcduino::m_bodyPanelBuzzKill(uint8_t panelNumber)
 {
-  if ( panelNumber > m_settings[iBodyPanels] ) { return; }
-  m_sendCommand(String(":ST" + m_leftPad(panelNumber) + '\r'), &MD_Body_Serial);
+  if ( panelNumber > m_settings->get(iBodyPanels) ) { return; }
+  m_sendCommand(m_encode(PSTR(":ST"), panelNumber, 2), &MD_Body_Serial);
 }
 void Marcduino::m_bodyPanelHold(uint8_t panelNumber)
 {
-  if ( panelNumber > m_settings[iBodyPanels] ) { return; }
-  m_sendCommand(String(":HD" + m_leftPad(panelNumber) + '\r'), &MD_Body_Serial);
+  if ( panelNumber > m_settings->get(iBodyPanels) ) { return; }
+  m_sendCommand(m_encode(PSTR(":HD"), panelNumber, 2), &MD_Body_Serial);
 }
 void Marcduino::m_domePanelOpen(uint8_t panelNumber) 
 {
-  if ( panelNumber > m_settings[iDomePanels] ) { return; }
-  m_sendCommand(String(":OP" + m_leftPad(panelNumber) + '\r'), &MD_Dome_Serial);
+  if ( panelNumber > m_settings->get(iDomePanels) ) { return; }
+  m_sendCommand(m_encode(PSTR(":OP"), panelNumber, 2), &MD_Dome_Serial);
 }
 void Marcduino::m_domePanelClose(uint8_t panelNumber)
 {
-  if ( panelNumber > m_settings[iDomePanels] ) { return; }
-  m_sendCommand(String(":CL" + m_leftPad(panelNumber) + '\r'), &MD_Dome_Serial);
+  if ( panelNumber > m_settings->get(iDomePanels) ) { return; }
+  m_sendCommand(m_encode(PSTR(":CL"), panelNumber, 2), &MD_Dome_Serial);
 }
 void Marcduino::m_domePanelRemoteControl(uint8_t panelNumber)
 {
-  if ( panelNumber > m_settings[iDomePanels] ) { return; }
-  m_sendCommand(String(":RC" + m_leftPad(panelNumber) + '\r'), &MD_Dome_Serial);
+  if ( panelNumber > m_settings->get(iDomePanels) ) { return; }
+  m_sendCommand(m_encode(PSTR(":RC"), panelNumber, 2), &MD_Dome_Serial);
 }
 void Marcduino::m_domePanelBuzzKill(uint8_t panelNumber)
 {
-  if ( panelNumber > m_settings[iDomePanels] ) { return; }
-  m_sendCommand(String(":ST" + m_leftPad(panelNumber) + '\r'), &MD_Dome_Serial);
+  if ( panelNumber > m_settings->get(iDomePanels) ) { return; }
+  m_sendCommand(m_encode(PSTR(":ST"), panelNumber, 2), &MD_Dome_Serial);
 }
 void Marcduino::m_domePanelHold(uint8_t panelNumber)
 {
-  if ( panelNumber > m_settings[iDomePanels] ) { return; }
-  m_sendCommand(String(":HD" + m_leftPad(panelNumber) + '\r'), &MD_Dome_Serial);
+  if ( panelNumber > m_settings->get(iDomePanels) ) { return; }
+  m_sendCommand(m_encode(PSTR(":HD"), panelNumber, 2), &MD_Dome_Serial);
 }
 
 // ===================================================================================================
@@ -507,43 +701,49 @@ void Marcduino::m_domePanelHold(uint8_t panelNumber)
 
 void Marcduino::m_hpRandomMove(uint8_t hpNumber)
 {
-  if ( hpNumber > m_settings[iHp] ) { return; }
-  m_sendCommand(String("*RD" + m_leftPad(hpNumber) + '\r'), &MD_Dome_Serial);
+  if ( hpNumber > m_settings->get(iHp) ) { return; }
+  m_sendCommand(m_encode(PSTR("*RD"), hpNumber, 2), &MD_Dome_Serial);
 }
 void Marcduino::m_hpLightOn(uint8_t hpNumber)
 {
-  if ( hpNumber > m_settings[iHp] ) { return; }
-  m_sendCommand(String("*ON" + m_leftPad(hpNumber) + '\r'), &MD_Dome_Serial);
+  if ( hpNumber > m_settings->get(iHp) ) { return; }
+  m_sendCommand(m_encode(PSTR("*ON"), hpNumber, 2), &MD_Dome_Serial);
 }
 void Marcduino::m_hpLightOff(uint8_t hpNumber)
 {
-  if ( hpNumber > m_settings[iHp] ) { return; }
-  m_sendCommand(String("*OF" + m_leftPad(hpNumber) + '\r'), &MD_Dome_Serial);
+  if ( hpNumber > m_settings->get(iHp) ) { return; }
+  m_sendCommand(m_encode(PSTR("*OF"), hpNumber, 2), &MD_Dome_Serial);
 }
 void Marcduino::m_hpRemoteControl(uint8_t hpNumber)
 {
-  if ( hpNumber > m_settings[iHp] ) { return; }
-  m_sendCommand(String("*RC" + m_leftPad(hpNumber) + '\r'), &MD_Dome_Serial);
+  if ( hpNumber > m_settings->get(iHp) ) { return; }
+  m_sendCommand(m_encode(PSTR("*RC"), hpNumber, 2), &MD_Dome_Serial);
 }
 void Marcduino::m_hpReset(uint8_t hpNumber)
 {
-  if ( hpNumber > m_settings[iHp] ) { return; }
-  m_sendCommand(String("*ST" + m_leftPad(hpNumber) + '\r'), &MD_Dome_Serial);
+  if ( hpNumber > m_settings->get(iHp) ) { return; }
+  m_sendCommand(m_encode(PSTR("*ST"), hpNumber, 2), &MD_Dome_Serial);
 }
 void Marcduino::m_hpHold(uint8_t hpNumber)
 {
-  if ( hpNumber > m_settings[iHp] ) { return; }
-  m_sendCommand(String("*HD" + m_leftPad(hpNumber) + '\r'), &MD_Dome_Serial);
+  if ( hpNumber > m_settings->get(iHp) ) { return; }
+  m_sendCommand(m_encode(PSTR("*HD"), hpNumber, 2), &MD_Dome_Serial);
 }
 void Marcduino::m_hpOnBoard(uint8_t hpNumber, uint8_t seconds = 0)
 {
-  if ( hpNumber > m_settings[iHp] ) { return; }
-  m_sendCommand(String("*H" + hpNumber + m_leftPad(min(seconds,99)) + '\r'), &MD_Dome_Serial);
+  if ( hpNumber > m_settings->get(iHp) ) { return; }
+  m_cmdStart(PSTR("*H"));
+  m_cmdNumber(hpNumber);
+  m_cmdNumber(min(seconds,99), 2);
+  m_sendCommand(m_cmdEnd(), &MD_Dome_Serial);
 }
 void Marcduino::m_hpFlicker(uint8_t hpNumber, uint8_t seconds = 0)
 {
-  if ( hpNumber > m_settings[iHp] ) { return; }
-  m_sendCommand(String("*F" + hpNumber + m_leftPad(min(seconds,99)) + '\r'), &MD_Dome_Serial);
+  if ( hpNumber > m_settings->get(iHp) ) { return; }
+  m_cmdStart(PSTR("*F"));
+  m_cmdNumber(hpNumber);
+  m_cmdNumber(min(seconds,99), 2);
+  m_sendCommand(m_cmdEnd(), &MD_Dome_Serial);
 }
 
 // ===================================================================================================
@@ -557,11 +757,11 @@ void Marcduino::m_hpFlicker(uint8_t hpNumber, uint8_t seconds = 0)
 
 void Marcduino::m_magicPanel(uint8_t seconds = 0)
 {
-  m_sendCommand(String("*MO" + m_leftPad(min(seconds,99)) + '\r'), &MD_Dome_Serial);
+  m_sendCommand(m_encode(PSTR("*MO"), min(seconds,99), 2), &MD_Dome_Serial);
 }
 void Marcduino::m_magicPanelFlicker(uint8_t seconds = 0)
 {
-  m_sendCommand(String("*MF" + m_leftPad(min(seconds,99)) + '\r'), &MD_Dome_Serial);
+  m_sendCommand(m_encode(PSTR("*MF"), min(seconds,99), 2), &MD_Dome_Serial);
 }
 
 // ===================================================================================================
@@ -578,72 +778,95 @@ void Marcduino::m_magicPanelFlicker(uint8_t seconds = 0)
 void Marcduino::m_logicsTest(uint8_t displayNumber)
 {
   if ( displayNumber > 5 ) { return; }
-  m_sendCommand(String((String)"@" + displayNumber + "T0\r"), &MD_Dome_Serial);
+  m_cmdStart(PSTR("@"));
+  m_cmdNumber(displayNumber);
+  m_cmdAppend(PSTR("T0"));
+  m_sendCommand(m_cmdEnd(), &MD_Dome_Serial);
 }
 void Marcduino::m_logicsReset(uint8_t displayNumber)
 {
   if ( displayNumber > 5 ) { return; }
-  m_sendCommand(String((String)"@" + displayNumber + "T1\r"), &MD_Dome_Serial);
+  m_cmdStart(PSTR("@"));
+  m_cmdNumber(displayNumber);
+  m_cmdAppend(PSTR("T1"));
+  m_sendCommand(m_cmdEnd(), &MD_Dome_Serial);
 }
 void Marcduino::m_logicsAlarm(void)
 {
-  m_sendCommand(String((String)"@0T2\r"), &MD_Dome_Serial);
+  m_sendCommand(m_encode(PSTR("@0T2")), &MD_Dome_Serial);
 }
 void Marcduino::m_logicsAlarmTimed(void)
 {
-  m_sendCommand(String((String)"@0T3\r"), &MD_Dome_Serial);
+  m_sendCommand(m_encode(PSTR("@0T3")), &MD_Dome_Serial);
 }
 void Marcduino::m_logicsShortCircuit(void)
 {
-  m_sendCommand(String((String)"@0T4\r"), &MD_Dome_Serial);
+  m_sendCommand(m_encode(PSTR("@0T4")), &MD_Dome_Serial);
 }
 void Marcduino::m_logicsScream(void)
 {
-  m_sendCommand(String((String)"@0T5\r"), &MD_Dome_Serial);
+  m_sendCommand(m_encode(PSTR("@0T5")), &MD_Dome_Serial);
 }
 void Marcduino::m_logicsLeia(void)
 {
-  m_sendCommand(String((String)"@0T6\r"), &MD_Dome_Serial);
+  m_sendCommand(m_encode(PSTR("@0T6")), &MD_Dome_Serial);
 }
 void Marcduino::m_logicsStarWars(void)
 {
-  m_sendCommand(String((String)"@0T10\r"), &MD_Dome_Serial);
+  m_sendCommand(m_encode(PSTR("@0T10")), &MD_Dome_Serial);
 }
 void Marcduino::m_logicsMarch(void)
 {
-  m_sendCommand(String((String)"@0T11\r"), &MD_Dome_Serial);
+  m_sendCommand(m_encode(PSTR("@0T11")), &MD_Dome_Serial);
 }
 void Marcduino::m_logicsOff(uint8_t displayNumber)
 {
   if ( displayNumber > 5 ) { return; }
-  m_sendCommand(String((String)"@" + displayNumber + "T20\r"), &MD_Dome_Serial);
+  m_cmdStart(PSTR("@"));
+  m_cmdNumber(displayNumber);
+  m_cmdAppend(PSTR("T20"));
+  m_sendCommand(m_cmdEnd(), &MD_Dome_Serial);
 }
 void Marcduino::m_logicsSpectrum(uint8_t displayNumber)
 {
   if ( displayNumber > 3 ) { return; }
-  m_sendCommand(String((String)"@" + displayNumber + "T92\r"), &MD_Dome_Serial);
+  m_cmdStart(PSTR("@"));
+  m_cmdNumber(displayNumber);
+  m_cmdAppend(PSTR("T92"));
+  m_sendCommand(m_cmdEnd(), &MD_Dome_Serial);
 }
-void Marcduino::m_logicsText(String text, uint8_t displayNumber)
+void Marcduino::m_logicsText(const char* text, uint8_t displayNumber)
 {
   if ( displayNumber > 3 ) { return; }
-  m_sendCommand(String((String)"@" + displayNumber + "T100\r" + (String)"@M" + text + '\r'), &MD_Dome_Serial);
+  m_cmdStart(PSTR("@"));
+  m_cmdNumber(displayNumber);
+  m_cmdAppend(PSTR("T100\r@M"));
+  m_cmdText(text);
+  m_sendCommand(m_cmdEnd(), &MD_Dome_Serial);
 }
 void Marcduino::m_logicsToggleFont(uint8_t displayNumber)
 {
   if ( displayNumber > 3 ) { return; }
+  m_cmdStart(PSTR("@"));
+  m_cmdNumber(displayNumber);
   if ( m_aurabesh ) {
-    m_sendCommand(String((String)"@" + displayNumber + "P60\r"), &MD_Dome_Serial);
+    m_cmdAppend(PSTR("P60"));
     m_aurabesh = false;
   } else {
-    m_sendCommand(String((String)"@" + displayNumber + "P61\r"), &MD_Dome_Serial);
+    m_cmdAppend(PSTR("P61"));
     m_aurabesh = true;
   }
+  m_sendCommand(m_cmdEnd(), &MD_Dome_Serial);
 }
 void Marcduino::m_logicsRandomStyle(uint8_t style, uint8_t displayNumber)
 {
   if ( displayNumber > 3 ) { return; }
   if ( style > 6 ) { style = 0; }
-  m_sendCommand(String((String)"@" + displayNumber + "R" + style + '\r'), &MD_Dome_Serial);
+  m_cmdStart(PSTR("@"));
+  m_cmdNumber(displayNumber);
+  m_cmdAppend(PSTR("R"));
+  m_cmdNumber(style);
+  m_sendCommand(m_cmdEnd(), &MD_Dome_Serial);
 }
 
 // ===================================================================================================
@@ -658,32 +881,47 @@ void Marcduino::m_logicsRandomStyle(uint8_t style, uint8_t displayNumber)
 void Marcduino::m_psiOn(uint8_t psiNumber)
 {
   uint8_t validationList[] = {0, 4, 5};
-  if ( ! m_inList(psiNumber, validationList) ) { return; }
-  m_sendCommand(String((String)"@" + psiNumber + "S0\r"), &MD_Dome_Serial);
+  if ( ! m_inList(psiNumber, validationList, sizeof(validationList)) ) { return; }
+  m_cmdStart(PSTR("@"));
+  m_cmdNumber(psiNumber);
+  m_cmdAppend(PSTR("S0"));
+  m_sendCommand(m_cmdEnd(), &MD_Dome_Serial);
 }
 void Marcduino::m_psiNormal(uint8_t psiNumber)
 {
   uint8_t validationList[] = {0, 4, 5};
-  if ( ! m_inList(psiNumber, validationList) ) { return; }
-  m_sendCommand(String((String)"@" + psiNumber + "S1\r"), &MD_Dome_Serial);
+  if ( ! m_inList(psiNumber, validationList, sizeof(validationList)) ) { return; }
+  m_cmdStart(PSTR("@"));
+  m_cmdNumber(psiNumber);
+  m_cmdAppend(PSTR("S1"));
+  m_sendCommand(m_cmdEnd(), &MD_Dome_Serial);
 }
 void Marcduino::m_psiFirstColor(uint8_t psiNumber)
 {
   uint8_t validationList[] = {0, 4, 5};
-  if ( ! m_inList(psiNumber, validationList) ) { return; }
-  m_sendCommand(String((String)"@" + psiNumber + "S2\r"), &MD_Dome_Serial);
+  if ( ! m_inList(psiNumber, validationList, sizeof(validationList)) ) { return; }
+  m_cmdStart(PSTR("@"));
+  m_cmdNumber(psiNumber);
+  m_cmdAppend(PSTR("S2"));
+  m_sendCommand(m_cmdEnd(), &MD_Dome_Serial);
 }
 void Marcduino::m_psiSecondColor(uint8_t psiNumber)
 {
   uint8_t validationList[] = {0, 4, 5};
-  if ( ! m_inList(psiNumber, validationList) ) { return; }
-  m_sendCommand(String((String)"@" + psiNumber + "S3\r"), &MD_Dome_Serial);
+  if ( ! m_inList(psiNumber, validationList, sizeof(validationList)) ) { return; }
+  m_cmdStart(PSTR("@"));
+  m_cmdNumber(psiNumber);
+  m_cmdAppend(PSTR("S3"));
+  m_sendCommand(m_cmdEnd(), &MD_Dome_Serial);
 }
 void Marcduino::m_psiOff(uint8_t psiNumber)
 {
   uint8_t validationList[] = {0, 4, 5};
-  if ( ! m_inList(psiNumber, validationList) ) { return; }
-  m_sendCommand(String((String)"@" + psiNumber + "S4\r"), &MD_Dome_Serial);
+  if ( ! m_inList(psiNumber, validationList, sizeof(validationList)) ) { return; }
+  m_cmdStart(PSTR("@"));
+  m_cmdNumber(psiNumber);
+  m_cmdAppend(PSTR("S4"));
+  m_sendCommand(m_cmdEnd(), &MD_Dome_Serial);
 }
 
 // ===================================================================================================
@@ -700,157 +938,96 @@ void Marcduino::m_soundNext(uint8_t bank)
 {
   if ( bank < 1 || bank > 4 ) { return; }
 
-  if ( m_settings[iSoundMaster] == 1 ) {
-    m_sendCommand(String((String)"$" + bank + '\r'), &MD_Body_Serial);
-  } else {
-    m_sendCommand(String((String)"$" + bank + '\r'), &MD_Dome_Serial);
-  }
+  m_cmdStart(PSTR("$"));
+  m_cmdNumber(bank);
+  m_sendSound(m_cmdEnd());
 }
 void Marcduino::m_soundFirst(uint8_t bank)
 {
-  if ( m_settings[iSoundBoard] ) {
+  if ( m_settings->get(iSoundBoard) ) {
     if ( bank < 5 || bank > 8 ) { return; }
   } else {
     if ( bank < 5 || bank > 9 ) { return; }
   }
 
-  if ( m_settings[iSoundMaster] == 1 ) {
-    m_sendCommand(String((String)"$" + bank + '\r'), &MD_Body_Serial);
-  } else {
-    m_sendCommand(String((String)"$" + bank + '\r'), &MD_Dome_Serial);
-  }
+  m_cmdStart(PSTR("$"));
+  m_cmdNumber(bank);
+  m_sendSound(m_cmdEnd());
 }
 void Marcduino::m_soundPlayTrack(uint8_t bank, uint8_t track)
 {
-  if ( m_settings[iSoundBoard] ) {
+  if ( m_settings->get(iSoundBoard) ) {
     if ( bank < 5 || bank > 8 ) { return; }
   } else {
     if ( bank < 5 || bank > 9 ) { return; }
   }
 
-  if ( m_settings[iSoundBoard] ) {
+  if ( m_settings->get(iSoundBoard) ) {
     if ( track < 1 || bank > 25 ) { return; }
   } else {
     if ( track < 1 || bank > 99 ) { return; }
   }
 
-  if ( m_settings[iSoundMaster] == 1 ) { 
-    m_sendCommand(String((String)"$" + bank + track + '\r'), &MD_Body_Serial);
-  } else {
-    m_sendCommand(String((String)"$" + bank + track + '\r'), &MD_Dome_Serial);
-  }
+  m_cmdStart(PSTR("$"));
+  m_cmdNumber(bank);
+  m_cmdNumber(track);
+  m_sendSound(m_cmdEnd());
 }
 void Marcduino::m_soundRandom(void)
 {
-  if ( m_settings[iSoundMaster] == 1 ) { 
-    m_sendCommand(String((String)"$R\r"), &MD_Body_Serial);
-  } else {
-    m_sendCommand(String((String)"$R\r"), &MD_Dome_Serial);
-  }
+  m_sendSound(m_encode(PSTR("$R")));
 }
 void Marcduino::m_soundRandomOff(void)
 {
-  if ( m_settings[iSoundMaster] == 1 ) { 
-    m_sendCommand(String((String)"$O\r"), &MD_Body_Serial);
-  } else {
-    m_sendCommand(String((String)"$O\r"), &MD_Dome_Serial);
-  }
+  m_sendSound(m_encode(PSTR("$O")));
 }
 void Marcduino::m_soundStop(void)
 {
-  if ( m_settings[iSoundMaster] == 1 ) { 
-    m_sendCommand(String((String)"$s\r"), &MD_Body_Serial);
-  } else {
-    m_sendCommand(String((String)"$s\r"), &MD_Dome_Serial);
-  }
+  m_sendSound(m_encode(PSTR("$s")));
 }
 void Marcduino::m_soundScream(void)
 {
-  if ( m_settings[iSoundMaster] == 1 ) { 
-    m_sendCommand(String((String)"$S\r"), &MD_Body_Serial);
-  } else {
-    m_sendCommand(String((String)"$S\r"), &MD_Dome_Serial);
-  }
+  m_sendSound(m_encode(PSTR("$S")));
 }
 void Marcduino::m_soundWave(void)
 {
-  if ( m_settings[iSoundMaster] == 1 ) { 
-    m_sendCommand(String((String)"$213\r"), &MD_Body_Serial);
-  } else {
-    m_sendCommand(String((String)"$213\r"), &MD_Dome_Serial);
-  }
+  m_sendSound(m_encode(PSTR("$213")));
 }
 void Marcduino::m_soundFastWave(void)
 {
-  if ( m_settings[iSoundMaster] == 1 ) { 
-    m_sendCommand(String((String)"$34\r"), &MD_Body_Serial);
-  } else {
-    m_sendCommand(String((String)"$34\r"), &MD_Dome_Serial);
-  }
+  m_sendSound(m_encode(PSTR("$34")));
 }
 void Marcduino::m_soundWave2(void)
 {
-  if ( m_settings[iSoundMaster] == 1 ) { 
-    m_sendCommand(String((String)"$36\r"), &MD_Body_Serial);
-  } else {
-    m_sendCommand(String((String)"$36\r"), &MD_Dome_Serial);
-  }
+  m_sendSound(m_encode(PSTR("$36")));
 }
 void Marcduino::m_soundFaint(void)
 {
-  if ( m_settings[iSoundMaster] == 1 ) { 
-    m_sendCommand(String((String)"$F\r"), &MD_Body_Serial);
-  } else {
-    m_sendCommand(String((String)"$F\r"), &MD_Dome_Serial);
-  }
+  m_sendSound(m_encode(PSTR("$F")));
 }
 void Marcduino::m_soundLeia(void)
 {
-  if ( m_settings[iSoundMaster] == 1 ) { 
-    m_sendCommand(String((String)"$L\r"), &MD_Body_Serial);
-  } else {
-    m_sendCommand(String((String)"$L\r"), &MD_Dome_Serial);
-  }
+  m_sendSound(m_encode(PSTR("$L")));
 }
 void Marcduino::m_soundBeepCantina(void)
 {
-  if ( m_settings[iSoundMaster] == 1 ) { 
-    m_sendCommand(String((String)"$c\r"), &MD_Body_Serial);
-  } else {
-    m_sendCommand(String((String)"$c\r"), &MD_Dome_Serial);
-  }
+  m_sendSound(m_encode(PSTR("$c")));
 }
 void Marcduino::m_soundStarWars(void)
 {
-  if ( m_settings[iSoundMaster] == 1 ) { 
-    m_sendCommand(String((String)"$W\r"), &MD_Body_Serial);
-  } else {
-    m_sendCommand(String((String)"$W\r"), &MD_Dome_Serial);
-  }
+  m_sendSound(m_encode(PSTR("$W")));
 }
 void Marcduino::m_soundMarch(void)
 {
-  if ( m_settings[iSoundMaster] == 1 ) { 
-    m_sendCommand(String((String)"$M\r"), &MD_Body_Serial);
-  } else {
-    m_sendCommand(String((String)"$M\r"), &MD_Dome_Serial);
-  }
+  m_sendSound(m_encode(PSTR("$M")));
 }
 void Marcduino::m_soundCantinaDance(void)
 {
-  if ( m_settings[iSoundMaster] == 1 ) { 
-    m_sendCommand(String((String)"$C\r"), &MD_Body_Serial);
-  } else {
-    m_sendCommand(String((String)"$C\r"), &MD_Dome_Serial);
-  }
+  m_sendSound(m_encode(PSTR("$C")));
 }
 void Marcduino::m_soundDisco(void)
 {
-  if ( m_settings[iSoundMaster] == 1 ) { 
-    m_sendCommand(String((String)"$D\r"), &MD_Body_Serial);
-  } else {
-    m_sendCommand(String((String)"$D\r"), &MD_Dome_Serial);
-  }
+  m_sendSound(m_encode(PSTR("$D")));
 }
 
 // ===================================================================================================
@@ -862,35 +1039,19 @@ void Marcduino::m_soundDisco(void)
 // ===================================================================================================
 void Marcduino::m_volumeDown(void)
 {
-  if ( m_settings[iSoundMaster] == 1 ) { 
-    m_sendCommand(String((String)"$-\r"), &MD_Body_Serial);
-  } else {
-    m_sendCommand(String((String)"$-\r"), &MD_Dome_Serial);
-  }
+  m_sendSound(m_encode(PSTR("$-")));
 }
 void Marcduino::m_volumeUp(void)
 {
-  if ( m_settings[iSoundMaster] == 1 ) { 
-    m_sendCommand(String((String)"$+\r"), &MD_Body_Serial);
-  } else {
-    m_sendCommand(String((String)"$+\r"), &MD_Dome_Serial);
-  }
+  m_sendSound(m_encode(PSTR("$+")));
 }
 void Marcduino::m_volumeMid(void)
 {
-  if ( m_settings[iSoundMaster] == 1 ) { 
-    m_sendCommand(String((String)"$m\r"), &MD_Body_Serial);
-  } else {
-    m_sendCommand(String((String)"$m\r"), &MD_Dome_Serial);
-  }
+  m_sendSound(m_encode(PSTR("$m")));
 }
 void Marcduino::m_volumeMax(void)
 {
-  if ( m_settings[iSoundMaster] == 1 ) { 
-    m_sendCommand(String((String)"$f\r"), &MD_Body_Serial);
-  } else {
-    m_sendCommand(String((String)"$f\r"), &MD_Dome_Serial);
-  }
+  m_sendSound(m_encode(PSTR("$f")));
 }
 
 // ===================================================================================================
@@ -905,7 +1066,7 @@ void Marcduino::m_runSequence(uint8_t sequenceNumber)
 {
   #if defined(DEBUG)
   if ( m_buttonIndex > -1 ) {
-    Debug.print(DBG_VERBOSE, F("Marcduino"), F("m_runSequence()"), F("Sequence: "),(String)sequenceNumber);
+    Debug.print(DBG_VERBOSE, F("Marcduino"), F("m_runSequence()"), F("Sequence: "),(long)sequenceNumber);
   }
   #endif
 
@@ -925,13 +1086,30 @@ void Marcduino::m_runSequence(uint8_t sequenceNumber)
   // Always send the sequence to the dome.
   // -------------------------------------
 
-  m_sendCommand(String(":SE" + m_leftPad(sequenceNumber) + '\r'), &MD_Dome_Serial);
+  m_sendCommand(m_encode(PSTR(":SE"), sequenceNumber, 2), &MD_Dome_Serial);
+
+  // ---------------------------------------------------------
+  // The body half follows a moment later, from the timeline,
+  // so the whole sequence does not go out in one burst.
+  // ---------------------------------------------------------
+
+  if ( m_settings->get(iBodyMaster) == 1 ) {
+    if ( ! runActionLater(MARCDUINO_STAGGER, aSequenceBody, sequenceNumber) ) {
+      m_runSequenceBody(sequenceNumber);
+    }
+  }
+}
 
+// =============================
+//      m_runSequenceBody()
+// =============================
+void Marcduino::m_runSequenceBody(uint8_t sequenceNumber)
+{
   // --------------------------------------------------
   // Conditionally send panel and/or sound to the body.
   // --------------------------------------------------
 
-  if ( m_settings[iBodyMaster] == 1 ) {
+  if ( m_settings->get(iBodyMaster) == 1 ) {
     switch (sequenceNumber) {
       case 10 : { m_bodyPanelClose(0);  break; }  // Quiet mode (close all body panels)
       case 11 : { m_bodyPanelClose(0);  break; }  // Full awake mode (close all body panels)
@@ -940,7 +1118,7 @@ void Marcduino::m_runSequence(uint8_t sequenceNumber)
       default : { break; }
     }
 
-    if ( m_settings[iSoundMaster] == 1 ) {
+    if ( m_settings->get(iSoundMaster) == 1 ) {
       switch (sequenceNumber) {
         case 1 : { m_soundScream();       break; }  // Scream         - scream sound, scream display, mp flicker 4 sec, hp flicker 4 sec
         case 2 : { m_soundWave();         break; }  // Wave           - happy sound (b2, #13), flash hp 4 seconds
@@ -962,17 +1140,14 @@ void Marcduino::m_runSequence(uint8_t sequenceNumber)
   }
 }
 
-void Marcduino::quietMode(void)       { m_runSequence(10); }
-void Marcduino::m_fullAwakeMode(void) { m_runSequence(11); }
-void Marcduino::m_midAwakeMode(void)  { m_runSequence(13); }
-void Marcduino::m_awakePlusMode(void) { m_runSequence(14); }
-void Marcduino::m_cantinaBeep(void)   { m_runSequence(5); }
-void Marcduino::m_cantinaDance(void)  { m_runSequence(7); }
-void Marcduino::m_disco(void)         { m_runSequence(9); }
-void Marcduino::m_faint(void)         { m_runSequence(6); }
-void Marcduino::m_fastWave(void)      { m_runSequence(3); }
-void Marcduino::m_marchingAnts(void)  { m_runSequence(55); }
-void Marcduino::m_leiaMessage(void)   { m_runSequence(8); }
-void Marcduino::m_scream(void)        { m_runSequence(1); }
-void Marcduino::m_wave(void)          { m_runSequence(2); }
-void Marcduino::m_wave2(void)         { m_runSequence(4); }
+void Marcduino::quietMode(void)
+{
+  // Drop anything still waiting on the timeline, then go quiet.
+
+  if ( m_timeline != NULL ) {
+    m_timeline->cancel(tagMarcduino);
+    m_timeline->cancel(tagPanelRoutine);
+  }
+  m_holoAutomationOff();
+  m_runSequence(SEQ_QUIET);
+}
@@ -11,37 +11,118 @@
 
 #include "../toolbox/DebugUtils.h"
 #include "../controller/Controller.h"
+#include "../hal/SerialQueue.h"
+#include "../scheduler/Timeline.h"
 
 #define DEBUG
 
-extern HardwareSerial &MD_Dome_Serial;
-extern HardwareSerial &MD_Body_Serial;
+extern SerialQueue &MD_Dome_Serial;
+extern SerialQueue &MD_Body_Serial;
 
 const int MARCDUINO_BAUD_RATE = 9600;  // Do not change this!
+const byte MARCDUINO_CMD_SIZE = 48;    // Longest command plus its carriage return and terminator.
+const byte MARCDUINO_STAGGER  = 20;    // Time between the commands of one sequence (ms).
+const byte MARCDUINO_MAX_HP   = 9;     // Holoprojector commands take a single digit.
+
+enum panel_location_e {
+  DOME_PANEL,
+  BODY_PANEL
+};
 
 typedef struct {
-  byte panelNbr;
-  int startDelay;
-  int openDuration;
-  unsigned long startedTime;
-  bool completed;
+  byte panel;               // Panel number.
+  byte location;            // DOME_PANEL or BODY_PANEL.
+  unsigned int startDelay;  // Time from the start of the routine until the panel opens (ms).
+  unsigned int openTime;    // Time the panel stays open (ms).
+} Panel_Step_Struct;
+
+typedef struct {
+  const Panel_Step_Struct* steps;
+  byte count;
 } Panel_Routine_Struct;
 
 enum marcduino_setting_index_e {
-  iFxCntl,      // 0  - FX control system.
-  iBodyMaster,  // 1  - Marcduino body master is used.
-  iSoundMaster, // 2  - Marcduino master controling sound.
-  iCmdSet,      // 3  - Marcduino command set.
-  iSoundBoard,  // 4  - Sound board.
-  iMagicPanel,  // 5  - Magic panel is used.
-  iBodyPanels,  // 6  - Number of body panels on servos.
-  iDomePanels,  // 7  - Number of dome panels on servos.
-  iHp,          // 8  - Number of holoprojectors on servos.
-  iHpDelayMin,  // 9  - HP automation delay min.
-  iHpDelayMax,  // 10 - HP automation delay max.
-  iRadio        // 11 - Feather radio in use 
+  iFxCntl,          // 0  - FX control system.
+  iBodyMaster,      // 1  - Marcduino body master is used.
+  iSoundMaster,     // 2  - Marcduino master controling sound.
+  iCmdSet,          // 3  - Marcduino command set.
+  iSoundBoard,      // 4  - Sound board.
+  iMagicPanel,      // 5  - Magic panel is used.
+  iBodyPanels,      // 6  - Number of body panels on servos.
+  iDomePanels,      // 7  - Number of dome panels on servos.
+  iHp,              // 8  - Number of holoprojectors on servos.
+  iHpDelayMin,      // 9  - HP automation delay min.
+  iHpDelayMax,      // 10 - HP automation delay max.
+  iRadio,           // 11 - Feather radio in use 
+  iHpAutomation,    // 12 - HP automation runs from startup.
+  iHpMoveWeight,    // 13 - HP automation, chance of a random move.
+  iHpFlickerWeight, // 14 - HP automation, chance of a flicker.
+  iHpOnBoardWeight, // 15 - HP automation, chance of the on-board light sequence.
+  iHpEffectTime     // 16 - HP automation, length of a flicker or on-board sequence.
 };
 
+const byte MARCDUINO_COMBO_COUNT  = 40;   // 8 base buttons, each alone or with one of 4 modifiers.
+const byte MARCDUINO_COMMAND_SETS = 2;
+
+// ---------------------------------------------------------
+// Actions a button combo can run. arg1 and arg2 are listed
+// for each action that uses them.
+// ---------------------------------------------------------
+
+enum marcduino_action_e {
+  aNone,
+  aSequence,          // arg1 = sequence number (see marcduino_sequence_e)
+  aBodyPanelOpen,     // arg1 = panel number, 0 = all
+  aBodyPanelClose,    // arg1 = panel number, 0 = all
+  aDomePanelOpen,     // arg1 = panel number, 0 = all
+  aDomePanelClose,    // arg1 = panel number, 0 = all
+  aHpLightOn,         // arg1 = holoprojector number, 0 = all
+  aHpLightOff,        // arg1 = holoprojector number, 0 = all
+  aHpReset,           // arg1 = holoprojector number, 0 = all
+  aHpRandomMove,      // arg1 = holoprojector number, 0 = all
+  aVolumeUp,
+  aVolumeDown,
+  aVolumeMid,
+  aVolumeMax,
+  aSound,             // arg1 = bank, arg2 = track
+  aSoundStarWars,     // arg1 = bank, arg2 = track, then the Star Wars logic display
+  aSoundLogicsReset,  // arg1 = bank, arg2 = track, then reset the logic displays
+  aDomeRoutine,       // arg1 = dome routine number (see DomeMotor_Routines.h)
+  aSequenceBody,      // arg1 = sequence number. The body half of a sequence, run after the dome half.
+  aPanelRoutine,      // arg1 = custom panel routine number (see Marcduino_Panel_Routines.h)
+  aPanelStepOpen,     // arg1 = routine number, arg2 = step. Used by the routine engine.
+  aPanelStepClose,    // arg1 = routine number, arg2 = step. Used by the routine engine.
+  aHoloAutomationOn,
+  aHoloAutomationOff,
+  aHoloStep,          // arg1 = holoprojector number. Used by holoprojector automation.
+  aQuiet              // Quiet mode, cancelling anything still waiting on the timeline. See quietMode().
+};
+
+enum marcduino_sequence_e {
+  SEQ_SCREAM        = 1,
+  SEQ_WAVE          = 2,
+  SEQ_FAST_WAVE     = 3,
+  SEQ_WAVE2         = 4,
+  SEQ_CANTINA_BEEP  = 5,
+  SEQ_FAINT         = 6,
+  SEQ_CANTINA_DANCE = 7,
+  SEQ_LEIA          = 8,
+  SEQ_DISCO         = 9,
+  SEQ_QUIET         = 10,
+  SEQ_FULL_AWAKE    = 11,
+  SEQ_MID_AWAKE     = 13,
+  SEQ_AWAKE_PLUS    = 14,
+  SEQ_MARCHING_ANTS = 55
+};
+
+typedef struct {
+  byte action;
+  byte arg1;
+  byte arg2;
+} Marcduino_Action_Struct;
+
+typedef void (*Marcduino_Routine_Callback)(byte routineNumber);
+
 enum panel_action_e {
   OPEN,
   CLOSE
@@ -54,46 +135,44 @@ class Marcduino {
 
   private:
     Controller* m_controller;
-    byte* m_settings;
+    const Config_Section* m_settings;
+    Timeline* m_timeline;
 
-    Button* m_button;
+    Button m_button;
 
     int m_buttonIndex;
     bool m_holoAutomationRunning;
-    unsigned long m_randomSeconds[3];
-    unsigned long m_lastRandomTime[3];
+    void m_holoAutomationOn(void);
+    void m_holoAutomationOff(void);
+    void m_holoStep(byte hpNumber);
+    bool m_holoSchedule(byte hpNumber, unsigned long extraTime);
+    byte m_holoCount(void);
 
-    bool m_cprRunning;
-    int m_cprRowCount;
-    int m_cprCompletedCount;
-    unsigned long m_cprStartTime;
-    String m_cprBuilCommand(String, int);
-    Panel_Routine_Struct * m_cprRunningRoutine;
-    void m_startCustomPanelRoutine(Panel_Routine_Struct [], int);
+    bool m_startPanelRoutine(byte routineNumber);
+    void m_runPanelStep(byte action, byte routineNumber, byte step);
 
     bool m_aurabesh;
 
+    Marcduino_Routine_Callback m_domeRoutine;
+
     int  m_getButtonsPressed(void);
-    void m_sendCommand(String, HardwareSerial *);
+    void m_sendCommand(const char*, SerialQueue *);
+    void m_sendSound(const char*);
 
-    // Preprogrammed modes
-    void m_fullAwakeMode(void);
-    void m_midAwakeMode(void);
-    void m_awakePlusMode(void);
-
-    void m_cantinaBeep(void);
-    void m_cantinaDance(void);
-    void m_disco(void);
-    void m_faint(void);
-    void m_fastWave(void);
-    void m_leiaMessage(void);
-    void m_marchingAnts(void);
-    void m_scream(void);
-    void m_wave(void);
-    void m_wave2(void);
+    // Command encoder
+    char m_command[MARCDUINO_CMD_SIZE];
+    byte m_commandLength;
+    void m_cmdStart(PGM_P text);
+    void m_cmdAppend(PGM_P text);
+    void m_cmdText(const char* text);
+    void m_cmdNumber(uint8_t n, uint8_t width = 0);
+    const char* m_cmdEnd(void);
+    const char* m_encode(PGM_P prefix, uint8_t n, uint8_t width);
+    const char* m_encode(PGM_P command);
 
     // Panel commands
     void m_runSequence(uint8_t sequenceNumber);
+    void m_runSequenceBody(uint8_t sequenceNumber);
     void m_bodyPanelOpen(uint8_t panelNumber);
     void m_bodyPanelClose(uint8_t panelNumber);
     void m_bodyPanelRemoteControl(uint8_t panelNumber);
@@ -131,7 +210,7 @@ class Marcduino {
     void m_logicsMarch(void);
     void m_logicsOff(uint8_t displayNumber);
     void m_logicsSpectrum(uint8_t displayNumber);
-    void m_logicsText(String text, uint8_t displayNumber);
+    void m_logicsText(const char* text, uint8_t displayNumber);
     void m_logicsToggleFont(uint8_t displayNumber);
     void m_logicsRandomStyle(uint8_t style, uint8_t displayNumber);
 
@@ -168,19 +247,23 @@ class Marcduino {
     void m_volumeMax(void);
 
     // Command support functions
-    String m_leftPad(uint8_t n, char c, uint8_t width);
-    bool m_inList(const uint8_t valueToFind, const uint8_t list[]);
+    bool m_inList(const uint8_t valueToFind, const uint8_t list[], size_t count);
+
+    static void m_onTimeline(byte action, byte arg1, byte arg2);
 
   public:
-    Marcduino(Controller* pController, const byte settings[]);
+    Marcduino(Controller* pController, const Config_Section* settings, Timeline* pTimeline);
     ~Marcduino(void);
     void begin(void);
-    void interpretController(void);
-    void runAutomation(void);
-    void runCustomPanelRoutine();
-    bool isCustomPanelRunning(void);
+    void interpretController(const Input_Frame_Struct* frame);
+    void runAction(byte action, byte arg1, byte arg2);
+    bool runActionLater(unsigned long delay, byte action, byte arg1 = 0, byte arg2 = 0);
+    void sendCommand(const char* command, byte location);
+    void attachDomeRoutine(Marcduino_Routine_Callback callback);
 
     // Preprogrammed modes
     void quietMode(void);
+
+    static Marcduino* anchor;
 };
 #endif
@@ -0,0 +1,116 @@
+/* =================================================================================
+ *    B.L.A.C.Box: Brian Lubkeman's Astromech Controller
+ * =================================================================================
+ * Marcduino_Command_Sets.h - Button combo mappings for the Marcduino system.
+ * Created by Brian Lubkeman, 16 June 2021
+ * Inspired by S.H.A.D.O.W. controller code written by KnightShade
+ * Released into the public domain.
+ */
+
+#ifndef _MARCDUINO_COMMAND_SETS_H_
+#define _MARCDUINO_COMMAND_SETS_H_
+
+// ---------------------------------------------------------------------------------
+// One row per command set, one entry per button combo. Each entry is an action
+// followed by up to two arguments. See marcduino_action_e for what the arguments
+// mean. The command set in use is chosen by marcduinoSettings in Settings.h.
+// To add a command set, add a row here and raise MARCDUINO_COMMAND_SETS.
+// ---------------------------------------------------------------------------------
+
+const Marcduino_Action_Struct marcduinoCommandSets[MARCDUINO_COMMAND_SETS][MARCDUINO_COMBO_COUNT] PROGMEM = {
+
+  // -------------------------------------------------------
+  // Command set 0. These mappings mimic the SHADOW+MD controls.
+  // -------------------------------------------------------
+  {
+    { aQuiet,             0,                  0 },  // 0  UP
+    { aSequence,          SEQ_MID_AWAKE,      0 },  // 1  RIGHT
+    { aSequence,          SEQ_FULL_AWAKE,     0 },  // 2  DOWN
+    { aSequence,          SEQ_AWAKE_PLUS,     0 },  // 3  LEFT
+    { aSequence,          SEQ_MARCHING_ANTS,  0 },  // 4  TRIANGLE
+    { aBodyPanelClose,    1,                  0 },  // 5  CIRCLE
+    { aSequence,          SEQ_CANTINA_BEEP,   0 },  // 6  CROSS
+    { aBodyPanelOpen,     1,                  0 },  // 7  SQUARE
+    { aSequence,          SEQ_LEIA,           0 },  // 8  L1/R1 + UP
+    { aSequence,          SEQ_WAVE,           0 },  // 9  L1/R1 + RIGHT
+    { aSequence,          SEQ_CANTINA_DANCE,  0 },  // 10 L1/R1 + DOWN
+    { aSequence,          SEQ_WAVE2,          0 },  // 11 L1/R1 + LEFT
+    { aDomePanelClose,    1,                  0 },  // 12 L1/R1 + TRIANGLE
+    { aDomePanelOpen,     2,                  0 },  // 13 L1/R1 + CIRCLE
+    { aDomePanelOpen,     1,                  0 },  // 14 L1/R1 + CROSS
+    { aDomePanelClose,    2,                  0 },  // 15 L1/R1 + SQUARE
+    { aVolumeUp,          0,                  0 },  // 16 SHARE/SELECT + UP
+    { aHpLightOn,         0,                  0 },  // 17 SHARE/SELECT + RIGHT
+    { aVolumeDown,        0,                  0 },  // 18 SHARE/SELECT + DOWN
+    { aHpLightOff,        0,                  0 },  // 19 SHARE/SELECT + LEFT
+    { aVolumeMid,         0,                  0 },  // 20 SHARE/SELECT + TRIANGLE
+    { aDomePanelClose,    0,                  0 },  // 21 SHARE/SELECT + CIRCLE
+    { aVolumeMax,         0,                  0 },  // 22 SHARE/SELECT + CROSS
+    { aDomePanelOpen,     0,                  0 },  // 23 SHARE/SELECT + SQUARE
+    { aSequence,          SEQ_DISCO,          0 },  // 24 OPTIONS/START + UP
+    { aSequence,          SEQ_FAST_WAVE,      0 },  // 25 OPTIONS/START + RIGHT
+    { aSequence,          SEQ_SCREAM,         0 },  // 26 OPTIONS/START + DOWN
+    { aSequence,          SEQ_FAINT,          0 },  // 27 OPTIONS/START + LEFT
+    { aHpReset,           0,                  0 },  // 28 OPTIONS/START + TRIANGLE
+    { aHpLightOn,         0,                  0 },  // 29 OPTIONS/START + CIRCLE
+    { aHpRandomMove,      0,                  0 },  // 30 OPTIONS/START + CROSS
+    { aHpLightOff,        0,                  0 },  // 31 OPTIONS/START + SQUARE
+    { aSoundStarWars,     8,                  8 },  // 32 PS/PS2 + UP
+    { aSoundLogicsReset,  8,                  9 },  // 33 PS/PS2 + RIGHT
+    { aSoundLogicsReset,  8,                  10 }, // 34 PS/PS2 + DOWN
+    { aSoundLogicsReset,  8,                  11 }, // 35 PS/PS2 + LEFT
+    { aDomePanelClose,    3,                  0 },  // 36 PS/PS2 + TRIANGLE
+    { aDomePanelOpen,     4,                  0 },  // 37 PS/PS2 + CIRCLE
+    { aDomePanelOpen,     3,                  0 },  // 38 PS/PS2 + CROSS
+    { aDomePanelClose,    4,                  0 }   // 39 PS/PS2 + SQUARE
+  },
+
+  // -------------------------------------------------------
+  // Command set 1. This is where you may define your own
+  // button combo mappings.
+  // -------------------------------------------------------
+  {
+    { aQuiet,             0,                  0 },  // 0  UP
+    { aSequence,          SEQ_MID_AWAKE,      0 },  // 1  RIGHT
+    { aSequence,          SEQ_FULL_AWAKE,     0 },  // 2  DOWN
+    { aSequence,          SEQ_AWAKE_PLUS,     0 },  // 3  LEFT
+    { aDomeRoutine,       1,                  0 },  // 4  TRIANGLE                 : Look left and scream
+    { aDomeRoutine,       2,                  0 },  // 5  CIRCLE                   : Patrol
+    { aHoloAutomationOn,  0,                  0 },  // 6  CROSS
+    { aHoloAutomationOff, 0,                  0 },  // 7  SQUARE
+    { aVolumeUp,          0,                  0 },  // 8  L1/R1 + UP
+    { aHpReset,           0,                  0 },  // 9  L1/R1 + RIGHT
+    { aVolumeDown,        0,                  0 },  // 10 L1/R1 + DOWN
+    { aHpRandomMove,      0,                  0 },  // 11 L1/R1 + LEFT
+    { aVolumeMid,         0,                  0 },  // 12 L1/R1 + TRIANGLE
+    { aHpLightOn,         0,                  0 },  // 13 L1/R1 + CIRCLE
+    { aVolumeMax,         0,                  0 },  // 14 L1/R1 + CROSS
+    { aHpLightOff,        0,                  0 },  // 15 L1/R1 + SQUARE
+    { aSound,             1,                  22 }, // 16 SHARE/SELECT + UP        : 022_Chatter-22.mp3
+    { aSound,             2,                  9 },  // 17 SHARE/SELECT + RIGHT     : 034_Idle-09.mp3
+    { aSound,             3,                  6 },  // 18 SHARE/SELECT + DOWN      : 056_Acknowledge-06.mp3
+    { aSound,             4,                  1 },  // 19 SHARE/SELECT + LEFT      : 076_Engage-01.mp3
+    { aSound,             1,                  25 }, // 20 SHARE/SELECT + TRIANGLE  : 025_Chatter-25.mp3
+    { aSound,             2,                  17 }, // 21 SHARE/SELECT + CIRCLE    : 042_Idle-17.mp3
+    { aSound,             3,                  20 }, // 22 SHARE/SELECT + CROSS     : 070_ActionComplete-09.mp3
+    { aSound,             7,                  15 }, // 23 SHARE/SELECT + SQUARE    : 165_ThreatWarning-04.mp3
+    { aSound,             4,                  17 }, // 24 OPTIONS/START + UP       : 092_Alert-03.mp3
+    { aSound,             8,                  1 },  // 25 OPTIONS/START + RIGHT    : 176_ImperialMarch.mp3
+    { aSound,             6,                  4 },  // 26 OPTIONS/START + DOWN     : 129_Hurt-04.mp3
+    { aSound,             8,                  2 },  // 27 OPTIONS/START + LEFT     : 177_DuelOfTheFates.mp3
+    { aSound,             4,                  22 }, // 28 OPTIONS/START + TRIANGLE : 097_Atack-01.mp3
+    { aSound,             8,                  3 },  // 29 OPTIONS/START + CIRCLE   : 178_ImperialSuite.mp3
+    { aSound,             7,                  3 },  // 30 OPTIONS/START + CROSS    : 153_Pain-03.mp3
+    { aSound,             8,                  4 },  // 31 OPTIONS/START + SQUARE   : 179_GnRScream.mp3
+    { aBodyPanelOpen,     1,                  0 },  // 32 PS/PS2 + UP
+    { aBodyPanelClose,    2,                  0 },  // 33 PS/PS2 + RIGHT
+    { aBodyPanelClose,    1,                  0 },  // 34 PS/PS2 + DOWN
+    { aBodyPanelOpen,     2,                  0 },  // 35 PS/PS2 + LEFT
+    { aNone,              0,                  0 },  // 36 PS/PS2 + TRIANGLE
+    { aNone,              0,                  0 },  // 37 PS/PS2 + CIRCLE
+    { aNone,              0,                  0 },  // 38 PS/PS2 + CROSS
+    { aNone,              0,                  0 }   // 39 PS/PS2 + SQUARE
+  }
+};
+
+#endif
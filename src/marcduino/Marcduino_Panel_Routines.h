@@ -10,22 +10,35 @@
 #ifndef _MARCDUINO_PANEL_ROUTINES_H_
 #define _MARCDUINO_PANEL_ROUTINES_H_
 
-// ----------------------
+// ---------------------------------------------------------------------------------
 // Custom Panel Routines.
-// ----------------------
+//
+// Each step is: panel number, DOME_PANEL or BODY_PANEL, time from the start of the
+// routine until the panel opens (ms), and how long it stays open (ms). Each panel
+// is sent one open and one close. To add a routine, write its steps and add a row
+// to marcduinoPanelRoutines. Routines are numbered from 1 in the order listed
+// there, and are started by :CPRn in a command or by the aPanelRoutine action.
+// Several routines may run at once.
+// ---------------------------------------------------------------------------------
 
 // In this sample routine, panels #1-#6 are used.  One second after starting the routine,
 // panel #1 begins opening.  Half a second later, panel #1 begins closing while panel #2
 // begins opening. Each panel in sequence follows the same pattern.  The whole sequence
-// is complete in 5 seconds.
+// is complete in 4 seconds.
 
-Panel_Routine_Struct sampleRoutine[] = {
-  { false, 1, 1000, 500 },
-  { false, 2, 1500, 500 },
-  { false, 3, 2000, 500 },
-  { false, 4, 2500, 500 },
-  { false, 5, 3000, 500 },
-  { false, 6, 3500, 500 }
+const Panel_Step_Struct sampleRoutine[] PROGMEM = {
+  { 1, DOME_PANEL, 1000, 500 },
+  { 2, DOME_PANEL, 1500, 500 },
+  { 3, DOME_PANEL, 2000, 500 },
+  { 4, DOME_PANEL, 2500, 500 },
+  { 5, DOME_PANEL, 3000, 500 },
+  { 6, DOME_PANEL, 3500, 500 }
 };
 
+const Panel_Routine_Struct marcduinoPanelRoutines[] PROGMEM = {
+  { sampleRoutine, sizeof(sampleRoutine) / sizeof(sampleRoutine[0]) }
+};
+
+const byte MARCDUINO_PANEL_ROUTINE_COUNT = sizeof(marcduinoPanelRoutines) / sizeof(marcduinoPanelRoutines[0]);
+
 #endif
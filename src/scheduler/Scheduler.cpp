@@ -0,0 +1,232 @@
+/* =================================================================================
+ *    B.L.A.C.Box: Brian Lubkeman's Astromech Controller
+ * =================================================================================
+ * Scheduler.cpp - Library for the cooperative task scheduler
+ * Created by Brian Lubkeman, 16 June 2021
+ * Inspired by S.H.A.D.O.W. controller code written by KnightShade
+ * Released into the public domain.
+ */
+#include "Scheduler.h"
+
+/* ================================================================================
+ *                                 Scheduler Class
+ * ================================================================================ */
+
+// =====================
+//      Constructor
+// =====================
+Scheduler::Scheduler(Controller* pController, const Config_Section* pSettings)
+{
+  m_controller = pController;
+  m_settings = pSettings;
+  m_taskCount = 0;
+  m_handlerCount = 0;
+  m_queueCount = 0;
+  m_timeline = NULL;
+
+  #if defined(PROFILE_LOOP)
+  m_passStage = m_profiler.addStage("Pass");
+  m_readStage = m_profiler.addStage("Read");
+  m_reportTime = 0;
+  #endif
+}
+
+// ====================
+//      Destructor
+// ====================
+Scheduler::~Scheduler(void) {}
+
+// ===================
+//      addTask()
+// ===================
+bool Scheduler::addTask(Task_Callback callback, unsigned long period, const char* name)
+{
+  if ( m_taskCount >= SCHEDULER_MAX_TASKS ) {
+
+    #if defined(DEBUG)
+    Debug.print(DBG_ERROR, F("Scheduler"), F("addTask()"), F("Too many tasks"));
+    #endif
+
+    return false;
+  }
+
+  m_tasks[m_taskCount].callback = callback;
+  m_tasks[m_taskCount].period = period;
+  m_tasks[m_taskCount].lastRunTime = 0;
+
+  #if defined(PROFILE_LOOP)
+  m_tasks[m_taskCount].stage = m_profiler.addStage(name);
+  #endif
+
+  m_taskCount++;
+  return true;
+}
+
+// ==============================
+//      attachOnDisconnect()
+// ==============================
+bool Scheduler::attachOnDisconnect(Disconnect_Callback callback)
+{
+  if ( m_handlerCount >= SCHEDULER_MAX_HANDLERS ) {
+
+    #if defined(DEBUG)
+    Debug.print(DBG_ERROR, F("Scheduler"), F("attachOnDisconnect()"), F("Too many handlers"));
+    #endif
+
+    return false;
+  }
+
+  m_disconnectHandlers[m_handlerCount] = callback;
+  m_handlerCount++;
+  return true;
+}
+
+// =======================
+//      attachQueue()
+// =======================
+bool Scheduler::attachQueue(SerialQueue* queue)
+{
+  if ( m_queueCount >= SCHEDULER_MAX_QUEUES ) {
+
+    #if defined(DEBUG)
+    Debug.print(DBG_ERROR, F("Scheduler"), F("attachQueue()"), F("Too many queues"));
+    #endif
+
+    return false;
+  }
+
+  m_queues[m_queueCount] = queue;
+  m_queueCount++;
+  return true;
+}
+
+// ==========================
+//      attachTimeline()
+// ==========================
+void Scheduler::attachTimeline(Timeline* timeline)
+{
+  m_timeline = timeline;
+}
+
+// ===============
+//      run()
+// ===============
+void Scheduler::run(void)
+{
+  // The pass is timed from the top, so queue and timeline work counts too.
+
+  #if defined(PROFILE_LOOP)
+  unsigned long passStart = Hal_Clock::stopwatch();
+  #endif
+
+  // ------------------------------------------------------------
+  // Feed each serial port whatever it can take without blocking.
+  // This runs every pass, whether or not the controller is read.
+  // ------------------------------------------------------------
+
+  for (byte i = 0; i < m_queueCount; i++) {
+    m_queues[i]->drain();
+  }
+
+  // ---------------------------------------------------------
+  // Run the show events that are due. Timed effects play out
+  // even while the controller is silent.
+  // ---------------------------------------------------------
+
+  if ( m_timeline != NULL ) {
+    m_timeline->run();
+  }
+
+  // ---------------------------------------------------------
+  // Poll the controller exactly once per pass. Every task due
+  // in this pass works from the same input frame.
+  // ---------------------------------------------------------
+
+  #if defined(PROFILE_LOOP)
+  unsigned long readStart = Hal_Clock::stopwatch();
+  #endif
+
+  bool inputValid = m_controller->read();
+
+  #if defined(PROFILE_LOOP)
+  m_profiler.record(m_readStage, Hal_Clock::stopwatch() - readStart);
+  #endif
+
+  // ------------------------------------------------------
+  // Let every peripheral act on a lost controller at once.
+  // ------------------------------------------------------
+
+  if ( m_controller->disconnectEvent() ) {
+    m_dispatchDisconnect();
+  }
+
+  if ( ! inputValid ) {
+    #if defined(PROFILE_LOOP)
+    m_profiler.record(m_passStage, Hal_Clock::stopwatch() - passStart);
+    #endif
+    return;
+  }
+
+  // --------------------------------
+  // Run each task whose period is up.
+  // --------------------------------
+
+  const Input_Frame_Struct* frame = m_controller->frame();
+  unsigned long currentTime = Hal_Clock::millis();
+
+  for (byte i = 0; i < m_taskCount; i++) {
+
+    if ( (currentTime - m_tasks[i].lastRunTime) < m_tasks[i].period ) {
+      continue;
+    }
+
+    // Hold a fixed rate, but do not try to catch up after a long stall.
+
+    m_tasks[i].lastRunTime += m_tasks[i].period;
+    if ( (currentTime - m_tasks[i].lastRunTime) >= m_tasks[i].period ) {
+      m_tasks[i].lastRunTime = currentTime;
+    }
+
+    m_tasks[i].callback(frame);
+
+    // Input-to-actuation latency: from the start of the read to the end of this task.
+
+    #if defined(PROFILE_LOOP)
+    m_profiler.record(m_tasks[i].stage, Hal_Clock::stopwatch() - readStart);
+    #endif
+  }
+
+  #if defined(PROFILE_LOOP)
+  m_profiler.record(m_passStage, Hal_Clock::stopwatch() - passStart);
+
+  if ( (currentTime - m_reportTime) >= m_settings->get(iProfileReport) ) {
+    m_profiler.report(&Serial);
+    m_profiler.reset();
+    m_reportTime = currentTime;
+  }
+  #endif
+}
+
+// ====================
+//      profiler()
+// ====================
+#if defined(PROFILE_LOOP)
+LoopProfiler* Scheduler::profiler(void)
+{
+  return &m_profiler;
+}
+#endif
+
+// ================================
+//      m_dispatchDisconnect()
+// ================================
+void Scheduler::m_dispatchDisconnect(void)
+{
+  #if defined(DEBUG)
+  Debug.print(DBG_WARNING, F("Scheduler"), F("m_dispatchDisconnect()"), F("Controller lost"));
+  #endif
+
+  for (byte i = 0; i < m_handlerCount; i++) {
+    m_disconnectHandlers[i]();
+  }
+}
@@ -0,0 +1,88 @@
+/* =================================================================================
+ *    B.L.A.C.Box: Brian Lubkeman's Astromech Controller
+ * =================================================================================
+ * Scheduler.h - Library for the cooperative task scheduler
+ * Created by Brian Lubkeman, 16 June 2021
+ * Inspired by S.H.A.D.O.W. controller code written by KnightShade
+ * Released into the public domain.
+ */
+#ifndef __BLACBOX_SCHEDULER_H__
+#define __BLACBOX_SCHEDULER_H__
+
+#include "../toolbox/DebugUtils.h"
+#include "../controller/Controller.h"
+#include "../hal/SerialQueue.h"
+#include "Timeline.h"
+
+#define DEBUG
+//#define PROFILE_LOOP    // Uncomment to collect and report per-stage loop timing.
+
+#if defined(PROFILE_LOOP)
+#include "../toolbox/LoopProfiler.h"
+#endif
+
+const byte SCHEDULER_MAX_TASKS    = 4;
+const byte SCHEDULER_MAX_HANDLERS = 4;
+const byte SCHEDULER_MAX_QUEUES   = 4;
+
+typedef void (*Task_Callback)(const Input_Frame_Struct* frame);
+typedef void (*Disconnect_Callback)(void);
+
+typedef struct {
+  Task_Callback callback;
+  unsigned long period;
+  unsigned long lastRunTime;
+  byte stage;
+} Scheduler_Task_Struct;
+
+enum scheduler_timing_index_e {
+  iDriveTask,     // 0 - Drive task period.
+  iDomeTask,      // 1 - Dome task period.
+  iMarcduinoTask, // 2 - Marcduino task period.
+  iProfileReport  // 3 - Loop profiler report interval.
+};
+
+/* ================================================================================
+ *                                 Scheduler Class
+ * ================================================================================ */
+class Scheduler
+{
+  private:
+    Controller* m_controller;
+    const Config_Section* m_settings;
+
+    Scheduler_Task_Struct m_tasks[SCHEDULER_MAX_TASKS];
+    byte m_taskCount;
+
+    Disconnect_Callback m_disconnectHandlers[SCHEDULER_MAX_HANDLERS];
+    byte m_handlerCount;
+
+    SerialQueue* m_queues[SCHEDULER_MAX_QUEUES];
+    byte m_queueCount;
+
+    Timeline* m_timeline;
+
+    void m_dispatchDisconnect(void);
+
+    #if defined(PROFILE_LOOP)
+    LoopProfiler m_profiler;
+    byte m_readStage;
+    byte m_passStage;
+    unsigned long m_reportTime;
+    #endif
+
+  public:
+    Scheduler(Controller* pController, const Config_Section* pSettings);
+    ~Scheduler(void);
+
+    bool addTask(Task_Callback callback, unsigned long period, const char* name);
+    bool attachOnDisconnect(Disconnect_Callback callback);
+    bool attachQueue(SerialQueue* queue);
+    void attachTimeline(Timeline* timeline);
+    void run(void);
+
+    #if defined(PROFILE_LOOP)
+    LoopProfiler* profiler(void);
+    #endif
+};
+#endif
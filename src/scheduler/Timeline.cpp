@@ -0,0 +1,223 @@
+/* =================================================================================
+ *    B.L.A.C.Box: Brian Lubkeman's Astromech Controller
+ * =================================================================================
+ * Timeline.cpp - Time-ordered queue of pending show events
+ * Created by Brian Lubkeman, 16 June 2021
+ * Inspired by S.H.A.D.O.W. controller code written by KnightShade
+ * Released into the public domain.
+ */
+#include "Timeline.h"
+
+/* ================================================================================
+ *                                  Timeline Class
+ * ================================================================================ */
+
+// =====================
+//      Constructor
+// =====================
+Timeline::Timeline(Timeline_Event_Struct events[], byte size)
+{
+  m_events = events;
+  m_size = size;
+  m_count = 0;
+  m_highWater = 0;
+  m_nextOrder = 0;
+  m_dropped = 0;
+}
+
+// ====================
+//      Destructor
+// ====================
+Timeline::~Timeline(void) {}
+
+// ====================
+//      schedule()
+// ====================
+bool Timeline::schedule(unsigned long delay, Timeline_Callback callback, byte action, byte arg1, byte arg2, byte tag)
+{
+  if ( callback == NULL ) {
+    return false;
+  }
+
+  if ( m_count >= m_size ) {
+    m_dropped++;
+
+    #if defined(DEBUG)
+    Debug.print(DBG_WARNING, F("Timeline"), F("schedule()"), F("Timeline full"));
+    #endif
+
+    return false;
+  }
+
+  // -----------------------------------------------------
+  // Add the event at the bottom and let it rise into place.
+  // -----------------------------------------------------
+
+  Timeline_Event_Struct* event = &m_events[m_count];
+  event->due      = Hal_Clock::millis() + delay;
+  event->order    = m_nextOrder++;
+  event->callback = callback;
+  event->action   = action;
+  event->arg1     = arg1;
+  event->arg2     = arg2;
+  event->tag      = tag;
+
+  m_count++;
+  m_siftUp(m_count - 1);
+
+  if ( m_count > m_highWater ) {
+    m_highWater = m_count;
+  }
+  return true;
+}
+
+// ==================
+//      cancel()
+// ==================
+byte Timeline::cancel(byte tag)
+{
+  // -----------------------------------------------------------------
+  // Keep every event with another tag, then rebuild the heap. This is
+  // rare enough that a full rebuild is simpler than removing in place.
+  // -----------------------------------------------------------------
+
+  byte kept = 0;
+  for (byte i = 0; i < m_count; i++) {
+    if ( m_events[i].tag != tag ) {
+      m_events[kept++] = m_events[i];
+    }
+  }
+
+  byte removed = m_count - kept;
+  m_count = kept;
+
+  for (int i = (m_count / 2) - 1; i >= 0; i--) {
+    m_siftDown(i);
+  }
+  return removed;
+}
+
+// ===============
+//      run()
+// ===============
+void Timeline::run(void)
+{
+  unsigned long currentTime = Hal_Clock::millis();
+
+  for (byte i = 0; i < TIMELINE_MAX_PER_PASS && m_count > 0; i++) {
+
+    if ( (long)(currentTime - m_events[0].due) < 0 ) {
+      return;
+    }
+
+    // ------------------------------------------------------------
+    // Take the event off the heap before running it, so its callback
+    // is free to schedule more.
+    // ------------------------------------------------------------
+
+    Timeline_Event_Struct event = m_events[0];
+    m_count--;
+    if ( m_count > 0 ) {
+      m_events[0] = m_events[m_count];
+      m_siftDown(0);
+    }
+
+    event.callback(event.action, event.arg1, event.arg2);
+  }
+}
+
+// ===================
+//      pending()
+// ===================
+byte Timeline::pending(void)
+{
+  return m_count;
+}
+
+// =====================
+//      available()
+// =====================
+byte Timeline::available(void)
+{
+  return ( m_size - m_count );
+}
+
+// =====================
+//      highWater()
+// =====================
+byte Timeline::highWater(void)
+{
+  return m_highWater;
+}
+
+// ===================
+//      dropped()
+// ===================
+unsigned long Timeline::dropped(void)
+{
+  return m_dropped;
+}
+
+// ====================
+//      m_before()
+// ====================
+bool Timeline::m_before(byte a, byte b)
+{
+  // Earlier due time first. Equal times keep the order they were
+  // scheduled in. Both compare safely across millis() rollover.
+
+  long difference = (long)(m_events[a].due - m_events[b].due);
+  if ( difference != 0 ) {
+    return ( difference < 0 );
+  }
+  return ( (int16_t)(m_events[a].order - m_events[b].order) < 0 );
+}
+
+// ==================
+//      m_swap()
+// ==================
+void Timeline::m_swap(byte a, byte b)
+{
+  Timeline_Event_Struct temp = m_events[a];
+  m_events[a] = m_events[b];
+  m_events[b] = temp;
+}
+
+// ====================
+//      m_siftUp()
+// ====================
+void Timeline::m_siftUp(byte index)
+{
+  while ( index > 0 ) {
+    byte parent = (index - 1) / 2;
+    if ( ! m_before(index, parent) ) {
+      return;
+    }
+    m_swap(index, parent);
+    index = parent;
+  }
+}
+
+// ======================
+//      m_siftDown()
+// ======================
+void Timeline::m_siftDown(byte index)
+{
+  while ( true ) {
+    byte smallest = index;
+    int left  = (2 * index) + 1;
+    int right = left + 1;
+
+    if ( left < m_count && m_before(left, smallest) ) {
+      smallest = left;
+    }
+    if ( right < m_count && m_before(right, smallest) ) {
+      smallest = right;
+    }
+    if ( smallest == index ) {
+      return;
+    }
+    m_swap(index, smallest);
+    index = smallest;
+  }
+}
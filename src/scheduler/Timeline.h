@@ -0,0 +1,79 @@
+/* =================================================================================
+ *    B.L.A.C.Box: Brian Lubkeman's Astromech Controller
+ * =================================================================================
+ * Timeline.h - Time-ordered queue of pending show events
+ * Created by Brian Lubkeman, 16 June 2021
+ * Inspired by S.H.A.D.O.W. controller code written by KnightShade
+ * Released into the public domain.
+ * =================================================================================
+ *
+ * Every timed effect (sound, panels, holoprojectors, logic displays, dome motion)
+ * is an event with a due time. Events sit in a min-heap keyed by due time, so
+ * each pass only looks at the events that are due. Events due at the same time
+ * run in the order they were scheduled. A few events run per pass at most, which
+ * spreads a burst of commands over several passes instead of one long one.
+ *
+ * An event's callback may schedule more events, so one routine can cue another.
+ * Each event carries a tag so its owner can cancel everything it scheduled.
+ */
+#ifndef __BLACBOX_TIMELINE_H__
+#define __BLACBOX_TIMELINE_H__
+
+#include "../toolbox/DebugUtils.h"
+#include "../hal/Hal.h"
+
+#define DEBUG
+
+const byte TIMELINE_MAX_PER_PASS = 2;   // Most events run in one pass.
+
+typedef void (*Timeline_Callback)(byte action, byte arg1, byte arg2);
+
+typedef struct {
+  unsigned long due;
+  uint16_t order;
+  Timeline_Callback callback;
+  byte action;
+  byte arg1;
+  byte arg2;
+  byte tag;
+} Timeline_Event_Struct;
+
+enum timeline_tag_e {
+  tagNone,          // 0 - Not cancelled by anyone.
+  tagMarcduino,     // 1 - Marcduino commands.
+  tagPanelRoutine,  // 2 - Custom panel routine steps.
+  tagHolo           // 3 - Holoprojector automation.
+};
+
+/* ================================================================================
+ *                                  Timeline Class
+ * ================================================================================ */
+class Timeline
+{
+  private:
+    Timeline_Event_Struct* m_events;
+    byte m_size;
+    byte m_count;
+    byte m_highWater;
+    uint16_t m_nextOrder;
+    unsigned long m_dropped;
+
+    bool m_before(byte a, byte b);
+    void m_swap(byte a, byte b);
+    void m_siftUp(byte index);
+    void m_siftDown(byte index);
+
+  public:
+    Timeline(Timeline_Event_Struct events[], byte size);
+    ~Timeline(void);
+
+    bool schedule(unsigned long delay, Timeline_Callback callback, byte action, byte arg1 = 0, byte arg2 = 0, byte tag = tagNone);
+    byte cancel(byte tag);
+    void run(void);
+
+    byte pending(void);
+    byte available(void);
+    byte highWater(void);
+    unsigned long dropped(void);
+};
+#endif
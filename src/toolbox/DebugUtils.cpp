@@ -28,6 +28,7 @@
    INCLUDE
  ******************************************************************************/
 
+#include <stdio.h>
 #include "DebugUtils.h"
 
 /******************************************************************************
@@ -35,7 +36,7 @@
  ******************************************************************************/
 
 static int const DEFAULT_DEBUG_LEVEL   = DBG_INFO;
-static Stream *  DEFAULT_OUTPUT_STREAM = &Serial;
+static Hal_Stream * const DEFAULT_OUTPUT_STREAM = &Serial;
 
 /******************************************************************************
    CTOR/DTOR
@@ -55,7 +56,7 @@ void Arduino_DebugUtils::setDebugLevel(int const debug_level) {
   _debug_level = debug_level;
 }
 
-void Arduino_DebugUtils::setDebugOutputStream(Stream * stream) {
+void Arduino_DebugUtils::setDebugOutputStream(Hal_Stream * stream) {
   _debug_output_stream = stream;
 }
 
@@ -101,70 +102,113 @@ void Arduino_DebugUtils::print(int const debug_level, const __FlashStringHelper
 
 void Arduino_DebugUtils::print(int const debug_level, const __FlashStringHelper * msgText)
 {
-  if (!shouldPrint(debug_level))
+  if (!startLine(debug_level))
     return;
 
-  if (_timestamp_on)
-    printTimestamp();
-
-  DEFAULT_OUTPUT_STREAM->println(msgText);
+  printFlash(msgText);
+  endLine();
 }
 
-void Arduino_DebugUtils::print(int const debug_level, const __FlashStringHelper * msgText, String value)
+void Arduino_DebugUtils::print(int const debug_level, const __FlashStringHelper * msgText, const char * value)
 {
-  if (!shouldPrint(debug_level))
+  if (!startLine(debug_level))
     return;
 
-  if (_timestamp_on)
-    printTimestamp();
+  printFlash(msgText);
+  printText(value);
+  endLine();
+}
 
-  String out = msgText;
-  out += value;
-  DEFAULT_OUTPUT_STREAM->println(out);
+void Arduino_DebugUtils::print(int const debug_level, const __FlashStringHelper * msgText, long value)
+{
+  if (!startLine(debug_level))
+    return;
+
+  printFlash(msgText);
+  printNumber(value);
+  endLine();
 }
 
-void Arduino_DebugUtils::print(int const debug_level, const __FlashStringHelper * className, const __FlashStringHelper * funcName, String value)
+void Arduino_DebugUtils::print(int const debug_level, const __FlashStringHelper * msgText, const __FlashStringHelper * value)
 {
-    if (!shouldPrint(debug_level))
+  if (!startLine(debug_level))
     return;
 
-  if (_timestamp_on)
-    printTimestamp();
+  printFlash(msgText);
+  printFlash(value);
+  endLine();
+}
 
-  String out = className; out += F("::");
-  out += funcName;        out += F(" - ");
-  out += value;
-  DEFAULT_OUTPUT_STREAM->println(out);
+void Arduino_DebugUtils::print(int const debug_level, const __FlashStringHelper * className, const __FlashStringHelper * funcName, const char * value)
+{
+  if (!startLine(debug_level))
+    return;
+
+  printSource(className, funcName);
+  printText(value);
+  endLine();
 }
 
 void Arduino_DebugUtils::print(int const debug_level, const __FlashStringHelper * className, const __FlashStringHelper * funcName, const __FlashStringHelper * msgText)
 {
-  if (!shouldPrint(debug_level))
+  if (!startLine(debug_level))
     return;
 
-  if (_timestamp_on)
-    printTimestamp();
+  printSource(className, funcName);
+  printFlash(msgText);
+  endLine();
+}
+
+void Arduino_DebugUtils::print(int const debug_level, const __FlashStringHelper * className, const __FlashStringHelper * funcName, const __FlashStringHelper * msgText, const char * value)
+{
+  if (!startLine(debug_level))
+    return;
 
-  String out = className; out += F("::");
-  out += funcName;        out += F(" - ");
-  out += msgText;
-  DEFAULT_OUTPUT_STREAM->println(out);
+  printSource(className, funcName);
+  printFlash(msgText);
+  printText(value);
+  endLine();
 }
 
-void Arduino_DebugUtils::print(int const debug_level, const __FlashStringHelper * className, const __FlashStringHelper * funcName, const __FlashStringHelper * msgText, String value)
+void Arduino_DebugUtils::print(int const debug_level, const __FlashStringHelper * className, const __FlashStringHelper * funcName, const __FlashStringHelper * msgText, long value)
 {
-    if (!shouldPrint(debug_level))
+  if (!startLine(debug_level))
     return;
 
-  if (_timestamp_on)
-    printTimestamp();
+  printSource(className, funcName);
+  printFlash(msgText);
+  printNumber(value);
+  endLine();
+}
 
-  String out = className; out += F("::");
-  out += funcName;        out += F(" - ");
-  out += msgText;         out += value;
-  DEFAULT_OUTPUT_STREAM->println(out);
+void Arduino_DebugUtils::print(int const debug_level, const __FlashStringHelper * className, const __FlashStringHelper * funcName, const __FlashStringHelper * msgText, const __FlashStringHelper * value)
+{
+  if (!startLine(debug_level))
+    return;
+
+  printSource(className, funcName);
+  printFlash(msgText);
+  printFlash(value);
+  endLine();
 }
 
+#if defined(ARDUINO)
+void Arduino_DebugUtils::print(int const debug_level, const __FlashStringHelper * msgText, const String & value)
+{
+  print(debug_level, msgText, value.c_str());
+}
+
+void Arduino_DebugUtils::print(int const debug_level, const __FlashStringHelper * className, const __FlashStringHelper * funcName, const String & value)
+{
+  print(debug_level, className, funcName, value.c_str());
+}
+
+void Arduino_DebugUtils::print(int const debug_level, const __FlashStringHelper * className, const __FlashStringHelper * funcName, const __FlashStringHelper * msgText, const String & value)
+{
+  print(debug_level, className, funcName, msgText, value.c_str());
+}
+#endif
+
 /******************************************************************************
    PRIVATE MEMBER FUNCTIONS
  ******************************************************************************/
@@ -175,16 +219,62 @@ void Arduino_DebugUtils::vPrint(char const * fmt, va_list args) {
 
   vsnprintf(msg_buf, MSG_BUF_SIZE, fmt, args);
 
-  _debug_output_stream->println(msg_buf);
+  printText(msg_buf);
+  endLine();
 }
 
 void Arduino_DebugUtils::printTimestamp()
 {
   char timestamp[20];
-  snprintf(timestamp, 20, "[ %lu ] ", millis());
+  snprintf(timestamp, 20, "[ %lu ] ", Hal_Clock::millis());
   _debug_output_stream->print(timestamp);
 }
 
+bool Arduino_DebugUtils::startLine(int const debug_level)
+{
+  if (!shouldPrint(debug_level) || _debug_output_stream == NULL)
+    return false;
+
+  if (_timestamp_on)
+    printTimestamp();
+
+  return true;
+}
+
+void Arduino_DebugUtils::printFlash(const __FlashStringHelper * text)
+{
+#if defined(ARDUINO)
+  _debug_output_stream->print(text);
+#else
+  _debug_output_stream->print(reinterpret_cast<const char *>(text));
+#endif
+}
+
+void Arduino_DebugUtils::printText(const char * text)
+{
+  _debug_output_stream->print(text);
+}
+
+void Arduino_DebugUtils::printNumber(long value)
+{
+  char number[12];
+  snprintf(number, sizeof(number), "%ld", value);
+  _debug_output_stream->print(number);
+}
+
+void Arduino_DebugUtils::printSource(const __FlashStringHelper * className, const __FlashStringHelper * funcName)
+{
+  printFlash(className);
+  _debug_output_stream->print("::");
+  printFlash(funcName);
+  _debug_output_stream->print(" - ");
+}
+
+void Arduino_DebugUtils::endLine()
+{
+  _debug_output_stream->print("\r\n");
+}
+
 bool Arduino_DebugUtils::shouldPrint(int const debug_level) const
 {
   return ((debug_level >= DBG_ERROR) && (debug_level <= DBG_VERBOSE) && (debug_level <= _debug_level));
@@ -31,7 +31,7 @@
    INCLUDE
  ******************************************************************************/
 
-#include <Arduino.h>
+#include "../hal/Hal.h"
 
 #include <stdarg.h>
 
@@ -60,28 +60,48 @@ class Arduino_DebugUtils {
 
     void setDebugLevel(int const debug_level);
 
-    void setDebugOutputStream(Stream * stream);
+    void setDebugOutputStream(Hal_Stream * stream);
 
     void timestampOn();
     void timestampOff();
 
 //    void print(int const debug_level, const char * fmt, ...);
 //    void print(int const debug_level, const __FlashStringHelper * fmt, ...);
+
+    // Each piece is written straight to the stream. Nothing is built on the heap.
+
     void print(int const debug_level, const __FlashStringHelper * msgText);
-    void print(int const debug_level, const __FlashStringHelper * msgText, String value);
-    void print(int const debug_level, const __FlashStringHelper * className, const __FlashStringHelper * funcName, String value);
+    void print(int const debug_level, const __FlashStringHelper * msgText, const char * value);
+    void print(int const debug_level, const __FlashStringHelper * msgText, long value);
+    void print(int const debug_level, const __FlashStringHelper * msgText, const __FlashStringHelper * value);
+    void print(int const debug_level, const __FlashStringHelper * className, const __FlashStringHelper * funcName, const char * value);
     void print(int const debug_level, const __FlashStringHelper * className, const __FlashStringHelper * funcName, const __FlashStringHelper * msgText);
-    void print(int const debug_level, const __FlashStringHelper * className, const __FlashStringHelper * funcName, const __FlashStringHelper * msgText, String value);
+    void print(int const debug_level, const __FlashStringHelper * className, const __FlashStringHelper * funcName, const __FlashStringHelper * msgText, const char * value);
+    void print(int const debug_level, const __FlashStringHelper * className, const __FlashStringHelper * funcName, const __FlashStringHelper * msgText, long value);
+    void print(int const debug_level, const __FlashStringHelper * className, const __FlashStringHelper * funcName, const __FlashStringHelper * msgText, const __FlashStringHelper * value);
+
+    #if defined(ARDUINO)
+    // For the controller test display, which still builds its lines as String.
+    void print(int const debug_level, const __FlashStringHelper * msgText, const String & value);
+    void print(int const debug_level, const __FlashStringHelper * className, const __FlashStringHelper * funcName, const String & value);
+    void print(int const debug_level, const __FlashStringHelper * className, const __FlashStringHelper * funcName, const __FlashStringHelper * msgText, const String & value);
+    #endif
 
   private:
 
-    bool      _timestamp_on;
-    int       _debug_level;
-    Stream *  _debug_output_stream;
+    bool         _timestamp_on;
+    int          _debug_level;
+    Hal_Stream * _debug_output_stream;
 
     void vPrint(char const * fmt, va_list args);
     void printTimestamp();
     bool shouldPrint(int const debug_level) const;
+    bool startLine(int const debug_level);
+    void printFlash(const __FlashStringHelper * text);
+    void printText(const char * text);
+    void printNumber(long value);
+    void printSource(const __FlashStringHelper * className, const __FlashStringHelper * funcName);
+    void endLine();
 
 };
 
@@ -0,0 +1,171 @@
+/* =================================================================================
+ *    B.L.A.C.Box: Brian Lubkeman's Astromech Controller
+ * =================================================================================
+ * LoopProfiler.cpp - Library for per-stage loop timing histograms
+ * Created by Brian Lubkeman, 16 June 2021
+ * Inspired by S.H.A.D.O.W. controller code written by KnightShade
+ * Released into the public domain.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "LoopProfiler.h"
+
+/* ================================================================================
+ *                               Loop Profiler Class
+ * ================================================================================ */
+
+// =====================
+//      Constructor
+// =====================
+LoopProfiler::LoopProfiler(void)
+{
+  m_stageCount = 0;
+  reset();
+}
+
+// ====================
+//      Destructor
+// ====================
+LoopProfiler::~LoopProfiler(void) {}
+
+// ====================
+//      addStage()
+// ====================
+byte LoopProfiler::addStage(const char* name)
+{
+  if ( m_stageCount >= PROFILER_MAX_STAGES ) {
+    return PROFILER_MAX_STAGES - 1;
+  }
+  m_names[m_stageCount] = name;
+  return m_stageCount++;
+}
+
+// ==================
+//      record()
+// ==================
+void LoopProfiler::record(byte stage, unsigned long microseconds)
+{
+  if ( stage >= m_stageCount ) {
+    return;
+  }
+
+  // Saturate rather than wrap so a long run still reports sensibly.
+
+  if ( m_count[stage] == 0xFFFF ) {
+    return;
+  }
+
+  m_histogram[stage][m_bucket(microseconds)]++;
+  m_count[stage]++;
+
+  if ( microseconds < m_min[stage] ) {
+    m_min[stage] = microseconds;
+  }
+  if ( microseconds > m_max[stage] ) {
+    m_max[stage] = microseconds;
+  }
+}
+
+// =================
+//      reset()
+// =================
+void LoopProfiler::reset(void)
+{
+  memset(m_histogram, 0, sizeof(m_histogram));
+  for (byte i = 0; i < PROFILER_MAX_STAGES; i++) {
+    m_count[i] = 0;
+    m_min[i] = 0xFFFFFFFF;
+    m_max[i] = 0;
+  }
+}
+
+// ==============================
+//      Statistic accessors
+// ==============================
+uint16_t LoopProfiler::count(byte stage)          { return m_count[stage]; }
+unsigned long LoopProfiler::minimum(byte stage)   { return ( m_count[stage] > 0 ? m_min[stage] : 0 ); }
+unsigned long LoopProfiler::maximum(byte stage)   { return m_max[stage]; }
+
+// ======================
+//      percentile()
+// ======================
+unsigned long LoopProfiler::percentile(byte stage, byte percent)
+{
+  if ( m_count[stage] == 0 ) {
+    return 0;
+  }
+
+  // -----------------------------------------------------------
+  // Walk the buckets until the cumulative count reaches the
+  // requested rank. Never report beyond the observed maximum.
+  // -----------------------------------------------------------
+
+  unsigned long rank = ((unsigned long)m_count[stage] * percent + 99) / 100;
+  unsigned long cumulative = 0;
+
+  for (byte b = 0; b < PROFILER_BUCKETS; b++) {
+    cumulative += m_histogram[stage][b];
+    if ( cumulative >= rank ) {
+      unsigned long limit = m_bucketLimit(b);
+      return ( limit < m_max[stage] ? limit : m_max[stage] );
+    }
+  }
+  return m_max[stage];
+}
+
+// ==================
+//      report()
+// ==================
+void LoopProfiler::report(Hal_SerialPort* out)
+{
+  char line[64];
+
+  out->print("Stage         count     min     p50     p99     max (us)\r\n");
+  for (byte i = 0; i < m_stageCount; i++) {
+    snprintf(line, sizeof(line), "%-10s %8u %7lu %7lu %7lu %7lu\r\n",
+             m_names[i],
+             m_count[i],
+             minimum(i),
+             percentile(i, 50),
+             percentile(i, 99),
+             maximum(i));
+    out->print(line);
+  }
+}
+
+// ====================
+//      m_bucket()
+// ====================
+byte LoopProfiler::m_bucket(unsigned long microseconds)
+{
+  // ---------------------------------------------------------------
+  // Below 16 us, buckets are 4 us wide. Above that, each power of
+  // two is split into four buckets using the two bits below the top.
+  // ---------------------------------------------------------------
+
+  if ( microseconds < 16 ) {
+    return microseconds >> 2;
+  }
+
+  byte octave = 4;
+  while ( octave < 31 && (microseconds >> (octave + 1)) > 0 ) {
+    octave++;
+  }
+
+  byte bucket = 4 + ((octave - 4) * 4) + ((microseconds >> (octave - 2)) & 3);
+  return ( bucket < PROFILER_BUCKETS ? bucket : PROFILER_BUCKETS - 1 );
+}
+
+// =========================
+//      m_bucketLimit()
+// =========================
+unsigned long LoopProfiler::m_bucketLimit(byte bucket)
+{
+  if ( bucket < 4 ) {
+    return ((unsigned long)(bucket + 1) * 4) - 1;
+  }
+
+  byte octave = 4 + ((bucket - 4) / 4);
+  byte sub    = (bucket - 4) % 4;
+  return ((unsigned long)(5 + sub) << (octave - 2)) - 1;
+}
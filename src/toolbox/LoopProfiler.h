@@ -0,0 +1,55 @@
+/* =================================================================================
+ *    B.L.A.C.Box: Brian Lubkeman's Astromech Controller
+ * =================================================================================
+ * LoopProfiler.h - Library for per-stage loop timing histograms
+ * Created by Brian Lubkeman, 16 June 2021
+ * Inspired by S.H.A.D.O.W. controller code written by KnightShade
+ * Released into the public domain.
+ * =================================================================================
+ *
+ * Each stage keeps a histogram of latencies in microseconds. Buckets are spaced
+ * four per power of two (about 19% wide) from 16 us to 65 ms, so memory use is
+ * fixed no matter how many samples are taken. The exact minimum and maximum are
+ * tracked alongside. Percentiles are reported as the upper edge of the bucket
+ * holding them.
+ */
+#ifndef __BLACBOX_LOOP_PROFILER_H__
+#define __BLACBOX_LOOP_PROFILER_H__
+
+#include "../hal/Hal.h"
+
+const byte PROFILER_MAX_STAGES = 6;
+const byte PROFILER_BUCKETS    = 48;
+
+/* ================================================================================
+ *                               Loop Profiler Class
+ * ================================================================================ */
+class LoopProfiler
+{
+  private:
+    const char* m_names[PROFILER_MAX_STAGES];
+    uint16_t m_histogram[PROFILER_MAX_STAGES][PROFILER_BUCKETS];
+    uint16_t m_count[PROFILER_MAX_STAGES];
+    unsigned long m_min[PROFILER_MAX_STAGES];
+    unsigned long m_max[PROFILER_MAX_STAGES];
+    byte m_stageCount;
+
+    static byte m_bucket(unsigned long microseconds);
+    static unsigned long m_bucketLimit(byte bucket);
+
+  public:
+    LoopProfiler(void);
+    ~LoopProfiler(void);
+
+    byte addStage(const char* name);
+    void record(byte stage, unsigned long microseconds);
+    void reset(void);
+
+    uint16_t count(byte stage);
+    unsigned long minimum(byte stage);
+    unsigned long maximum(byte stage);
+    unsigned long percentile(byte stage, byte percent);
+
+    void report(Hal_SerialPort* out);
+};
+#endif
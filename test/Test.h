@@ -0,0 +1,82 @@
+/* =================================================================================
+ *    B.L.A.C.Box: Brian Lubkeman's Astromech Controller
+ * =================================================================================
+ * Test.h - A very small test harness for the host build
+ * Created by Brian Lubkeman, 16 June 2021
+ * Inspired by S.H.A.D.O.W. controller code written by KnightShade
+ * Released into the public domain.
+ * =================================================================================
+ *
+ * Each test file is its own program. TEST(name) declares a test and adds it to
+ * the list, CHECK() and CHECK_EQUAL() record a failure and carry on, and
+ * TEST_MAIN() runs every test in the order declared. The exit code is the number
+ * of failed tests, so ctest sees any failure.
+ */
+#ifndef __BLACBOX_TEST_H__
+#define __BLACBOX_TEST_H__
+
+#include <stdio.h>
+
+typedef void (*Test_Function)(void);
+
+typedef struct {
+  const char* name;
+  Test_Function function;
+} Test_Case_Struct;
+
+const int TEST_MAX_CASES = 64;
+
+static Test_Case_Struct s_testCases[TEST_MAX_CASES];
+static int s_testCount = 0;
+static int s_testFailures = 0;
+
+struct Test_Register
+{
+  Test_Register(const char* name, Test_Function function)
+  {
+    if ( s_testCount < TEST_MAX_CASES ) {
+      s_testCases[s_testCount].name = name;
+      s_testCases[s_testCount].function = function;
+      s_testCount++;
+    }
+  }
+};
+
+#define TEST(name) \
+  static void test_##name(void); \
+  static Test_Register register_##name(#name, test_##name); \
+  static void test_##name(void)
+
+#define CHECK(condition) \
+  do { \
+    if ( ! (condition) ) { \
+      printf("  %s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+      s_testFailures++; \
+    } \
+  } while (0)
+
+#define CHECK_EQUAL(expected, actual) \
+  do { \
+    long e_ = (long)(expected); \
+    long a_ = (long)(actual); \
+    if ( e_ != a_ ) { \
+      printf("  %s:%d: CHECK_EQUAL(%s, %s) failed: expected %ld, got %ld\n", __FILE__, __LINE__, #expected, #actual, e_, a_); \
+      s_testFailures++; \
+    } \
+  } while (0)
+
+#define TEST_MAIN() \
+  int main(void) \
+  { \
+    int failed = 0; \
+    for (int i = 0; i < s_testCount; i++) { \
+      int before = s_testFailures; \
+      s_testCases[i].function(); \
+      bool passed = ( s_testFailures == before ); \
+      printf("%s %s\n", ( passed ? "PASS" : "FAIL" ), s_testCases[i].name); \
+      failed += ( passed ? 0 : 1 ); \
+    } \
+    printf("%d of %d tests passed\n", s_testCount - failed, s_testCount); \
+    return failed; \
+  }
+#endif
@@ -0,0 +1,221 @@
+/* =================================================================================
+ *    B.L.A.C.Box: Brian Lubkeman's Astromech Controller
+ * =================================================================================
+ * test_config.cpp - Settings changes, saves, and what a restart reads back
+ * Created by Brian Lubkeman, 16 June 2021
+ * Inspired by S.H.A.D.O.W. controller code written by KnightShade
+ * Released into the public domain.
+ */
+#include "Test.h"
+#include "../src/config/Config.h"
+
+const byte testBytes[] PROGMEM = { 10, 20, 30 };
+const int testInts[] PROGMEM = { -500, 1000, 25, 7, 0, 300 };
+const unsigned long testLongs[] PROGMEM = { 100000UL, 5 };
+const byte testMany[CONFIG_MAX_EDITS + 1] PROGMEM = { 0 };
+
+const uint16_t TEST_VERSION = 3;
+
+// -------------------------------------------------------------------------
+// One sketch's worth of settings. Each test starts the sketch over on the
+// same EEPROM, as a reset would, by building a new one.
+// -------------------------------------------------------------------------
+
+class Test_Sketch
+{
+  public:
+    Config config;
+    Config_Section bytes;
+    Config_Section ints;
+    Config_Section longs;
+
+    Test_Sketch(uint16_t version = TEST_VERSION) :
+      config(version),
+      bytes(&config, testBytes, 3),
+      ints(&config, testInts, 6),
+      longs(&config, testLongs, 2) {}
+};
+
+static const uint16_t EEPROM_SAVED = CONFIG_EEPROM_BASE + sizeof(Config_Header_Struct);
+
+static byte s_snapshot[4096];
+
+static void m_snapshot(void)
+{
+  for (uint16_t i = 0; i < Hal_Eeprom::length(); i++) {
+    s_snapshot[i] = Hal_Eeprom::read(i);
+  }
+}
+
+static bool m_unchanged(void)
+{
+  for (uint16_t i = 0; i < Hal_Eeprom::length(); i++) {
+    if ( Hal_Eeprom::read(i) != s_snapshot[i] ) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/* ================================================================================
+ *                                      Tests
+ * ================================================================================ */
+
+TEST(fresh_eeprom_reads_the_defaults)
+{
+  Hal_Eeprom::erase();
+  Test_Sketch sketch;
+
+  CHECK_EQUAL(20, sketch.bytes.get(1));
+  CHECK_EQUAL(-500, sketch.ints.get(0));
+  CHECK_EQUAL(100000L, sketch.longs.get(0));
+  CHECK(! sketch.config.isCustomized());
+}
+
+TEST(set_takes_effect_and_writes_nothing)
+{
+  // ----------------------------------------------------------------
+  // A change is read back at once, but EEPROM is untouched until
+  // save(). Writing it costs over 3 ms a byte on the Mega.
+  // ----------------------------------------------------------------
+
+  Hal_Eeprom::erase();
+  Test_Sketch sketch;
+  m_snapshot();
+
+  CHECK(sketch.ints.set(0, 1234));
+  CHECK(sketch.bytes.set(2, 255));
+  CHECK(sketch.longs.set(1, 70000));
+  CHECK_EQUAL(1234, sketch.ints.get(0));
+  CHECK_EQUAL(255, sketch.bytes.get(2));
+  CHECK_EQUAL(70000L, sketch.longs.get(1));
+  CHECK(sketch.config.isDirty());
+  CHECK(m_unchanged());
+
+  // Out of range for the type is refused.
+
+  CHECK(! sketch.bytes.set(0, 256));
+  CHECK(! sketch.ints.set(0, 40000));
+  CHECK(! sketch.longs.set(0, -1));
+  CHECK_EQUAL(10, sketch.bytes.get(0));
+}
+
+TEST(unsaved_changes_do_not_survive_a_restart)
+{
+  Hal_Eeprom::erase();
+  {
+    Test_Sketch sketch;
+    sketch.ints.set(3, 99);
+  }
+
+  Test_Sketch restarted;
+  CHECK_EQUAL(7, restarted.ints.get(3));
+  CHECK(! restarted.config.isCustomized());
+}
+
+TEST(saved_changes_survive_a_restart)
+{
+  Hal_Eeprom::erase();
+  {
+    Test_Sketch sketch;
+    sketch.ints.set(3, -99);
+    sketch.longs.set(0, 4000000000UL);
+    CHECK(sketch.config.save());
+    CHECK(! sketch.config.isDirty());
+    CHECK_EQUAL(-99, sketch.ints.get(3));
+  }
+
+  Test_Sketch restarted;
+  CHECK(restarted.config.isCustomized());
+  CHECK_EQUAL(-99, restarted.ints.get(3));
+  CHECK_EQUAL((long)4000000000UL, restarted.longs.get(0));
+  CHECK_EQUAL(1000, restarted.ints.get(1));
+
+  // A change on top of the saved image, put back again, leaves nothing to save.
+
+  restarted.ints.set(3, 5);
+  CHECK(restarted.config.isDirty());
+  restarted.ints.set(3, -99);
+  CHECK(! restarted.config.isDirty());
+}
+
+TEST(crc_mismatch_falls_back_to_the_defaults)
+{
+  Hal_Eeprom::erase();
+  {
+    Test_Sketch sketch;
+    sketch.bytes.set(0, 77);
+    sketch.config.save();
+  }
+
+  // Flip one bit of the saved settings.
+
+  Hal_Eeprom::update(EEPROM_SAVED, Hal_Eeprom::read(EEPROM_SAVED) ^ 0x01);
+
+  Test_Sketch restarted;
+  CHECK(! restarted.config.isCustomized());
+  CHECK_EQUAL(10, restarted.bytes.get(0));
+  CHECK_EQUAL(-500, restarted.ints.get(0));
+}
+
+TEST(version_mismatch_falls_back_to_the_defaults)
+{
+  Hal_Eeprom::erase();
+  {
+    Test_Sketch sketch;
+    sketch.bytes.set(0, 77);
+    sketch.config.save();
+  }
+
+  Test_Sketch upgraded(TEST_VERSION + 1);
+  CHECK(! upgraded.config.isCustomized());
+  CHECK_EQUAL(10, upgraded.bytes.get(0));
+
+  // The same version still reads the image.
+
+  Test_Sketch same;
+  CHECK_EQUAL(77, same.bytes.get(0));
+}
+
+TEST(restore_defaults_drops_the_saved_image)
+{
+  Hal_Eeprom::erase();
+  {
+    Test_Sketch sketch;
+    sketch.bytes.set(0, 77);
+    sketch.config.save();
+    sketch.bytes.set(1, 88);
+    sketch.config.restoreDefaults();
+    CHECK_EQUAL(10, sketch.bytes.get(0));
+    CHECK_EQUAL(20, sketch.bytes.get(1));
+  }
+
+  Test_Sketch restarted;
+  CHECK_EQUAL(10, restarted.bytes.get(0));
+}
+
+TEST(change_table_fills_and_save_empties_it)
+{
+  // ----------------------------------------------------------------
+  // More settings than the change table holds. Once it is full, only
+  // settings already changed can change again, until a save.
+  // ----------------------------------------------------------------
+
+  Hal_Eeprom::erase();
+  Config config(TEST_VERSION);
+  Config_Section section(&config, testMany, CONFIG_MAX_EDITS + 1);
+
+  for (byte i = 0; i < CONFIG_MAX_EDITS; i++) {
+    CHECK(section.set(i, i + 1));
+  }
+  CHECK(! section.set(CONFIG_MAX_EDITS, 1));
+  CHECK(section.set(0, 50));
+
+  CHECK(config.save());
+  CHECK(section.set(CONFIG_MAX_EDITS, 1));
+  CHECK_EQUAL(50, section.get(0));
+  CHECK_EQUAL(CONFIG_MAX_EDITS, section.get(CONFIG_MAX_EDITS - 1));
+  CHECK_EQUAL(1, section.get(CONFIG_MAX_EDITS));
+}
+
+TEST_MAIN()
@@ -0,0 +1,202 @@
+/* =================================================================================
+ *    B.L.A.C.Box: Brian Lubkeman's Astromech Controller
+ * =================================================================================
+ * test_console.cpp - Console lines in, replies out, and changes taken up live
+ * Created by Brian Lubkeman, 16 June 2021
+ * Inspired by S.H.A.D.O.W. controller code written by KnightShade
+ * Released into the public domain.
+ */
+#include "Test.h"
+#include "../Settings.h"
+#include "../src/console/Console.h"
+#include "../src/driveMotor/DriveMotor.h"
+#include "../src/domeMotor/DomeMotor.h"
+
+#include <string.h>
+
+#define SECTION(name, defaults) Config_Section name(&config, defaults, sizeof(defaults) / sizeof(defaults[0]))
+
+Config config(CONFIG_VERSION);
+SECTION(cfgController, controllerSettings);
+SECTION(cfgControllerTimings, controllerTimings);
+SECTION(cfgDrive, driveMotorSettings);
+SECTION(cfgDriveMotion, driveMotionSettings);
+SECTION(cfgDrivePins, driveMotorPins);
+SECTION(cfgSabertooth, sabertoothSettings);
+SECTION(cfgDome, domeMotorSettings);
+SECTION(cfgDomeTimings, domeMotorTimings);
+SECTION(cfgDomePosition, domePositionSettings);
+SECTION(cfgSyren, syrenSettings);
+
+const char consoleSections[] PROGMEM = "controller controllerTimings drive driveMotion drivePins sabertooth dome domeTimings domePosition syren";
+
+byte motorBuffer[128];
+SerialQueue motorQueue(Serial2, motorBuffer, sizeof(motorBuffer));
+SerialQueue &DriveMotor_Serial = motorQueue;
+SerialQueue &DomeMotor_Serial = motorQueue;
+
+Controller_Script controller(&cfgController, &cfgControllerTimings);
+Console console(Serial, &config, consoleSections);
+
+// Reach the copies the motors keep of their settings.
+
+class Drive_Probe : public DriveMotor_Sabertooth
+{
+  public:
+    Drive_Probe(void) : DriveMotor_Sabertooth(&controller, &cfgDrive, &cfgDrivePins, &cfgDriveMotion, &cfgSabertooth) {}
+
+    MotionProfile* motion(void)  { return &m_motion; }
+};
+
+class Dome_Probe : public DomeMotor_Syren10
+{
+  public:
+    Dome_Probe(void) : DomeMotor_Syren10(&controller, &cfgDome, &cfgDomeTimings, &cfgDomePosition, &cfgSyren) {}
+
+    DomePosition* position(void)  { return &m_position; }
+    bool automationInvalid(void)  { return m_automationSettingsInvalid; }
+};
+
+static Drive_Probe drive;
+static Dome_Probe dome;
+
+// The same hand-off the sketch makes in consoleChange().
+
+static void m_onChange(const Config_Section* section, byte index)
+{
+  if ( section == &cfgController ) {
+    controller.applySettings();
+    drive.applySettings();
+  } else if ( section == &cfgDriveMotion ) {
+    drive.applySettings();
+  } else if ( section == &cfgDome || section == &cfgDomeTimings || section == &cfgDomePosition ) {
+    dome.applySettings();
+  }
+}
+
+/* ================================================================================
+ *                                 Serial Monitor
+ * ================================================================================ */
+
+static char s_output[1024];
+static size_t s_outputLength = 0;
+
+static void m_printed(const byte* buffer, size_t count)
+{
+  for (size_t i = 0; i < count && s_outputLength < sizeof(s_output) - 1; i++) {
+    s_output[s_outputLength++] = buffer[i];
+  }
+  s_output[s_outputLength] = '\0';
+}
+
+// Starts everything once, then puts the settings back and clears the output.
+
+static void m_reset(void)
+{
+  static bool started = false;
+  if ( ! started ) {
+    Serial.onTransmit(m_printed);
+    console.attachOnChange(m_onChange);
+    controller.begin();
+    drive.begin();
+    dome.begin();
+    started = true;
+  }
+  config.restoreDefaults();
+  drive.applySettings();
+  dome.applySettings();
+  motorQueue.drain();
+  s_outputLength = 0;
+  s_output[0] = '\0';
+}
+
+// Types a line into the serial monitor and runs the console until it is done.
+
+static void m_type(const char* line)
+{
+  Serial.inject((const byte*)line, strlen(line));
+  for (int i = 0; i < 20; i++) {
+    console.run();
+    Hal_Clock::advance(1000);
+  }
+}
+
+/* ================================================================================
+ *                                      Tests
+ * ================================================================================ */
+
+TEST(get_and_set_reply_on_the_monitor)
+{
+  m_reset();
+
+  m_type("get dome 5\r\n");
+  CHECK(strstr(s_output, "dome[5] = 25") != NULL);
+
+  m_type("set dome 5 40\n");
+  CHECK(strstr(s_output, "dome[5] = 40  (default 25)") != NULL);
+  CHECK_EQUAL(40, cfgDome.get(iDomeLatency));
+
+  m_type("set dome 99 1\n");
+  CHECK(strstr(s_output, "Index out of range") != NULL);
+}
+
+TEST(drive_ramp_takes_up_a_change)
+{
+  // ---------------------------------------------------------------
+  // Walk accelerates at 1000 per second by default. Raise it to 4000
+  // with no jerk limit, and 100 ms of full stick reaches 400.
+  // ---------------------------------------------------------------
+
+  m_reset();
+  m_type("set driveMotion 0 4000\n");
+  m_type("set driveMotion 2 0\n");
+
+  MotionProfile* motion = drive.motion();
+  motion->reset();
+  motion->update(Hal_Clock::millis());
+  motion->setTarget(MOTION_FULL_SCALE, 0);
+  for (int i = 0; i < 100; i++) {
+    Hal_Clock::advance(1000);
+    motion->update(Hal_Clock::millis());
+  }
+  CHECK_EQUAL(400, motion->value(0));
+}
+
+TEST(dome_estimate_takes_up_a_change)
+{
+  // -------------------------------------------------------------
+  // A second at automated speed is half a turn with the default
+  // two second turn time, and a quarter turn once it is four.
+  // -------------------------------------------------------------
+
+  m_reset();
+  m_type("set domeTimings 2 4000\n");
+  CHECK(! dome.automationInvalid());
+
+  DomePosition* position = dome.position();
+  int start = position->angle();
+  position->update(Hal_Clock::millis());
+  position->setSpeed(cfgDome.get(iAutoSpeed));
+  for (int i = 0; i < 1000; i++) {
+    Hal_Clock::advance(1000);
+    position->update(Hal_Clock::millis());
+  }
+  position->setSpeed(0);
+
+  CHECK_EQUAL(900, DomePosition::difference(start, position->angle()));
+}
+
+TEST(dome_automation_rechecks_its_limits)
+{
+  // A turn time past the allowed maximum stops automation, and bringing
+  // it back in range lets it run again.
+
+  m_reset();
+  m_type("set domeTimings 2 9000\n");
+  CHECK(dome.automationInvalid());
+
+  m_type("set domeTimings 2 3000\n");
+  CHECK(! dome.automationInvalid());
+}
+
+TEST_MAIN()
@@ -0,0 +1,72 @@
+/* =================================================================================
+ *    B.L.A.C.Box: Brian Lubkeman's Astromech Controller
+ * =================================================================================
+ * test_controller.cpp - Scripted controller input
+ * Created by Brian Lubkeman, 16 June 2021
+ * Inspired by S.H.A.D.O.W. controller code written by KnightShade
+ * Released into the public domain.
+ */
+#include "Test.h"
+#include "../Settings.h"
+#include "../src/controller/Controller.h"
+
+#define BIT(button) ((uint32_t)1 << (button))
+
+Config config(CONFIG_VERSION);
+Config_Section cfgController(&config, controllerSettings, sizeof(controllerSettings) / sizeof(controllerSettings[0]));
+Config_Section cfgControllerTimings(&config, controllerTimings, sizeof(controllerTimings) / sizeof(controllerTimings[0]));
+
+static const Script_Step_Struct script[] = {
+  //  ms   connected  hats                  buttons
+  {    0,  false,     { 127, 127, 127, 127 }, 0 },
+  {  100,  true,      { 127, 127, 127, 127 }, 0 },
+  {  200,  true,      { 127,   0, 127, 127 }, BIT(CROSS) },
+  {  300,  true,      { 127,   0, 127, 127 }, BIT(CROSS) | BIT(L1) },
+  {  400,  false,     { 127, 127, 127, 127 }, 0 },
+};
+
+static Controller_Script controller(&cfgController, &cfgControllerTimings);
+
+static void m_runTo(unsigned long ms)
+{
+  while ( Hal_Clock::millis() < ms ) {
+    Hal_Clock::advance(1000);
+    controller.read();
+  }
+}
+
+TEST(script_drives_connection_and_input)
+{
+  Hal_Clock::set(0);
+  controller.begin();
+  controller.play(script, sizeof(script) / sizeof(script[0]));
+
+  m_runTo(50);
+  CHECK_EQUAL(NONE, controller.connectionStatus());
+
+  m_runTo(150);
+  CHECK_EQUAL(FULL, controller.connectionStatus());
+  CHECK_EQUAL(0, controller.frame()->pressed);
+
+  m_runTo(200);
+  const Input_Frame_Struct* frame = controller.frame();
+  CHECK_EQUAL(BIT(CROSS), frame->pressed);
+  CHECK_EQUAL(BIT(CROSS), frame->clicked);
+  CHECK(frame->driveY < 127);
+
+  // Held down, a button clicks only once.
+
+  m_runTo(250);
+  CHECK_EQUAL(0, controller.frame()->clicked);
+
+  m_runTo(300);
+  CHECK_EQUAL(BIT(L1), controller.frame()->clicked);
+  CHECK_EQUAL(BIT(CROSS) | BIT(L1), controller.frame()->pressed);
+
+  m_runTo(400);
+  CHECK_EQUAL(NONE, controller.connectionStatus());
+  CHECK(controller.disconnectEvent());
+  CHECK(controller.finished());
+}
+
+TEST_MAIN()
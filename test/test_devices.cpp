@@ -0,0 +1,248 @@
+/* =================================================================================
+ *    B.L.A.C.Box: Brian Lubkeman's Astromech Controller
+ * =================================================================================
+ * test_devices.cpp - Authorized and paired controllers
+ * Created by Brian Lubkeman, 16 June 2021
+ * Inspired by S.H.A.D.O.W. controller code written by KnightShade
+ * Released into the public domain.
+ */
+#include "Test.h"
+#include "../Settings.h"
+#include "../src/controller/Controller.h"
+
+#include <string.h>
+
+#define BIT(button) ((uint32_t)1 << (button))
+
+Config config(CONFIG_VERSION);
+Config_Section cfgController(&config, controllerSettings, sizeof(controllerSettings) / sizeof(controllerSettings[0]));
+Config_Section cfgControllerTimings(&config, controllerTimings, sizeof(controllerTimings) / sizeof(controllerTimings[0]));
+
+// MAC_ADDRESS() refuses to compile text that fails this.
+
+static_assert(macValid("00:1B:FB:63:A1:5C"), "Upper case is a MAC address.");
+static_assert(macValid("00:1b:fb:63:a1:5c"), "Lower case is a MAC address.");
+static_assert(! macValid("xx:xx:xx:xx:xx:xx"), "A placeholder is not a MAC address.");
+static_assert(! macValid("00:1B:FB:63:A1"), "Five pairs are not a MAC address.");
+static_assert(! macValid("00:1B:FB:63:A1:5C:00"), "Seven pairs are not a MAC address.");
+static_assert(! macValid("00-1B-FB-63-A1-5C"), "Dashes are not a MAC address.");
+
+static const Mac_Address_Struct table[] PROGMEM = {
+  MAC_ADDRESS("00:1B:FB:63:A1:5C"),
+  MAC_UNSET
+};
+
+static const byte TABLE_COUNT = sizeof(table) / sizeof(table[0]);
+
+// A made-up address for paired controller n.
+
+static void m_address(byte n, byte address[])
+{
+  for (byte i = 0; i < MAC_ADDRESS_SIZE; i++) {
+    address[i] = (byte)(0x10 + n + i);
+  }
+}
+
+/* ================================================================================
+ *                                      Tests
+ * ================================================================================ */
+
+TEST(parse_and_format_round_trip)
+{
+  byte address[MAC_ADDRESS_SIZE];
+  char text[MAC_TEXT_SIZE];
+
+  CHECK(Authorized_Devices::parse("00:1b:fb:63:a1:5c", address));
+  Authorized_Devices::format(address, text);
+  CHECK(strcmp(text, "00:1B:FB:63:A1:5C") == 0);
+
+  // The packed form runs last pair first, as MAC_ADDRESS() builds it.
+
+  byte packed[MAC_ADDRESS_SIZE];
+  memcpy_P(packed, table[0].address, MAC_ADDRESS_SIZE);
+  CHECK(memcmp(packed, address, MAC_ADDRESS_SIZE) == 0);
+  CHECK_EQUAL(0x5C, address[0]);
+  CHECK_EQUAL(0x00, address[5]);
+
+  for (byte n = 0; n < 4; n++) {
+    byte again[MAC_ADDRESS_SIZE];
+    m_address(n * 60, address);
+    Authorized_Devices::format(address, text);
+    CHECK(Authorized_Devices::parse(text, again));
+    CHECK(memcmp(again, address, MAC_ADDRESS_SIZE) == 0);
+  }
+
+  CHECK(! Authorized_Devices::parse("xx:xx:xx:xx:xx:xx", address));
+  CHECK(! Authorized_Devices::parse("00:1B:FB:63:A1", address));
+  CHECK(! Authorized_Devices::parse("00:1B:FB:63:A1:5C:00", address));
+  CHECK(! Authorized_Devices::parse("00.1B.FB.63.A1.5C", address));
+}
+
+TEST(unset_slot_lets_nobody_in)
+{
+  Hal_Eeprom::erase();
+  Authorized_Devices devices(table, TABLE_COUNT);
+
+  byte address[MAC_ADDRESS_SIZE];
+  CHECK(Authorized_Devices::parse("00:1B:FB:63:A1:5C", address));
+  CHECK(devices.isAuthorized(address));
+
+  // A controller that reports no address matches the unset slot byte
+  // for byte, and must still be refused, even while pairing.
+
+  memset(address, 0, sizeof(address));
+  CHECK(Authorized_Devices::isUnset(address));
+  CHECK(! devices.isAuthorized(address));
+
+  devices.startPairing(PAIRING_TIME);
+  CHECK(! devices.authorize(address));
+  CHECK_EQUAL(0, devices.pairedCount());
+}
+
+TEST(add_and_remove)
+{
+  Hal_Eeprom::erase();
+  Authorized_Devices devices(table, TABLE_COUNT);
+  byte address[MAC_ADDRESS_SIZE];
+  byte stored[MAC_ADDRESS_SIZE];
+
+  for (byte n = 0; n < 3; n++) {
+    m_address(n, address);
+    CHECK(! devices.isAuthorized(address));
+    CHECK(devices.add(address));
+    CHECK(devices.isAuthorized(address));
+  }
+  CHECK_EQUAL(3, devices.pairedCount());
+
+  // Adding one twice keeps one copy.
+
+  m_address(1, address);
+  CHECK(devices.add(address));
+  CHECK_EQUAL(3, devices.pairedCount());
+
+  // Removing the first moves the last into its slot.
+
+  m_address(0, address);
+  CHECK(devices.remove(address));
+  CHECK(! devices.isAuthorized(address));
+  CHECK_EQUAL(2, devices.pairedCount());
+
+  CHECK(devices.paired(0, stored));
+  m_address(2, address);
+  CHECK(memcmp(stored, address, MAC_ADDRESS_SIZE) == 0);
+  m_address(1, address);
+  CHECK(devices.isAuthorized(address));
+
+  // Only paired controllers can be removed.
+
+  memcpy_P(address, table[0].address, MAC_ADDRESS_SIZE);
+  CHECK(! devices.remove(address));
+  CHECK(devices.isAuthorized(address));
+
+  m_address(0, address);
+  CHECK(! devices.remove(address));
+}
+
+TEST(full_table_refuses_one_more)
+{
+  Hal_Eeprom::erase();
+  Authorized_Devices devices(table, TABLE_COUNT);
+  byte address[MAC_ADDRESS_SIZE];
+
+  for (byte n = 0; n < PAIRED_MAX_DEVICES; n++) {
+    m_address(n, address);
+    CHECK(devices.add(address));
+  }
+  CHECK_EQUAL(PAIRED_MAX_DEVICES, devices.pairedCount());
+
+  m_address(PAIRED_MAX_DEVICES, address);
+  CHECK(! devices.add(address));
+
+  devices.startPairing(PAIRING_TIME);
+  CHECK(! devices.authorize(address));
+  CHECK(! devices.isAuthorized(address));
+  CHECK_EQUAL(PAIRED_MAX_DEVICES, devices.pairedCount());
+
+  // Every controller paired before it filled up still gets in.
+
+  for (byte n = 0; n < PAIRED_MAX_DEVICES; n++) {
+    m_address(n, address);
+    CHECK(devices.isAuthorized(address));
+  }
+}
+
+TEST(paired_table_survives_a_restart)
+{
+  Hal_Eeprom::erase();
+  byte address[MAC_ADDRESS_SIZE];
+
+  {
+    Authorized_Devices devices(table, TABLE_COUNT);
+    devices.startPairing(PAIRING_TIME);
+    m_address(5, address);
+    CHECK(devices.authorize(address));
+    CHECK(! devices.isPairing());
+  }
+
+  // Saving settings shares EEPROM with the paired table, and must leave it be.
+
+  config.restoreDefaults();
+  cfgController.set(iDeadZone, 5);
+  config.save();
+
+  Authorized_Devices restarted(table, TABLE_COUNT);
+  CHECK_EQUAL(1, restarted.pairedCount());
+  CHECK(restarted.isAuthorized(address));
+  CHECK(! restarted.isPairing());
+
+  config.restoreDefaults();
+}
+
+TEST(pairing_times_out)
+{
+  Hal_Eeprom::erase();
+  Authorized_Devices devices(table, TABLE_COUNT);
+  byte address[MAC_ADDRESS_SIZE];
+  m_address(0, address);
+
+  devices.startPairing(PAIRING_TIME);
+  Hal_Clock::advance(PAIRING_TIME * 1000UL);
+  CHECK(! devices.isPairing());
+  CHECK(! devices.authorize(address));
+  CHECK_EQUAL(0, devices.pairedCount());
+}
+
+TEST(holding_ps_starts_pairing)
+{
+  // -----------------------------------------------------------------
+  // PS alone, held for the hold time, starts pairing without the
+  // console. A shorter hold, or PS with another button, does not.
+  // -----------------------------------------------------------------
+
+  static const Script_Step_Struct script[] = {
+    //  ms    connected  hats                    buttons
+    {     0,  true,      { 127, 127, 127, 127 }, 0 },
+    {   100,  true,      { 127, 127, 127, 127 }, BIT(PS) },
+    {  1000,  true,      { 127, 127, 127, 127 }, 0 },
+    {  1100,  true,      { 127, 127, 127, 127 }, BIT(PS) | BIT(L4) },
+    {  5000,  true,      { 127, 127, 127, 127 }, BIT(PS) },
+    {  8500,  true,      { 127, 127, 127, 127 }, 0 },
+  };
+
+  Hal_Eeprom::erase();
+  Controller_Script controller(&cfgController, &cfgControllerTimings);
+  controller.begin();
+  controller.play(script, sizeof(script) / sizeof(script[0]));
+
+  unsigned long start = Hal_Clock::millis();
+  bool early = false;
+  while ( Hal_Clock::millis() - start < 8000 ) {
+    Hal_Clock::advance(1000);
+    controller.read();
+    early = early || ( Hal_Clock::millis() - start < 7900 && controller.devices.isPairing() );
+  }
+  CHECK(! early);
+  CHECK(controller.devices.isPairing());
+}
+
+TEST_MAIN()
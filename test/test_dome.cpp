@@ -0,0 +1,540 @@
+/* =================================================================================
+ *    B.L.A.C.Box: Brian Lubkeman's Astromech Controller
+ * =================================================================================
+ * test_dome.cpp - Dome positioning against a simulated dome
+ * Created by Brian Lubkeman, 16 June 2021
+ * Inspired by S.H.A.D.O.W. controller code written by KnightShade
+ * Released into the public domain.
+ */
+#include "Test.h"
+#include "../Settings.h"
+#include "../src/domeMotor/DomeMotor.h"
+#include "../src/marcduino/Marcduino.h"
+
+#define SECTION(name, defaults) Config_Section name(&config, defaults, sizeof(defaults) / sizeof(defaults[0]))
+
+Config config(CONFIG_VERSION);
+SECTION(cfgController, controllerSettings);
+SECTION(cfgControllerTimings, controllerTimings);
+SECTION(cfgDome, domeMotorSettings);
+SECTION(cfgDomeTimings, domeMotorTimings);
+SECTION(cfgDomePosition, domePositionSettings);
+SECTION(cfgSyren, syrenSettings);
+
+byte motorBuffer[128];
+SerialQueue motorQueue(Serial2, motorBuffer, sizeof(motorBuffer));
+SerialQueue &DomeMotor_Serial = motorQueue;
+
+Controller_Script controller(&cfgController, &cfgControllerTimings);
+
+// Reaches the protected parts of the dome motor.
+
+class Dome_Probe : public DomeMotor_Syren10
+{
+  public:
+    Dome_Probe(void) : DomeMotor_Syren10(&controller, &cfgDome, &cfgDomeTimings, &cfgDomePosition, &cfgSyren) {}
+
+    void restartPosition(void)  { m_position.begin(); applySettings(); }
+    void updatePosition(void)   { m_position.update(Hal_Clock::millis()); }
+    int lastCorrection(void)    { return m_position.lastCorrection(); }
+    byte routineStage(void)     { return m_routineStage; }
+    byte routineStep(void)      { return m_routineStep; }
+    byte routinePass(void)      { return m_routinePass; }
+};
+
+static Dome_Probe dome;
+
+const byte DOME_PIN_A    = 2;
+const byte DOME_PIN_B    = 4;
+const byte DOME_PIN_HOME = 3;
+
+/* ================================================================================
+ *                                  Dome Plant
+ * ================================================================================ */
+
+// ---------------------------------------------------------------------------
+// A Syren10 and the dome it turns. Packets on Serial2 set the motor power, and
+// the dome turns in proportion to it: at automated speed, one full turn in
+// iTurn360 ms, scaled by s_plantPercent for a dome that is slower or faster
+// than the settings say. Without a good packet for the Syren10's timeout the
+// motor stops, as the real one does. The dome drives the encoder pins one
+// edge per count, and pulls the home pin low as it passes front.
+// ---------------------------------------------------------------------------
+
+static byte s_partial[4];
+static byte s_partialLength = 0;
+static int s_power = 0;
+static unsigned long s_syrenTimeout = 0;
+static unsigned long s_lastPacket = 0;
+static unsigned long s_worstGap = 0;
+static bool s_timedOut = false;
+
+static long s_plantAngle = 0;     // Thousandths of a tenth of a degree, unwrapped.
+static long s_plantCount = 0;     // Encoder counts, one per tenth.
+static int s_plantPercent = 100;
+
+static void m_plantPacket(const byte* packet)
+{
+  if ( ((packet[0] + packet[1] + packet[2]) & 0x7F) != packet[3] ) {
+    return;
+  }
+
+  unsigned long now = Hal_Clock::millis();
+  if ( s_power != 0 ) {
+    s_worstGap = max(s_worstGap, now - s_lastPacket);
+  }
+  s_lastPacket = now;
+
+  switch (packet[1]) {
+    case 0  : { s_power = packet[2];  s_timedOut = false; break; }
+    case 1  : { s_power = -packet[2]; s_timedOut = false; break; }
+    case 14 : { s_syrenTimeout = (unsigned long)packet[2] * 100; break; }
+  }
+}
+
+static void m_plantReceive(const byte* buffer, size_t length)
+{
+  for (size_t i = 0; i < length; i++) {
+    if ( buffer[i] >= 128 ) {
+      s_partialLength = 0;
+    } else if ( s_partialLength == 0 ) {
+      continue;
+    }
+    s_partial[s_partialLength++] = buffer[i];
+    if ( s_partialLength == 4 ) {
+      m_plantPacket(s_partial);
+      s_partialLength = 0;
+    }
+  }
+}
+
+// Drives the encoder pins until they have counted to count. One edge on
+// channel A per count, with B leading or lagging A by the direction, the
+// way the quadrature signal would.
+
+static void m_plantEdges(long count)
+{
+  while ( s_plantCount != count ) {
+    bool forward = ( count > s_plantCount );
+    int a = ( (s_plantCount + (forward ? 1 : 0)) & 1 );
+    Hal_Pin::inject(DOME_PIN_B, forward ? ! a : a);
+    Hal_Pin::inject(DOME_PIN_A, a);
+    s_plantCount += ( forward ? 1 : -1 );
+  }
+}
+
+// Runs the dome for one millisecond.
+
+static void m_plantStep(void)
+{
+  if ( s_syrenTimeout > 0 && s_power != 0 && (Hal_Clock::millis() - s_lastPacket) > s_syrenTimeout ) {
+    s_power = 0;
+    s_timedOut = true;
+  }
+
+  long before = s_plantAngle;
+  long denominator = (long)cfgDome.get(iAutoSpeed) * cfgDomeTimings.get(iTurn360);
+  s_plantAngle += ((long)s_power * DOME_FULL_TURN * 1000 / denominator) * s_plantPercent / 100;
+
+  m_plantEdges( s_plantAngle >= 0 ? s_plantAngle / 1000 : -((-s_plantAngle + 999) / 1000) );
+
+  // The home switch sits at front.
+
+  long turnBefore = ( before >= 0 ? before / (DOME_FULL_TURN * 1000L) : -1 - (-before - 1) / (DOME_FULL_TURN * 1000L) );
+  long turnAfter  = ( s_plantAngle >= 0 ? s_plantAngle / (DOME_FULL_TURN * 1000L) : -1 - (-s_plantAngle - 1) / (DOME_FULL_TURN * 1000L) );
+  if ( turnBefore != turnAfter ) {
+    Hal_Pin::inject(DOME_PIN_HOME, LOW);
+    Hal_Pin::inject(DOME_PIN_HOME, HIGH);
+  }
+}
+
+static int m_plantTenths(void)
+{
+  return DomePosition::wrap(s_plantAngle / 1000);
+}
+
+// Starts the dome once with the given sensor, puts the simulated dome where
+// the estimate says it is, and clears the plant's record.
+
+static void m_start(byte sensor, int plantPercent)
+{
+  static bool started = false;
+  cfgDomePosition.set(iPositionSensor, sensor);
+  cfgDomePosition.set(iEncoderPinA, DOME_PIN_A);
+  cfgDomePosition.set(iEncoderPinB, DOME_PIN_B);
+  cfgDomePosition.set(iHomePin, DOME_PIN_HOME);
+  cfgDomePosition.set(iEncoderCounts, DOME_FULL_TURN);
+
+  if ( ! started ) {
+    Serial2.onTransmit(m_plantReceive);
+    dome.begin();
+    started = true;
+  } else {
+    dome.stopRoutine();
+    dome.restartPosition();
+  }
+  motorQueue.drain();
+
+  s_plantPercent = plantPercent;
+  s_plantAngle = (long)dome.position() * 1000;
+  s_plantCount = s_plantAngle / 1000;
+  s_worstGap = 0;
+  s_timedOut = false;
+}
+
+// Turns to an angle, one millisecond at a time, as the scheduler would.
+
+static void m_seek(int angle)
+{
+  dome.goTo(angle);
+  for (int i = 0; i < 10000 && dome.isTurning(); i++) {
+    dome.runPositioning();
+    motorQueue.drain();
+    m_plantStep();
+    Hal_Clock::advance(1000);
+  }
+}
+
+/* ================================================================================
+ *                                 Dome Routines
+ * ================================================================================ */
+
+// ------------------------------------------------------------------------
+// The routines played are the samples in DomeMotor_Routines.h. Routine 1,
+// lookAndScream, plays once: look left, hold still and scream, come home.
+// Routine 2, patrol, loops: 45 degrees right, front, 45 left, front, with
+// a holoprojector cue at each side.
+// ------------------------------------------------------------------------
+
+const byte ROUTINE_LOOK_AND_SCREAM = 1;
+const byte ROUTINE_PATROL          = 2;
+
+typedef struct {
+  byte step;
+  int plantAngle;     // Where the dome really was.
+  byte cueAction;     // Cue fired in the same pass, or 0.
+  byte cueArg1;
+} Arrival_Struct;
+
+const byte MAX_ARRIVALS = 32;
+
+static Arrival_Struct s_arrivals[MAX_ARRIVALS];
+static byte s_arrivalCount = 0;
+static byte s_cueCount = 0;
+static byte s_cueAction = 0;
+static byte s_cueArg1 = 0;
+
+static void m_cue(byte action, byte arg1, byte arg2)
+{
+  s_cueCount++;
+  s_cueAction = action;
+  s_cueArg1 = arg1;
+}
+
+// -------------------------------------------------------------------
+// Runs the dome task for a time, one millisecond at a time. Each time
+// a keyframe is reached, notes where the dome is and any cue fired.
+// -------------------------------------------------------------------
+
+static void m_runRoutine(unsigned long ms)
+{
+  for (unsigned long t = 0; t < ms; t++) {
+    byte stage = dome.routineStage();
+    byte step = dome.routineStep();
+    byte cues = s_cueCount;
+
+    dome.runAutomation();
+    dome.runPositioning();
+    motorQueue.drain();
+    m_plantStep();
+    Hal_Clock::advance(1000);
+
+    if ( stage == ROUTINE_MOVING && dome.routineStage() == ROUTINE_DWELLING && s_arrivalCount < MAX_ARRIVALS ) {
+      Arrival_Struct* arrival = &s_arrivals[s_arrivalCount++];
+      arrival->step = step;
+      arrival->plantAngle = m_plantTenths();
+      arrival->cueAction = ( s_cueCount != cues ? s_cueAction : 0 );
+      arrival->cueArg1 = s_cueArg1;
+    }
+  }
+}
+
+// Plays a routine on the encoder, which tracks the plant closely.
+
+static void m_playRoutine(byte routineNumber)
+{
+  m_start(SENSOR_ENCODER, 100);
+  s_plantAngle = 0;
+  s_plantCount = 0;
+  s_arrivalCount = 0;
+  s_cueCount = 0;
+
+  dome.attachCue(m_cue);
+  dome.playRoutine(routineNumber);
+}
+
+static bool m_near(int angle, int target, int spread)
+{
+  return ( abs(DomePosition::difference(angle, target)) <= spread + cfgDomePosition.get(iArriveTolerance) + 10 );
+}
+
+/* ================================================================================
+ *                                      Tests
+ * ================================================================================ */
+
+TEST(long_turn_is_kept_alive)
+{
+  // ------------------------------------------------------------------
+  // A half turn holds full speed for most of a second. The speed must
+  // be resent inside the Syren10's timeout the whole way, or the dome
+  // stops short.
+  // ------------------------------------------------------------------
+
+  m_start(SENSOR_NONE, 100);
+  CHECK_EQUAL(300, s_syrenTimeout);
+
+  m_seek(1800);
+
+  CHECK(! dome.isTurning());
+  CHECK(! s_timedOut);
+  CHECK(s_worstGap <= DOME_KEEP_ALIVE);
+  CHECK(abs(DomePosition::difference(m_plantTenths(), 1800)) <= cfgDomePosition.get(iArriveTolerance) + 10);
+}
+
+TEST(timed_estimate_drifts_on_a_slow_dome)
+{
+  // A dome 20% slower than the settings say falls well short on time alone.
+
+  m_start(SENSOR_NONE, 80);
+  m_seek(dome.position() + 1200);
+
+  CHECK(abs(DomePosition::difference(m_plantTenths(), dome.position())) > 100);
+}
+
+TEST(encoder_lands_a_slow_dome_on_target)
+{
+  m_start(SENSOR_ENCODER, 80);
+  s_plantAngle = 0;
+  s_plantCount = 0;
+
+  m_seek(900);
+  CHECK(! s_timedOut);
+  CHECK(abs(DomePosition::difference(m_plantTenths(), 900)) <= cfgDomePosition.get(iArriveTolerance) + 10);
+  CHECK(abs(DomePosition::difference(m_plantTenths(), dome.position())) <= 1);
+
+  m_seek(2700);
+  CHECK(abs(DomePosition::difference(m_plantTenths(), 2700)) <= cfgDomePosition.get(iArriveTolerance) + 10);
+  CHECK(abs(DomePosition::difference(m_plantTenths(), dome.position())) <= 1);
+}
+
+TEST(encoder_counts_many_turns_without_home)
+{
+  // -------------------------------------------------------------------
+  // With no home switch the encoder count only grows. Past 596,523
+  // counts, scaling it to tenths overflowed a 32-bit long, and the
+  // angle jumped. Hundreds of turns each way must still read true, give
+  // or take the edge the plant drops each time it changes direction.
+  // -------------------------------------------------------------------
+
+  m_start(SENSOR_ENCODER, 100);
+  dome.updatePosition();
+  long start = s_plantCount;
+  int startAngle = dome.position();
+
+  m_plantEdges(start + 1000000L);
+  dome.updatePosition();
+  CHECK(abs(DomePosition::difference(dome.position(), DomePosition::wrap(startAngle + 1000000L % DOME_FULL_TURN))) <= 1);
+
+  m_plantEdges(start - 1500450L);
+  dome.updatePosition();
+  CHECK(abs(DomePosition::difference(dome.position(), DomePosition::wrap(startAngle - 1500450L % DOME_FULL_TURN))) <= 2);
+
+  // Back where it started.
+
+  m_plantEdges(start);
+  dome.updatePosition();
+  CHECK(abs(DomePosition::difference(dome.position(), startAngle)) <= 3);
+}
+
+TEST(home_switch_corrects_the_estimate)
+{
+  // -------------------------------------------------------------------
+  // Timed estimate plus home switch on the slow dome. Passing front
+  // snaps the estimate back, so only the part of the turn after home
+  // can drift.
+  // -------------------------------------------------------------------
+
+  m_start(SENSOR_HOME, 80);
+  m_seek(3000);
+  int before = abs(DomePosition::difference(m_plantTenths(), dome.position()));
+
+  m_start(SENSOR_HOME, 80);
+  m_seek(DomePosition::wrap(dome.position() + 900));
+
+  CHECK(dome.lastCorrection() != 0);
+  int after = abs(DomePosition::difference(m_plantTenths(), dome.position()));
+  CHECK(after < before);
+}
+
+TEST(routine_reaches_each_keyframe_and_cues_on_arrival)
+{
+  // -------------------------------------------------------------------
+  // One pass of patrol. Every keyframe is reached, within its spread,
+  // and the holoprojector cue fires in the pass the dome arrives at
+  // either side, not before. The keyframes in front fire nothing.
+  // -------------------------------------------------------------------
+
+  static const int angles[]  = { 450, 0, 3150, 0 };
+  static const int spreads[] = { 150, 100, 150, 100 };
+
+  m_playRoutine(ROUTINE_PATROL);
+  CHECK(dome.isRoutineRunning());
+
+  while ( s_arrivalCount < 4 && Hal_Clock::millis() < 60000000UL ) {
+    m_runRoutine(100);
+  }
+  CHECK(s_arrivalCount >= 4);
+
+  for (byte i = 0; i < 4; i++) {
+    CHECK_EQUAL(i, s_arrivals[i].step);
+    CHECK(m_near(s_arrivals[i].plantAngle, angles[i], spreads[i]));
+  }
+  CHECK_EQUAL(aHpRandomMove, s_arrivals[0].cueAction);
+  CHECK_EQUAL(0, s_arrivals[1].cueAction);
+  CHECK_EQUAL(aHpRandomMove, s_arrivals[2].cueAction);
+  CHECK_EQUAL(0, s_arrivals[3].cueAction);
+  CHECK(s_cueCount >= 2 && s_cueCount <= 3);
+  CHECK(! s_timedOut);
+}
+
+TEST(stay_keyframe_holds_the_dome_and_a_single_pass_ends)
+{
+  // -------------------------------------------------------------------
+  // lookAndScream: the middle keyframe stays where the first one left
+  // the dome, and screams as it starts to hold. The routine plays once,
+  // then stops at home with the motor off.
+  // -------------------------------------------------------------------
+
+  m_playRoutine(ROUTINE_LOOK_AND_SCREAM);
+
+  while ( s_arrivalCount < 1 ) {
+    m_runRoutine(1);
+  }
+  int looked = m_plantTenths();
+  CHECK(m_near(looked, 2700, 100));
+
+  // Hold through the first dwell and the whole of the stay.
+
+  bool held = true;
+  while ( dome.routineStep() < 2 && dome.isRoutineRunning() ) {
+    m_runRoutine(1);
+    if ( dome.routineStep() < 2 ) {
+      held = held && ( m_plantTenths() == looked ) && ( s_power == 0 );
+    }
+  }
+  CHECK(held);
+  CHECK(s_arrivalCount >= 2);
+  CHECK_EQUAL(1, s_arrivals[1].step);
+  CHECK_EQUAL(looked, s_arrivals[1].plantAngle);
+  CHECK_EQUAL(aSequence, s_arrivals[1].cueAction);
+  CHECK_EQUAL(SEQ_SCREAM, s_arrivals[1].cueArg1);
+
+  m_runRoutine(10000);
+  CHECK(! dome.isRoutineRunning());
+  CHECK_EQUAL(3, s_arrivalCount);
+  CHECK(m_near(m_plantTenths(), 0, 0));
+  CHECK_EQUAL(0, s_power);
+  CHECK_EQUAL(1, s_cueCount);
+}
+
+TEST(looping_routine_keeps_going)
+{
+  // Patrol has repeats of 0, and is still turning after several passes.
+
+  m_playRoutine(ROUTINE_PATROL);
+
+  while ( dome.routinePass() < 3 && Hal_Clock::millis() < 60000000UL ) {
+    m_runRoutine(100);
+  }
+  CHECK(dome.routinePass() >= 3);
+  CHECK(dome.isRoutineRunning());
+  CHECK(s_arrivalCount >= 12);
+  CHECK(! s_timedOut);
+}
+
+TEST(stick_stops_a_routine)
+{
+  // ------------------------------------------------------------------
+  // Moving the dome stick mid-turn takes the dome back from the routine
+  // and it turns as the stick says, not toward the keyframe.
+  // ------------------------------------------------------------------
+
+  m_playRoutine(ROUTINE_PATROL);
+  m_runRoutine(200);
+  CHECK(dome.isTurning());
+
+  Input_Frame_Struct frame = *controller.frame();
+  frame.connectionStatus = FULL;
+  frame.domeX = 0;
+
+  for (int i = 0; i < 100; i++) {
+    dome.interpretController(&frame);
+    m_runRoutine(1);
+  }
+  CHECK(! dome.isRoutineRunning());
+  CHECK(s_power < 0);
+
+  // Once the stick is let go, the dome stops, and nothing picks the routine up.
+
+  frame.domeX = 127;
+  for (int i = 0; i < 100; i++) {
+    dome.interpretController(&frame);
+    m_runRoutine(1);
+  }
+  int stopped = m_plantTenths();
+  m_runRoutine(3000);
+  CHECK_EQUAL(0, s_power);
+  CHECK_EQUAL(stopped, m_plantTenths());
+  CHECK(! dome.isRoutineRunning());
+}
+
+TEST(disconnect_stops_a_routine)
+{
+  // -------------------------------------------------------------------
+  // Each pass as the scheduler runs it, with the sketch's domeDisconnect()
+  // handler. When the controller drops out mid-turn the routine ends and
+  // the dome stops where it is, and stays there.
+  // -------------------------------------------------------------------
+
+  static const Script_Step_Struct script[] = {
+    {    0,  true,  { 127, 127, 127, 127 }, 0 },
+    {  300,  false, { 127, 127, 127, 127 }, 0 },
+  };
+
+  m_playRoutine(ROUTINE_PATROL);
+  controller.begin();
+  controller.play(script, 2);
+
+  bool wasTurning = false;
+  for (int i = 0; i < 400; i++) {
+    bool inputValid = controller.read();
+    if ( controller.disconnectEvent() ) {
+      wasTurning = dome.isTurning();
+      dome.stopRoutine();
+      dome.stop();
+    }
+    if ( inputValid ) {
+      dome.interpretController(controller.frame());
+    }
+    m_runRoutine(1);
+  }
+  CHECK(wasTurning);
+  CHECK(! dome.isRoutineRunning());
+
+  int stopped = m_plantTenths();
+  m_runRoutine(3000);
+  CHECK_EQUAL(0, s_power);
+  CHECK_EQUAL(stopped, m_plantTenths());
+}
+
+TEST_MAIN()
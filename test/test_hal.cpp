@@ -0,0 +1,96 @@
+/* =================================================================================
+ *    B.L.A.C.Box: Brian Lubkeman's Astromech Controller
+ * =================================================================================
+ * test_hal.cpp - Host backend of the hardware abstraction layer
+ * Created by Brian Lubkeman, 16 June 2021
+ * Inspired by S.H.A.D.O.W. controller code written by KnightShade
+ * Released into the public domain.
+ */
+#include "Test.h"
+#include "../src/hal/Hal.h"
+
+static int s_isrCount = 0;
+static void m_countIsr(void) { s_isrCount++; }
+
+static byte s_sent[16];
+static size_t s_sentLength = 0;
+static void m_capture(const byte* buffer, size_t length)
+{
+  for (size_t i = 0; i < length && s_sentLength < sizeof(s_sent); i++) {
+    s_sent[s_sentLength++] = buffer[i];
+  }
+}
+
+TEST(clock_moves_only_when_told)
+{
+  Hal_Clock::set(0);
+  CHECK_EQUAL(0, Hal_Clock::millis());
+  Hal_Clock::advance(2500);
+  CHECK_EQUAL(2500, Hal_Clock::micros());
+  CHECK_EQUAL(2, Hal_Clock::millis());
+}
+
+TEST(pin_interrupt_fires_on_change)
+{
+  Hal_Pin::mode(20, INPUT_PULLUP);
+  CHECK_EQUAL(HIGH, Hal_Pin::read(20));
+
+  s_isrCount = 0;
+  Hal_Pin::attachInterrupt(20, m_countIsr, CHANGE);
+  Hal_Pin::inject(20, LOW);
+  Hal_Pin::inject(20, LOW);
+  Hal_Pin::inject(20, HIGH);
+  CHECK_EQUAL(2, s_isrCount);
+}
+
+TEST(eeprom_starts_erased)
+{
+  CHECK_EQUAL(0xFF, Hal_Eeprom::read(0));
+  Hal_Eeprom::update(10, 0x42);
+  CHECK_EQUAL(0x42, Hal_Eeprom::read(10));
+  Hal_Eeprom::erase();
+  CHECK_EQUAL(0xFF, Hal_Eeprom::read(10));
+  CHECK_EQUAL(4096, Hal_Eeprom::length());
+}
+
+TEST(serial_round_trip)
+{
+  const byte input[] = { 'a', 'b' };
+  Serial1.inject(input, 2);
+  CHECK_EQUAL(2, Serial1.available());
+  CHECK_EQUAL('a', Serial1.peek());
+  CHECK_EQUAL('a', Serial1.read());
+  CHECK_EQUAL('b', Serial1.read());
+  CHECK_EQUAL(-1, Serial1.read());
+
+  Serial1.onTransmit(m_capture);
+  Serial1.print("ok");
+  CHECK_EQUAL(2, s_sentLength);
+  CHECK_EQUAL('o', s_sent[0]);
+  CHECK_EQUAL(2, Serial1.txCount());
+}
+
+TEST(arduino_helpers_match_the_core)
+{
+  CHECK_EQUAL(90, map(127, 0, 254, 0, 180));
+  CHECK_EQUAL(-126, constrain(-200, -126, 126));
+  CHECK_EQUAL(3, min(3, 4));
+  CHECK_EQUAL(4, max(3L, 4));
+  CHECK(strcmp((const char*)F("text"), "text") == 0);
+}
+
+TEST(random_repeats_from_a_seed)
+{
+  long first[8];
+  randomSeed(7);
+  for (int i = 0; i < 8; i++) {
+    first[i] = random(10, 20);
+    CHECK(first[i] >= 10 && first[i] < 20);
+  }
+  randomSeed(7);
+  for (int i = 0; i < 8; i++) {
+    CHECK_EQUAL(first[i], random(10, 20));
+  }
+}
+
+TEST_MAIN()
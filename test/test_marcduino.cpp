@@ -0,0 +1,301 @@
+/* =================================================================================
+ *    B.L.A.C.Box: Brian Lubkeman's Astromech Controller
+ * =================================================================================
+ * test_marcduino.cpp - Button combos to Marcduino commands
+ * Created by Brian Lubkeman, 16 June 2021
+ * Inspired by S.H.A.D.O.W. controller code written by KnightShade
+ * Released into the public domain.
+ */
+#include "Test.h"
+#include "../Settings.h"
+#include "../src/controller/Controller.h"
+#include "../src/marcduino/Marcduino.h"
+
+#include <string.h>
+
+#define BIT(button) ((uint32_t)1 << (button))
+#define SECTION(name, defaults) Config_Section name(&config, defaults, sizeof(defaults) / sizeof(defaults[0]))
+
+Config config(CONFIG_VERSION);
+SECTION(cfgController, controllerSettings);
+SECTION(cfgControllerTimings, controllerTimings);
+SECTION(cfgMarcduino, marcduinoSettings);
+
+byte mdDomeBuffer[256];
+byte mdBodyBuffer[64];
+SerialQueue mdDomeQueue(Serial1, mdDomeBuffer, sizeof(mdDomeBuffer));
+SerialQueue mdBodyQueue(Serial3, mdBodyBuffer, sizeof(mdBodyBuffer));
+SerialQueue &MD_Dome_Serial = mdDomeQueue;
+SerialQueue &MD_Body_Serial = mdBodyQueue;
+
+Timeline_Event_Struct timelineEvents[TIMELINE_DEPTH];
+Timeline timeline(timelineEvents, TIMELINE_DEPTH);
+Controller_Script controller(&cfgController, &cfgControllerTimings);
+Marcduino marcduino(&controller, &cfgMarcduino, &timeline);
+
+/* ================================================================================
+ *                                 Serial Capture
+ * ================================================================================ */
+
+static char s_dome[512];
+static size_t s_domeLength = 0;
+static char s_body[512];
+static size_t s_bodyLength = 0;
+
+static void m_keep(char* log, size_t* length, size_t size, const byte* buffer, size_t count)
+{
+  for (size_t i = 0; i < count && *length < size - 1; i++) {
+    log[(*length)++] = buffer[i];
+  }
+  log[*length] = '\0';
+}
+
+// Each dome command as it went out, and when, for timing the panel routines.
+
+typedef struct {
+  unsigned long time;
+  char text[MARCDUINO_CMD_SIZE];
+} Sent_Command_Struct;
+
+const int MAX_SENT = 64;
+
+static Sent_Command_Struct s_sent[MAX_SENT];
+static int s_sentCount = 0;
+static size_t s_sentStart = 0;
+
+static void m_domeSent(const byte* buffer, size_t count)
+{
+  m_keep(s_dome, &s_domeLength, sizeof(s_dome), buffer, count);
+
+  // Cut the log into commands at each carriage return.
+
+  for (size_t i = s_sentStart; i < s_domeLength; i++) {
+    if ( s_dome[i] != '\r' ) {
+      continue;
+    }
+    if ( s_sentCount < MAX_SENT ) {
+      size_t length = min(i - s_sentStart, sizeof(s_sent[0].text) - 1);
+      s_sent[s_sentCount].time = Hal_Clock::millis();
+      memcpy(s_sent[s_sentCount].text, &s_dome[s_sentStart], length);
+      s_sent[s_sentCount].text[length] = '\0';
+      s_sentCount++;
+    }
+    s_sentStart = i + 1;
+  }
+}
+
+static void m_bodySent(const byte* buffer, size_t count) { m_keep(s_body, &s_bodyLength, sizeof(s_body), buffer, count); }
+
+// Starts everything once, then clears the logs.
+
+static void m_reset(void)
+{
+  static bool started = false;
+  if ( ! started ) {
+    Serial1.onTransmit(m_domeSent);
+    Serial3.onTransmit(m_bodySent);
+    controller.begin();
+    marcduino.begin();
+    started = true;
+  }
+  mdDomeQueue.drain();
+  mdBodyQueue.drain();
+  s_domeLength = 0;
+  s_dome[0] = '\0';
+  s_sentCount = 0;
+  s_sentStart = 0;
+  s_bodyLength = 0;
+  s_body[0] = '\0';
+}
+
+// One 1 ms pass, the way the scheduler runs it.
+
+static void m_pass(void)
+{
+  controller.read();
+  marcduino.interpretController(controller.frame());
+  timeline.run();
+  mdDomeQueue.drain();
+  mdBodyQueue.drain();
+  Hal_Clock::advance(1000);
+}
+
+static void m_runFor(unsigned long ms)
+{
+  for (unsigned long i = 0; i < ms; i++) {
+    m_pass();
+  }
+}
+
+// How many times a dome command went out, and when it last did.
+
+static int m_sentCount(const char* text, unsigned long* time)
+{
+  int count = 0;
+  for (int i = 0; i < s_sentCount; i++) {
+    if ( strcmp(s_sent[i].text, text) == 0 ) {
+      *time = s_sent[i].time;
+      count++;
+    }
+  }
+  return count;
+}
+
+static void m_play(const Script_Step_Struct script[], byte count, unsigned long ms)
+{
+  controller.play(script, count);
+  m_runFor(ms);
+}
+
+/* ================================================================================
+ *                                  Base Buttons
+ * ================================================================================ */
+
+TEST(face_buttons_are_base_buttons)
+{
+  // ---------------------------------------------------------------
+  // TRIANGLE and SQUARE are base buttons 4 and 7 of command set 0,
+  // whatever their bits in the click mask.
+  // ---------------------------------------------------------------
+
+  static const Script_Step_Struct script[] = {
+    {   0,  true,  { 127, 127, 127, 127 }, 0 },
+    { 100,  true,  { 127, 127, 127, 127 }, BIT(TRIANGLE) },
+    { 200,  true,  { 127, 127, 127, 127 }, 0 },
+    { 300,  true,  { 127, 127, 127, 127 }, BIT(SQUARE) },
+    { 400,  true,  { 127, 127, 127, 127 }, 0 },
+  };
+
+  m_reset();
+  m_play(script, 5, 500);
+
+  CHECK(strstr(s_dome, ":SE55\r") != NULL);
+  CHECK(strstr(s_body, ":OP01\r") != NULL);
+}
+
+TEST(select_and_start_alone_send_nothing)
+{
+  // SELECT, START, L3 and R3 sit at bits 4-7, where the old mask looked.
+
+  static const Script_Step_Struct script[] = {
+    {   0,  true,  { 127, 127, 127, 127 }, 0 },
+    { 100,  true,  { 127, 127, 127, 127 }, BIT(SELECT) },
+    { 200,  true,  { 127, 127, 127, 127 }, BIT(START) },
+    { 300,  true,  { 127, 127, 127, 127 }, BIT(L3) | BIT(R3) },
+    { 400,  true,  { 127, 127, 127, 127 }, 0 },
+  };
+
+  m_reset();
+  m_play(script, 5, 500);
+
+  CHECK_EQUAL(0, s_domeLength);
+  CHECK_EQUAL(0, s_bodyLength);
+}
+
+/* ================================================================================
+ *                                 Panel Routines
+ * ================================================================================ */
+
+TEST(sample_routine_replays_on_time)
+{
+  // -----------------------------------------------------------------
+  // The sample routine opens dome panels 1-6 in turn, half a second
+  // apart from one second in, and holds each open for half a second.
+  // Each panel gets one open and one close, at those times.
+  // -----------------------------------------------------------------
+
+  m_reset();
+  unsigned long start = Hal_Clock::millis();
+  marcduino.runAction(aPanelRoutine, 1, 0);
+  m_runFor(5000);
+
+  CHECK_EQUAL(12, s_sentCount);
+  for (int panel = 1; panel <= 6; panel++) {
+    char open[8], close[8];
+    snprintf(open, sizeof(open), ":OP%02d", panel);
+    snprintf(close, sizeof(close), ":CL%02d", panel);
+
+    unsigned long openTime = 0, closeTime = 0;
+    CHECK_EQUAL(1, m_sentCount(open, &openTime));
+    CHECK_EQUAL(1, m_sentCount(close, &closeTime));
+    CHECK_EQUAL(1000 + (panel - 1) * 500, openTime - start);
+    CHECK_EQUAL(500, closeTime - openTime);
+  }
+  CHECK_EQUAL(0, s_bodyLength);
+}
+
+TEST(routine_starts_from_a_command)
+{
+  // :CPR1 starts the routine and is cut out of the command. The rest
+  // of the command still goes.
+
+  m_reset();
+  marcduino.sendCommand(":SE01\r:CPR1", DOME_PANEL);
+  m_runFor(5000);
+
+  unsigned long time = 0;
+  CHECK_EQUAL(13, s_sentCount);
+  CHECK(strcmp(s_sent[0].text, ":SE01") == 0);
+  CHECK_EQUAL(0, m_sentCount(":CPR1", &time));
+  CHECK_EQUAL(1, m_sentCount(":OP06", &time));
+  CHECK_EQUAL(1, m_sentCount(":CL06", &time));
+}
+
+TEST(routines_overlap)
+{
+  // A second start half way through runs alongside the first.
+
+  m_reset();
+  marcduino.runAction(aPanelRoutine, 1, 0);
+  m_runFor(2000);
+  marcduino.runAction(aPanelRoutine, 1, 0);
+  m_runFor(5000);
+
+  unsigned long time = 0;
+  CHECK_EQUAL(24, s_sentCount);
+  CHECK_EQUAL(2, m_sentCount(":OP01", &time));
+  CHECK_EQUAL(2, m_sentCount(":CL06", &time));
+}
+
+TEST(unknown_routine_sends_nothing)
+{
+  m_reset();
+  CHECK(marcduino.runActionLater(0, aPanelRoutine, 99, 0));
+  marcduino.runAction(aPanelRoutine, 0, 0);
+  m_runFor(5000);
+
+  CHECK_EQUAL(0, s_domeLength);
+  CHECK_EQUAL(0, s_bodyLength);
+}
+
+TEST(quiet_combo_cancels_routines_and_automation)
+{
+  // ------------------------------------------------------------------
+  // UP is quiet mode. Besides :SE10 it drops the panel routine part way
+  // through, and switches holoprojector automation off, so the dome
+  // goes silent after it.
+  // ------------------------------------------------------------------
+
+  static const Script_Step_Struct script[] = {
+    {   0,  true,  { 127, 127, 127, 127 }, 0 },
+    { 100,  true,  { 127, 127, 127, 127 }, BIT(UP) },
+    { 200,  true,  { 127, 127, 127, 127 }, 0 },
+  };
+
+  m_reset();
+  marcduino.runAction(aHoloAutomationOn, 0, 0);
+  marcduino.runAction(aPanelRoutine, 1, 0);
+  m_runFor(1200);
+
+  unsigned long time = 0;
+  CHECK_EQUAL(1, m_sentCount(":OP01", &time));
+
+  m_play(script, 3, 300);
+  CHECK(strstr(s_dome, ":SE10\r") != NULL);
+
+  m_reset();
+  m_runFor(20000);
+  CHECK_EQUAL(0, s_domeLength);
+}
+
+TEST_MAIN()
@@ -0,0 +1,165 @@
+/* =================================================================================
+ *    B.L.A.C.Box: Brian Lubkeman's Astromech Controller
+ * =================================================================================
+ * test_motion.cpp - Drive ramping, stalls and resets
+ * Created by Brian Lubkeman, 16 June 2021
+ * Inspired by S.H.A.D.O.W. controller code written by KnightShade
+ * Released into the public domain.
+ */
+#include "Test.h"
+#include "../src/driveMotor/MotionProfile.h"
+
+static MotionProfile motion;
+static unsigned long s_time = 0;
+
+// Starts from rest with the given limits, and anchors the profile's clock.
+
+static void m_start(int accel, int decel, int jerk)
+{
+  motion.reset();
+  motion.setLimits(accel, decel, jerk);
+  motion.setEmergencyDecel(0);
+  s_time += 1000;
+  motion.update(s_time);
+}
+
+// Runs the profile at one update per millisecond.
+
+static void m_runFor(unsigned long ms)
+{
+  for (unsigned long i = 0; i < ms; i++) {
+    s_time++;
+    motion.update(s_time);
+  }
+}
+
+TEST(acceleration_sets_the_ramp_time)
+{
+  m_start(1000, 2000, 0);
+  motion.setTarget(1000, -500);
+
+  m_runFor(500);
+  CHECK_EQUAL(500, motion.value(0));
+  CHECK_EQUAL(-500, motion.value(1));
+
+  m_runFor(500);
+  CHECK_EQUAL(1000, motion.value(0));
+  CHECK_EQUAL(-500, motion.value(1));
+  CHECK(motion.settled());
+}
+
+TEST(deceleration_sets_the_stop_time)
+{
+  m_start(1000, 2000, 0);
+  motion.setTarget(1000, 0);
+  m_runFor(1000);
+
+  motion.setTarget(0, 0);
+  m_runFor(250);
+  CHECK_EQUAL(500, motion.value(0));
+  m_runFor(250);
+  CHECK_EQUAL(0, motion.value(0));
+  CHECK(motion.settled());
+}
+
+TEST(jerk_softens_the_start_without_overshoot)
+{
+  m_start(1000, 2000, 4000);
+  motion.setTarget(1000, 0);
+
+  // At 4000 per second squared the rate takes 250 ms to reach 1000.
+
+  m_runFor(100);
+  CHECK(motion.value(0) > 0);
+  CHECK(motion.value(0) < 100);
+
+  int highest = 0;
+  for (int i = 0; i < 3000; i++) {
+    m_runFor(1);
+    highest = max(highest, motion.value(0));
+  }
+  CHECK_EQUAL(1000, highest);
+  CHECK(motion.settled());
+}
+
+TEST(short_gaps_are_caught_up)
+{
+  m_start(1000, 2000, 0);
+  motion.setTarget(1000, 0);
+  m_runFor(100);
+  CHECK_EQUAL(100, motion.value(0));
+
+  // 300 ms is 30 steps, within MOTION_MAX_CATCHUP, so all of it is run.
+
+  s_time += 300;
+  motion.update(s_time);
+  CHECK_EQUAL(400, motion.value(0));
+}
+
+TEST(a_stall_is_dropped)
+{
+  // --------------------------------------------------------------
+  // Two seconds without an update is a stall. The profile takes a
+  // single 10 ms step and carries on from there, rather than
+  // jumping by the whole time missed.
+  // --------------------------------------------------------------
+
+  m_start(1000, 2000, 0);
+  motion.setTarget(1000, 0);
+  m_runFor(200);
+  CHECK_EQUAL(200, motion.value(0));
+
+  s_time += 2000;
+  motion.update(s_time);
+  CHECK_EQUAL(210, motion.value(0));
+
+  m_runFor(100);
+  CHECK_EQUAL(310, motion.value(0));
+}
+
+TEST(reset_starts_from_rest_and_a_fresh_clock)
+{
+  m_start(1000, 2000, 0);
+  motion.setTarget(1000, 1000);
+  m_runFor(300);
+
+  // A controller drop resets the profile. When it returns much
+  // later, the ramp starts over at zero with no catch up.
+
+  motion.reset();
+  CHECK_EQUAL(0, motion.value(0));
+  CHECK(motion.settled());
+
+  s_time += 5000;
+  motion.update(s_time);
+  motion.setTarget(1000, 0);
+  CHECK_EQUAL(0, motion.value(0));
+
+  m_runFor(10);
+  CHECK_EQUAL(10, motion.value(0));
+}
+
+TEST(emergency_stop)
+{
+  // With no emergency rate, stop on the spot.
+
+  m_start(1000, 2000, 0);
+  motion.setTarget(1000, 0);
+  m_runFor(500);
+  motion.emergencyStop();
+  CHECK_EQUAL(0, motion.value(0));
+
+  // With one, ramp down at that rate, ignoring the usual decel.
+
+  m_start(1000, 500, 0);
+  motion.setEmergencyDecel(5000);
+  motion.setTarget(1000, 0);
+  m_runFor(1000);
+  motion.emergencyStop();
+  m_runFor(100);
+  CHECK_EQUAL(500, motion.value(0));
+  m_runFor(100);
+  CHECK_EQUAL(0, motion.value(0));
+}
+
+TEST_MAIN()
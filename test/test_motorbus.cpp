@@ -0,0 +1,131 @@
+/* =================================================================================
+ *    B.L.A.C.Box: Brian Lubkeman's Astromech Controller
+ * =================================================================================
+ * test_motorbus.cpp - Packet coalescing and priority on the shared motor bus
+ * Created by Brian Lubkeman, 16 June 2021
+ * Inspired by S.H.A.D.O.W. controller code written by KnightShade
+ * Released into the public domain.
+ */
+#include "Test.h"
+#include "../src/hal/MotorBus.h"
+#include <Sabertooth.h>
+
+static byte s_sent[64];
+static size_t s_sentLength = 0;
+
+static void m_capture(const byte* buffer, size_t length)
+{
+  for (size_t i = 0; i < length && s_sentLength < sizeof(s_sent); i++) {
+    s_sent[s_sentLength++] = buffer[i];
+  }
+}
+
+static byte s_buffer[64];
+static MotorBus bus(Serial2, s_buffer, sizeof(s_buffer));
+static Sabertooth drive(128, bus);
+static Sabertooth dome(129, bus);
+
+static void m_reset(void)
+{
+  bus.drain();
+  s_sentLength = 0;
+  Serial2.onTransmit(m_capture);
+}
+
+// The command byte of the n'th packet sent.
+static byte m_command(size_t n)   { return s_sent[(n * 4) + 1]; }
+static byte m_address(size_t n)   { return s_sent[n * 4]; }
+static byte m_value(size_t n)     { return s_sent[(n * 4) + 2]; }
+
+TEST(forward_and_reverse_coalesce)
+{
+  m_reset();
+  unsigned long before = bus.coalesced();
+
+  drive.drive(40);     // Command 8.
+  drive.drive(-30);    // Command 9 replaces it.
+  drive.turn(20);      // Command 10.
+  drive.turn(-10);     // Command 11 replaces it.
+  bus.drain();
+
+  CHECK_EQUAL(8, s_sentLength);
+  CHECK_EQUAL(9, m_command(0));
+  CHECK_EQUAL(30, m_value(0));
+  CHECK_EQUAL(11, m_command(1));
+  CHECK_EQUAL(2, bus.coalesced() - before);
+}
+
+TEST(motor_channels_coalesce_apart)
+{
+  m_reset();
+
+  drive.motor(1, 50);  // Command 0.
+  drive.motor(2, 50);  // Command 4.
+  drive.motor(1, -5);  // Command 1 replaces motor 1 only.
+  bus.drain();
+
+  CHECK_EQUAL(8, s_sentLength);
+  CHECK_EQUAL(1, m_command(0));
+  CHECK_EQUAL(4, m_command(1));
+}
+
+TEST(settings_never_coalesce)
+{
+  m_reset();
+
+  drive.command(2, 30);   // Minimum voltage.
+  drive.command(3, 40);   // Maximum voltage.
+  drive.command(6, 64);   // 7-bit motor 1.
+  drive.command(7, 64);   // 7-bit motor 2.
+  bus.drain();
+
+  // Pending packets go out in turn, not in the order written.
+
+  CHECK_EQUAL(16, s_sentLength);
+  unsigned int seen = 0;
+  for (size_t i = 0; i < 4; i++) {
+    seen |= (1 << m_command(i));
+  }
+  CHECK_EQUAL((1 << 2) | (1 << 3) | (1 << 6) | (1 << 7), seen);
+}
+
+TEST(addresses_never_coalesce)
+{
+  m_reset();
+
+  drive.motor(1, 20);
+  dome.motor(1, 20);
+  bus.drain();
+
+  CHECK_EQUAL(8, s_sentLength);
+  CHECK_EQUAL(128, m_address(0));
+  CHECK_EQUAL(129, m_address(1));
+}
+
+TEST(stop_goes_first)
+{
+  m_reset();
+
+  dome.motor(1, 60);
+  drive.drive(0);
+  bus.drain();
+
+  CHECK_EQUAL(8, s_sentLength);
+  CHECK_EQUAL(128, m_address(0));
+  CHECK_EQUAL(0, m_value(0));
+  CHECK_EQUAL(129, m_address(1));
+}
+
+TEST(bad_checksum_passes_through)
+{
+  m_reset();
+
+  const byte junk[] = { 130, 8, 20, 0 };
+  bus.write(junk, sizeof(junk));
+  bus.drain();
+
+  CHECK_EQUAL(4, s_sentLength);
+  CHECK_EQUAL(0, s_sent[3]);
+}
+
+TEST_MAIN()
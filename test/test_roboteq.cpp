@@ -0,0 +1,480 @@
+/* =================================================================================
+ *    B.L.A.C.Box: Brian Lubkeman's Astromech Controller
+ * =================================================================================
+ * test_roboteq.cpp - Roboteq mixer, commands and replies
+ * Created by Brian Lubkeman, 16 June 2021
+ * Inspired by S.H.A.D.O.W. controller code written by KnightShade
+ * Released into the public domain.
+ */
+#include "Test.h"
+#include "../Settings.h"
+#include "../src/driveMotor/DriveMotor.h"
+
+#include <string.h>
+
+#define SECTION(name, defaults) Config_Section name(&config, defaults, sizeof(defaults) / sizeof(defaults[0]))
+
+Config config(CONFIG_VERSION);
+SECTION(cfgController, controllerSettings);
+SECTION(cfgControllerTimings, controllerTimings);
+SECTION(cfgDrive, driveMotorSettings);
+SECTION(cfgDriveMotion, driveMotionSettings);
+SECTION(cfgDrivePins, driveMotorPins);
+SECTION(cfgRoboteq, roboteqSettings);
+
+byte motorBuffer[128];
+SerialQueue motorQueue(Serial2, motorBuffer, sizeof(motorBuffer));
+SerialQueue &DriveMotor_Serial = motorQueue;
+
+Controller_Script controller(&cfgController, &cfgControllerTimings);
+
+// Reaches the protected parts of the driver.
+
+class Roboteq_Probe : public DriveMotor_Roboteq
+{
+  public:
+    Roboteq_Probe(void) : DriveMotor_Roboteq(&controller, &cfgDrive, &cfgDrivePins, &cfgDriveMotion, &cfgRoboteq) {}
+
+    void mix(byte throttle, byte steering)  { m_mixBHD(throttle, steering); }
+    int left(void)                          { return m_input1; }
+    int right(void)                         { return m_input2; }
+
+    void drive(int throttle, int steering)  { m_throttle = throttle; m_steering = steering; m_drive(); }
+    void service(void)                      { m_serviceLink(); }
+    bool linkUp(void)                       { return m_linkUp; }
+    bool derated(void)                      { return m_derated; }
+};
+
+static Roboteq_Probe roboteq;
+
+/* ================================================================================
+ *                                      Mixer
+ * ================================================================================ */
+
+// ------------------------------------------------------------------------
+// The float mixer the integer one replaced, as it stood, dead zone mapping,
+// centre handling and all. Only the member reads are now arguments.
+// ------------------------------------------------------------------------
+
+static void m_floatMix(byte throttle, byte steering, const Joystick* stick, int* input1, int* input2)
+{
+  const int servoMin = 0;
+  const int servoCenter = 90;
+  const int servoMax = 180;
+
+  if ( steering == stick->center && throttle == stick->center ) {
+    *input1 = servoCenter;
+    *input2 = servoCenter;
+    return;
+  }
+
+  int xInt = 0;
+  int yInt = 0;
+
+  if (throttle < stick->center) {
+    yInt = map(throttle, stick->minValue, (stick->center - stick->deadZone), 100, 1);
+  } else {
+    yInt = map(throttle, (stick->center + stick->deadZone), stick->maxValue, -1, -100);
+  }
+
+  if (steering < stick->center) {
+    xInt = map(steering, stick->minValue, (stick->center - stick->deadZone), -100, -1);
+  } else {
+    xInt = map(steering, (stick->center + stick->deadZone), stick->maxValue, 1, 100);
+  }
+
+  float xFloat = xInt;
+  float yFloat = yInt;
+
+  if ( yInt > (xInt + 100) ) {
+    xFloat = -100 / (1 - (yFloat / xFloat));
+    yFloat = xFloat + 100;
+  } else if ( yInt > (100 - xInt) ) {
+    xFloat = -100 / (-1 - (yFloat / xFloat));
+    yFloat = -xFloat + 100;
+  } else if (yInt < (-xInt - 100)) {
+    xFloat = 100 / (-1 - (yFloat / xFloat));
+    yFloat = -xFloat - 100;
+  } else if (yInt < (xInt - 100)) {
+    xFloat = 100 / (1 - (yFloat / xFloat));
+    yFloat = xFloat - 100;
+  }
+
+  float leftSpeed = ((xFloat + yFloat - 100) / 2) + 100;
+  leftSpeed = (leftSpeed - 50) * 2;
+
+  float rightSpeed = ((yFloat - xFloat - 100) / 2) + 100;
+  rightSpeed = (rightSpeed - 50) * 2;
+
+  *input1 = map(leftSpeed, -100, 100, servoMax, servoMin);
+  *input2 = map(rightSpeed, -100, 100, servoMax, servoMin);
+}
+
+TEST(mixer_matches_float_for_every_stick_position)
+{
+  // ---------------------------------------------------------------
+  // Every throttle and steering byte, at every dead zone from none
+  // to far past any sensible setting. The servo output must be
+  // identical to the float mixer's, everywhere.
+  // ---------------------------------------------------------------
+
+  long differ = 0;
+
+  for (int deadZone = 0; deadZone <= 60; deadZone++) {
+    cfgController.set(iDeadZone, deadZone);
+    controller.applySettings();
+    CHECK_EQUAL(deadZone, controller.driveStick.deadZone);
+
+    for (int throttle = 0; throttle < 256; throttle++) {
+      for (int steering = 0; steering < 256; steering++) {
+        int expectLeft;
+        int expectRight;
+        m_floatMix(throttle, steering, &controller.driveStick, &expectLeft, &expectRight);
+
+        roboteq.mix(throttle, steering);
+        if ( roboteq.left() != expectLeft || roboteq.right() != expectRight ) {
+          if ( differ < 5 ) {
+            printf("  dead zone %d, throttle %d, steering %d: %d,%d against %d,%d\n",
+                   deadZone, throttle, steering, roboteq.left(), roboteq.right(), expectLeft, expectRight);
+          }
+          differ++;
+        }
+      }
+    }
+  }
+
+  cfgController.set(iDeadZone, cfgController.getDefault(iDeadZone));
+  controller.applySettings();
+  CHECK_EQUAL(0, differ);
+}
+
+TEST(mixer_corners)
+{
+  // ----------------------------------------------------------------
+  // The float mixer maps a centered axis through the dead zone, so it
+  // lands a little off zero when only the other axis moves. The exact
+  // values are checked above. Here, only the directions.
+  // ----------------------------------------------------------------
+
+  roboteq.mix(127, 127);
+  CHECK_EQUAL(90, roboteq.left());
+  CHECK_EQUAL(90, roboteq.right());
+
+  roboteq.mix(0, 127);        // Full ahead.
+  CHECK(roboteq.left() < 10);
+  CHECK(roboteq.right() < 10);
+
+  roboteq.mix(255, 127);      // Full back.
+  CHECK(roboteq.left() > 170);
+  CHECK(roboteq.right() > 170);
+
+  roboteq.mix(127, 255);      // Spin right.
+  CHECK(roboteq.left() < 10);
+  CHECK(roboteq.right() > 170);
+}
+
+/* ================================================================================
+ *                                  Fake Roboteq
+ * ================================================================================ */
+
+// ---------------------------------------------------------------------------
+// Stands in for the Roboteq on Serial2. It splits what the sketch sends into
+// commands at '_' and '\r', keeps each with the time it arrived, and answers
+// the way the Roboteq does: the line is echoed, each ! command draws a "+",
+// and each ? query draws its reading.
+// ---------------------------------------------------------------------------
+
+typedef struct {
+  unsigned long time;
+  char text[16];
+} Fake_Command_Struct;
+
+const int FAKE_MAX_COMMANDS = 256;
+
+static Fake_Command_Struct s_commands[FAKE_MAX_COMMANDS];
+static int s_commandCount = 0;
+static char s_line[32];
+static size_t s_lineLength = 0;
+static bool s_answering = true;
+
+static void m_reply(const char* text)
+{
+  Serial2.inject((const byte*)text, strlen(text));
+}
+
+static void m_fakeCommand(const char* text, size_t length)
+{
+  if ( length == 0 || s_commandCount >= FAKE_MAX_COMMANDS ) {
+    return;
+  }
+  Fake_Command_Struct* command = &s_commands[s_commandCount++];
+  command->time = Hal_Clock::millis();
+  snprintf(command->text, sizeof(command->text), "%.*s", (int)length, text);
+
+  if ( ! s_answering ) {
+    return;
+  }
+  if ( text[0] == '!' )                       { m_reply("+\r"); }
+  else if ( strcmp(command->text, "?A") == 0 )  { m_reply("A=12:13\r"); }
+  else if ( strcmp(command->text, "?V") == 0 )  { m_reply("V=120:240:5000\r"); }
+  else if ( strcmp(command->text, "?T") == 0 )  { m_reply("T=30:31:32\r"); }
+  else if ( strcmp(command->text, "?FF") == 0 ) { m_reply("FF=0\r"); }
+}
+
+static void m_fakeReceive(const byte* buffer, size_t length)
+{
+  for (size_t i = 0; i < length; i++) {
+    if ( buffer[i] != '\r' ) {
+      if ( s_lineLength < sizeof(s_line) - 1 ) {
+        s_line[s_lineLength++] = buffer[i];
+      }
+      continue;
+    }
+
+    s_line[s_lineLength] = '\0';
+    if ( s_answering ) {
+      m_reply(s_line);
+      m_reply("\r");
+    }
+
+    size_t start = 0;
+    for (size_t j = 0; j <= s_lineLength; j++) {
+      if ( s_line[j] == '_' || s_line[j] == '\0' ) {
+        m_fakeCommand(&s_line[start], j - start);
+        start = j + 1;
+      }
+    }
+    s_lineLength = 0;
+  }
+}
+
+// Starts the driver in RS232 mode once, then clears the fake's log and lets
+// a second go by, so every test starts with the previous output long sent.
+
+static void m_fakeReset(void)
+{
+  static bool started = false;
+  if ( ! started ) {
+    cfgRoboteq.set(iCommMode, 1);    // RS232
+    Serial2.onTransmit(m_fakeReceive);
+    roboteq.begin();
+    started = true;
+  }
+  Hal_Clock::advance(1000000);
+  roboteq.service();
+  motorQueue.drain();
+  s_commandCount = 0;
+  s_lineLength = 0;
+  s_answering = true;
+}
+
+// One 1 ms pass of the sketch, as far as the drive link goes.
+
+static void m_pass(int throttle, int steering)
+{
+  roboteq.service();
+  if ( throttle == 127 && steering == 127 ) {
+    roboteq.stop();
+  } else {
+    roboteq.drive(throttle, steering);
+  }
+  motorQueue.drain();
+  Hal_Clock::advance(1000);
+}
+
+static int m_countCommands(const char* prefix)
+{
+  int count = 0;
+  for (int i = 0; i < s_commandCount; i++) {
+    count += ( strncmp(s_commands[i].text, prefix, strlen(prefix)) == 0 ? 1 : 0 );
+  }
+  return count;
+}
+
+TEST(go_command_scales_to_roboteq_range)
+{
+  m_fakeReset();
+
+  m_pass(0, 127);             // Full throttle, no steering.
+
+  CHECK_EQUAL(2, m_countCommands("!G"));
+  CHECK_EQUAL(1, m_countCommands("!G 1 -1000"));
+  CHECK_EQUAL(1, m_countCommands("!G 2 0"));
+}
+
+TEST(steady_stick_resends_once_per_keep_alive)
+{
+  // ---------------------------------------------------------------
+  // A held stick is resent every iDriveRefresh and by nothing else,
+  // so the gaps between !G commands are all exactly that long.
+  // ---------------------------------------------------------------
+
+  m_fakeReset();
+  unsigned long refresh = cfgDrive.get(iDriveRefresh);
+
+  for (int i = 0; i < 1000; i++) {
+    m_pass(60, 127);
+  }
+
+  unsigned long previous = 0;
+  int sends = 0;
+  for (int i = 0; i < s_commandCount; i++) {
+    if ( strncmp(s_commands[i].text, "!G 1", 4) != 0 ) {
+      continue;
+    }
+    if ( sends > 0 ) {
+      CHECK_EQUAL(refresh, s_commands[i].time - previous);
+    }
+    previous = s_commands[i].time;
+    sends++;
+  }
+
+  CHECK_EQUAL(1000 / refresh, sends);
+  CHECK_EQUAL(sends, m_countCommands("!G 2"));
+}
+
+TEST(stop_is_sent_once)
+{
+  m_fakeReset();
+
+  m_pass(60, 127);
+  for (int i = 0; i < 1000; i++) {
+    m_pass(127, 127);
+  }
+
+  CHECK_EQUAL(1, m_countCommands("!MS 1"));
+  CHECK_EQUAL(1, m_countCommands("!MS 2"));
+  CHECK(m_countCommands("?") >= 9);
+}
+
+TEST(replies_keep_link_up_and_fill_telemetry)
+{
+  m_fakeReset();
+
+  for (int i = 0; i < 500; i++) {
+    m_pass(127, 127);
+  }
+
+  CHECK(roboteq.linkUp());
+  CHECK_EQUAL(12, roboteq.telemetry()->motorAmps[0]);
+  CHECK_EQUAL(13, roboteq.telemetry()->motorAmps[1]);
+  CHECK_EQUAL(240, roboteq.telemetry()->batteryVolts);
+  CHECK_EQUAL(31, roboteq.telemetry()->temperature[1]);
+  CHECK_EQUAL(0, roboteq.telemetry()->faultFlags);
+}
+
+/* ================================================================================
+ *                                  Reply Stream
+ * ================================================================================ */
+
+// Hands the driver a recorded reply stream, as the bytes would arrive.
+
+static void m_replay(const char* stream)
+{
+  s_answering = false;
+  Serial2.inject((const byte*)stream, strlen(stream));
+  roboteq.service();
+  motorQueue.drain();
+}
+
+TEST(replay_echo_and_acknowledgements)
+{
+  m_fakeReset();
+  m_replay("!G 1 100_!G 2 0\r+\r+\r-\r");
+
+  CHECK(roboteq.linkUp());
+  CHECK_EQUAL(12, roboteq.telemetry()->motorAmps[0]);
+}
+
+TEST(replay_line_split_across_reads)
+{
+  m_fakeReset();
+
+  m_replay("A=3");
+  CHECK_EQUAL(12, roboteq.telemetry()->motorAmps[0]);
+  m_replay("4:-5");
+  m_replay("6\rT=40:41");
+  CHECK_EQUAL(34, roboteq.telemetry()->motorAmps[0]);
+  CHECK_EQUAL(-56, roboteq.telemetry()->motorAmps[1]);
+  m_replay(":42\r");
+  CHECK_EQUAL(41, roboteq.telemetry()->temperature[1]);
+}
+
+TEST(replay_overlong_line_is_dropped)
+{
+  // ---------------------------------------------------------------
+  // 30 characters will not fit the 24 byte buffer. Cut short, the
+  // line would read as A=1234567890... Dropped, it changes nothing,
+  // and the next line parses as usual.
+  // ---------------------------------------------------------------
+
+  m_fakeReset();
+  m_replay("A=12:13\rV=120:240\r");
+
+  m_replay("A=1234567890123456789012345:9\rV=120:250\r");
+  CHECK_EQUAL(12, roboteq.telemetry()->motorAmps[0]);
+  CHECK_EQUAL(13, roboteq.telemetry()->motorAmps[1]);
+  CHECK_EQUAL(250, roboteq.telemetry()->batteryVolts);
+
+  // Exactly 23 characters still fit.
+
+  m_replay("A=9999999999999999999:7\r");
+  CHECK_EQUAL(32767, roboteq.telemetry()->motorAmps[0]);
+  CHECK_EQUAL(7, roboteq.telemetry()->motorAmps[1]);
+
+  m_replay("A=12:13\r");
+}
+
+TEST(replay_unknown_and_empty_lines_are_ignored)
+{
+  m_fakeReset();
+
+  m_replay("\r\rZZ=5\rA=\rFF\r?A\r");
+  CHECK_EQUAL(12, roboteq.telemetry()->motorAmps[0]);
+  CHECK_EQUAL(0, roboteq.telemetry()->faultFlags);
+}
+
+TEST(lost_link_stops_and_derates)
+{
+  // ----------------------------------------------------------
+  // The Roboteq goes quiet while the stick is held. The drive
+  // must stop and derate, and send no !G until it answers.
+  // ----------------------------------------------------------
+
+  m_fakeReset();
+  m_pass(60, 127);
+  CHECK(roboteq.linkUp());
+  CHECK(! roboteq.derated());
+
+  s_answering = false;
+  for (int i = 0; i < 1500; i++) {
+    m_pass(60, 127);
+  }
+
+  CHECK(! roboteq.linkUp());
+  CHECK(roboteq.derated());
+  CHECK_EQUAL(1, m_countCommands("!MS 1"));
+
+  int lastGo = -1;
+  int stopAt = -1;
+  for (int i = 0; i < s_commandCount; i++) {
+    if ( strncmp(s_commands[i].text, "!G", 2) == 0 ) { lastGo = i; }
+    if ( strncmp(s_commands[i].text, "!MS", 3) == 0 && stopAt < 0 ) { stopAt = i; }
+  }
+  CHECK(stopAt > lastGo);
+
+  // It answers again. Driving resumes and the derate clears
+  // once fresh telemetry is in.
+
+  s_answering = true;
+  s_commandCount = 0;
+  for (int i = 0; i < 1000; i++) {
+    m_pass(60, 127);
+  }
+
+  CHECK(roboteq.linkUp());
+  CHECK(! roboteq.derated());
+  CHECK(m_countCommands("!G 1") > 0);
+}
+
+TEST_MAIN()
@@ -0,0 +1,394 @@
+/* =================================================================================
+ *    B.L.A.C.Box: Brian Lubkeman's Astromech Controller
+ * =================================================================================
+ * test_sabertooth.cpp - Sabertooth drive packets, checked by a fake Sabertooth
+ * Created by Brian Lubkeman, 16 June 2021
+ * Inspired by S.H.A.D.O.W. controller code written by KnightShade
+ * Released into the public domain.
+ */
+#include "Test.h"
+#include "../Settings.h"
+#include "../src/driveMotor/DriveMotor.h"
+
+#define SECTION(name, defaults) Config_Section name(&config, defaults, sizeof(defaults) / sizeof(defaults[0]))
+
+Config config(CONFIG_VERSION);
+SECTION(cfgController, controllerSettings);
+SECTION(cfgControllerTimings, controllerTimings);
+SECTION(cfgDrive, driveMotorSettings);
+SECTION(cfgDriveMotion, driveMotionSettings);
+SECTION(cfgDrivePins, driveMotorPins);
+SECTION(cfgSabertooth, sabertoothSettings);
+
+byte motorBuffer[128];
+SerialQueue motorQueue(Serial2, motorBuffer, sizeof(motorBuffer));
+SerialQueue &DriveMotor_Serial = motorQueue;
+
+Controller_Script controller(&cfgController, &cfgControllerTimings);
+
+// Reaches the protected parts of the driver.
+
+class Sabertooth_Probe : public DriveMotor_Sabertooth
+{
+  public:
+    Sabertooth_Probe(void) : DriveMotor_Sabertooth(&controller, &cfgDrive, &cfgDrivePins, &cfgDriveMotion, &cfgSabertooth) {}
+
+    void drive(int throttle, int steering)  { m_throttle = throttle; m_steering = steering; m_drive(); }
+    void profile(byte profile)              { speedProfile = profile; }
+};
+
+static Sabertooth_Probe sabertooth;
+
+/* ================================================================================
+ *                                 Fake Sabertooth
+ * ================================================================================ */
+
+// -------------------------------------------------------------------------
+// Decodes what goes out on Serial2 the way a Sabertooth in packetized serial
+// mode does. A packet is an address (128-135), a command, a value and a
+// checksum of the three, all but the address under 128. A byte of 128 or
+// more always starts a new packet. Only packets with a good checksum count.
+// The fake keeps mixed mode drive and turn, and its own serial timeout.
+// -------------------------------------------------------------------------
+
+typedef struct {
+  unsigned long time;
+  byte address;
+  byte command;
+  byte value;
+} Fake_Packet_Struct;
+
+const int FAKE_MAX_PACKETS = 512;
+
+static Fake_Packet_Struct s_packets[FAKE_MAX_PACKETS];
+static int s_packetCount = 0;
+static int s_badPackets = 0;
+static byte s_partial[4];
+static byte s_partialLength = 0;
+
+static int s_drive = 0;
+static int s_turn = 0;
+static unsigned long s_timeout = 0;
+static unsigned long s_lastGood = 0;
+static bool s_timedOut = false;
+
+static void m_fakePacket(const byte* packet)
+{
+  if ( ((packet[0] + packet[1] + packet[2]) & 0x7F) != packet[3] ) {
+    s_badPackets++;
+    return;
+  }
+
+  if ( s_packetCount < FAKE_MAX_PACKETS ) {
+    Fake_Packet_Struct* p = &s_packets[s_packetCount++];
+    p->time = Hal_Clock::millis();
+    p->address = packet[0];
+    p->command = packet[1];
+    p->value = packet[2];
+  }
+  s_lastGood = Hal_Clock::millis();
+
+  switch (packet[1]) {
+    case 8  : { s_drive = packet[2];  break; }
+    case 9  : { s_drive = -packet[2]; break; }
+    case 10 : { s_turn = packet[2];   break; }
+    case 11 : { s_turn = -packet[2]; break; }
+    case 14 : { s_timeout = (unsigned long)packet[2] * 100; break; }
+  }
+}
+
+static void m_fakeReceive(const byte* buffer, size_t length)
+{
+  for (size_t i = 0; i < length; i++) {
+    if ( buffer[i] >= 128 ) {
+      s_partialLength = 0;
+    } else if ( s_partialLength == 0 ) {
+      s_badPackets++;
+      continue;
+    }
+    s_partial[s_partialLength++] = buffer[i];
+    if ( s_partialLength == 4 ) {
+      m_fakePacket(s_partial);
+      s_partialLength = 0;
+    }
+  }
+}
+
+// The Sabertooth's own watchdog. Once it trips, it stays stopped until the
+// next good packet.
+
+static void m_fakeWatchdog(void)
+{
+  if ( s_timeout > 0 && (Hal_Clock::millis() - s_lastGood) > s_timeout ) {
+    s_timedOut = true;
+  }
+}
+
+static int m_count(byte command)
+{
+  int count = 0;
+  for (int i = 0; i < s_packetCount; i++) {
+    count += ( s_packets[i].command == command ? 1 : 0 );
+  }
+  return count;
+}
+
+// Starts the driver once, then clears the fake's log and lets a second go by.
+
+static void m_reset(void)
+{
+  static bool started = false;
+  if ( ! started ) {
+    Serial2.onTransmit(m_fakeReceive);
+    sabertooth.begin();
+    started = true;
+  }
+  motorQueue.drain();
+  Hal_Clock::advance(1000000);
+  s_packetCount = 0;
+  s_badPackets = 0;
+  s_timedOut = false;
+  s_lastGood = Hal_Clock::millis();
+}
+
+// One 1 ms pass of the sketch, as far as the drive goes.
+
+static void m_pass(int throttle, int steering)
+{
+  if ( throttle == 127 && steering == 127 ) {
+    sabertooth.stop();
+  } else {
+    sabertooth.drive(throttle, steering);
+  }
+  motorQueue.drain();
+  m_fakeWatchdog();
+  Hal_Clock::advance(1000);
+}
+
+/* ================================================================================
+ *                                      Tests
+ * ================================================================================ */
+
+TEST(begin_sets_timeout_and_zeroes_mixed_mode)
+{
+  // The log is cleared after begin(), so read back the state it left.
+
+  m_reset();
+
+  CHECK_EQUAL(0, s_badPackets);
+  CHECK_EQUAL(cfgSabertooth.get(iSerialTimeout), s_timeout);
+  CHECK_EQUAL(0, s_drive);
+  CHECK_EQUAL(0, s_turn);
+}
+
+TEST(each_speed_profile_has_its_top_speed)
+{
+  const byte profiles[4] = { WALK, JOG, RUN, SPRINT };
+
+  for (byte i = 0; i < 4; i++) {
+    m_reset();
+    sabertooth.profile(profiles[i]);
+    m_pass(255, 127);
+    CHECK_EQUAL(cfgSabertooth.get(iWalkSpeed + i), abs(s_drive));
+    CHECK_EQUAL(0, s_turn);
+    m_pass(127, 127);
+  }
+  sabertooth.profile(WALK);
+  CHECK_EQUAL(0, s_badPackets);
+}
+
+TEST(turn_narrows_with_speed)
+{
+  m_reset();
+
+  m_pass(127, 255);           // Spin in place.
+  CHECK_EQUAL(cfgSabertooth.get(iTurnSpeed), abs(s_turn));
+
+  for (int i = 0; i < 30; i++) {
+    m_pass(255, 255);         // Full speed, full turn.
+  }
+  // At full speed (127) only a quarter of the turn would be left. Walk
+  // is slower, so it keeps more.
+
+  long turnSpeed = cfgSabertooth.get(iTurnSpeed);
+  long walkSpeed = cfgSabertooth.get(iWalkSpeed);
+  CHECK_EQUAL(turnSpeed - ((turnSpeed * 3 * walkSpeed) / (4 * 127)), abs(s_turn));
+  m_pass(127, 127);
+}
+
+TEST(only_changed_values_are_sent)
+{
+  m_reset();
+
+  m_pass(255, 127);
+  int before = s_packetCount;
+
+  // A turn alone, after the serial latency, sends only a turn packet.
+
+  for (int i = 0; i < 30; i++) {
+    m_pass(255, 200);
+  }
+  CHECK_EQUAL(1, s_packetCount - before);
+  CHECK(s_packets[s_packetCount - 1].command == 10 || s_packets[s_packetCount - 1].command == 11);
+  m_pass(127, 127);
+}
+
+TEST(steady_hold_is_kept_alive_inside_the_timeout)
+{
+  // ------------------------------------------------------------------
+  // A held stick resends both values every iDriveRefresh. The gap
+  // between good packets never reaches the Sabertooth's own timeout.
+  // ------------------------------------------------------------------
+
+  m_reset();
+
+  for (int i = 0; i < 2000; i++) {
+    m_pass(200, 150);
+  }
+
+  CHECK(! s_timedOut);
+  CHECK_EQUAL(0, s_badPackets);
+
+  unsigned long worst = 0;
+  for (int i = 1; i < s_packetCount; i++) {
+    worst = max(worst, s_packets[i].time - s_packets[i - 1].time);
+  }
+  CHECK(worst <= (unsigned long)cfgDrive.get(iDriveRefresh));
+  CHECK(worst < s_timeout);
+  CHECK(m_count(8) + m_count(9) >= 2000 / cfgDrive.get(iDriveRefresh));
+  m_pass(127, 127);
+}
+
+TEST(stop_sends_zero_drive_and_turn_once)
+{
+  m_reset();
+
+  m_pass(255, 200);
+  int before = s_packetCount;
+  for (int i = 0; i < 100; i++) {
+    m_pass(127, 127);
+  }
+
+  CHECK_EQUAL(2, s_packetCount - before);
+  CHECK_EQUAL(0, s_drive);
+  CHECK_EQUAL(0, s_turn);
+}
+
+TEST(timeout_trips_when_the_sketch_goes_quiet)
+{
+  m_reset();
+
+  m_pass(200, 127);
+  for (int i = 0; i < 600; i++) {
+    m_fakeWatchdog();
+    Hal_Clock::advance(1000);
+  }
+  CHECK(s_timedOut);
+  m_pass(127, 127);
+}
+
+TEST(reconnect_starts_from_rest)
+{
+  // -----------------------------------------------------------------
+  // Full stick, then the controller drops out and comes back with the
+  // stick centred. The sketch's disconnect handler stops the motors
+  // and restarts the ramp, so nothing but zero is sent after the
+  // reconnect. Before, the ramp picked up at its old speed.
+  // -----------------------------------------------------------------
+
+  static const Script_Step_Struct script[] = {
+    {    0,  true,  { 127,   0, 127, 127 }, 0 },
+    { 3000,  false, { 127,   0, 127, 127 }, 0 },
+    { 5000,  true,  { 127, 127, 127, 127 }, 0 },
+  };
+
+  m_reset();
+  controller.begin();
+  controller.play(script, 3);
+  unsigned long start = Hal_Clock::millis();
+
+  // Each pass as the scheduler runs it: read once, hand a lost
+  // controller to the disconnect handler, and only run the task on
+  // good input.
+
+  int topSpeed = 0;
+  for (int i = 0; i < 6000; i++) {
+    bool inputValid = controller.read();
+    if ( controller.disconnectEvent() ) {
+      sabertooth.disconnect();
+    }
+    if ( inputValid ) {
+      sabertooth.interpretController(controller.frame());
+    }
+    motorQueue.drain();
+    Hal_Clock::advance(1000);
+
+    if ( Hal_Clock::millis() - start < 3000 ) {
+      topSpeed = max(topSpeed, abs(s_drive));
+    }
+  }
+
+  CHECK(topSpeed > 0);
+  for (int i = 0; i < s_packetCount; i++) {
+    if ( s_packets[i].time - start >= 5000 ) {
+      CHECK_EQUAL(0, s_packets[i].value);
+    }
+  }
+  CHECK_EQUAL(0, s_drive);
+  CHECK_EQUAL(0, s_turn);
+}
+
+TEST(dead_man_switch_drives_its_own_pin)
+{
+  // ----------------------------------------------------------------
+  // With the dead-man switch on, holding R2 raises the dead-man pin
+  // and letting go lowers it. Drive pin #2 is left alone; it was the
+  // one written when the pin was looked up by the wrong index.
+  // ----------------------------------------------------------------
+
+  static const Script_Step_Struct script[] = {
+    {   0,  true,  { 127, 127, 127, 127 }, (uint32_t)1 << R2 },
+    { 100,  true,  { 127, 127, 127, 127 }, 0 },
+  };
+
+  m_reset();
+  cfgDrive.set(iDeadMan, 1);
+  byte deadManPin = cfgDrivePins.get(iDeadManPin);
+  byte drivePin2 = cfgDrivePins.get(iDrivePin2);
+  Hal_Pin::write(drivePin2, 0);
+
+  controller.play(script, 2);
+  unsigned long start = Hal_Clock::millis();
+  bool heldHigh = true;
+  while ( Hal_Clock::millis() - start < 200 ) {
+    if ( controller.read() ) {
+      sabertooth.interpretController(controller.frame());
+    }
+    motorQueue.drain();
+    if ( Hal_Clock::millis() - start < 100 ) {
+      heldHigh = heldHigh && ( Hal_Pin::read(deadManPin) == HIGH );
+    }
+    Hal_Clock::advance(1000);
+  }
+
+  CHECK(heldHigh);
+  CHECK_EQUAL(LOW, Hal_Pin::read(deadManPin));
+  CHECK_EQUAL(0, Hal_Pin::read(drivePin2));
+
+  config.restoreDefaults();
+}
+
+TEST(decoder_rejects_a_bad_checksum)
+{
+  m_reset();
+
+  const byte junk[] = { 128, 8, 20, 0, 5, 128, 8, 20, 28 };
+  DriveMotor_Serial.write(junk, sizeof(junk));
+  motorQueue.drain();
+
+  CHECK_EQUAL(2, s_badPackets);
+  CHECK_EQUAL(1, s_packetCount);
+  CHECK_EQUAL(20, s_drive);
+}
+
+TEST_MAIN()